@@ -70,6 +70,7 @@
  */
 #include "ookLibs/ookApp/ookApplication.h"
 #include "ookLibs/ookUtil/ookString.h"
+#include "ookLibs/ookThread/ookLockGuard.h"
 
 
 #ifdef __GNUC__
@@ -207,14 +208,26 @@ void ookApplication::AppMain()
 /*! 
  \brief Returns the specified configuration value.
  
+ The configuration is read far more often than it is written, so readers
+ share an ookSharedMutex and any thread may call this.
+ 
  \param key	The key correspoinding to a configuration value.
  
- \return The requested configuration value.
+ \return The requested configuration value, or an empty string if the key
+ is not set.
 
  */
 string ookApplication::GetConfigValue(string key)
 {
-	return _appConfigVals[key];
+	OOK_LOCK_SITE(getSite, "app config get");
+	ookSharedLockGuard<ookSharedMutex> lock(_configMut, &getSite);
+	
+	StringMapIterator it = _appConfigVals.find(key);
+	
+	if(it == _appConfigVals.end())
+		return "";
+	
+	return it->second;
 }
 
 /*! 
@@ -229,6 +242,9 @@ string ookApplication::GetConfigValue(string key)
  */
 void ookApplication::SetConfigValue(string key, string value)
 {
+	OOK_LOCK_SITE(setSite, "app config set");
+	ookLockGuard<ookSharedMutex> lock(_configMut, &setSite);
+	
 	_appConfigVals[key] = value;
 }
 
@@ -241,6 +257,7 @@ void ookApplication::SetConfigValue(string key, string value)
 vector<string> ookApplication::GetConfigKeys()
 {
 	vector<string> key_list;
+	ookSharedLockGuard<ookSharedMutex> lock(_configMut);
 	
 	for(StringMapIterator it = _appConfigVals.begin(); it != _appConfigVals.end(); ++it) 
     key_list.push_back(it->first);
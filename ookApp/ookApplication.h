@@ -32,6 +32,7 @@
 #define OOK_APPLICATION_H_
 
 #include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookSharedMutex.h"
 
 class ookApplication
 {
@@ -56,6 +57,7 @@ private:
 	const char** _argv;
 	
 	StringMap _appConfigVals;
+	ookSharedMutex _configMut;
 };
 
 #endif
\ No newline at end of file
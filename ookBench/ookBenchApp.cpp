@@ -0,0 +1,100 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookBenchApp
+ \headerfile ookBenchApp.h "ookLibs/ookBench/ookBenchApp.h"
+ \brief Base for the benchmark front ends. Turns --key=value arguments into
+ config values ("bench.opt.<key>"); a bare --key is stored as "1". Lists
+ are comma separated.
+ */
+#include "ookLibs/ookBench/ookBenchApp.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+static const string BENCH_OPT_PREFIX = "bench.opt.";
+
+ookBenchApp::ookBenchApp(int argc, const char** argv)
+	: ookApplication(argc, argv), _argc(argc), _argv(argv)
+{
+	
+}
+
+ookBenchApp::~ookBenchApp()
+{
+	
+}
+
+void ookBenchApp::Init()
+{
+	ookApplication::Init();
+	
+	for(int i = 1; i < _argc; i++)
+	{
+		string arg = _argv[i];
+		
+		if(arg.compare(0, 2, "--") != 0)
+			continue;
+		
+		size_t iEq = arg.find('=');
+		if(iEq == string::npos)
+			this->SetConfigValue(BENCH_OPT_PREFIX + arg.substr(2), "1");
+		else
+			this->SetConfigValue(BENCH_OPT_PREFIX + arg.substr(2, iEq - 2), arg.substr(iEq + 1));
+	}
+}
+
+string ookBenchApp::GetOption(string key)
+{
+	return this->GetConfigValue(BENCH_OPT_PREFIX + key);
+}
+
+vector<int> ookBenchApp::GetIntList(string key)
+{
+	vector<int> vRet;
+	vector<string> toks = this->GetStringList(key);
+	
+	for(size_t i = 0; i < toks.size(); i++)
+		vRet.push_back(atoi(toks[i].c_str()));
+	
+	return vRet;
+}
+
+vector<string> ookBenchApp::GetStringList(string key)
+{
+	vector<string> vRet;
+	vector<string> toks = ookString::Split(this->GetOption(key), ",");
+	
+	for(size_t i = 0; i < toks.size(); i++)
+		if(!toks[i].empty())
+			vRet.push_back(toks[i]);
+	
+	return vRet;
+}
\ No newline at end of file
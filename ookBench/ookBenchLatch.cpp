@@ -0,0 +1,53 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookBench/ookBenchLatch.h"
+
+ookBenchLatch::ookBenchLatch(int iCount)
+	: _iCount(iCount)
+{
+	
+}
+
+void ookBenchLatch::Arrive()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	if(--_iCount <= 0)
+		_cond.notify_all();
+}
+
+void ookBenchLatch::Wait()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	while(_iCount > 0)
+		_cond.wait(lock);
+}
\ No newline at end of file
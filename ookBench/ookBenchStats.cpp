@@ -0,0 +1,150 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookBenchStats
+ \headerfile ookBenchStats.h "ookLibs/ookBench/ookBenchStats.h"
+ \brief Collects raw samples (typically latencies in microseconds) and
+ reports the mean, max and nearest-rank percentiles over them.
+ */
+#include "ookLibs/ookBench/ookBenchStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __GNUC__
+#include <sys/resource.h>
+#endif
+
+ookBenchStats::ookBenchStats()
+	: _bSorted(true)
+{
+	
+}
+
+ookBenchStats::~ookBenchStats()
+{
+	
+}
+
+void ookBenchStats::AddSample(double dValue)
+{
+	_vSamples.push_back(dValue);
+	_bSorted = false;
+}
+
+void ookBenchStats::Merge(const ookBenchStats& stats)
+{
+	_vSamples.insert(_vSamples.end(), stats._vSamples.begin(), stats._vSamples.end());
+	_bSorted = false;
+}
+
+void ookBenchStats::Clear()
+{
+	_vSamples.clear();
+	_bSorted = true;
+}
+
+ulong ookBenchStats::GetCount() const
+{
+	return _vSamples.size();
+}
+
+double ookBenchStats::GetMean() const
+{
+	if(_vSamples.empty())
+		return 0.0;
+	
+	double dSum = 0.0;
+	for(size_t i = 0; i < _vSamples.size(); i++)
+		dSum += _vSamples[i];
+	
+	return dSum / _vSamples.size();
+}
+
+double ookBenchStats::GetMax() const
+{
+	if(_vSamples.empty())
+		return 0.0;
+	
+	return *std::max_element(_vSamples.begin(), _vSamples.end());
+}
+
+/*! 
+ \brief Returns the nearest-rank percentile of the collected samples.
+ 
+ \param dPct	The percentile to fetch, from 0.0 to 100.0.
+ */
+double ookBenchStats::GetPercentile(double dPct)
+{
+	if(_vSamples.empty())
+		return 0.0;
+	
+	if(!_bSorted)
+	{
+		std::sort(_vSamples.begin(), _vSamples.end());
+		_bSorted = true;
+	}
+	
+	if(dPct <= 0.0)
+		return _vSamples.front();
+	
+	if(dPct >= 100.0)
+		return _vSamples.back();
+	
+	//The smallest sample with at least dPct% of them at or below it; the
+	//epsilon keeps p99 of 100 samples from rounding up past the 99th
+	double dRank = std::ceil(dPct * _vSamples.size() / 100.0 - 1e-9);
+	size_t iIndex = (dRank < 1.0) ? 0 : (size_t) dRank - 1;
+	
+	if(iIndex >= _vSamples.size())
+		iIndex = _vSamples.size() - 1;
+	
+	return _vSamples[iIndex];
+}
+
+/*! 
+ \brief Returns the user plus system CPU time consumed so far by the
+ whole process, in seconds.
+ */
+double ookBenchStats::GetProcessCPUSeconds()
+{
+	#ifdef __GNUC__
+		struct rusage usage;
+		if(getrusage(RUSAGE_SELF, &usage) == 0)
+		{
+			return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+				(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+		}
+	#endif
+	
+	return 0.0;
+}
\ No newline at end of file
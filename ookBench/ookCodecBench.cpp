@@ -0,0 +1,224 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookCodecBench
+ \headerfile ookCodecBench.h "ookLibs/ookBench/ookCodecBench.h"
+ \brief Cost and size of serializing an application message, the
+ ookMsgSchema way against the delimited text we used to send.
+ 
+ lMessages quotes, from a set of varied ones, are encoded then decoded
+ one at a time. One JSON line per codec:
+ 
+ \code
+ 
+ {"codec":"schema","messages":1000000,"bytes_per_msg":41.0,
+  "encode_ns":38.2,"decode_ns":61.7,"roundtrip_ns":99.9,
+  "vs_text":9.6,"failed":0}
+ 
+ \endcode
+ 
+ Codecs: "text" formats the fields into a '|' separated string with a
+ stringstream and parses it back with ookString::Split() and atol()/atof(),
+ as our message classes did by hand. "schema" is ookMsgCodec encoding into
+ a reused buffer and decoding from it. vs_text is the round trip speedup
+ over text, when text is part of the run. failed counts quotes that didn't
+ come back equal.
+ */
+#include "ookLibs/ookBench/ookCodecBench.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+#include <iomanip>
+#include <sstream>
+
+//Distinct quotes the benchmark cycles through
+#define OOK_CODEC_BENCH_QUOTES 1024
+
+bool ookBenchQuote::operator==(const ookBenchQuote& q) const
+{
+	return (symbol == q.symbol) && (venue == q.venue) && (price == q.price) && (qty == q.qty)
+		&& (side == q.side) && (stamp == q.stamp) && (seq == q.seq);
+}
+
+string ookCodecBench::EncodeText(const ookBenchQuote& quote)
+{
+	std::ostringstream out;
+	
+	out << std::setprecision(17) << quote.symbol << '|' << quote.venue << '|' << quote.price << '|'
+		<< quote.qty << '|' << quote.side << '|' << quote.stamp << '|' << quote.seq;
+	
+	return out.str();
+}
+
+void ookCodecBench::DecodeText(const string& text, ookBenchQuote& quote)
+{
+	vector<string> vFields = ookString::Split(text, "|");
+	
+	if(vFields.size() != 7)
+		throw ookException("ookCodecBench: malformed text quote");
+	
+	quote.symbol = vFields[0];
+	quote.venue = vFields[1];
+	quote.price = atof(vFields[2].c_str());
+	quote.qty = atol(vFields[3].c_str());
+	quote.side = atoi(vFields[4].c_str());
+	quote.stamp = atol(vFields[5].c_str());
+	quote.seq = strtoul(vFields[6].c_str(), NULL, 10);
+}
+
+ookCodecBench::ookCodecBench()
+	: _lMessages(1000000), _dTextNs(0.0)
+{
+	_vCodecs.push_back("text");
+	_vCodecs.push_back("schema");
+	
+	const char* symbols[] = {"AAPL", "MSFT", "GOOG", "BRK.B", "TSLA", "NVDA", "XOM", "JPM"};
+	const char* venues[] = {"XNAS", "XNYS", "ARCX", "BATS"};
+	
+	_vQuotes.resize(OOK_CODEC_BENCH_QUOTES);
+	
+	for(int i = 0; i < OOK_CODEC_BENCH_QUOTES; i++)
+	{
+		ookBenchQuote& q = _vQuotes[i];
+		
+		q.symbol = symbols[i % 8];
+		q.venue = venues[i % 4];
+		q.price = 100.0 + (i * 0.01);
+		q.qty = 100 * ((i % 50) + 1);
+		q.side = ((i % 2) == 0) ? 1 : -1;
+		q.stamp = 1600000000000000000L + (i * 1000L);
+		q.seq = 1000000 + i;
+	}
+}
+
+ookCodecBench::~ookCodecBench()
+{
+	
+}
+
+void ookCodecBench::SetCodecs(vector<string> vCodecs)
+{
+	for(size_t i = 0; i < vCodecs.size(); i++)
+		if((vCodecs[i] != "text") && (vCodecs[i] != "schema"))
+			throw ookException("ookCodecBench: codecs are text and schema");
+	
+	_vCodecs = vCodecs;
+}
+
+void ookCodecBench::SetMessages(long lMessages)
+{
+	_lMessages = lMessages;
+}
+
+void ookCodecBench::RunCodec(ostream& out, string codec)
+{
+	ookBenchQuote decoded;
+	double dBytes = 0.0;
+	long lFailed = 0;
+	
+	bench_clock::duration encodeTime(0);
+	bench_clock::duration decodeTime(0);
+	
+	if(codec == "text")
+	{
+		for(long i = 0; i < _lMessages; i++)
+		{
+			const ookBenchQuote& q = _vQuotes[i % OOK_CODEC_BENCH_QUOTES];
+			
+			bench_clock::time_point tStart = bench_clock::now();
+			string text = EncodeText(q);
+			bench_clock::time_point tEncoded = bench_clock::now();
+			DecodeText(text, decoded);
+			bench_clock::time_point tDecoded = bench_clock::now();
+			
+			encodeTime += tEncoded - tStart;
+			decodeTime += tDecoded - tEncoded;
+			dBytes += text.size();
+			
+			if(!(decoded == q))
+				lFailed++;
+		}
+	}
+	else
+	{
+		vector<char> vBuf(256);
+		
+		for(long i = 0; i < _lMessages; i++)
+		{
+			const ookBenchQuote& q = _vQuotes[i % OOK_CODEC_BENCH_QUOTES];
+			
+			bench_clock::time_point tStart = bench_clock::now();
+			size_t iSize = ookMsgCodec::Encode(q, &vBuf[0], vBuf.size());
+			bench_clock::time_point tEncoded = bench_clock::now();
+			ookMsgCodec::Decode(&vBuf[0], iSize, decoded);
+			bench_clock::time_point tDecoded = bench_clock::now();
+			
+			encodeTime += tEncoded - tStart;
+			decodeTime += tDecoded - tEncoded;
+			dBytes += iSize;
+			
+			if(!(decoded == q))
+				lFailed++;
+		}
+	}
+	
+	double dEncodeNs = boost::chrono::duration<double, boost::nano>(encodeTime).count() / _lMessages;
+	double dDecodeNs = boost::chrono::duration<double, boost::nano>(decodeTime).count() / _lMessages;
+	double dRoundNs = dEncodeNs + dDecodeNs;
+	
+	if(codec == "text")
+		_dTextNs = dRoundNs;
+	
+	out << std::fixed << std::setprecision(3)
+		<< "{\"codec\":\"" << codec << "\""
+		<< ",\"messages\":" << _lMessages
+		<< ",\"bytes_per_msg\":" << (dBytes / _lMessages)
+		<< ",\"encode_ns\":" << dEncodeNs
+		<< ",\"decode_ns\":" << dDecodeNs
+		<< ",\"roundtrip_ns\":" << dRoundNs
+		<< ",\"vs_text\":" << ((dRoundNs > 0.0) ? _dTextNs / dRoundNs : 0.0)
+		<< ",\"failed\":" << lFailed
+		<< "}" << endl;
+}
+
+/*! 
+ \brief Runs every codec, writing one JSON line each to out.
+ */
+void ookCodecBench::Run(ostream& out)
+{
+	if(_lMessages <= 0)
+		throw ookException("ookCodecBench: message count must be positive");
+	
+	_dTextNs = 0.0;
+	
+	for(size_t c = 0; c < _vCodecs.size(); c++)
+		this->RunCodec(out, _vCodecs[c]);
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_CODEC_BENCH_H_
+#define OOK_CODEC_BENCH_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgSchema.h"
+#include "ookLibs/ookBench/ookBenchStats.h"
+
+/*!
+ \brief A typical application message: a quote, as a feed handler would
+ send it.
+ */
+class ookBenchQuote : public ookMessage
+{
+	OOK_MESSAGE_TYPE(ookBenchQuote, ookMessage)
+	
+public:
+	
+	ookBenchQuote() : price(0.0), qty(0), side(0), stamp(0), seq(0) {}
+	virtual ~ookBenchQuote() {}
+	
+	bool operator==(const ookBenchQuote& q) const;
+	
+	string symbol;
+	string venue;
+	double price;
+	long qty;
+	int side;
+	long stamp;
+	unsigned long seq;
+	
+	OOK_MSG_SCHEMA(1)
+		OOK_MSG_FIELD(1, symbol)
+		OOK_MSG_FIELD(2, venue)
+		OOK_MSG_FIELD(3, price)
+		OOK_MSG_FIELD(4, qty)
+		OOK_MSG_FIELD(5, side)
+		OOK_MSG_FIELD_FIXED(6, stamp)
+		OOK_MSG_FIELD(7, seq)
+	OOK_MSG_SCHEMA_END
+};
+
+class ookCodecBench
+{
+public:
+	
+	ookCodecBench();
+	virtual ~ookCodecBench();
+	
+	void SetCodecs(vector<string> vCodecs);
+	void SetMessages(long lMessages);
+	
+	void Run(ostream& out);
+	
+	static string EncodeText(const ookBenchQuote& quote);
+	static void DecodeText(const string& text, ookBenchQuote& quote);
+	
+protected:
+	
+	void RunCodec(ostream& out, string codec);
+	
+private:
+	
+	vector<string> _vCodecs;
+	long _lMessages;
+	vector<ookBenchQuote> _vQuotes;
+	
+	double _dTextNs;
+};
+
+#endif
\ No newline at end of file
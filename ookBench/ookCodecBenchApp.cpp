@@ -0,0 +1,79 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookCodecBenchApp
+ \headerfile ookCodecBenchApp.h "ookLibs/ookBench/ookCodecBenchApp.h"
+ \brief Command line front end for ookCodecBench.
+ 
+ \code
+ 
+ ookcodecbench --codecs=text,schema --messages=1000000
+ 
+ \endcode
+ 
+ Results are written to stdout as one JSON object per line.
+ */
+#include "ookLibs/ookBench/ookCodecBenchApp.h"
+#include "ookLibs/ookBench/ookCodecBench.h"
+
+ookCodecBenchApp::ookCodecBenchApp(int argc, const char** argv)
+	: ookBenchApp(argc, argv)
+{
+	
+}
+
+ookCodecBenchApp::~ookCodecBenchApp()
+{
+	
+}
+
+void ookCodecBenchApp::AppMain()
+{
+	try
+	{
+		ookCodecBench bench;
+		
+		vector<string> vCodecs = this->GetStringList("codecs");
+		if(!vCodecs.empty())
+			bench.SetCodecs(vCodecs);
+		
+		string messages = this->GetOption("messages");
+		if(!messages.empty())
+			bench.SetMessages(atol(messages.c_str()));
+		
+		bench.Run(cout);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "ookCodecBenchApp: " << e.what() << endl;
+	}
+}
\ No newline at end of file
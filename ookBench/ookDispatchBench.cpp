@@ -0,0 +1,314 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookDispatchBench
+ \headerfile ookDispatchBench.h "ookLibs/ookBench/ookDispatchBench.h"
+ \brief Cost of a synchronous PostMsg() as observers are added.
+ 
+ iObservers observers are spread round robin over iTypes message types,
+ all derived from ookTextMessage, and lPosts messages of the first type
+ are posted. So about one observer in iTypes is interested in each post.
+ One JSON line per point:
+ 
+ \code
+ 
+ {"dispatcher":"indexed","observers":1000,"interested":125,"posts":100000,
+  "elapsed_sec":0.09,"ns_per_post":912.4,"ns_per_delivery":7.3,
+  "vs_scan":31.8,"failed":0}
+ 
+ \endcode
+ 
+ Dispatchers: "scan" is ookBenchScanDispatcher, the old loop that asks
+ every observer with a dynamic_cast, and "indexed" is ookMsgDispatcher
+ routing by ookMsgType. "topic" registers every observer for the first
+ message type but under topic pattern "bench.t<type>.*", and posts under
+ "bench.t0.quote", so the same observers are interested but are found
+ through the topic trie. "log" is "indexed" writing through an ookMsgLog
+ in SetLogDir() with a group fsync, the time including the final Flush()
+ that makes every post durable. "batch" is "indexed" posting
+ OOK_DISPATCH_BENCH_BATCH messages per PostBatch() call, and "profiled"
+ is "indexed" timing every observer call for an ookDispatchProfiler that
+ traces one post in a thousand. vs_scan is the
+ speedup over the scan at the same observer count, when the scan is part
+ of the sweep. failed is non zero if observers got the wrong number of
+ messages.
+ */
+#include "ookLibs/ookBench/ookDispatchBench.h"
+#include "ookLibs/ookCore/ookMsgLog.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+#include <iomanip>
+
+void ookBenchScanDispatcher::RegisterObserver(ookMsgObserverAbs* obs)
+{
+	_vObservers.push_back(boost::shared_ptr<ookMsgObserverAbs>(obs));
+}
+
+void ookBenchScanDispatcher::PostMsg(ookMessage* msg)
+{
+	for(size_t i = 0; i < _vObservers.size(); i++)
+	{
+		if(_vObservers[i]->Accepts(msg))
+			_vObservers[i]->SendMessage(msg);
+	}
+}
+
+template <int N>
+static ookMsgObserverAbs* ookDispatchBenchNewObserver(ookBenchMsgTarget* target)
+{
+	return new ookMsgObserver<ookBenchMsgTarget, ookBenchMsg<N> >(target, &ookBenchMsgTarget::OnMsg<N>);
+}
+
+//Observer of message type iType, for a dispatcher to own
+static ookMsgObserverAbs* ookDispatchBenchObserver(int iType, ookBenchMsgTarget* target)
+{
+	switch(iType)
+	{
+		case 0:		return ookDispatchBenchNewObserver<0>(target);
+		case 1:		return ookDispatchBenchNewObserver<1>(target);
+		case 2:		return ookDispatchBenchNewObserver<2>(target);
+		case 3:		return ookDispatchBenchNewObserver<3>(target);
+		case 4:		return ookDispatchBenchNewObserver<4>(target);
+		case 5:		return ookDispatchBenchNewObserver<5>(target);
+		case 6:		return ookDispatchBenchNewObserver<6>(target);
+		default:	return ookDispatchBenchNewObserver<7>(target);
+	}
+}
+
+template <class D>
+static double ookDispatchBenchRun(D* dispatcher, long lPosts, string topic = "")
+{
+	ookBenchMsg<0> msg;
+	msg.SetTopic(topic);
+	
+	bench_clock::time_point tStart = bench_clock::now();
+	
+	for(long i = 0; i < lPosts; i++)
+		dispatcher->PostMsg(&msg);
+	
+	return boost::chrono::duration<double>(bench_clock::now() - tStart).count();
+}
+
+//The same message OOK_DISPATCH_BENCH_BATCH times per PostBatch(), and the
+//remainder in a last short batch
+static double ookDispatchBenchRunBatch(ookMsgDispatcher* dispatcher, long lPosts)
+{
+	ookBenchMsg<0> msg;
+	vector<ookMessage*> vBatch(OOK_DISPATCH_BENCH_BATCH, &msg);
+	
+	bench_clock::time_point tStart = bench_clock::now();
+	
+	for(long i = 0; i < lPosts; i += OOK_DISPATCH_BENCH_BATCH)
+		dispatcher->PostBatch(&vBatch[0], (size_t) std::min(lPosts - i, (long) OOK_DISPATCH_BENCH_BATCH));
+	
+	return boost::chrono::duration<double>(bench_clock::now() - tStart).count();
+}
+
+ookDispatchBench::ookDispatchBench()
+	: _iTypes(OOK_DISPATCH_BENCH_TYPES), _lPosts(100000), _logDir("/tmp/ookdispatchbench.log")
+{
+	_vDispatchers.push_back("scan");
+	_vDispatchers.push_back("indexed");
+	_vDispatchers.push_back("topic");
+	
+	_vObservers.push_back(1);
+	_vObservers.push_back(10);
+	_vObservers.push_back(100);
+	_vObservers.push_back(1000);
+}
+
+ookDispatchBench::~ookDispatchBench()
+{
+	
+}
+
+void ookDispatchBench::SetDispatchers(vector<string> vDispatchers)
+{
+	for(size_t i = 0; i < vDispatchers.size(); i++)
+		if((vDispatchers[i] != "scan") && (vDispatchers[i] != "indexed") && (vDispatchers[i] != "topic") &&
+			 (vDispatchers[i] != "log") && (vDispatchers[i] != "batch") && (vDispatchers[i] != "profiled"))
+			throw ookException("ookDispatchBench: dispatchers are scan, indexed, topic, log, batch and profiled");
+	
+	_vDispatchers = vDispatchers;
+}
+
+void ookDispatchBench::SetObserverCounts(vector<int> vObservers)
+{
+	_vObservers = vObservers;
+}
+
+void ookDispatchBench::SetTypes(int iTypes)
+{
+	if((iTypes < 1) || (iTypes > OOK_DISPATCH_BENCH_TYPES))
+		throw ookException("ookDispatchBench: types must be between 1 and 8");
+	
+	_iTypes = iTypes;
+}
+
+void ookDispatchBench::SetPosts(long lPosts)
+{
+	_lPosts = lPosts;
+}
+
+/*! 
+ \brief Where the "log" dispatcher keeps its log. Old segments are
+ deleted as the sweep goes, so the directory stays small.
+ */
+void ookDispatchBench::SetLogDir(const string& dir)
+{
+	_logDir = dir;
+}
+
+void ookDispatchBench::RunPoint(ostream& out, string dispatcher, int iObservers)
+{
+	vector<ookBenchMsgTarget> vTargets(iObservers);
+	int iInterested = 0;
+	
+	for(int i = 0; i < iObservers; i += _iTypes)
+		iInterested++;
+	
+	double dElapsed = 0.0;
+	
+	if(dispatcher == "scan")
+	{
+		ookBenchScanDispatcher d;
+		
+		for(int i = 0; i < iObservers; i++)
+			d.RegisterObserver(ookDispatchBenchObserver(i % _iTypes, &vTargets[i]));
+		
+		dElapsed = ookDispatchBenchRun(&d, _lPosts);
+	}
+	else if(dispatcher == "topic")
+	{
+		ookMsgDispatcher d;
+		
+		for(int i = 0; i < iObservers; i++)
+		{
+			string pattern = "bench.t" + ookString::ConvertInt2String(i % _iTypes) + ".*";
+			d.RegisterObserver(pattern, ookDispatchBenchObserver(0, &vTargets[i]));
+		}
+		
+		dElapsed = ookDispatchBenchRun(&d, _lPosts, "bench.t0.quote");
+	}
+	else if(dispatcher == "log")
+	{
+		ookMsgLog log;
+		log.RegisterType<ookTextMessage>();
+		log.SetSegmentSize(4 * 1024 * 1024);
+		log.SetRetention(8 * 1024 * 1024, 0);
+		log.Open(_logDir);
+		
+		ookMsgDispatcher d;
+		d.SetLog(&log);
+		
+		for(int i = 0; i < iObservers; i++)
+			d.RegisterObserver(ookDispatchBenchObserver(i % _iTypes, &vTargets[i]));
+		
+		bench_clock::time_point tStart = bench_clock::now();
+		
+		ookDispatchBenchRun(&d, _lPosts);
+		log.Flush();
+		
+		dElapsed = boost::chrono::duration<double>(bench_clock::now() - tStart).count();
+	}
+	else if(dispatcher == "batch")
+	{
+		ookMsgDispatcher d;
+		
+		for(int i = 0; i < iObservers; i++)
+			d.RegisterObserver(ookDispatchBenchObserver(i % _iTypes, &vTargets[i]));
+		
+		dElapsed = ookDispatchBenchRunBatch(&d, _lPosts);
+	}
+	else if(dispatcher == "profiled")
+	{
+		ookDispatchProfiler profiler;
+		profiler.SetSampling(1000);
+		
+		ookMsgDispatcher d;
+		d.SetProfiler(&profiler);
+		
+		for(int i = 0; i < iObservers; i++)
+			d.RegisterObserver(ookDispatchBenchObserver(i % _iTypes, &vTargets[i]));
+		
+		dElapsed = ookDispatchBenchRun(&d, _lPosts);
+	}
+	else
+	{
+		ookMsgDispatcher d;
+		
+		for(int i = 0; i < iObservers; i++)
+			d.RegisterObserver(ookDispatchBenchObserver(i % _iTypes, &vTargets[i]));
+		
+		dElapsed = ookDispatchBenchRun(&d, _lPosts);
+	}
+	
+	long lFailed = 0;
+	
+	for(int i = 0; i < iObservers; i++)
+		if(vTargets[i].GetCount() != (((i % _iTypes) == 0) ? _lPosts : 0))
+			lFailed++;
+	
+	double dPostNs = (dElapsed * 1000000000.0) / _lPosts;
+	
+	if(dispatcher == "scan")
+		_baselines[iObservers] = dPostNs;
+	
+	double dBase = (_baselines.find(iObservers) != _baselines.end()) ? _baselines[iObservers] : 0.0;
+	
+	out << std::fixed << std::setprecision(3)
+		<< "{\"dispatcher\":\"" << dispatcher << "\""
+		<< ",\"observers\":" << iObservers
+		<< ",\"interested\":" << iInterested
+		<< ",\"posts\":" << _lPosts
+		<< ",\"elapsed_sec\":" << dElapsed
+		<< ",\"ns_per_post\":" << dPostNs
+		<< ",\"ns_per_delivery\":" << ((iInterested > 0) ? dPostNs / iInterested : 0.0)
+		<< ",\"vs_scan\":" << ((dPostNs > 0.0) ? dBase / dPostNs : 0.0)
+		<< ",\"failed\":" << lFailed
+		<< "}" << endl;
+}
+
+/*! 
+ \brief Runs the full sweep, writing one JSON line per point to out.
+ */
+void ookDispatchBench::Run(ostream& out)
+{
+	if(_lPosts <= 0)
+		throw ookException("ookDispatchBench: post count must be positive");
+	
+	_baselines.clear();
+	
+	for(size_t o = 0; o < _vObservers.size(); o++)
+		for(size_t d = 0; d < _vDispatchers.size(); d++)
+			this->RunPoint(out, _vDispatchers[d], _vObservers[o]);
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_DISPATCH_BENCH_H_
+#define OOK_DISPATCH_BENCH_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookTextMessage.h"
+#include "ookLibs/ookCore/ookMsgObserver.h"
+#include "ookLibs/ookCore/ookMsgDispatcher.h"
+#include "ookLibs/ookBench/ookBenchStats.h"
+#include "boost/shared_ptr.hpp"
+
+//Distinct message types the observers are spread over
+#define OOK_DISPATCH_BENCH_TYPES 8
+
+//Messages per PostBatch() for the "batch" dispatcher
+#define OOK_DISPATCH_BENCH_BATCH 64
+
+template <int N>
+class ookBenchMsg : public ookTextMessage
+{
+	OOK_MESSAGE_TYPE(ookBenchMsg<N>, ookTextMessage)
+	
+public:
+	
+	ookBenchMsg() {}
+	virtual ~ookBenchMsg() {}
+};
+
+/*!
+ \brief What every benchmark observer calls: it only counts.
+ */
+class ookBenchMsgTarget
+{
+public:
+	
+	ookBenchMsgTarget() : _lCount(0) {}
+	
+	template <int N>
+	void OnMsg(ookBenchMsg<N>*)
+	{
+		_lCount++;
+	}
+	
+	long GetCount() const { return _lCount; }
+	
+private:
+	
+	long _lCount;
+};
+
+/*!
+ \brief The baseline: the dispatch loop ookMsgDispatcher had before the
+ type index. Every post asks every observer, and each interested one
+ dynamic_casts twice, in Accepts() and in SendMessage(). Owns its
+ observers, as ookMsgDispatcher does.
+ */
+class ookBenchScanDispatcher
+{
+public:
+	
+	void RegisterObserver(ookMsgObserverAbs* obs);
+	void PostMsg(ookMessage* msg);
+	
+private:
+	
+	vector<boost::shared_ptr<ookMsgObserverAbs> > _vObservers;
+};
+
+class ookDispatchBench
+{
+public:
+	
+	ookDispatchBench();
+	virtual ~ookDispatchBench();
+	
+	void SetDispatchers(vector<string> vDispatchers);
+	void SetObserverCounts(vector<int> vObservers);
+	void SetTypes(int iTypes);
+	void SetPosts(long lPosts);
+	void SetLogDir(const string& dir);
+	
+	void Run(ostream& out);
+	
+protected:
+	
+	void RunPoint(ostream& out, string dispatcher, int iObservers);
+	
+private:
+	
+	vector<string> _vDispatchers;
+	vector<int> _vObservers;
+	int _iTypes;
+	long _lPosts;
+	string _logDir;
+	
+	std::map<int, double> _baselines;
+};
+
+#endif
\ No newline at end of file
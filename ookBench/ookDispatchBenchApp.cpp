@@ -0,0 +1,92 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookDispatchBenchApp
+ \headerfile ookDispatchBenchApp.h "ookLibs/ookBench/ookDispatchBenchApp.h"
+ \brief Command line front end for ookDispatchBench.
+ 
+ \code
+ 
+ ookdispatchbench --dispatchers=scan,indexed,topic,log,batch,profiled --observers=1,10,100,1000
+                  --types=8 --posts=100000 --log-dir=/tmp/ookdispatchbench.log
+ 
+ \endcode
+ 
+ Results are written to stdout as one JSON object per line.
+ */
+#include "ookLibs/ookBench/ookDispatchBenchApp.h"
+#include "ookLibs/ookBench/ookDispatchBench.h"
+
+ookDispatchBenchApp::ookDispatchBenchApp(int argc, const char** argv)
+	: ookBenchApp(argc, argv)
+{
+	
+}
+
+ookDispatchBenchApp::~ookDispatchBenchApp()
+{
+	
+}
+
+void ookDispatchBenchApp::AppMain()
+{
+	try
+	{
+		ookDispatchBench bench;
+		
+		vector<string> vDispatchers = this->GetStringList("dispatchers");
+		if(!vDispatchers.empty())
+			bench.SetDispatchers(vDispatchers);
+		
+		vector<int> vList = this->GetIntList("observers");
+		if(!vList.empty())
+			bench.SetObserverCounts(vList);
+		
+		string types = this->GetOption("types");
+		if(!types.empty())
+			bench.SetTypes(atoi(types.c_str()));
+		
+		string posts = this->GetOption("posts");
+		if(!posts.empty())
+			bench.SetPosts(atol(posts.c_str()));
+		
+		string logDir = this->GetOption("log-dir");
+		if(!logDir.empty())
+			bench.SetLogDir(logDir);
+		
+		bench.Run(cout);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "ookDispatchBenchApp: " << e.what() << endl;
+	}
+}
\ No newline at end of file
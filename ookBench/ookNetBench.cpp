@@ -0,0 +1,401 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookNetBench
+ \headerfile ookNetBench.h "ookLibs/ookBench/ookNetBench.h"
+ \brief Loopback load generator for ookNet.
+ 
+ Spins up an echo ookTCPServer (and an echo ookSSLServer when credentials
+ are supplied) and sweeps every combination of message size, connection
+ count and pipeline depth against it. Each sweep point is written to the
+ output stream as a single line of JSON:
+ 
+ \code
+ 
+ {"transport":"tcp","msg_size":64,"connections":8,"pipeline":4,"messages":80000,
+  "failed_connections":0,"elapsed_sec":0.52,"msgs_per_sec":153846.2,"mb_per_sec":9.85,
+  "cpu_us_per_msg":11.3,"lat_us_p50":180.1,"lat_us_p90":240.7,"lat_us_p99":410.2,
+  "lat_us_p999":900.4,"lat_us_max":1500.3}
+ 
+ \endcode
+ 
+ mb_per_sec counts echoed payload bytes in one direction. cpu_us_per_msg is
+ the CPU time of the whole process (clients and server both run in it)
+ divided by the number of round trips.
+ 
+ With SetKTLS(true) a third echo server with kernel TLS offload for writes
+ is started and every point is also run as transport "ktls", so its rows
+ can be compared directly against the "ssl" rows. Use large messages and
+ deep pipelines to see the bulk transfer difference. Where the kernel has
+ no TLS support the server logs the fallback and "ktls" measures plain
+ OpenSSL.
+ 
+ SetCoro(true) adds an echo ookCoroServer and runs every point against it
+ as transport "coro". Its rows line up with the "tcp" rows, which use a
+ thread per connection; compare them at high connection counts.
+ */
+#include "ookLibs/ookBench/ookNetBench.h"
+
+#include <iomanip>
+
+//==========================================================
+// Echo servers
+//==========================================================
+
+ookEchoTCPServerThread::ookEchoTCPServerThread(socket_ptr sock)
+	: ookTCPServerThread(sock, NULL)
+{
+	
+}
+
+//Run() calls our HandleMsg(), so it has to be finished before we go
+ookEchoTCPServerThread::~ookEchoTCPServerThread()
+{
+	this->Stop();
+	this->Join();
+}
+
+void ookEchoTCPServerThread::HandleMsg(string msg)
+{
+	this->WriteMsg(msg);
+}
+
+ookEchoTCPServer::ookEchoTCPServer(int iPort)
+	: ookTCPServer(iPort)
+{
+	
+}
+
+ookEchoTCPServer::~ookEchoTCPServer()
+{
+	
+}
+
+tcp_thread_ptr ookEchoTCPServer::GetServerThread(socket_ptr sock)
+{
+	tcp_thread_ptr thrd(new ookEchoTCPServerThread(sock));
+	
+	this->GetServerThreads().push_back(thrd);
+	
+	return thrd;
+}
+
+ookEchoSSLServerThread::ookEchoSSLServerThread(ssl_socket_ptr sock, ookMsgDispatcher* dispatcher)
+	: ookSSLServerThread(sock, dispatcher)
+{
+	
+}
+
+ookEchoSSLServerThread::~ookEchoSSLServerThread()
+{
+	this->Stop();
+	this->Join();
+}
+
+void ookEchoSSLServerThread::HandleMsg(string msg)
+{
+	this->WriteMsg(msg);
+}
+
+ookEchoSSLServer::ookEchoSSLServer(int iPort)
+	: ookSSLServer(iPort)
+{
+	
+}
+
+ookEchoSSLServer::~ookEchoSSLServer()
+{
+	
+}
+
+ssl_thread_ptr ookEchoSSLServer::GetServerThread(ssl_socket_ptr sock)
+{
+	ssl_thread_ptr thrd(new ookEchoSSLServerThread(sock, &_dispatcher));
+	
+	_vServerThreads.push_back(thrd);
+	
+	return thrd;
+}
+
+ookEchoCoroConnection::ookEchoCoroConnection(socket_ptr sock)
+	: ookCoroConnection(sock, NULL)
+{
+	
+}
+
+ookEchoCoroConnection::~ookEchoCoroConnection()
+{
+	
+}
+
+void ookEchoCoroConnection::HandleMsg(string msg, ook_yield yield)
+{
+	this->WriteMsg(msg, yield);
+}
+
+ookEchoCoroServer::ookEchoCoroServer(int iPort)
+	: ookCoroServer(iPort)
+{
+	
+}
+
+ookEchoCoroServer::~ookEchoCoroServer()
+{
+	
+}
+
+coro_conn_ptr ookEchoCoroServer::GetConnection(socket_ptr sock)
+{
+	return coro_conn_ptr(new ookEchoCoroConnection(sock));
+}
+
+//==========================================================
+// ookNetBench
+//==========================================================
+
+/*! 
+ \brief Constructor.
+ 
+ \param iPort	The loopback port for the TCP echo server. The SSL echo
+ server, if enabled, listens on iPort + 1, the kernel TLS one on iPort + 2
+ and the coroutine one on iPort + 3.
+ */
+ookNetBench::ookNetBench(int iPort)
+	: _iPort(iPort), _lMsgsPerConn(10000), _bKTLS(false), _bCoro(false)
+{
+	_vSizes.push_back(64);
+	_vSizes.push_back(1024);
+	_vSizes.push_back(8192);
+	
+	_vConns.push_back(1);
+	_vConns.push_back(8);
+	_vConns.push_back(64);
+	
+	_vDepths.push_back(1);
+	_vDepths.push_back(16);
+}
+
+ookNetBench::~ookNetBench()
+{
+	
+}
+
+void ookNetBench::SetMsgSizes(vector<int> vSizes)
+{
+	//The wire header is a zero padded decimal of sizeof(int) digits
+	for(size_t i = 0; i < vSizes.size(); i++)
+		if((vSizes[i] <= 0) || (vSizes[i] > 9999))
+			throw ookException("ookNetBench: message sizes must be between 1 and 9999 bytes");
+	
+	_vSizes = vSizes;
+}
+
+void ookNetBench::SetConnections(vector<int> vConns)
+{
+	_vConns = vConns;
+}
+
+void ookNetBench::SetPipelineDepths(vector<int> vDepths)
+{
+	_vDepths = vDepths;
+}
+
+void ookNetBench::SetMsgsPerConnection(long lMsgs)
+{
+	_lMsgsPerConn = lMsgs;
+}
+
+void ookNetBench::SetSSLCredentials(string certFile, string keyFile)
+{
+	_certFile = certFile;
+	_keyFile = keyFile;
+}
+
+void ookNetBench::SetKTLS(bool bKTLS)
+{
+	_bKTLS = bKTLS;
+}
+
+void ookNetBench::SetCoro(bool bCoro)
+{
+	_bCoro = bCoro;
+}
+
+/*! 
+ \brief Starts a server and blocks until its acceptor answers on the
+ loopback interface.
+ */
+void ookNetBench::StartServer(ookThread* server, int iPort)
+{
+	server->Start();
+	
+	asio::io_service io;
+	tcp::endpoint ep(asio::ip::address_v4::loopback(), iPort);
+	
+	for(int i = 0; i < 500; i++)
+	{
+		boost::system::error_code err;
+		tcp::socket probe(io);
+		probe.connect(ep, err);
+		
+		if(!err)
+			return;
+		
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+	
+	throw ookException("ookNetBench: echo server never started listening");
+}
+
+template <class C>
+void ookNetBench::RunPoint(ostream& out, string transport, int iMsgSize, int iConns, int iDepth)
+{
+	int iPort = _iPort;
+	if(transport == "ssl")
+		iPort = _iPort + 1;
+	else if(transport == "ktls")
+		iPort = _iPort + 2;
+	else if(transport == "coro")
+		iPort = _iPort + 3;
+	
+	ookBenchLatch latch(iConns);
+	vector<boost::shared_ptr<ookBenchClient<C> > > vClients;
+	
+	for(int i = 0; i < iConns; i++)
+		vClients.push_back(boost::shared_ptr<ookBenchClient<C> >(
+			new ookBenchClient<C>("127.0.0.1", iPort, iMsgSize, iDepth, _lMsgsPerConn, &latch)));
+	
+	double dCPUStart = ookBenchStats::GetProcessCPUSeconds();
+	
+	for(int i = 0; i < iConns; i++)
+		vClients[i]->Start();
+	
+	latch.Wait();
+	
+	double dCPU = ookBenchStats::GetProcessCPUSeconds() - dCPUStart;
+	
+	//The measured window runs from the first send on any connection to the
+	//last reply on any connection, so connection setup is not counted
+	ookBenchStats latency;
+	long lMsgs = 0;
+	int iFailed = 0;
+	bench_clock::time_point tStart = bench_clock::time_point::max();
+	bench_clock::time_point tEnd = bench_clock::time_point::min();
+	
+	for(int i = 0; i < iConns; i++)
+	{
+		latency.Merge(vClients[i]->GetStats());
+		lMsgs += vClients[i]->GetReceived();
+		
+		if(vClients[i]->HasFailed())
+			iFailed++;
+		
+		if(vClients[i]->GetReceived() > 0)
+		{
+			tStart = std::min(tStart, vClients[i]->GetFirstSend());
+			tEnd = std::max(tEnd, vClients[i]->GetLastRecv());
+		}
+	}
+	
+	double dElapsed = (lMsgs > 0) ? boost::chrono::duration<double>(tEnd - tStart).count() : 0.0;
+	double dMsgsPerSec = (dElapsed > 0.0) ? lMsgs / dElapsed : 0.0;
+	
+	out << std::fixed << std::setprecision(3)
+		<< "{\"transport\":\"" << transport << "\""
+		<< ",\"msg_size\":" << iMsgSize
+		<< ",\"connections\":" << iConns
+		<< ",\"pipeline\":" << iDepth
+		<< ",\"messages\":" << lMsgs
+		<< ",\"failed_connections\":" << iFailed
+		<< ",\"elapsed_sec\":" << dElapsed
+		<< ",\"msgs_per_sec\":" << dMsgsPerSec
+		<< ",\"mb_per_sec\":" << (dMsgsPerSec * iMsgSize) / (1024.0 * 1024.0)
+		<< ",\"cpu_us_per_msg\":" << ((lMsgs > 0) ? (dCPU * 1000000.0) / lMsgs : 0.0)
+		<< ",\"lat_us_p50\":" << latency.GetPercentile(50.0)
+		<< ",\"lat_us_p90\":" << latency.GetPercentile(90.0)
+		<< ",\"lat_us_p99\":" << latency.GetPercentile(99.0)
+		<< ",\"lat_us_p999\":" << latency.GetPercentile(99.9)
+		<< ",\"lat_us_max\":" << latency.GetMax()
+		<< "}" << endl;
+}
+
+/*! 
+ \brief Runs the full sweep, writing one JSON line per point to out.
+ */
+void ookNetBench::Run(ostream& out)
+{
+	//Destroying the servers stops and joins them and their connections
+	boost::scoped_ptr<ookEchoTCPServer> tcpServer(new ookEchoTCPServer(_iPort));
+	this->StartServer(tcpServer.get(), _iPort);
+	
+	boost::scoped_ptr<ookEchoSSLServer> sslServer;
+	boost::scoped_ptr<ookEchoSSLServer> ktlsServer;
+	if(!_certFile.empty() && !_keyFile.empty())
+	{
+		sslServer.reset(new ookEchoSSLServer(_iPort + 1));
+		sslServer->UseCertificateFile(_certFile, asio::ssl::context_base::pem);
+		sslServer->UsePrivateKeyFile(_keyFile, asio::ssl::context_base::pem);
+		this->StartServer(sslServer.get(), _iPort + 1);
+		
+		if(_bKTLS)
+		{
+			ktlsServer.reset(new ookEchoSSLServer(_iPort + 2));
+			ktlsServer->UseCertificateFile(_certFile, asio::ssl::context_base::pem);
+			ktlsServer->UsePrivateKeyFile(_keyFile, asio::ssl::context_base::pem);
+			ktlsServer->SetKTLS(true);
+			this->StartServer(ktlsServer.get(), _iPort + 2);
+		}
+	}
+	
+	boost::scoped_ptr<ookEchoCoroServer> coroServer;
+	if(_bCoro)
+	{
+		coroServer.reset(new ookEchoCoroServer(_iPort + 3));
+		this->StartServer(coroServer.get(), _iPort + 3);
+	}
+	
+	for(size_t s = 0; s < _vSizes.size(); s++)
+		for(size_t c = 0; c < _vConns.size(); c++)
+			for(size_t d = 0; d < _vDepths.size(); d++)
+			{
+				this->RunPoint<ookTCPClient>(out, "tcp", _vSizes[s], _vConns[c], _vDepths[d]);
+				
+				if(sslServer)
+					this->RunPoint<ookSSLClient>(out, "ssl", _vSizes[s], _vConns[c], _vDepths[d]);
+				
+				if(ktlsServer)
+					this->RunPoint<ookSSLClient>(out, "ktls", _vSizes[s], _vConns[c], _vDepths[d]);
+				
+				if(coroServer)
+					this->RunPoint<ookTCPClient>(out, "coro", _vSizes[s], _vConns[c], _vDepths[d]);
+			}
+}
\ No newline at end of file
@@ -0,0 +1,266 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_NET_BENCH_H_
+#define OOK_NET_BENCH_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookBench/ookBenchStats.h"
+#include "ookLibs/ookBench/ookBenchLatch.h"
+#include "ookLibs/ookNet/ookTCPServer.h"
+#include "ookLibs/ookNet/ookTCPClient.h"
+#include "ookLibs/ookNet/ookSSLServer.h"
+#include "ookLibs/ookNet/ookSSLClient.h"
+#include "ookLibs/ookNet/ookCoroServer.h"
+
+#include <deque>
+
+//==========================================================
+// Echo servers
+//==========================================================
+
+class ookEchoTCPServerThread : public ookTCPServerThread
+{
+public:
+	
+	ookEchoTCPServerThread(socket_ptr sock);
+	virtual ~ookEchoTCPServerThread();
+	
+	virtual void HandleMsg(string msg);
+};
+
+class ookEchoTCPServer : public ookTCPServer
+{
+public:
+	
+	ookEchoTCPServer(int iPort);
+	virtual ~ookEchoTCPServer();
+	
+protected:
+	
+	virtual tcp_thread_ptr GetServerThread(socket_ptr sock);
+};
+
+class ookEchoSSLServerThread : public ookSSLServerThread
+{
+public:
+	
+	ookEchoSSLServerThread(ssl_socket_ptr sock, ookMsgDispatcher* dispatcher);
+	virtual ~ookEchoSSLServerThread();
+	
+	virtual void HandleMsg(string msg);
+};
+
+class ookEchoSSLServer : public ookSSLServer
+{
+public:
+	
+	ookEchoSSLServer(int iPort);
+	virtual ~ookEchoSSLServer();
+	
+protected:
+	
+	virtual ssl_thread_ptr GetServerThread(ssl_socket_ptr sock);
+};
+
+class ookEchoCoroConnection : public ookCoroConnection
+{
+public:
+	
+	ookEchoCoroConnection(socket_ptr sock);
+	virtual ~ookEchoCoroConnection();
+	
+	virtual void HandleMsg(string msg, ook_yield yield);
+};
+
+class ookEchoCoroServer : public ookCoroServer
+{
+public:
+	
+	ookEchoCoroServer(int iPort);
+	virtual ~ookEchoCoroServer();
+	
+protected:
+	
+	virtual coro_conn_ptr GetConnection(socket_ptr sock);
+};
+
+//==========================================================
+// Load generating clients
+//==========================================================
+
+/*!
+ \brief Echo client which keeps up to iDepth messages in flight and records
+ the round trip time of each one. C is ookTCPClient or ookSSLClient.
+ */
+template <class C>
+class ookBenchClient : public C
+{
+public:
+	
+	ookBenchClient(string ipaddr, int iPort, int iMsgSize, int iDepth, long lTotal, ookBenchLatch* latch)
+		: C(ipaddr, iPort), _msg(iMsgSize, 'x'), _iDepth(iDepth), _lTotal(lTotal),
+			_lSent(0), _lRecv(0), _bFailed(false), _latch(latch)
+	{
+		
+	}
+	
+	virtual ~ookBenchClient()
+	{
+		this->Stop();
+		this->Join();
+	}
+	
+	virtual void HandleMsg(string msg)
+	{
+		if(msg.empty() || _inflight.empty())
+		{
+			//ookSSLClient::Read() swallows errors and hands us an empty string
+			_bFailed = true;
+			this->Stop();
+			return;
+		}
+		
+		bench_clock::time_point now = bench_clock::now();
+		
+		_stats.AddSample(boost::chrono::duration<double, boost::micro>(now - _inflight.front()).count());
+		_inflight.pop_front();
+		_lRecv++;
+		_tLast = now;
+		
+		if(_lSent < _lTotal)
+			this->Send();
+		
+		if(_lRecv >= _lTotal)
+			this->Stop();
+	}
+	
+	virtual void Run()
+	{
+		try
+		{
+			C::Run();
+		}
+		catch(...)
+		{
+			_bFailed = true;
+		}
+		
+		if(_lRecv < _lTotal)
+			_bFailed = true;
+		
+		//This must be the last thing we touch; the driver may destroy us after it
+		_latch->Arrive();
+	}
+	
+	ookBenchStats& GetStats() { return _stats; }
+	long GetReceived() const { return _lRecv; }
+	bool HasFailed() const { return _bFailed; }
+	bench_clock::time_point GetFirstSend() const { return _tFirst; }
+	bench_clock::time_point GetLastRecv() const { return _tLast; }
+	
+protected:
+	
+	virtual void OnConnect()
+	{
+		_tFirst = bench_clock::now();
+		
+		while((_lSent < _lTotal) && ((int) _inflight.size() < _iDepth))
+			this->Send();
+	}
+	
+	void Send()
+	{
+		_inflight.push_back(bench_clock::now());
+		_lSent++;
+		this->WriteMsg(_msg);
+	}
+	
+private:
+	
+	string _msg;
+	int _iDepth;
+	long _lTotal;
+	long _lSent;
+	long _lRecv;
+	bool _bFailed;
+	
+	std::deque<bench_clock::time_point> _inflight;
+	bench_clock::time_point _tFirst;
+	bench_clock::time_point _tLast;
+	
+	ookBenchStats _stats;
+	ookBenchLatch* _latch;
+};
+
+//==========================================================
+// Benchmark driver
+//==========================================================
+
+class ookNetBench
+{
+public:
+	
+	ookNetBench(int iPort);
+	virtual ~ookNetBench();
+	
+	void SetMsgSizes(vector<int> vSizes);
+	void SetConnections(vector<int> vConns);
+	void SetPipelineDepths(vector<int> vDepths);
+	void SetMsgsPerConnection(long lMsgs);
+	void SetSSLCredentials(string certFile, string keyFile);
+	void SetKTLS(bool bKTLS);
+	void SetCoro(bool bCoro);
+	
+	void Run(ostream& out);
+	
+protected:
+	
+	template <class C>
+	void RunPoint(ostream& out, string transport, int iMsgSize, int iConns, int iDepth);
+	
+	void StartServer(ookThread* server, int iPort);
+	
+private:
+	
+	int _iPort;
+	long _lMsgsPerConn;
+	
+	vector<int> _vSizes;
+	vector<int> _vConns;
+	vector<int> _vDepths;
+	
+	string _certFile;
+	string _keyFile;
+	bool _bKTLS;
+	bool _bCoro;
+};
+
+#endif
\ No newline at end of file
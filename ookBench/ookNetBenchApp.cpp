@@ -0,0 +1,100 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookNetBenchApp
+ \headerfile ookNetBenchApp.h "ookLibs/ookBench/ookNetBenchApp.h"
+ \brief Command line front end for ookNetBench.
+ 
+ Options are given as --key=value and lists are comma separated:
+ 
+ \code
+ 
+ ooknetbench --port=13130 --sizes=64,1024,8192 --conns=1,8,64 --depths=1,16
+             --msgs=10000 --cert=server.pem --key=server.key --ktls --coro
+ 
+ \endcode
+ 
+ The SSL sweep only runs when both --cert and --key are given; --ktls adds
+ a kernel TLS offload sweep next to it. --coro adds a sweep against the
+ coroutine server, which serves every connection from a few threads. Results are written to stdout as
+ one JSON object per line.
+ */
+#include "ookLibs/ookBench/ookNetBenchApp.h"
+#include "ookLibs/ookBench/ookNetBench.h"
+
+ookNetBenchApp::ookNetBenchApp(int argc, const char** argv)
+	: ookBenchApp(argc, argv)
+{
+	
+}
+
+ookNetBenchApp::~ookNetBenchApp()
+{
+	
+}
+
+void ookNetBenchApp::AppMain()
+{
+	try
+	{
+		string port = this->GetOption("port");
+		ookNetBench bench(port.empty() ? 13130 : atoi(port.c_str()));
+		
+		vector<int> vList = this->GetIntList("sizes");
+		if(!vList.empty())
+			bench.SetMsgSizes(vList);
+		
+		vList = this->GetIntList("conns");
+		if(!vList.empty())
+			bench.SetConnections(vList);
+		
+		vList = this->GetIntList("depths");
+		if(!vList.empty())
+			bench.SetPipelineDepths(vList);
+		
+		string msgs = this->GetOption("msgs");
+		if(!msgs.empty())
+			bench.SetMsgsPerConnection(atol(msgs.c_str()));
+		
+		bench.SetSSLCredentials(this->GetOption("cert"),
+														this->GetOption("key"));
+		
+		bench.SetKTLS(!this->GetOption("ktls").empty());
+		bench.SetCoro(!this->GetOption("coro").empty());
+		
+		bench.Run(cout);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "ookNetBenchApp: " << e.what() << endl;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,319 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookQueueBench
+ \headerfile ookQueueBench.h "ookLibs/ookBench/ookQueueBench.h"
+ \brief Hand-off throughput of the ookThread queues against a mutex queue.
+ 
+ iThreads producers push lItems longs in total through the queue, in
+ batches of iBatch, to iThreads consumers. The consumers check the sum of
+ what they got. One JSON line per point:
+ 
+ \code
+ 
+ {"queue":"mpmc","producers":4,"consumers":4,"batch":16,"items":4000000,
+  "capacity":1024,"elapsed_sec":0.18,"items_per_sec":22222222.2,
+  "vs_mutex":9.4,"cpu_ns_per_item":71.2,"failed":0}
+ 
+ \endcode
+ 
+ Queues: "mutex" is ookBenchMutexQueue, "spsc" is ookBlockingQueue over
+ ookSPSCQueue and only runs at one thread a side, and "mpmc" is
+ ookBlockingQueue over ookMPMCQueue. vs_mutex is items_per_sec relative
+ to the mutex queue at the same thread count and batch size, when the
+ mutex queue is part of the sweep. failed is non zero if items were lost
+ or duplicated.
+ */
+#include "ookLibs/ookBench/ookQueueBench.h"
+#include "ookLibs/ookThread/ookBlockingQueue.h"
+#include "ookLibs/ookThread/ookSPSCQueue.h"
+#include "ookLibs/ookThread/ookMPMCQueue.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+
+#include <cstdlib>
+#include <iomanip>
+
+ookBenchMutexQueue::ookBenchMutexQueue(size_t iCapacity)
+	: _iCapacity(iCapacity), _bClosed(false)
+{
+	
+}
+
+size_t ookBenchMutexQueue::PushBatch(const long* items, size_t iCount)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	size_t iDone = 0;
+	
+	while(iDone < iCount)
+	{
+		while(!_bClosed && (_queue.size() >= _iCapacity))
+			_notFull.wait(lock);
+		
+		if(_bClosed)
+			break;
+		
+		while((iDone < iCount) && (_queue.size() < _iCapacity))
+			_queue.push_back(items[iDone++]);
+		
+		_notEmpty.notify_all();
+	}
+	
+	return iDone;
+}
+
+size_t ookBenchMutexQueue::PopBatch(long* items, size_t iMax)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	while(!_bClosed && _queue.empty())
+		_notEmpty.wait(lock);
+	
+	size_t iPopped = 0;
+	
+	while((iPopped < iMax) && !_queue.empty())
+	{
+		items[iPopped++] = _queue.front();
+		_queue.pop_front();
+	}
+	
+	if(iPopped > 0)
+		_notFull.notify_all();
+	
+	return iPopped;
+}
+
+void ookBenchMutexQueue::Close()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_bClosed = true;
+	_notEmpty.notify_all();
+	_notFull.notify_all();
+}
+
+//Pushes the values [lFirst, lFirst + lCount)
+template<class Q>
+static void ookQueueBenchProduce(Q* queue, long lFirst, long lCount, int iBatch)
+{
+	vector<long> batch(iBatch);
+	long lNext = lFirst;
+	long lEnd = lFirst + lCount;
+	
+	while(lNext < lEnd)
+	{
+		size_t iCount = (size_t) std::min((long) iBatch, lEnd - lNext);
+		
+		for(size_t i = 0; i < iCount; i++)
+			batch[i] = lNext++;
+		
+		queue->PushBatch(&batch[0], iCount);
+	}
+}
+
+template<class Q>
+static void ookQueueBenchConsume(Q* queue, int iBatch, boost::atomic<long>* lSum, boost::atomic<long>* lCount)
+{
+	vector<long> batch(iBatch);
+	long lMySum = 0;
+	long lMyCount = 0;
+	size_t iPopped;
+	
+	while((iPopped = queue->PopBatch(&batch[0], iBatch)) > 0)
+	{
+		for(size_t i = 0; i < iPopped; i++)
+			lMySum += batch[i];
+		
+		lMyCount += iPopped;
+	}
+	
+	lSum->fetch_add(lMySum);
+	lCount->fetch_add(lMyCount);
+}
+
+//Runs one point and returns the elapsed seconds
+template<class Q>
+static double ookQueueBenchRun(Q* queue, int iThreads, int iBatch, long lItems, long& lFailed)
+{
+	boost::atomic<long> lSum(0);
+	boost::atomic<long> lCount(0);
+	
+	boost::thread_group consumers;
+	boost::thread_group producers;
+	
+	bench_clock::time_point tStart = bench_clock::now();
+	
+	for(int i = 0; i < iThreads; i++)
+		consumers.create_thread(boost::bind(&ookQueueBenchConsume<Q>, queue, iBatch, &lSum, &lCount));
+	
+	long lPer = lItems / iThreads;
+	
+	for(int i = 0; i < iThreads; i++)
+	{
+		long lFirst = i * lPer;
+		long lMine = (i == iThreads - 1) ? (lItems - lFirst) : lPer;
+		
+		producers.create_thread(boost::bind(&ookQueueBenchProduce<Q>, queue, lFirst, lMine, iBatch));
+	}
+	
+	producers.join_all();
+	queue->Close();
+	consumers.join_all();
+	
+	double dElapsed = boost::chrono::duration<double>(bench_clock::now() - tStart).count();
+	
+	long lExpected = (lItems * (lItems - 1)) / 2;
+	if(lCount.load() != lItems)
+		lFailed = std::abs(lItems - lCount.load());
+	else
+		lFailed = (lSum.load() == lExpected) ? 0 : 1;
+	
+	return dElapsed;
+}
+
+ookQueueBench::ookQueueBench()
+	: _lItems(2000000), _iCapacity(1024)
+{
+	_vQueues.push_back("mutex");
+	_vQueues.push_back("spsc");
+	_vQueues.push_back("mpmc");
+	
+	for(int i = 1; i <= 8; i *= 2)
+		_vThreads.push_back(i);
+	
+	_vBatches.push_back(1);
+	_vBatches.push_back(16);
+}
+
+ookQueueBench::~ookQueueBench()
+{
+	
+}
+
+void ookQueueBench::SetQueues(vector<string> vQueues)
+{
+	for(size_t i = 0; i < vQueues.size(); i++)
+		if((vQueues[i] != "mutex") && (vQueues[i] != "spsc") && (vQueues[i] != "mpmc"))
+			throw ookException("ookQueueBench: queues are mutex, spsc and mpmc");
+	
+	_vQueues = vQueues;
+}
+
+void ookQueueBench::SetThreadCounts(vector<int> vThreads)
+{
+	_vThreads = vThreads;
+}
+
+void ookQueueBench::SetBatchSizes(vector<int> vBatches)
+{
+	_vBatches = vBatches;
+}
+
+void ookQueueBench::SetItems(long lItems)
+{
+	_lItems = lItems;
+}
+
+void ookQueueBench::SetCapacity(int iCapacity)
+{
+	_iCapacity = iCapacity;
+}
+
+void ookQueueBench::RunPoint(ostream& out, string queue, int iThreads, int iBatch)
+{
+	long lFailed = 0;
+	double dElapsed = 0.0;
+	double dCPUStart = ookBenchStats::GetProcessCPUSeconds();
+	
+	if(queue == "mutex")
+	{
+		ookBenchMutexQueue q(_iCapacity);
+		dElapsed = ookQueueBenchRun(&q, iThreads, iBatch, _lItems, lFailed);
+	}
+	else if(queue == "spsc")
+	{
+		ookBlockingQueue< ookSPSCQueue<long> > q(_iCapacity);
+		dElapsed = ookQueueBenchRun(&q, iThreads, iBatch, _lItems, lFailed);
+	}
+	else
+	{
+		ookBlockingQueue< ookMPMCQueue<long> > q(_iCapacity);
+		dElapsed = ookQueueBenchRun(&q, iThreads, iBatch, _lItems, lFailed);
+	}
+	
+	double dCPU = ookBenchStats::GetProcessCPUSeconds() - dCPUStart;
+	double dItemsPerSec = (dElapsed > 0.0) ? _lItems / dElapsed : 0.0;
+	
+	string baseKey = ookString::ConvertInt2String(iThreads) + "/" + ookString::ConvertInt2String(iBatch);
+	if(queue == "mutex")
+		_baselines[baseKey] = dItemsPerSec;
+	
+	double dBase = (_baselines.find(baseKey) != _baselines.end()) ? _baselines[baseKey] : 0.0;
+	
+	out << std::fixed << std::setprecision(3)
+		<< "{\"queue\":\"" << queue << "\""
+		<< ",\"producers\":" << iThreads
+		<< ",\"consumers\":" << iThreads
+		<< ",\"batch\":" << iBatch
+		<< ",\"items\":" << _lItems
+		<< ",\"capacity\":" << _iCapacity
+		<< ",\"elapsed_sec\":" << dElapsed
+		<< ",\"items_per_sec\":" << dItemsPerSec
+		<< ",\"vs_mutex\":" << ((dBase > 0.0) ? dItemsPerSec / dBase : 0.0)
+		<< ",\"cpu_ns_per_item\":" << (dCPU * 1000000000.0) / _lItems
+		<< ",\"failed\":" << lFailed
+		<< "}" << endl;
+}
+
+/*! 
+ \brief Runs the full sweep, writing one JSON line per point to out.
+ */
+void ookQueueBench::Run(ostream& out)
+{
+	if(_lItems <= 0)
+		throw ookException("ookQueueBench: item count must be positive");
+	
+	_baselines.clear();
+	
+	for(size_t b = 0; b < _vBatches.size(); b++)
+		for(size_t t = 0; t < _vThreads.size(); t++)
+			for(size_t q = 0; q < _vQueues.size(); q++)
+			{
+				//One producer and one consumer is all an SPSC ring allows
+				if((_vQueues[q] == "spsc") && (_vThreads[t] != 1))
+					continue;
+				
+				this->RunPoint(out, _vQueues[q], _vThreads[t], _vBatches[b]);
+			}
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_QUEUE_BENCH_H_
+#define OOK_QUEUE_BENCH_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookBench/ookBenchStats.h"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/atomic.hpp"
+
+#include <deque>
+
+/*!
+ \brief The baseline: a bounded std::deque behind a mutex, with condition
+ variables for full and empty. This is how every hand-off in ookLibs was
+ written before the lock-free queues.
+ */
+class ookBenchMutexQueue
+{
+public:
+	
+	typedef long value_type;
+	
+	ookBenchMutexQueue(size_t iCapacity);
+	
+	size_t PushBatch(const long* items, size_t iCount);
+	size_t PopBatch(long* items, size_t iMax);
+	void Close();
+	
+private:
+	
+	size_t _iCapacity;
+	bool _bClosed;
+	std::deque<long> _queue;
+	
+	boost::mutex _mut;
+	boost::condition_variable _notEmpty;
+	boost::condition_variable _notFull;
+};
+
+class ookQueueBench
+{
+public:
+	
+	ookQueueBench();
+	virtual ~ookQueueBench();
+	
+	void SetQueues(vector<string> vQueues);
+	void SetThreadCounts(vector<int> vThreads);
+	void SetBatchSizes(vector<int> vBatches);
+	void SetItems(long lItems);
+	void SetCapacity(int iCapacity);
+	
+	void Run(ostream& out);
+	
+protected:
+	
+	void RunPoint(ostream& out, string queue, int iThreads, int iBatch);
+	
+private:
+	
+	vector<string> _vQueues;
+	vector<int> _vThreads;
+	vector<int> _vBatches;
+	long _lItems;
+	int _iCapacity;
+	
+	std::map<string, double> _baselines;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookQueueBenchApp
+ \headerfile ookQueueBenchApp.h "ookLibs/ookBench/ookQueueBenchApp.h"
+ \brief Command line front end for ookQueueBench.
+ 
+ \code
+ 
+ ookqueuebench --queues=mutex,spsc,mpmc --threads=1,2,4,8 --batch=1,16
+               --items=2000000 --capacity=1024
+ 
+ \endcode
+ 
+ --threads is the number of producers, and of consumers. Results are
+ written to stdout as one JSON object per line.
+ */
+#include "ookLibs/ookBench/ookQueueBenchApp.h"
+#include "ookLibs/ookBench/ookQueueBench.h"
+
+ookQueueBenchApp::ookQueueBenchApp(int argc, const char** argv)
+	: ookBenchApp(argc, argv)
+{
+	
+}
+
+ookQueueBenchApp::~ookQueueBenchApp()
+{
+	
+}
+
+void ookQueueBenchApp::AppMain()
+{
+	try
+	{
+		ookQueueBench bench;
+		
+		vector<string> vQueues = this->GetStringList("queues");
+		if(!vQueues.empty())
+			bench.SetQueues(vQueues);
+		
+		vector<int> vList = this->GetIntList("threads");
+		if(!vList.empty())
+			bench.SetThreadCounts(vList);
+		
+		vList = this->GetIntList("batch");
+		if(!vList.empty())
+			bench.SetBatchSizes(vList);
+		
+		string items = this->GetOption("items");
+		if(!items.empty())
+			bench.SetItems(atol(items.c_str()));
+		
+		string capacity = this->GetOption("capacity");
+		if(!capacity.empty())
+			bench.SetCapacity(atoi(capacity.c_str()));
+		
+		bench.Run(cout);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "ookQueueBenchApp: " << e.what() << endl;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,320 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookSchedBench
+ \headerfile ookSchedBench.h "ookLibs/ookBench/ookSchedBench.h"
+ \brief Task throughput benchmark for the ookThread executors.
+ 
+ Runs lTasks fine grained tasks through each scheduler at each worker
+ count and writes one JSON line per point:
+ 
+ \code
+ 
+ {"scheduler":"stealing","workload":"decrypt","pattern":"fork","threads":16,
+  "tasks":200000,"elapsed_sec":0.21,"tasks_per_sec":952380.9,"speedup":11.8,
+  "steals":5120,"cpu_us_per_task":14.9,"failed":0}
+ 
+ \endcode
+ 
+ Schedulers: "shared" is ookThreadPool (one locked queue), "stealing" is
+ ookWorkStealingPool. Workloads, each on a payload of iPayloadSize bytes:
+ "decrypt" opens an AES-128-GCM record, "inflate" zlib-decompresses a
+ block, and "noop" does nothing, so it measures pure scheduling overhead.
+ 
+ Patterns: "flat" submits every task from the driver thread, the way an
+ I/O thread hands off messages. "fork" submits one root task which splits
+ the range in half recursively, so tasks spawn tasks.
+ 
+ With SetPinned(true) every worker gets a CPU of its own, with memory on
+ that CPU's NUMA node, so runs don't depend on where the kernel happens to
+ put the workers.
+ 
+ speedup is tasks_per_sec relative to the first thread count in the sweep
+ for the same scheduler, workload and pattern. Sweep thread counts up to
+ the number of cores on the box.
+ */
+#include "ookLibs/ookBench/ookSchedBench.h"
+#include "ookLibs/ookThread/ookThreadPool.h"
+#include "ookLibs/ookThread/ookWorkStealingPool.h"
+
+#include "openssl/evp.h"
+#include "openssl/rand.h"
+
+#include <zlib.h>
+#include <iomanip>
+
+//Ranges at or below this size run as one leaf in the fork pattern
+static const long OOK_SCHED_FORK_LEAF = 1;
+
+ookSchedBench::ookSchedBench()
+	: _lTasks(200000), _iPayloadSize(1024), _bPinned(false), _pExecutor(NULL), _lRemaining(0), _lFailed(0), _pLatch(NULL)
+{
+	for(int i = 1; i <= 64; i *= 2)
+		_vThreads.push_back(i);
+	
+	_vScheds.push_back("shared");
+	_vScheds.push_back("stealing");
+	
+	_vWorkloads.push_back("noop");
+	_vWorkloads.push_back("decrypt");
+	_vWorkloads.push_back("inflate");
+	
+	_vPatterns.push_back("flat");
+	_vPatterns.push_back("fork");
+}
+
+ookSchedBench::~ookSchedBench()
+{
+	
+}
+
+void ookSchedBench::SetThreadCounts(vector<int> vThreads)
+{
+	_vThreads = vThreads;
+}
+
+void ookSchedBench::SetSchedulers(vector<string> vScheds)
+{
+	for(size_t i = 0; i < vScheds.size(); i++)
+		if((vScheds[i] != "shared") && (vScheds[i] != "stealing"))
+			throw ookException("ookSchedBench: schedulers are shared and stealing");
+	
+	_vScheds = vScheds;
+}
+
+void ookSchedBench::SetWorkloads(vector<string> vWorkloads)
+{
+	for(size_t i = 0; i < vWorkloads.size(); i++)
+		if((vWorkloads[i] != "noop") && (vWorkloads[i] != "decrypt") && (vWorkloads[i] != "inflate"))
+			throw ookException("ookSchedBench: workloads are noop, decrypt and inflate");
+	
+	_vWorkloads = vWorkloads;
+}
+
+void ookSchedBench::SetPatterns(vector<string> vPatterns)
+{
+	for(size_t i = 0; i < vPatterns.size(); i++)
+		if((vPatterns[i] != "flat") && (vPatterns[i] != "fork"))
+			throw ookException("ookSchedBench: patterns are flat and fork");
+	
+	_vPatterns = vPatterns;
+}
+
+void ookSchedBench::SetPinned(bool bPinned)
+{
+	_bPinned = bPinned;
+}
+
+void ookSchedBench::SetTasks(long lTasks)
+{
+	_lTasks = lTasks;
+}
+
+void ookSchedBench::SetPayloadSize(int iSize)
+{
+	_iPayloadSize = iSize;
+}
+
+void ookSchedBench::BuildWorkload(string kind, ookSchedWorkload& work)
+{
+	work.kind = kind;
+	work.iPlainSize = _iPayloadSize;
+	
+	vector<uchar> plain(_iPayloadSize);
+	
+	//Half random, half repeated, so the inflate case has something to do
+	RAND_bytes(&plain[0], _iPayloadSize / 2);
+	for(size_t i = _iPayloadSize / 2; i < plain.size(); i++)
+		plain[i] = (uchar) (i % 16);
+	
+	if(kind == "decrypt")
+	{
+		work.key.resize(16);
+		work.iv.resize(12);
+		work.tag.resize(16);
+		work.cipherText.resize(plain.size());
+		RAND_bytes(&work.key[0], 16);
+		RAND_bytes(&work.iv[0], 12);
+		
+		int iLen = 0;
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		EVP_EncryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, &work.key[0], &work.iv[0]);
+		EVP_EncryptUpdate(ctx, &work.cipherText[0], &iLen, &plain[0], (int) plain.size());
+		EVP_EncryptFinal_ex(ctx, &work.cipherText[0] + iLen, &iLen);
+		EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16, &work.tag[0]);
+		EVP_CIPHER_CTX_free(ctx);
+	}
+	else if(kind == "inflate")
+	{
+		uLongf iLen = compressBound(plain.size());
+		work.compressed.resize(iLen);
+		compress(&work.compressed[0], &iLen, &plain[0], plain.size());
+		work.compressed.resize(iLen);
+	}
+}
+
+void ookSchedBench::DoWork()
+{
+	bool bOk = true;
+	
+	if(_work.kind == "decrypt")
+	{
+		vector<uchar> plain(_work.cipherText.size() + 16);
+		int iLen = 0;
+		
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		EVP_DecryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, &_work.key[0], &_work.iv[0]);
+		EVP_DecryptUpdate(ctx, &plain[0], &iLen, &_work.cipherText[0], (int) _work.cipherText.size());
+		EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16, (void*) &_work.tag[0]);
+		bOk = (EVP_DecryptFinal_ex(ctx, &plain[0] + iLen, &iLen) > 0);
+		EVP_CIPHER_CTX_free(ctx);
+	}
+	else if(_work.kind == "inflate")
+	{
+		vector<uchar> plain(_work.iPlainSize);
+		uLongf iLen = plain.size();
+		
+		bOk = (uncompress(&plain[0], &iLen, &_work.compressed[0], _work.compressed.size()) == Z_OK) &&
+			(iLen == _work.iPlainSize);
+	}
+	
+	if(!bOk)
+		_lFailed.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void ookSchedBench::Leaf()
+{
+	this->DoWork();
+	
+	if(_lRemaining.fetch_sub(1) == 1)
+		_pLatch->Arrive();
+}
+
+/*
+ Hands half of the range to the executor and keeps splitting the other
+ half itself, the usual shape of divide and conquer task code.
+ */
+void ookSchedBench::Fork(long lCount)
+{
+	while(lCount > OOK_SCHED_FORK_LEAF)
+	{
+		long lHalf = lCount / 2;
+		_pExecutor->Execute(boost::bind(&ookSchedBench::Fork, this, lHalf));
+		lCount -= lHalf;
+	}
+	
+	for(long i = 0; i < lCount; i++)
+		this->Leaf();
+}
+
+void ookSchedBench::RunPoint(ostream& out, string sched, string workload, string pattern, int iThreads)
+{
+	this->BuildWorkload(workload, _work);
+	
+	ookThreadPool* shared = NULL;
+	ookWorkStealingPool* stealing = NULL;
+	
+	ookThreadOptions opts;
+	opts.bPinPerCore = _bPinned;
+	opts.name = "ook-" + sched;
+	
+	if(sched == "shared")
+		_pExecutor = shared = new ookThreadPool(iThreads, opts);
+	else
+		_pExecutor = stealing = new ookWorkStealingPool(iThreads, opts);
+	
+	ookBenchLatch latch(1);
+	_pLatch = &latch;
+	_lRemaining.store(_lTasks);
+	_lFailed.store(0);
+	
+	double dCPUStart = ookBenchStats::GetProcessCPUSeconds();
+	bench_clock::time_point tStart = bench_clock::now();
+	
+	if(pattern == "flat")
+	{
+		for(long i = 0; i < _lTasks; i++)
+			_pExecutor->Execute(boost::bind(&ookSchedBench::Leaf, this));
+	}
+	else
+		_pExecutor->Execute(boost::bind(&ookSchedBench::Fork, this, _lTasks));
+	
+	latch.Wait();
+	
+	double dElapsed = boost::chrono::duration<double>(bench_clock::now() - tStart).count();
+	double dCPU = ookBenchStats::GetProcessCPUSeconds() - dCPUStart;
+	long lSteals = stealing ? stealing->GetStealCount() : 0;
+	
+	delete shared;
+	delete stealing;
+	_pExecutor = NULL;
+	_pLatch = NULL;
+	
+	double dTasksPerSec = (dElapsed > 0.0) ? _lTasks / dElapsed : 0.0;
+	
+	string baseKey = sched + "/" + workload + "/" + pattern;
+	if(_baselines.find(baseKey) == _baselines.end())
+		_baselines[baseKey] = dTasksPerSec;
+	
+	double dBase = _baselines[baseKey];
+	
+	out << std::fixed << std::setprecision(3)
+		<< "{\"scheduler\":\"" << sched << "\""
+		<< ",\"workload\":\"" << workload << "\""
+		<< ",\"pattern\":\"" << pattern << "\""
+		<< ",\"threads\":" << iThreads
+		<< ",\"tasks\":" << _lTasks
+		<< ",\"elapsed_sec\":" << dElapsed
+		<< ",\"tasks_per_sec\":" << dTasksPerSec
+		<< ",\"speedup\":" << ((dBase > 0.0) ? dTasksPerSec / dBase : 0.0)
+		<< ",\"steals\":" << lSteals
+		<< ",\"cpu_us_per_task\":" << (dCPU * 1000000.0) / _lTasks
+		<< ",\"failed\":" << _lFailed.load()
+		<< "}" << endl;
+}
+
+/*! 
+ \brief Runs the full sweep, writing one JSON line per point to out.
+ */
+void ookSchedBench::Run(ostream& out)
+{
+	if(_lTasks <= 0)
+		throw ookException("ookSchedBench: task count must be positive");
+	
+	_baselines.clear();
+	
+	for(size_t w = 0; w < _vWorkloads.size(); w++)
+		for(size_t p = 0; p < _vPatterns.size(); p++)
+			for(size_t s = 0; s < _vScheds.size(); s++)
+				for(size_t t = 0; t < _vThreads.size(); t++)
+					this->RunPoint(out, _vScheds[s], _vWorkloads[w], _vPatterns[p], _vThreads[t]);
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_SCHED_BENCH_H_
+#define OOK_SCHED_BENCH_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookBench/ookBenchStats.h"
+#include "ookLibs/ookBench/ookBenchLatch.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+
+#include "boost/atomic.hpp"
+
+/*!
+ \brief Inputs for the per task workloads, built once per run so the tasks
+ only do the decrypt or inflate itself.
+ */
+struct ookSchedWorkload
+{
+	string kind;
+	
+	vector<uchar> key;
+	vector<uchar> iv;
+	vector<uchar> cipherText;
+	vector<uchar> tag;
+	
+	vector<uchar> compressed;
+	size_t iPlainSize;
+};
+
+class ookSchedBench
+{
+public:
+	
+	ookSchedBench();
+	virtual ~ookSchedBench();
+	
+	void SetThreadCounts(vector<int> vThreads);
+	void SetSchedulers(vector<string> vScheds);
+	void SetWorkloads(vector<string> vWorkloads);
+	void SetPatterns(vector<string> vPatterns);
+	void SetTasks(long lTasks);
+	void SetPayloadSize(int iSize);
+	void SetPinned(bool bPinned);
+	
+	void Run(ostream& out);
+	
+protected:
+	
+	void RunPoint(ostream& out, string sched, string workload, string pattern, int iThreads);
+	void BuildWorkload(string kind, ookSchedWorkload& work);
+	
+	void Leaf();
+	void Fork(long lCount);
+	void DoWork();
+	
+private:
+	
+	vector<int> _vThreads;
+	vector<string> _vScheds;
+	vector<string> _vWorkloads;
+	vector<string> _vPatterns;
+	long _lTasks;
+	int _iPayloadSize;
+	bool _bPinned;
+	
+	//State for the point being run
+	ookExecutor* _pExecutor;
+	ookSchedWorkload _work;
+	boost::atomic<long> _lRemaining;
+	boost::atomic<long> _lFailed;
+	ookBenchLatch* _pLatch;
+	
+	std::map<string, double> _baselines;
+};
+
+#endif
\ No newline at end of file
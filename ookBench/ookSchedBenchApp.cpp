@@ -0,0 +1,100 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookSchedBenchApp
+ \headerfile ookSchedBenchApp.h "ookLibs/ookBench/ookSchedBenchApp.h"
+ \brief Command line front end for ookSchedBench.
+ 
+ \code
+ 
+ ookschedbench --threads=1,2,4,8,16,32,64 --scheds=shared,stealing
+               --workloads=noop,decrypt,inflate --patterns=flat,fork
+               --tasks=200000 --payload=1024 --pin
+ 
+ \endcode
+ 
+ --pin pins each worker to its own CPU. Results are written to stdout as
+ one JSON object per line.
+ */
+#include "ookLibs/ookBench/ookSchedBenchApp.h"
+#include "ookLibs/ookBench/ookSchedBench.h"
+
+ookSchedBenchApp::ookSchedBenchApp(int argc, const char** argv)
+	: ookBenchApp(argc, argv)
+{
+	
+}
+
+ookSchedBenchApp::~ookSchedBenchApp()
+{
+	
+}
+
+void ookSchedBenchApp::AppMain()
+{
+	try
+	{
+		ookSchedBench bench;
+		
+		vector<int> vThreads = this->GetIntList("threads");
+		if(!vThreads.empty())
+			bench.SetThreadCounts(vThreads);
+		
+		vector<string> vList = this->GetStringList("scheds");
+		if(!vList.empty())
+			bench.SetSchedulers(vList);
+		
+		vList = this->GetStringList("workloads");
+		if(!vList.empty())
+			bench.SetWorkloads(vList);
+		
+		vList = this->GetStringList("patterns");
+		if(!vList.empty())
+			bench.SetPatterns(vList);
+		
+		string tasks = this->GetOption("tasks");
+		if(!tasks.empty())
+			bench.SetTasks(atol(tasks.c_str()));
+		
+		string payload = this->GetOption("payload");
+		if(!payload.empty())
+			bench.SetPayloadSize(atoi(payload.c_str()));
+		
+		bench.SetPinned(!this->GetOption("pin").empty());
+		
+		bench.Run(cout);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "ookSchedBenchApp: " << e.what() << endl;
+	}
+}
\ No newline at end of file
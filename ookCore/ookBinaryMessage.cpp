@@ -0,0 +1,111 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookBinaryMessage
+ \headerfile ookBinaryMessage.h "ookLibs/ookCore/ookBinaryMessage.h"
+ \brief Derived ookMessage which carries a view of a shared ookBuffer
+ rather than a copy of the bytes.
+ 
+ \code
+ 
+ void ookFeed::HandleMsg(ookBinaryMessage* msg)
+ {
+ 	boost::string_view body = msg->GetStringView();	//Reads the socket's buffer in place
+ 	ookBufferView header = msg->Slice(0, 8);	//Shares it, for keeping past the call
+ 	...
+ }
+ 
+ \endcode
+ 
+ Copies, Clone() included, share the buffer, so an asynchronous
+ dispatcher queues the message without touching the payload. A pooled
+ message lets go of its buffer when it is recycled.
+ */
+#include "ookLibs/ookCore/ookBinaryMessage.h"
+
+ookBinaryMessage::ookBinaryMessage()
+{
+	
+}
+
+ookBinaryMessage::ookBinaryMessage(const ookBufferView& payload)
+	: _payload(payload)
+{
+	
+}
+
+ookBinaryMessage::~ookBinaryMessage()
+{
+	
+}
+
+ookMessage* ookBinaryMessage::Clone() const
+{
+	return new ookBinaryMessage(*this);
+}
+
+//Don't keep a pooled message's buffer alive while it sits in the pool
+void ookBinaryMessage::OnRecycle()
+{
+	_payload.Reset();
+	ookMessage::OnRecycle();
+}
+
+const ookBufferView& ookBinaryMessage::GetPayload() const
+{
+	return _payload;
+}
+
+void ookBinaryMessage::SetPayload(const ookBufferView& payload)
+{
+	_payload = payload;
+}
+
+const char* ookBinaryMessage::GetData() const
+{
+	return _payload.GetData();
+}
+
+size_t ookBinaryMessage::GetSize() const
+{
+	return _payload.GetSize();
+}
+
+boost::string_view ookBinaryMessage::GetStringView() const
+{
+	return _payload.GetStringView();
+}
+
+ookBufferView ookBinaryMessage::Slice(size_t iOffset, size_t iSize) const
+{
+	return _payload.Slice(iOffset, iSize);
+}
\ No newline at end of file
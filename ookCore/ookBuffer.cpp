@@ -0,0 +1,170 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookBuffer
+ \headerfile ookBuffer.h "ookLibs/ookCore/ookBuffer.h"
+ \brief Reference counted block of bytes, such as a frame read off a
+ socket, that any number of messages and ookBufferViews can share.
+ 
+ \code
+ 
+ buffer_ptr buf = ookBuffer::Create(iFrameSize);
+ asio::read(*sock, asio::buffer(buf->GetData(), buf->GetSize()));
+ 
+ ookBufferView frame(buf);
+ ookBufferView body = frame.Slice(iHeaderSize);	//No copy, shares buf
+ 
+ \endcode
+ 
+ A buffer is freed when the last buffer_ptr or view of it goes, on
+ whichever thread that is. Fill it before sharing it: once it is handed
+ to a view or message, it must not change.
+ */
+
+/*! 
+ \class ookBufferView
+ \headerfile ookBuffer.h "ookLibs/ookCore/ookBuffer.h"
+ \brief A range of bytes in an ookBuffer, which keeps the buffer alive.
+ 
+ Copying and slicing a view only bumps the buffer's reference count. The
+ bytes are read in place through GetData()/GetSize(), GetStringView(), or
+ GetAsioBuffer() for writing them straight back out. ToString() is the
+ only accessor that copies.
+ */
+#include "ookLibs/ookCore/ookBuffer.h"
+#include "ookLibs/ookCore/ookException.h"
+
+/*! 
+ \brief Returns a new buffer of iSize uninitialized bytes.
+ */
+buffer_ptr ookBuffer::Create(size_t iSize)
+{
+	return buffer_ptr(new ookBuffer(iSize));
+}
+
+ookBuffer::ookBuffer(size_t iSize)
+	: _iRefs(0), _iSize(iSize), _pData(new char[iSize ? iSize : 1])
+{
+	
+}
+
+ookBuffer::~ookBuffer()
+{
+	delete [] _pData;
+}
+
+char* ookBuffer::GetData()
+{
+	return _pData;
+}
+
+const char* ookBuffer::GetData() const
+{
+	return _pData;
+}
+
+size_t ookBuffer::GetSize() const
+{
+	return _iSize;
+}
+
+int ookBuffer::GetRefCount() const
+{
+	return _iRefs.load(boost::memory_order_relaxed);
+}
+
+ookBufferView::ookBufferView()
+	: _iOffset(0), _iSize(0)
+{
+	
+}
+
+ookBufferView::ookBufferView(const buffer_ptr& buf)
+	: _buf(buf), _iOffset(0), _iSize(buf ? buf->GetSize() : 0)
+{
+	
+}
+
+ookBufferView::ookBufferView(const buffer_ptr& buf, size_t iOffset, size_t iSize)
+	: _buf(buf), _iOffset(iOffset), _iSize(iSize)
+{
+	size_t iBufSize = buf ? buf->GetSize() : 0;
+	
+	if((iOffset > iBufSize) || (iSize > iBufSize - iOffset))
+		throw ookException("ookBufferView range is outside its buffer");
+}
+
+const buffer_ptr& ookBufferView::GetBuffer() const
+{
+	return _buf;
+}
+
+/*! 
+ \brief Returns the view from iOffset to its end.
+ */
+ookBufferView ookBufferView::Slice(size_t iOffset) const
+{
+	if(iOffset > _iSize)
+		throw ookException("ookBufferView::Slice offset is past the end of the view");
+	
+	return this->Slice(iOffset, _iSize - iOffset);
+}
+
+/*! 
+ \brief Returns iSize bytes of the view starting at iOffset, sharing the
+ same buffer. Throws an ookException if they run past the end of the view.
+ */
+ookBufferView ookBufferView::Slice(size_t iOffset, size_t iSize) const
+{
+	if((iOffset > _iSize) || (iSize > _iSize - iOffset))
+		throw ookException("ookBufferView::Slice range is past the end of the view");
+	
+	if(iSize == 0)
+		return ookBufferView();
+	
+	return ookBufferView(_buf, _iOffset + iOffset, iSize);
+}
+
+string ookBufferView::ToString() const
+{
+	return string(this->GetData() ? this->GetData() : "", _iSize);
+}
+
+/*! 
+ \brief Drops the view's reference to its buffer.
+ */
+void ookBufferView::Reset()
+{
+	_buf.reset();
+	_iOffset = 0;
+	_iSize = 0;
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_BUFFER_H_
+#define OOK_BUFFER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/atomic.hpp"
+#include "boost/intrusive_ptr.hpp"
+#include "boost/utility/string_view.hpp"
+
+class ookBuffer
+{
+public:
+	
+	static boost::intrusive_ptr<ookBuffer> Create(size_t iSize);
+	
+	virtual ~ookBuffer();
+	
+	char* GetData();
+	const char* GetData() const;
+	size_t GetSize() const;
+	
+	void AddRef() const;
+	void Release() const;
+	int GetRefCount() const;
+	
+protected:
+	
+	ookBuffer(size_t iSize);
+	
+private:
+	
+	ookBuffer(const ookBuffer&);
+	ookBuffer& operator=(const ookBuffer&);
+	
+	mutable boost::atomic<int> _iRefs;
+	size_t _iSize;
+	char* _pData;
+};
+
+typedef boost::intrusive_ptr<ookBuffer> buffer_ptr;
+
+inline void ookBuffer::AddRef() const
+{
+	_iRefs.fetch_add(1, boost::memory_order_relaxed);
+}
+
+inline void ookBuffer::Release() const
+{
+	if(_iRefs.fetch_sub(1, boost::memory_order_release) != 1)
+		return;
+	
+	boost::atomic_thread_fence(boost::memory_order_acquire);
+	delete this;
+}
+
+inline void intrusive_ptr_add_ref(const ookBuffer* buf)
+{
+	buf->AddRef();
+}
+
+inline void intrusive_ptr_release(const ookBuffer* buf)
+{
+	buf->Release();
+}
+
+class ookBufferView
+{
+public:
+	
+	ookBufferView();
+	ookBufferView(const buffer_ptr& buf);
+	ookBufferView(const buffer_ptr& buf, size_t iOffset, size_t iSize);
+	
+	const char* GetData() const;
+	size_t GetSize() const;
+	bool IsEmpty() const;
+	
+	const buffer_ptr& GetBuffer() const;
+	
+	ookBufferView Slice(size_t iOffset) const;
+	ookBufferView Slice(size_t iOffset, size_t iSize) const;
+	
+	boost::string_view GetStringView() const;
+	asio::const_buffer GetAsioBuffer() const;
+	string ToString() const;
+	
+	void Reset();
+	
+protected:
+	
+private:
+	
+	buffer_ptr _buf;
+	size_t _iOffset;
+	size_t _iSize;
+};
+
+inline const char* ookBufferView::GetData() const
+{
+	return _buf ? _buf->GetData() + _iOffset : NULL;
+}
+
+inline size_t ookBufferView::GetSize() const
+{
+	return _iSize;
+}
+
+inline bool ookBufferView::IsEmpty() const
+{
+	return (_iSize == 0);
+}
+
+inline boost::string_view ookBufferView::GetStringView() const
+{
+	return boost::string_view(this->GetData(), _iSize);
+}
+
+inline asio::const_buffer ookBufferView::GetAsioBuffer() const
+{
+	return asio::const_buffer(this->GetData(), _iSize);
+}
+
+#endif
\ No newline at end of file
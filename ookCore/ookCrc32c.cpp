@@ -0,0 +1,175 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookCore/ookCrc32c.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OOK_CRC32C_X86 1
+#include <nmmintrin.h>
+#endif
+
+/*!
+ \class ookCrc32c
+ \headerfile ookCrc32c.h "ookLibs/ookCore/ookCrc32c.h"
+ \brief CRC-32C (Castagnoli), the checksum on ookMsgLog records.
+ 
+ On x86 CPUs with SSE4.2 this uses the crc32 instruction, eight bytes at
+ a time, which is close to free next to encoding the record. Elsewhere it
+ falls back to slicing-by-8 tables. Both give the same result, so a log
+ written on one machine checks out on any other.
+ 
+ \code
+ 
+ boost::uint32_t iCrc = ookCrc32c::Compute(pRecord, iSize);
+ 
+ \endcode
+ 
+ Pass a previous result as iCrc to continue a checksum over several
+ pieces.
+ */
+
+//Reflected Castagnoli polynomial
+#define OOK_CRC32C_POLY 0x82F63B78
+
+//_vTable[k][b] is the CRC of byte b followed by k zero bytes
+struct ookCrc32cTables
+{
+	boost::uint32_t vTable[8][256];
+	
+	ookCrc32cTables()
+	{
+		for(int b = 0; b < 256; b++)
+		{
+			boost::uint32_t iCrc = b;
+			
+			for(int k = 0; k < 8; k++)
+				iCrc = (iCrc & 1) ? ((iCrc >> 1) ^ OOK_CRC32C_POLY) : (iCrc >> 1);
+			
+			vTable[0][b] = iCrc;
+		}
+		
+		for(int b = 0; b < 256; b++)
+			for(int k = 1; k < 8; k++)
+				vTable[k][b] = (vTable[k - 1][b] >> 8) ^ vTable[0][vTable[k - 1][b] & 0xFF];
+	}
+};
+
+//Built before main(), so there's no first-use race
+static const ookCrc32cTables ookCrc32cTable;
+
+#ifdef OOK_CRC32C_X86
+static const bool ookCrc32cHasSSE42 = __builtin_cpu_supports("sse4.2");
+#else
+static const bool ookCrc32cHasSSE42 = false;
+#endif
+
+boost::uint32_t ookCrc32c::Compute(const char* pData, size_t iSize, boost::uint32_t iCrc)
+{
+	if(ookCrc32cHasSSE42)
+		return ComputeHardware(pData, iSize, iCrc);
+	
+	return ComputeSoftware(pData, iSize, iCrc);
+}
+
+/*! 
+ \brief True when Compute() runs on the CPU's crc32 instruction.
+ */
+bool ookCrc32c::IsHardware()
+{
+	return ookCrc32cHasSSE42;
+}
+
+boost::uint32_t ookCrc32c::ComputeSoftware(const char* pData, size_t iSize, boost::uint32_t iCrc)
+{
+	const unsigned char* p = (const unsigned char*) pData;
+	const boost::uint32_t (*t)[256] = ookCrc32cTable.vTable;
+	
+	iCrc = ~iCrc;
+	
+	//Eight bytes per step, little endian
+	while(iSize >= 8)
+	{
+		boost::uint32_t iLow = iCrc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((boost::uint32_t) p[3] << 24));
+		boost::uint32_t iHigh = p[4] | (p[5] << 8) | (p[6] << 16) | ((boost::uint32_t) p[7] << 24);
+		
+		iCrc = t[7][iLow & 0xFF] ^ t[6][(iLow >> 8) & 0xFF] ^ t[5][(iLow >> 16) & 0xFF] ^ t[4][iLow >> 24] ^
+			t[3][iHigh & 0xFF] ^ t[2][(iHigh >> 8) & 0xFF] ^ t[1][(iHigh >> 16) & 0xFF] ^ t[0][iHigh >> 24];
+		
+		p += 8;
+		iSize -= 8;
+	}
+	
+	while(iSize-- > 0)
+		iCrc = (iCrc >> 8) ^ t[0][(iCrc ^ *p++) & 0xFF];
+	
+	return ~iCrc;
+}
+
+#ifdef OOK_CRC32C_X86
+
+//Compiled for SSE4.2 on its own, so the rest of the library needn't be
+__attribute__((target("sse4.2")))
+boost::uint32_t ookCrc32c::ComputeHardware(const char* pData, size_t iSize, boost::uint32_t iCrc)
+{
+	iCrc = ~iCrc;
+	
+#ifdef __x86_64__
+	boost::uint64_t iCrc64 = iCrc;
+	
+	while(iSize >= 8)
+	{
+		boost::uint64_t iWord;
+		memcpy(&iWord, pData, 8);
+		
+		iCrc64 = _mm_crc32_u64(iCrc64, iWord);
+		
+		pData += 8;
+		iSize -= 8;
+	}
+	
+	iCrc = (boost::uint32_t) iCrc64;
+#endif
+	
+	while(iSize-- > 0)
+		iCrc = _mm_crc32_u8(iCrc, (unsigned char) *pData++);
+	
+	return ~iCrc;
+}
+
+#else
+
+boost::uint32_t ookCrc32c::ComputeHardware(const char* pData, size_t iSize, boost::uint32_t iCrc)
+{
+	return ComputeSoftware(pData, iSize, iCrc);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,411 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookDispatchProfiler
+ \headerfile ookDispatchProfiler.h "ookLibs/ookCore/ookDispatchProfiler.h"
+ \brief Per observer timings for an ookMsgDispatcher, and sampled traces
+ of where messages go.
+ 
+ Set on a dispatcher, it times every call into every observer and counts
+ the exceptions they throw, so a slow or failing observer shows up by
+ name instead of as a slow PostMsg():
+ 
+ \code
+ 
+ ookDispatchProfiler profiler;
+ profiler.SetSampling(1000);		//Trace one post in a thousand
+ dispatcher.SetProfiler(&profiler);
+ ...
+ profiler.Report(cout);			//One JSON line per observer
+ 
+ std::ofstream trace("dispatch.json");
+ profiler.WriteTrace(trace);		//Open in chrome://tracing or Perfetto
+ 
+ \endcode
+ 
+ Report() writes a line per observer, slowest handlers easiest to spot by
+ their percentiles:
+ 
+ \code
+ 
+ {"id":3,"observer":"ookMsgObserver<ookBook, ookTextMessage>","topic":"orders.*",
+  "calls":120000,"messages":120000,"exceptions":2,
+  "us_avg":1.9,"us_p50":1.2,"us_p99":14.8,"us_max":211.4}
+ 
+ \endcode
+ 
+ Sampling picks one post in SetSampling() for tracing, stamping the
+ message with a trace id (see ookMessage::SetTraceId()). Every step that
+ handles a traced message records a span: the ookTCPServerThread read of
+ its frame, the post and each observer's call, on whatever thread it ran, with how long
+ the message sat in the observer's queue. WriteTrace() writes the spans
+ in the Chrome trace event format, with flow arrows joining the spans of
+ each message across threads.
+ 
+ Timing reads the clock twice per observer call and updates a histogram,
+ on the order of 100 ns a call, so it is meant to be switched on to find
+ a problem rather than left on for the fastest paths. Without a profiler
+ the dispatcher pays nothing for it.
+ 
+ The last SetTraceCapacity() spans are kept. Observer profiles stay after
+ the observer is unregistered, so its numbers can still be read. The
+ profiler must outlive the dispatchers it is set on.
+ */
+#include "ookLibs/ookCore/ookDispatchProfiler.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+#include <algorithm>
+#include <iomanip>
+
+/*! 
+ \class ookObserverProfile
+ \headerfile ookDispatchProfiler.h "ookLibs/ookCore/ookDispatchProfiler.h"
+ \brief Call counts, call times and exceptions for one observer.
+ */
+ookObserverProfile::ookObserverProfile(long lId, const string& name, const string& topic)
+	: _lId(lId), _name(name), _topic(topic), _lMessages(0), _lExceptions(0)
+{
+	
+}
+
+ookObserverProfile::~ookObserverProfile()
+{
+	
+}
+
+/*! 
+ \brief One call into the observer, handing it iMessages messages.
+ */
+void ookObserverProfile::RecordCall(boost::chrono::nanoseconds elapsed, size_t iMessages)
+{
+	_calls.RecordDelivered(elapsed);
+	_lMessages.fetch_add((long) iMessages, boost::memory_order_relaxed);
+}
+
+void ookObserverProfile::RecordException()
+{
+	_lExceptions.fetch_add(1, boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief The subscription id RegisterObserver() returned.
+ */
+long ookObserverProfile::GetId() const
+{
+	return _lId;
+}
+
+/*! 
+ \brief The observer's class, such as
+ "ookMsgObserver<ookBook, ookTextMessage>".
+ */
+const string& ookObserverProfile::GetName() const
+{
+	return _name;
+}
+
+const string& ookObserverProfile::GetTopic() const
+{
+	return _topic;
+}
+
+long ookObserverProfile::GetCallCount() const
+{
+	return _calls.GetDeliveredCount();
+}
+
+/*! 
+ \brief Messages handed over, more than the calls for observers that take
+ batches.
+ */
+long ookObserverProfile::GetMessageCount() const
+{
+	return _lMessages.load(boost::memory_order_relaxed);
+}
+
+long ookObserverProfile::GetExceptionCount() const
+{
+	return _lExceptions.load(boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief How long each call took, as latency in an ookDispatchStats.
+ */
+const ookDispatchStats& ookObserverProfile::GetCallTimes() const
+{
+	return _calls;
+}
+
+void ookObserverProfile::Report(ostream& out) const
+{
+	//Left as the caller had them
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize iPrecision = out.precision();
+	
+	out << std::fixed << std::setprecision(1)
+		<< "{\"id\":" << _lId
+		<< ",\"observer\":";
+	ookString::WriteJSONString(out, _name);
+	out << ",\"topic\":";
+	ookString::WriteJSONString(out, _topic);
+	out << ",\"calls\":" << this->GetCallCount()
+		<< ",\"messages\":" << this->GetMessageCount()
+		<< ",\"exceptions\":" << this->GetExceptionCount()
+		<< ",\"us_avg\":" << _calls.GetLatencyAvg()
+		<< ",\"us_p50\":" << _calls.GetLatencyPercentile(50.0)
+		<< ",\"us_p99\":" << _calls.GetLatencyPercentile(99.0)
+		<< ",\"us_max\":" << _calls.GetLatencyMax()
+		<< "}" << endl;
+	
+	out.flags(flags);
+	out.precision(iPrecision);
+}
+
+ookDispatchProfiler::ookDispatchProfiler()
+	: _lEvery(0), _lPosts(0), _tStart(ookClock::Now()), _iCapacity(OOK_PROFILER_TRACE_SPANS)
+{
+	
+}
+
+ookDispatchProfiler::~ookDispatchProfiler()
+{
+	
+}
+
+/*! 
+ \brief Traces one post in lEvery, or none with 0 (the default). Only
+ traced messages cost more than the timing of observer calls.
+ */
+void ookDispatchProfiler::SetSampling(long lEvery)
+{
+	_lEvery.store(std::max(lEvery, 0L), boost::memory_order_relaxed);
+}
+
+void ookDispatchProfiler::SetTraceCapacity(size_t iSpans)
+{
+	boost::mutex::scoped_lock lock(_traceMut);
+	
+	_iCapacity = iSpans;
+	
+	while(_spans.size() > _iCapacity)
+		_spans.pop_front();
+}
+
+/*! 
+ \brief Makes the profile for a newly registered observer. Called by
+ ookMsgDispatcher; the profiler keeps it.
+ */
+ookObserverProfile* ookDispatchProfiler::AddObserver(long lId, const string& name, const string& topic)
+{
+	profile_ptr profile(new ookObserverProfile(lId, name, topic));
+	
+	boost::mutex::scoped_lock lock(_profileMut);
+	_vProfiles.push_back(profile);
+	
+	return profile.get();
+}
+
+/*! 
+ \brief Every observer profiled so far, in registration order.
+ */
+vector<profile_ptr> ookDispatchProfiler::GetProfiles()
+{
+	boost::mutex::scoped_lock lock(_profileMut);
+	return _vProfiles;
+}
+
+/*! 
+ \brief Returns a new trace id if this post is one to trace, else 0.
+ */
+boost::uint64_t ookDispatchProfiler::Sample()
+{
+	long lEvery = _lEvery.load(boost::memory_order_relaxed);
+	
+	if(lEvery <= 0)
+		return 0;
+	
+	boost::uint64_t lPost = _lPosts.fetch_add(1, boost::memory_order_relaxed) + 1;
+	
+	if((lPost % lEvery) != 0)
+		return 0;
+	
+	return lPost;
+}
+
+/*! 
+ \brief Records that msg spent tStart to tEnd in the step name, on the
+ calling thread. pPosted, when known, is when it was queued.
+ */
+void ookDispatchProfiler::RecordSpan(boost::uint64_t lTraceId, const string& name, ook_clock::time_point tStart,
+																		 ook_clock::time_point tEnd, ookMessage* msg, const ook_clock::time_point* pPosted, bool bFailed)
+{
+	ookTraceSpan span;
+	span.lTraceId = lTraceId;
+	span.name = name;
+	span.msgType = msg->GetType()->GetName();
+	span.topic = msg->GetTopic();
+	span.lStart = boost::chrono::duration_cast<boost::chrono::nanoseconds>(tStart - _tStart).count();
+	span.lDuration = boost::chrono::duration_cast<boost::chrono::nanoseconds>(tEnd - tStart).count();
+	span.lQueued = pPosted ? boost::chrono::duration_cast<boost::chrono::nanoseconds>(tStart - *pPosted).count() : -1;
+	span.bFailed = bFailed;
+	
+	boost::mutex::scoped_lock lock(_traceMut);
+	
+	if(_iCapacity == 0)
+		return;
+	
+	span.iThread = this->GetThreadNumber();
+	
+	if(_spans.size() >= _iCapacity)
+		_spans.pop_front();
+	
+	_spans.push_back(span);
+}
+
+/*! 
+ \brief Writes each observer's profile as a line of JSON.
+ */
+void ookDispatchProfiler::Report(ostream& out)
+{
+	vector<profile_ptr> vProfiles = this->GetProfiles();
+	
+	for(size_t i = 0; i < vProfiles.size(); i++)
+		vProfiles[i]->Report(out);
+}
+
+/*! 
+ \brief Writes the recorded spans as a Chrome trace event file, for
+ chrome://tracing or ui.perfetto.dev. Times are in microseconds from the
+ profiler's creation.
+ */
+void ookDispatchProfiler::WriteTrace(ostream& out)
+{
+	vector<ookTraceSpan> vSpans;
+	
+	{
+		boost::mutex::scoped_lock lock(_traceMut);
+		vSpans.assign(_spans.begin(), _spans.end());
+	}
+	
+	std::stable_sort(vSpans.begin(), vSpans.end(), &ookDispatchProfiler::SpanBefore);
+	
+	//Each trace's spans, in time order, for its flow arrows
+	std::map<boost::uint64_t, vector<size_t> > traces;
+	
+	for(size_t i = 0; i < vSpans.size(); i++)
+		traces[vSpans[i].lTraceId].push_back(i);
+	
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize iPrecision = out.precision();
+	
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+	
+	for(size_t i = 0; i < vSpans.size(); i++)
+	{
+		const ookTraceSpan& span = vSpans[i];
+		
+		out << ((i > 0) ? ",\n" : "\n")
+			<< "{\"name\":";
+		ookString::WriteJSONString(out, span.name);
+		out << ",\"cat\":\"dispatch\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.iThread
+			<< ",\"ts\":" << (span.lStart / 1000.0)
+			<< ",\"dur\":" << (span.lDuration / 1000.0)
+			<< ",\"args\":{\"trace\":" << span.lTraceId
+			<< ",\"msg\":";
+		ookString::WriteJSONString(out, span.msgType);
+		out << ",\"topic\":";
+		ookString::WriteJSONString(out, span.topic);
+		
+		if(span.lQueued >= 0)
+			out << ",\"queued_us\":" << (span.lQueued / 1000.0);
+		
+		if(span.bFailed)
+			out << ",\"exception\":true";
+		
+		out << "}}";
+		
+		const vector<size_t>& vFlow = traces[span.lTraceId];
+		
+		if(vFlow.size() < 2)
+			continue;
+		
+		//Start in the first span, step through the middle ones and end in
+		//the last, each bound to the span it is in
+		const char* pPhase = "t";
+		
+		if(i == vFlow.front())
+			pPhase = "s";
+		else if(i == vFlow.back())
+			pPhase = "f";
+		
+		out << ",\n{\"name\":\"message\",\"cat\":\"dispatch\",\"ph\":\"" << pPhase << "\",\"bp\":\"e\",\"id\":" << span.lTraceId
+			<< ",\"pid\":1,\"tid\":" << span.iThread
+			<< ",\"ts\":" << (span.lStart / 1000.0) << "}";
+	}
+	
+	out << "\n],\"displayTimeUnit\":\"ns\"}" << endl;
+	
+	out.flags(flags);
+	out.precision(iPrecision);
+}
+
+void ookDispatchProfiler::ClearTrace()
+{
+	boost::mutex::scoped_lock lock(_traceMut);
+	_spans.clear();
+}
+
+size_t ookDispatchProfiler::GetSpanCount()
+{
+	boost::mutex::scoped_lock lock(_traceMut);
+	return _spans.size();
+}
+
+//Small numbers for the trace's thread rows. Called with _traceMut held.
+int ookDispatchProfiler::GetThreadNumber()
+{
+	boost::thread::id id = boost::this_thread::get_id();
+	std::map<boost::thread::id, int>::iterator it = _threads.find(id);
+	
+	if(it != _threads.end())
+		return it->second;
+	
+	int iNumber = (int) _threads.size() + 1;
+	_threads[id] = iNumber;
+	
+	return iNumber;
+}
+
+bool ookDispatchProfiler::SpanBefore(const ookTraceSpan& a, const ookTraceSpan& b)
+{
+	return a.lStart < b.lStart;
+}
\ No newline at end of file
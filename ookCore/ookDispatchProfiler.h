@@ -0,0 +1,147 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_DISPATCH_PROFILER_H_
+#define OOK_DISPATCH_PROFILER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookDispatchStats.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/thread.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/atomic.hpp"
+#include "boost/cstdint.hpp"
+
+#include <deque>
+#include <map>
+
+//Trace spans kept for WriteTrace() by default; the oldest go first
+#define OOK_PROFILER_TRACE_SPANS 65536
+
+class ookObserverProfile
+{
+public:
+	
+	ookObserverProfile(long lId, const string& name, const string& topic);
+	virtual ~ookObserverProfile();
+	
+	void RecordCall(boost::chrono::nanoseconds elapsed, size_t iMessages);
+	void RecordException();
+	
+	long GetId() const;
+	const string& GetName() const;
+	const string& GetTopic() const;
+	
+	long GetCallCount() const;
+	long GetMessageCount() const;
+	long GetExceptionCount() const;
+	const ookDispatchStats& GetCallTimes() const;
+	
+	void Report(ostream& out) const;
+	
+protected:
+	
+private:
+	
+	ookObserverProfile(const ookObserverProfile&);
+	ookObserverProfile& operator=(const ookObserverProfile&);
+	
+	long _lId;
+	string _name;
+	string _topic;
+	
+	ookDispatchStats _calls;
+	boost::atomic<long> _lMessages;
+	boost::atomic<long> _lExceptions;
+};
+
+typedef boost::shared_ptr<ookObserverProfile> profile_ptr;
+
+class ookDispatchProfiler
+{
+public:
+	
+	ookDispatchProfiler();
+	virtual ~ookDispatchProfiler();
+	
+	void SetSampling(long lEvery);
+	void SetTraceCapacity(size_t iSpans);
+	
+	ookObserverProfile* AddObserver(long lId, const string& name, const string& topic);
+	vector<profile_ptr> GetProfiles();
+	
+	boost::uint64_t Sample();
+	void RecordSpan(boost::uint64_t lTraceId, const string& name, ook_clock::time_point tStart, ook_clock::time_point tEnd,
+									ookMessage* msg, const ook_clock::time_point* pPosted = NULL, bool bFailed = false);
+	
+	void Report(ostream& out);
+	void WriteTrace(ostream& out);
+	void ClearTrace();
+	size_t GetSpanCount();
+	
+protected:
+	
+	int GetThreadNumber();
+	
+private:
+	
+	ookDispatchProfiler(const ookDispatchProfiler&);
+	ookDispatchProfiler& operator=(const ookDispatchProfiler&);
+	
+	struct ookTraceSpan
+	{
+		boost::uint64_t lTraceId;
+		string name;
+		string msgType;
+		string topic;
+		boost::int64_t lStart;
+		boost::int64_t lDuration;
+		boost::int64_t lQueued;
+		int iThread;
+		bool bFailed;
+	};
+	
+	static bool SpanBefore(const ookTraceSpan& a, const ookTraceSpan& b);
+	
+	boost::atomic<long> _lEvery;
+	boost::atomic<boost::uint64_t> _lPosts;
+	ook_clock::time_point _tStart;
+	
+	boost::mutex _profileMut;
+	vector<profile_ptr> _vProfiles;
+	
+	boost::mutex _traceMut;
+	std::deque<ookTraceSpan> _spans;
+	size_t _iCapacity;
+	std::map<boost::thread::id, int> _threads;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookDispatchStats
+ \headerfile ookDispatchStats.h "ookLibs/ookCore/ookDispatchStats.h"
+ \brief Counters and delivery latency for an asynchronous ookMsgDispatcher.
+ 
+ Latency is measured from PostMsg() to the moment a worker hands the
+ message to the observer, so it is the time spent queued. It is kept in a
+ log-linear histogram of four buckets per power of two, so percentiles are
+ within about 12% of the true value whatever the range. Everything is
+ relaxed atomics; a snapshot taken while messages flow may be a few counts
+ out between fields.
+ 
+ Report() writes a single JSON object:
+ 
+ \code
+ 
+ {"queued":120000,"delivered":119890,"dropped":110,"rejected":0,
+  "lat_us_avg":41.7,"lat_us_p50":18.4,"lat_us_p99":610.2,"lat_us_max":2210.9}
+ 
+ \endcode
+ */
+#include "ookLibs/ookCore/ookDispatchStats.h"
+
+#include <cmath>
+#include <iomanip>
+
+ookDispatchStats::ookDispatchStats()
+	: _lQueued(0), _lDelivered(0), _lDropped(0), _lRejected(0), _lLatencyNanos(0), _lMaxLatencyNanos(0)
+{
+	for(int i = 0; i < OOK_DISPATCH_LATENCY_BUCKETS; i++)
+		_vBuckets[i].store(0, boost::memory_order_relaxed);
+}
+
+ookDispatchStats::~ookDispatchStats()
+{
+	
+}
+
+void ookDispatchStats::RecordQueued()
+{
+	_lQueued.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void ookDispatchStats::RecordDelivered(boost::chrono::nanoseconds latency)
+{
+	long lNanos = std::max((long) latency.count(), 0L);
+	
+	_lDelivered.fetch_add(1, boost::memory_order_relaxed);
+	_lLatencyNanos.fetch_add(lNanos, boost::memory_order_relaxed);
+	_vBuckets[ookDispatchStats::GetBucket(lNanos)].fetch_add(1, boost::memory_order_relaxed);
+	
+	long lMax = _lMaxLatencyNanos.load(boost::memory_order_relaxed);
+	
+	while((lNanos > lMax) && !_lMaxLatencyNanos.compare_exchange_weak(lMax, lNanos, boost::memory_order_relaxed))
+	{
+	}
+}
+
+void ookDispatchStats::RecordDropped()
+{
+	_lDropped.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void ookDispatchStats::RecordRejected()
+{
+	_lRejected.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void ookDispatchStats::Reset()
+{
+	_lQueued.store(0, boost::memory_order_relaxed);
+	_lDelivered.store(0, boost::memory_order_relaxed);
+	_lDropped.store(0, boost::memory_order_relaxed);
+	_lRejected.store(0, boost::memory_order_relaxed);
+	_lLatencyNanos.store(0, boost::memory_order_relaxed);
+	_lMaxLatencyNanos.store(0, boost::memory_order_relaxed);
+	
+	for(int i = 0; i < OOK_DISPATCH_LATENCY_BUCKETS; i++)
+		_vBuckets[i].store(0, boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Messages accepted onto an observer's queue. A message going to
+ three observers counts three times.
+ */
+long ookDispatchStats::GetQueuedCount() const
+{
+	return _lQueued.load(boost::memory_order_relaxed);
+}
+
+long ookDispatchStats::GetDeliveredCount() const
+{
+	return _lDelivered.load(boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Queued messages thrown away, either to make room under
+ OOK_OVERFLOW_DROP_OLDEST or because the dispatcher went away first.
+ */
+long ookDispatchStats::GetDroppedCount() const
+{
+	return _lDropped.load(boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Messages refused at PostMsg() by a full queue under
+ OOK_OVERFLOW_REJECT.
+ */
+long ookDispatchStats::GetRejectedCount() const
+{
+	return _lRejected.load(boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Average time queued, in microseconds.
+ */
+double ookDispatchStats::GetLatencyAvg() const
+{
+	long lDelivered = this->GetDeliveredCount();
+	
+	if(lDelivered == 0)
+		return 0.0;
+	
+	return (_lLatencyNanos.load(boost::memory_order_relaxed) / 1000.0) / lDelivered;
+}
+
+double ookDispatchStats::GetLatencyMax() const
+{
+	return _lMaxLatencyNanos.load(boost::memory_order_relaxed) / 1000.0;
+}
+
+/*! 
+ \brief Time queued at the given percentile (0 - 100), in microseconds.
+ */
+double ookDispatchStats::GetLatencyPercentile(double dPercentile) const
+{
+	long vCounts[OOK_DISPATCH_LATENCY_BUCKETS];
+	long lTotal = 0;
+	
+	for(int i = 0; i < OOK_DISPATCH_LATENCY_BUCKETS; i++)
+	{
+		vCounts[i] = _vBuckets[i].load(boost::memory_order_relaxed);
+		lTotal += vCounts[i];
+	}
+	
+	if(lTotal == 0)
+		return 0.0;
+	
+	double dRank = (dPercentile / 100.0) * lTotal;
+	long lSeen = 0;
+	
+	for(int i = 0; i < OOK_DISPATCH_LATENCY_BUCKETS; i++)
+	{
+		lSeen += vCounts[i];
+		
+		if((lSeen > 0) && (lSeen >= dRank))
+			return std::min(ookDispatchStats::GetBucketMid(i), (double) _lMaxLatencyNanos.load(boost::memory_order_relaxed)) / 1000.0;
+	}
+	
+	return this->GetLatencyMax();
+}
+
+void ookDispatchStats::Report(ostream& out) const
+{
+	//Left as the caller had them
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize iPrecision = out.precision();
+	
+	out << std::fixed << std::setprecision(1)
+		<< "{\"queued\":" << this->GetQueuedCount()
+		<< ",\"delivered\":" << this->GetDeliveredCount()
+		<< ",\"dropped\":" << this->GetDroppedCount()
+		<< ",\"rejected\":" << this->GetRejectedCount()
+		<< ",\"lat_us_avg\":" << this->GetLatencyAvg()
+		<< ",\"lat_us_p50\":" << this->GetLatencyPercentile(50.0)
+		<< ",\"lat_us_p99\":" << this->GetLatencyPercentile(99.0)
+		<< ",\"lat_us_max\":" << this->GetLatencyMax()
+		<< "}" << endl;
+	
+	out.flags(flags);
+	out.precision(iPrecision);
+}
+
+//Values below 4 get a bucket each. Above that, the bucket is the position
+//of the top bit and the two bits after it pick one of four sub-buckets.
+int ookDispatchStats::GetBucket(long lNanos)
+{
+	if(lNanos < 4)
+		return (int) lNanos;
+	
+	int iTop = 2;
+	
+	while((lNanos >> (iTop + 1)) != 0)
+		iTop++;
+	
+	int iSub = (int) ((lNanos >> (iTop - 2)) & 3);
+	
+	return std::min((iTop - 1) * 4 + iSub, OOK_DISPATCH_LATENCY_BUCKETS - 1);
+}
+
+double ookDispatchStats::GetBucketMid(int iBucket)
+{
+	if(iBucket < 4)
+		return iBucket;
+	
+	int iTop = (iBucket / 4) + 1;
+	double dWidth = std::ldexp(1.0, iTop - 2);
+	double dLow = (4 + (iBucket % 4)) * dWidth;
+	
+	return dLow + (dWidth / 2.0);
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_DISPATCH_STATS_H_
+#define OOK_DISPATCH_STATS_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/atomic.hpp"
+
+//Four buckets per power of two, enough for any latency in nanoseconds
+#define OOK_DISPATCH_LATENCY_BUCKETS 256
+
+class ookDispatchStats
+{
+public:
+	
+	ookDispatchStats();
+	virtual ~ookDispatchStats();
+	
+	void RecordQueued();
+	void RecordDelivered(boost::chrono::nanoseconds latency);
+	void RecordDropped();
+	void RecordRejected();
+	void Reset();
+	
+	long GetQueuedCount() const;
+	long GetDeliveredCount() const;
+	long GetDroppedCount() const;
+	long GetRejectedCount() const;
+	
+	double GetLatencyAvg() const;
+	double GetLatencyMax() const;
+	double GetLatencyPercentile(double dPercentile) const;
+	
+	void Report(ostream& out) const;
+	
+protected:
+	
+	static int GetBucket(long lNanos);
+	static double GetBucketMid(int iBucket);
+	
+private:
+	
+	ookDispatchStats(const ookDispatchStats&);
+	ookDispatchStats& operator=(const ookDispatchStats&);
+	
+	boost::atomic<long> _lQueued;
+	boost::atomic<long> _lDelivered;
+	boost::atomic<long> _lDropped;
+	boost::atomic<long> _lRejected;
+	boost::atomic<long> _lLatencyNanos;
+	boost::atomic<long> _lMaxLatencyNanos;
+	boost::atomic<long> _vBuckets[OOK_DISPATCH_LATENCY_BUCKETS];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,443 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookCore/ookLogSegment.h"
+#include "ookLibs/ookCore/ookMsgWire.h"
+#include "ookLibs/ookCore/ookException.h"
+#include "ookLibs/ookCore/ookCrc32c.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*!
+ \class ookLogSegment
+ \headerfile ookLogSegment.h "ookLibs/ookCore/ookLogSegment.h"
+ \brief One file of an ookMsgLog, holding the records from a base offset
+ on. The file is named after its base offset, so the segments of a log
+ sort in offset order.
+ 
+ A record is a fixed32 body length and a fixed32 CRC-32C of the body,
+ followed by the body. Offsets aren't stored; a record's offset is the
+ segment's base plus the number of records before it, and every
+ OOK_LOG_INDEX_INTERVAL'th record's position is kept so a seek only
+ steps over a few records.
+ 
+ Only the newest segment is written, by one thread, with Append(). Once
+ it is full it is sealed: flushed and mapped into memory, so reading it
+ back is a copy out of the page cache with no system calls. Records that
+ are written but not yet sealed are read with pread(). Any number of
+ threads may read while the writer appends.
+ */
+ookLogSegment::ookLogSegment(const string& path, boost::int64_t lBase)
+	: _path(path), _lBase(lBase), _fd(-1), _pMap(NULL), _iMapSize(0), _bSealed(false),
+		_iSize(0), _lEnd(lBase), _tModified(0), _lIndexed(0)
+{
+	
+}
+
+ookLogSegment::~ookLogSegment()
+{
+	if(_pMap)
+		munmap((void*) _pMap, _iMapSize);
+	
+	if(_fd >= 0)
+		close(_fd);
+}
+
+/*! 
+ \brief Opens the segment's file, creating it if bWritable. Throws the
+ system error on failure.
+ */
+void ookLogSegment::Open(bool bWritable)
+{
+	_fd = open(_path.c_str(), bWritable ? (O_RDWR | O_CREAT | O_APPEND) : O_RDONLY, 0644);
+	
+	if(_fd < 0)
+		throw system::error_code(errno, system::system_category());
+	
+	struct stat st;
+	
+	if(fstat(_fd, &st) == 0)
+		_tModified.store(st.st_mtime);
+}
+
+/*! 
+ \brief Counts and indexes the records already in the file. Without
+ bTruncate the segment is sealed first. With bTruncate, which is for the
+ segment being written when the log was last closed, every record is checked and the file is cut at the first one
+ that is short or fails its CRC, the remains of a write cut off by a
+ crash. An older segment can end in a short record too, when the log
+ doesn't sync and the machine went down around a roll; it is cut at its
+ last whole record, leaving a gap in the offsets before the next one.
+ */
+void ookLogSegment::Recover(bool bTruncate)
+{
+	struct stat st;
+	
+	if(fstat(_fd, &st) != 0)
+		throw system::error_code(errno, system::system_category());
+	
+	size_t iFileSize = (size_t) st.st_size;
+	size_t iPos = 0;
+	boost::int64_t lCount = 0;
+	
+	//A sealed segment is read through its mapping, here and from then on
+	if(!bTruncate)
+	{
+		_iSize.store(iFileSize);
+		this->Seal();
+	}
+	
+	boost::mutex::scoped_lock lock(_indexMut);
+	
+	_vIndex.clear();
+	
+	while(iPos + OOK_LOG_HEADER_SIZE <= iFileSize)
+	{
+		char hdr[OOK_LOG_HEADER_SIZE];
+		this->ReadAt(iPos, hdr, sizeof(hdr));
+		
+		ookMsgReader reader(hdr, sizeof(hdr));
+		size_t iBody = reader.ReadFixed32();
+		boost::uint32_t iCrc = reader.ReadFixed32();
+		
+		if(iPos + OOK_LOG_HEADER_SIZE + iBody > iFileSize)
+			break;
+		
+		if(bTruncate)
+		{
+			vector<char> body(iBody);
+			
+			if(iBody > 0)
+				this->ReadAt(iPos + OOK_LOG_HEADER_SIZE, &body[0], iBody);
+			
+			if(ookCrc32c::Compute(body.empty() ? NULL : &body[0], iBody) != iCrc)
+				break;
+		}
+		
+		if((lCount % OOK_LOG_INDEX_INTERVAL) == 0)
+			_vIndex.push_back(iPos);
+		
+		iPos += OOK_LOG_HEADER_SIZE + iBody;
+		lCount++;
+	}
+	
+	if(iPos < iFileSize)
+	{
+		std::cerr << "Truncating " << _path << " to its last whole record, dropping " << (iFileSize - iPos) << " bytes\n";
+		
+		//A sealed segment is open read only; cut it by name and map it again
+		if(!bTruncate)
+		{
+			if(truncate(_path.c_str(), iPos) != 0)
+				throw system::error_code(errno, system::system_category());
+			
+			if(_pMap)
+				munmap((void*) _pMap, _iMapSize);
+			
+			_pMap = NULL;
+			_iMapSize = 0;
+			_iSize.store(iPos);
+			this->Seal();
+		}
+		else if(ftruncate(_fd, iPos) != 0)
+			throw system::error_code(errno, system::system_category());
+	}
+	
+	_lIndexed = lCount;
+	_iSize.store(iPos);
+	_lEnd.store(_lBase + lCount);
+}
+
+/*! 
+ \brief Writes whole records, as many as pData holds. Throws the system
+ error if the write fails.
+ */
+void ookLogSegment::Append(const char* pData, size_t iSize)
+{
+	size_t iStart = _iSize.load(boost::memory_order_relaxed);
+	size_t iDone = 0;
+	
+	while(iDone < iSize)
+	{
+		ssize_t iWritten = write(_fd, pData + iDone, iSize - iDone);
+		
+		if(iWritten < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			
+			throw system::error_code(errno, system::system_category());
+		}
+		
+		iDone += (size_t) iWritten;
+	}
+	
+	this->AddToIndex(pData, iSize, iStart);
+	_tModified.store(time(NULL));
+}
+
+//Counts the records in a block just written, indexing the ones that fall
+//on the interval, then publishes them to readers
+void ookLogSegment::AddToIndex(const char* pData, size_t iSize, size_t iStart)
+{
+	boost::int64_t lCount = _lIndexed;
+	size_t iPos = 0;
+	
+	{
+		boost::mutex::scoped_lock lock(_indexMut);
+		
+		while(iPos + OOK_LOG_HEADER_SIZE <= iSize)
+		{
+			ookMsgReader reader(pData + iPos, OOK_LOG_HEADER_SIZE);
+			size_t iBody = reader.ReadFixed32();
+			
+			if((lCount % OOK_LOG_INDEX_INTERVAL) == 0)
+				_vIndex.push_back(iStart + iPos);
+			
+			iPos += OOK_LOG_HEADER_SIZE + iBody;
+			lCount++;
+		}
+		
+		_lIndexed = lCount;
+	}
+	
+	_iSize.store(iStart + iSize, boost::memory_order_release);
+	_lEnd.store(_lBase + lCount, boost::memory_order_release);
+}
+
+/*! 
+ \brief Flushes what has been written to the disk itself.
+ */
+void ookLogSegment::Sync()
+{
+	if(fdatasync(_fd) != 0)
+		throw system::error_code(errno, system::system_category());
+}
+
+/*! 
+ \brief Ends writing: flushes the file and maps it for reading. The
+ segment's size and record count are final from then on.
+ */
+void ookLogSegment::Seal()
+{
+	size_t iSize = _iSize.load();
+	
+	if(iSize > 0)
+	{
+		void* pMap = mmap(NULL, iSize, PROT_READ, MAP_SHARED, _fd, 0);
+		
+		if(pMap == MAP_FAILED)
+			throw system::error_code(errno, system::system_category());
+		
+		//Replays read a segment front to back
+		madvise(pMap, iSize, MADV_SEQUENTIAL);
+		
+		_pMap = (const char*) pMap;
+		_iMapSize = iSize;
+	}
+	
+	_bSealed.store(true, boost::memory_order_release);
+}
+
+/*! 
+ \brief Deletes the file. Readers that still hold the segment can finish
+ with it; the data goes once the last of them lets go.
+ */
+void ookLogSegment::Remove()
+{
+	unlink(_path.c_str());
+}
+
+/*! 
+ \brief Where the record at lOffset starts, which must be in this
+ segment and already written.
+ */
+size_t ookLogSegment::FindPosition(boost::int64_t lOffset)
+{
+	boost::int64_t lRecord = lOffset - _lBase;
+	size_t iPos;
+	
+	{
+		boost::mutex::scoped_lock lock(_indexMut);
+		
+		size_t iSlot = (size_t) (lRecord / OOK_LOG_INDEX_INTERVAL);
+		
+		if(iSlot >= _vIndex.size())
+			throw ookException("ookLogSegment::FindPosition: offset isn't in the segment");
+		
+		iPos = _vIndex[iSlot];
+		lRecord -= (boost::int64_t) iSlot * OOK_LOG_INDEX_INTERVAL;
+	}
+	
+	for(; lRecord > 0; lRecord--)
+	{
+		char hdr[sizeof(boost::uint32_t)];
+		this->ReadAt(iPos, hdr, sizeof(hdr));
+		
+		ookMsgReader reader(hdr, sizeof(hdr));
+		iPos += OOK_LOG_HEADER_SIZE + reader.ReadFixed32();
+	}
+	
+	return iPos;
+}
+
+/*! 
+ \brief Reads the record at iPos into a buffer of its own and moves iPos
+ past it. Returns false if there is no whole record there yet, and throws
+ an ookException if the record fails its CRC.
+ */
+bool ookLogSegment::ReadRecord(size_t& iPos, ookBufferView& record)
+{
+	size_t iEnd = _iSize.load(boost::memory_order_acquire);
+	
+	if(iPos + OOK_LOG_HEADER_SIZE > iEnd)
+		return false;
+	
+	char hdr[OOK_LOG_HEADER_SIZE];
+	this->ReadAt(iPos, hdr, sizeof(hdr));
+	
+	ookMsgReader reader(hdr, sizeof(hdr));
+	size_t iBody = reader.ReadFixed32();
+	boost::uint32_t iCrc = reader.ReadFixed32();
+	
+	if(iPos + OOK_LOG_HEADER_SIZE + iBody > iEnd)
+		return false;
+	
+	buffer_ptr buf = ookBuffer::Create(iBody);
+	
+	if(iBody > 0)
+		this->ReadAt(iPos + OOK_LOG_HEADER_SIZE, buf->GetData(), iBody);
+	
+	if(ookCrc32c::Compute(buf->GetData(), iBody) != iCrc)
+		throw ookException("ookLogSegment::ReadRecord: record failed its CRC");
+	
+	iPos += OOK_LOG_HEADER_SIZE + iBody;
+	record = ookBufferView(buf);
+	
+	return true;
+}
+
+void ookLogSegment::ReadAt(size_t iPos, char* pOut, size_t iSize)
+{
+	if(_bSealed.load(boost::memory_order_acquire) && (iPos + iSize <= _iMapSize))
+	{
+		memcpy(pOut, _pMap + iPos, iSize);
+		return;
+	}
+	
+	size_t iDone = 0;
+	
+	while(iDone < iSize)
+	{
+		ssize_t iRead = pread(_fd, pOut + iDone, iSize - iDone, iPos + iDone);
+		
+		if(iRead < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			
+			throw system::error_code(errno, system::system_category());
+		}
+		
+		if(iRead == 0)
+			throw ookException("ookLogSegment::ReadAt: read past the end of the file");
+		
+		iDone += (size_t) iRead;
+	}
+}
+
+const string& ookLogSegment::GetPath() const
+{
+	return _path;
+}
+
+boost::int64_t ookLogSegment::GetBase() const
+{
+	return _lBase;
+}
+
+/*! 
+ \brief The offset after the last record written.
+ */
+boost::int64_t ookLogSegment::GetEnd() const
+{
+	return _lEnd.load(boost::memory_order_acquire);
+}
+
+size_t ookLogSegment::GetSize() const
+{
+	return _iSize.load(boost::memory_order_acquire);
+}
+
+time_t ookLogSegment::GetModified() const
+{
+	return _tModified.load();
+}
+
+bool ookLogSegment::IsSealed() const
+{
+	return _bSealed.load(boost::memory_order_acquire);
+}
+
+string ookLogSegment::MakePath(const string& dir, boost::int64_t lBase)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%020lld.log", (long long) lBase);
+	
+	return dir + "/" + name;
+}
+
+/*! 
+ \brief Reads the base offset out of a segment file name, returning false
+ for names that aren't one.
+ */
+bool ookLogSegment::ParseName(const string& name, boost::int64_t& lBase)
+{
+	if((name.size() != 24) || (name.compare(20, 4, ".log") != 0))
+		return false;
+	
+	lBase = 0;
+	
+	for(size_t i = 0; i < 20; i++)
+	{
+		if((name[i] < '0') || (name[i] > '9'))
+			return false;
+		
+		lBase = (lBase * 10) + (name[i] - '0');
+	}
+	
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_LOG_SEGMENT_H_
+#define OOK_LOG_SEGMENT_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookBuffer.h"
+#include "boost/cstdint.hpp"
+#include "boost/atomic.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/thread/mutex.hpp"
+
+//Record header: body length, then CRC-32C of the body
+#define OOK_LOG_HEADER_SIZE 8
+
+//Records between the positions a segment remembers for seeking
+#define OOK_LOG_INDEX_INTERVAL 64
+
+class ookLogSegment
+{
+public:
+	
+	ookLogSegment(const string& path, boost::int64_t lBase);
+	virtual ~ookLogSegment();
+	
+	void Open(bool bWritable);
+	void Recover(bool bTruncate);
+	
+	void Append(const char* pData, size_t iSize);
+	void Sync();
+	void Seal();
+	void Remove();
+	
+	size_t FindPosition(boost::int64_t lOffset);
+	bool ReadRecord(size_t& iPos, ookBufferView& record);
+	
+	const string& GetPath() const;
+	boost::int64_t GetBase() const;
+	boost::int64_t GetEnd() const;
+	size_t GetSize() const;
+	time_t GetModified() const;
+	bool IsSealed() const;
+	
+	static string MakePath(const string& dir, boost::int64_t lBase);
+	static bool ParseName(const string& name, boost::int64_t& lBase);
+	
+protected:
+	
+	void ReadAt(size_t iPos, char* pOut, size_t iSize);
+	void AddToIndex(const char* pData, size_t iSize, size_t iStart);
+	
+private:
+	
+	ookLogSegment(const ookLogSegment&);
+	ookLogSegment& operator=(const ookLogSegment&);
+	
+	string _path;
+	boost::int64_t _lBase;
+	int _fd;
+	
+	//Set once sealed; reads come from the mapping from then on
+	const char* _pMap;
+	size_t _iMapSize;
+	boost::atomic<bool> _bSealed;
+	
+	//What has been written, published size first so a reader that sees a
+	//record count can read that many records
+	boost::atomic<size_t> _iSize;
+	boost::atomic<boost::int64_t> _lEnd;
+	boost::atomic<time_t> _tModified;
+	
+	//Position of every OOK_LOG_INDEX_INTERVAL'th record
+	boost::mutex _indexMut;
+	vector<size_t> _vIndex;
+	boost::int64_t _lIndexed;
+};
+
+typedef boost::shared_ptr<ookLogSegment> log_segment_ptr;
+
+#endif
\ No newline at end of file
@@ -34,10 +34,30 @@
  \headerfile ookMessage.h "ookLibs/ookCore/ookMessage.h"
  \brief Base class for messages sent through the ookMessageDispatcher.
  
+ Messages carry an intrusive reference count, so a msg_ptr (or
+ boost::intrusive_ptr to a derived class) can hold one past PostMsg() and
+ hand it across threads and queues without copying it. When the last
+ reference goes, the message is deleted, or given back to the
+ ookMsgPool it came from.
+ 
+ A message made on the stack has no references, and nobody may take one.
+ An asynchronous ookMsgDispatcher copies such messages with Clone(), and
+ shares counted ones as they are. Either way, a message must not change
+ once it is posted.
  */
 #include "ookLibs/ookCore/ookMessage.h"
 
 ookMessage::ookMessage()
+	: _iRefs(0), _pRecycler(NULL), _pOrigin(NULL), _lLogOffset(-1), _priority(OOK_PRIORITY_NORMAL),
+		_lTraceId(0)
+{
+
+}
+
+//A copy is a new message: its own references, and no pool
+ookMessage::ookMessage(const ookMessage& msg)
+	: _iRefs(0), _pRecycler(NULL), _topic(msg._topic), _pOrigin(msg._pOrigin), _lLogOffset(msg._lLogOffset),
+		_priority(msg._priority), _lTraceId(msg._lTraceId)
 {
 
 }
@@ -45,4 +65,142 @@ ookMessage::ookMessage()
 ookMessage::~ookMessage()
 {
 
+}
+
+ookMessage& ookMessage::operator=(const ookMessage& msg)
+{
+	_topic = msg._topic;
+	_pOrigin = msg._pOrigin;
+	_lLogOffset = msg._lLogOffset;
+	_priority = msg._priority;
+	_lTraceId = msg._lTraceId;
+	return *this;
+}
+
+/*! 
+ \brief Returns a heap copy of the message for ookMsgDispatcher to queue,
+ or NULL if the class can't be copied. Derived messages posted to an
+ asynchronous dispatcher must override it to copy themselves.
+ */
+ookMessage* ookMessage::Clone() const
+{
+	return NULL;
+}
+
+/*! 
+ \brief Called by ookMsgPool before a message goes back in the pool.
+ Override it to let go of anything big or shared the message holds, and
+ call the base version to clear the topic.
+ */
+void ookMessage::OnRecycle()
+{
+	_topic.clear();
+	_pOrigin = NULL;
+	_lLogOffset = -1;
+	_priority = OOK_PRIORITY_NORMAL;
+	_lTraceId = 0;
+}
+
+/*! 
+ \brief The topic the message is published under, such as
+ "orders.AAPL.filled", for observers registered with a topic pattern.
+ Empty for a message only routed by type. See ookMsgDispatcher.
+ */
+void ookMessage::SetTopic(const string& topic)
+{
+	_topic = topic;
+}
+
+const string& ookMessage::GetTopic() const
+{
+	return _topic;
+}
+
+/*! 
+ \brief Where the message came into this process from: NULL when it was
+ published here, or the ookBridgePeer that received it. Lets a bridge
+ tell local messages from ones it delivered itself.
+ */
+void ookMessage::SetOrigin(const void* origin)
+{
+	_pOrigin = origin;
+}
+
+const void* ookMessage::GetOrigin() const
+{
+	return _pOrigin;
+}
+
+/*! 
+ \brief The message's offset in the ookMsgLog it was written to or read
+ from, or -1. An observer that keeps the last offset it handled can
+ replay from the one after it.
+ */
+void ookMessage::SetLogOffset(boost::int64_t lOffset)
+{
+	_lLogOffset = lOffset;
+}
+
+boost::int64_t ookMessage::GetLogOffset() const
+{
+	return _lLogOffset;
+}
+
+/*! 
+ \brief The lane an asynchronous ookMsgDispatcher queues the message in.
+ OOK_PRIORITY_NORMAL unless set; control and high priority messages are
+ delivered ahead of a backlog of bulk ones.
+ */
+void ookMessage::SetPriority(ookMsgPriority priority)
+{
+	_priority = priority;
+}
+
+ookMsgPriority ookMessage::GetPriority() const
+{
+	return _priority;
+}
+
+/*! 
+ \brief Non zero when the message was picked for tracing by an
+ ookDispatchProfiler; every step that handles it records a span under
+ this id. Set by ookMsgDispatcher when its profiler samples the post.
+ */
+void ookMessage::SetTraceId(boost::uint64_t lTraceId)
+{
+	_lTraceId = lTraceId;
+}
+
+boost::uint64_t ookMessage::GetTraceId() const
+{
+	return _lTraceId;
+}
+
+int ookMessage::GetRefCount() const
+{
+	return _iRefs.load(boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Who gets the message when its last reference is released,
+ instead of it being deleted. Set by ookMsgPool.
+ */
+void ookMessage::SetRecycler(ookMsgRecycler* recycler)
+{
+	_pRecycler = recycler;
+}
+
+/*! 
+ \brief The root of every message type. Subclasses declare theirs with
+ OOK_MESSAGE_TYPE().
+ */
+const ookMsgType* ookMessage::StaticType()
+{
+	static const ookMsgType type("ookMessage", NULL);
+	return &type;
+}
+
+const ookMsgType* ookMessage::GetType() const
+{
+	return ookMessage::StaticType();
 }
\ No newline at end of file
@@ -32,18 +32,117 @@
 #define OOK_MESSAGE_H_
 
 #include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMsgType.h"
+#include "boost/atomic.hpp"
+#include "boost/intrusive_ptr.hpp"
+#include "boost/cstdint.hpp"
+
+class ookMessage;
+
+//Delivery lanes, most urgent first; see ookMsgDispatcher::SetLanes()
+enum ookMsgPriority
+{
+	OOK_PRIORITY_CONTROL,
+	OOK_PRIORITY_HIGH,
+	OOK_PRIORITY_NORMAL,
+	OOK_PRIORITY_BULK
+};
+
+#define OOK_MSG_LANES 4
+
+//Takes back messages whose last reference is gone, see ookMsgPool
+class ookMsgRecycler
+{
+public:
+	
+	virtual ~ookMsgRecycler() {}
+	
+	virtual void Recycle(ookMessage* msg) = 0;
+};
 
 class ookMessage
 {
 public:
 	
 	ookMessage();
+	ookMessage(const ookMessage& msg);
 	virtual ~ookMessage();
+	
+	ookMessage& operator=(const ookMessage& msg);
+	
+	virtual ookMessage* Clone() const;
+	virtual void OnRecycle();
+	
+	typedef ookMessage ook_msg_self;
+	static const ookMsgType* StaticType();
+	virtual const ookMsgType* GetType() const;
+	
+	void AddRef() const;
+	void Release() const;
+	int GetRefCount() const;
+	
+	void SetRecycler(ookMsgRecycler* recycler);
+	
+	void SetTopic(const string& topic);
+	const string& GetTopic() const;
+	
+	void SetOrigin(const void* origin);
+	const void* GetOrigin() const;
+	
+	void SetLogOffset(boost::int64_t lOffset);
+	boost::int64_t GetLogOffset() const;
+	
+	void SetPriority(ookMsgPriority priority);
+	ookMsgPriority GetPriority() const;
+	
+	void SetTraceId(boost::uint64_t lTraceId);
+	boost::uint64_t GetTraceId() const;
 
 protected:
 
 private:
+	
+	mutable boost::atomic<int> _iRefs;
+	ookMsgRecycler* _pRecycler;
+	string _topic;
+	const void* _pOrigin;
+	boost::int64_t _lLogOffset;
+	ookMsgPriority _priority;
+	boost::uint64_t _lTraceId;
 
 };
 
+typedef boost::intrusive_ptr<ookMessage> msg_ptr;
+
+inline void ookMessage::AddRef() const
+{
+	_iRefs.fetch_add(1, boost::memory_order_relaxed);
+}
+
+inline void ookMessage::Release() const
+{
+	if(_iRefs.fetch_sub(1, boost::memory_order_release) != 1)
+		return;
+	
+	//Everything other holders did happens before we recycle it
+	boost::atomic_thread_fence(boost::memory_order_acquire);
+	
+	ookMessage* msg = const_cast<ookMessage*>(this);
+	
+	if(_pRecycler)
+		_pRecycler->Recycle(msg);
+	else
+		delete msg;
+}
+
+inline void intrusive_ptr_add_ref(const ookMessage* msg)
+{
+	msg->AddRef();
+}
+
+inline void intrusive_ptr_release(const ookMessage* msg)
+{
+	msg->Release();
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_BATCH_OBSERVER_H_
+#define OOK_MSG_BATCH_OBSERVER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMsgObserverAbs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "boost/type_traits/is_same.hpp"
+
+//Messages cast and handed to the handler per call, kept on the stack
+#define OOK_BATCH_OBSERVER_CHUNK 64
+
+/*!
+ \brief An observer whose handler takes messages of class M in batches,
+ for handlers that do better with many messages at once: one lock, one
+ write, or one pass over a vector of prices instead of one per message.
+ 
+ \code
+ 
+ void ookBook::OnQuotes(ookQuoteMessage** vQuotes, size_t iCount);
+ 
+ dispatcher.RegisterObserver(new ookMsgBatchObserver<ookBook, ookQuoteMessage>(&book, &ookBook::OnQuotes));
+ dispatcher.PostBatch(vMsgs, iCount);
+ 
+ \endcode
+ 
+ A synchronous ookMsgDispatcher hands it each run of alike messages from
+ PostBatch() in one call. An asynchronous one hands it whatever has piled
+ up in its queue, up to OOK_MAILBOX_BATCH messages, however they were
+ posted. Messages posted with PostMsg() come one at a time when the queue
+ is empty, so batches grow with the load. A handler is never called with
+ an empty batch, and gets at most OOK_BATCH_OBSERVER_CHUNK per call.
+ 
+ The messages are only valid during the call, as with ookMsgObserver.
+ */
+template <class H, class M>
+class ookMsgBatchObserver : public ookMsgObserverAbs
+{
+	typedef void (H::*FP_OOK_MSG_BATCH)(M**, size_t);
+	
+public:
+	
+	ookMsgBatchObserver(H* handler, FP_OOK_MSG_BATCH func)
+		: _handler(handler), _handlerFunc(func)
+	{
+		
+	}
+	
+	virtual ~ookMsgBatchObserver()
+	{
+		
+	}
+	
+	void SendMessage(ookMessage* msg)
+	{
+		this->DeliverBatch(&msg, 1);
+	}
+	
+	bool Accepts(ookMessage* msg)
+	{
+		return dynamic_cast<M*>(msg) != 0;
+	}
+	
+	//As ookMsgObserver: without an OOK_MESSAGE_TYPE() of its own, M can't
+	//be routed by type
+	const ookMsgType* GetMsgType() const
+	{
+		if(boost::is_same<typename M::ook_msg_self, M>::value)
+			return M::StaticType();
+		
+		return NULL;
+	}
+	
+	void Deliver(ookMessage* msg)
+	{
+		this->DeliverBatch(&msg, 1);
+	}
+	
+	bool TakesBatches() const
+	{
+		return true;
+	}
+	
+	//Routed by type the messages are all M already; otherwise the ones
+	//that aren't are left out
+	void DeliverBatch(ookMessage** vMsgs, size_t iCount)
+	{
+		M* vCast[OOK_BATCH_OBSERVER_CHUNK];
+		size_t iCast = 0;
+		
+		for(size_t i = 0; i < iCount; i++)
+		{
+			if(boost::is_same<typename M::ook_msg_self, M>::value)
+				vCast[iCast] = static_cast<M*>(vMsgs[i]);
+			else
+				vCast[iCast] = dynamic_cast<M*>(vMsgs[i]);
+			
+			if(vCast[iCast] && (++iCast == OOK_BATCH_OBSERVER_CHUNK))
+			{
+				(_handler->*_handlerFunc)(vCast, iCast);
+				iCast = 0;
+			}
+		}
+		
+		if(iCast > 0)
+			(_handler->*_handlerFunc)(vCast, iCast);
+	}
+	
+protected:
+	
+private:
+	
+	ookMsgBatchObserver(const ookMsgBatchObserver&);
+	ookMsgBatchObserver& operator=(const ookMsgBatchObserver&);
+	
+	H* _handler;
+	FP_OOK_MSG_BATCH _handlerFunc;
+};
+
+#endif
\ No newline at end of file
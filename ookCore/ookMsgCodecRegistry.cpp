@@ -0,0 +1,158 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookCore/ookMsgCodecRegistry.h"
+
+/*!
+ \class ookMsgCodecRegistry
+ \headerfile ookMsgCodecRegistry.h "ookLibs/ookCore/ookMsgCodecRegistry.h"
+ \brief The message classes something can encode, looked up by type or
+ by name, and the entry format they share on the wire and on disk.
+ 
+ \code
+ 
+ ookMsgCodecRegistry codecs;
+ codecs.RegisterType<ookTextMessage>();
+ codecs.RegisterType<ookQuoteMessage>();
+ 
+ \endcode
+ 
+ An entry names the message's type, so the reading side can pick the
+ class to decode, and carries its topic along with the encoded fields:
+ 
+ type name, topic, encoded message, each a varint length and the bytes
+ 
+ Register every class before the registry is shared between threads;
+ lookups take no lock.
+ */
+ookMsgCodecRegistry::ookMsgCodecRegistry()
+{
+	
+}
+
+ookMsgCodecRegistry::~ookMsgCodecRegistry()
+{
+	
+}
+
+void ookMsgCodecRegistry::AddCodec(type_codec_ptr codec)
+{
+	_byName.erase(codec->GetName());
+	_byName[codec->GetName()] = codec;
+	_byType[codec->GetType()] = codec.get();
+}
+
+/*! 
+ \brief The codec registered for the type called typeName, or NULL.
+ */
+const ookMsgTypeCodec* ookMsgCodecRegistry::GetCodec(boost::string_view typeName) const
+{
+	std::map<boost::string_view, type_codec_ptr>::const_iterator it = _byName.find(typeName);
+	
+	if(it == _byName.end())
+		return NULL;
+	
+	return it->second.get();
+}
+
+/*! 
+ \brief The codec for type or its nearest registered parent, or NULL. A
+ message whose own class isn't registered is encoded as that parent.
+ */
+const ookMsgTypeCodec* ookMsgCodecRegistry::FindCodec(const ookMsgType* type) const
+{
+	for(; type != NULL; type = type->GetParent())
+	{
+		std::map<const ookMsgType*, const ookMsgTypeCodec*>::const_iterator it = _byType.find(type);
+		
+		if(it != _byType.end())
+			return it->second;
+	}
+	
+	return NULL;
+}
+
+/*! 
+ \brief The size of msg's entry. iBody is set to the size of the encoded
+ message, which WriteEntry() needs.
+ */
+size_t ookMsgCodecRegistry::GetEntrySize(ookMessage* msg, const ookMsgTypeCodec* codec, size_t& iBody) const
+{
+	const string& name = codec->GetName();
+	const string& topic = msg->GetTopic();
+	
+	iBody = codec->GetSize(msg);
+	
+	return ookMsgWriter::GetVarintSize(name.size()) + name.size() + 
+		ookMsgWriter::GetVarintSize(topic.size()) + topic.size() + 
+		ookMsgWriter::GetVarintSize(iBody) + iBody;
+}
+
+void ookMsgCodecRegistry::WriteEntry(ookMessage* msg, const ookMsgTypeCodec* codec, size_t iBody, ookMsgWriter& writer) const
+{
+	const string& name = codec->GetName();
+	const string& topic = msg->GetTopic();
+	
+	writer.WriteVarint(name.size());
+	writer.WriteBytes(name.data(), name.size());
+	writer.WriteVarint(topic.size());
+	writer.WriteBytes(topic.data(), topic.size());
+	writer.WriteVarint(iBody);
+	codec->Encode(msg, writer);
+}
+
+/*! 
+ \brief Decodes the next entry, or steps over it and returns NULL if its
+ type isn't registered. With a reader over an ookBufferView, byte fields
+ view the reader's buffer.
+ */
+msg_ptr ookMsgCodecRegistry::ReadEntry(ookMsgReader& reader) const
+{
+	size_t iSize = (size_t) reader.ReadVarint();
+	const char* pName = reader.ReadBytes(iSize);
+	const ookMsgTypeCodec* codec = this->GetCodec(boost::string_view(pName, iSize));
+	
+	iSize = (size_t) reader.ReadVarint();
+	const char* pTopic = reader.ReadBytes(iSize);
+	size_t iTopic = iSize;
+	
+	iSize = (size_t) reader.ReadVarint();
+	
+	if(!codec)
+	{
+		reader.ReadBytes(iSize);
+		return msg_ptr();
+	}
+	
+	msg_ptr msg = codec->Decode(reader.ReadView(iSize));
+	msg->SetTopic(string(pTopic, iTopic));
+	
+	return msg;
+}
\ No newline at end of file
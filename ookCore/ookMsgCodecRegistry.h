@@ -0,0 +1,133 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_CODEC_REGISTRY_H_
+#define OOK_MSG_CODEC_REGISTRY_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgPool.h"
+#include "ookLibs/ookCore/ookMsgSchema.h"
+#include "ookLibs/ookCore/ookMsgWire.h"
+#include "ookLibs/ookCore/ookBuffer.h"
+#include "boost/shared_ptr.hpp"
+#include "boost/utility/string_view.hpp"
+
+#include <map>
+
+/*!
+ \brief Encodes and decodes one message class behind a common interface,
+ for code that moves messages of any registered class, such as
+ ookMsgBridge and ookMsgLog.
+ */
+class ookMsgTypeCodec
+{
+public:
+	
+	ookMsgTypeCodec(const ookMsgType* type) : _pType(type), _name(type->GetName()) {}
+	virtual ~ookMsgTypeCodec() {}
+	
+	const ookMsgType* GetType() const { return _pType; }
+	const string& GetName() const { return _name; }
+	
+	virtual size_t GetSize(ookMessage* msg) const = 0;
+	virtual void Encode(ookMessage* msg, ookMsgWriter& writer) const = 0;
+	virtual msg_ptr Decode(const ookBufferView& view) const = 0;
+	
+private:
+	
+	const ookMsgType* _pType;
+	string _name;
+};
+
+typedef boost::shared_ptr<ookMsgTypeCodec> type_codec_ptr;
+
+/*!
+ \brief The codec for message class M, which needs an OOK_MESSAGE_TYPE()
+ and an OOK_MSG_SCHEMA(). Decoded messages come from M's global pool, and
+ byte fields view the buffer they were read from rather than copying it.
+ */
+template <class M>
+class ookMsgTypeCodecT : public ookMsgTypeCodec
+{
+public:
+	
+	ookMsgTypeCodecT() : ookMsgTypeCodec(M::StaticType()) {}
+	
+	size_t GetSize(ookMessage* msg) const
+	{
+		return ookMsgCodec::GetSize(*static_cast<M*>(msg));
+	}
+	
+	void Encode(ookMessage* msg, ookMsgWriter& writer) const
+	{
+		ookMsgCodec::Encode(*static_cast<M*>(msg), writer);
+	}
+	
+	msg_ptr Decode(const ookBufferView& view) const
+	{
+		boost::intrusive_ptr<M> msg = ookMsgPool<M>::Global().Acquire();
+		ookMsgCodec::Decode(view, *msg);
+		
+		return msg_ptr(msg.get());
+	}
+};
+
+class ookMsgCodecRegistry
+{
+public:
+	
+	ookMsgCodecRegistry();
+	virtual ~ookMsgCodecRegistry();
+	
+	template <class M>
+	void RegisterType()
+	{
+		this->AddCodec(type_codec_ptr(new ookMsgTypeCodecT<M>()));
+	}
+	
+	void AddCodec(type_codec_ptr codec);
+	const ookMsgTypeCodec* GetCodec(boost::string_view typeName) const;
+	const ookMsgTypeCodec* FindCodec(const ookMsgType* type) const;
+	
+	size_t GetEntrySize(ookMessage* msg, const ookMsgTypeCodec* codec, size_t& iBody) const;
+	void WriteEntry(ookMessage* msg, const ookMsgTypeCodec* codec, size_t iBody, ookMsgWriter& writer) const;
+	msg_ptr ReadEntry(ookMsgReader& reader) const;
+	
+protected:
+	
+private:
+	
+	//Keyed by views of the codecs' own names, so lookups don't allocate
+	std::map<boost::string_view, type_codec_ptr> _byName;
+	std::map<const ookMsgType*, const ookMsgTypeCodec*> _byType;
+};
+
+#endif
\ No newline at end of file
@@ -37,31 +37,669 @@
  \headerfile ookMsgDispatcher.h "ookLibs/ookCore/ookMsgDispatcher.h"
  \brief Manages ookMessagObservers and forwards any messages which they
  register an interest in.
+ 
+ Observers are indexed by the message type they take (see ookMsgType), so
+ PostMsg() only visits the observers that want the message and calls them
+ without a dynamic_cast. The cost of a post follows the number of
+ interested observers, not the number registered.
+ 
+ Observers can be registered and unregistered from any thread while
+ messages flow, including from inside a handler. PostMsg() takes no lock:
+ it works from an immutable snapshot of the observer list, and changes
+ publish a new snapshot (see ookMsgRoutes). For observers tied to an
+ object's lifetime, use an ookMsgSubscription:
+ 
+ \code
+ 
+ ookMsgSubscription _sub;	//Member of the observing class
+ 
+ _sub.Reset(&dispatcher, new ookMsgObserver<ookFeed, ookTextMessage>(this, &ookFeed::HandleMsg));
+ 
+ \endcode
+ 
+ By default PostMsg() calls every interested observer on the caller's
+ thread before returning. After SetAsync() it only queues the message:
+ each observer gets its own bounded queue (an ookMsgMailbox) and the
+ executor's workers deliver from them. A slow observer then only delays
+ its own messages, not the thread posting them or the other observers.
+ 
+ \code
+ 
+ ookThreadPool pool(4);
+ 
+ dispatcher.SetAsync(&pool, 4096, OOK_OVERFLOW_DROP_OLDEST);
+ dispatcher.PostMsg(&msg);		//Queued, returns straight away
+ ...
+ dispatcher.Flush();			//Everything posted so far is delivered
+ dispatcher.GetStats().Report(cout);
+ 
+ \endcode
+ 
+ Asynchronous delivery guarantees that one observer receives messages one
+ at a time, in the order they were posted. Different observers may run at
+ the same time on different workers, and each may run on any worker.
+ 
+ That order is per priority. Each queue has a lane per ookMsgPriority, and
+ a message tagged as more urgent than the backlog goes ahead of it, so a
+ heartbeat or a cancel isn't stuck behind a burst of bulk updates. Lanes
+ are served strictly by priority, or weighted so that bulk messages still
+ get a share (SetLanes()):
+ 
+ \code
+ 
+ dispatcher.SetLanes(OOK_LANES_WEIGHTED);		//8:4:2:1 by default
+ dispatcher.PostMsg(&snapshot, OOK_PRIORITY_BULK);
+ dispatcher.PostMsg(&cancel, OOK_PRIORITY_HIGH);	//Delivered first
+ dispatcher.GetLaneStats(OOK_PRIORITY_HIGH).Report(cout);
+ 
+ \endcode
+ 
+ Synchronous delivery has no queues, so priorities make no difference.
+ 
+ A producer with many messages at hand, such as a reader that decoded a
+ buffer full of frames, can post them together with PostBatch(). The
+ observers are looked up once for each run of messages of the same type
+ and topic, and each observer's queue is locked once for the run. An
+ ookMsgBatchObserver gets the run in a single call:
+ 
+ \code
+ 
+ vector<ookMessage*> vMsgs;
+ ...					//One per decoded frame
+ dispatcher.PostBatch(vMsgs);
+ 
+ \endcode
+ 
+ Observers can also subscribe to topics. A message posted with a topic
+ goes to the observers of its type as usual, and to those registered with
+ a topic pattern that matches it. Patterns are dot separated levels, where
+ "*" matches one level and a final "#" the rest (see ookTopicTrie):
+ 
+ \code
+ 
+ dispatcher.RegisterObserver("orders.*.filled", new ookMsgObserver<ookBook, ookTextMessage>(&book, &ookBook::OnFill));
+ 
+ dispatcher.PostMsg("orders.AAPL.filled", &msg);		//To OnFill
+ dispatcher.PostMsg("orders.AAPL.cancelled", &msg);		//Not to OnFill
+ 
+ \endcode
+ 
+ Patterns are kept in a trie, so a post only visits the patterns that
+ match its topic, however many are registered.
+ 
+ A message the caller holds a reference to (see ookMessage and ookMsgPool)
+ is queued as it is. Otherwise it may be gone by delivery time, so the
+ queued message is a Clone() of it, and posting a message class without
+ Clone() throws an ookException. Either way one message is shared by
+ every observer it goes to, so observers must treat it as read only.
+ 
+ With an ookMsgLog set (SetLog()), every post is written to the log
+ first, so an observer that fails or restarts can replay what it missed
+ from the offset it got to, for at least once delivery.
+ 
+ An exception thrown by an observer loses it that message. It is reported
+ on std::cerr and never reaches the thread that posted, so one bad handler
+ can't take down a connection's reader. To see which observers are slow or
+ throwing, set an ookDispatchProfiler (SetProfiler()), which can also
+ trace sampled messages from the network read to every observer.
  */
 #include "ookLibs/ookCore/ookMsgDispatcher.h"
+#include "ookLibs/ookCore/ookException.h"
+
+#include <algorithm>
 
 ookMsgDispatcher::ookMsgDispatcher()
+	: _pRoutes(new ookMsgRoutes()), _iEpoch(0), _lNextId(0), _iQueueSize(1024), _policy(OOK_OVERFLOW_BLOCK),
+		_stats(new ookDispatchStats()), _pLog(NULL), _bWaitDurable(false),
+		_pProfiler(NULL)
 {
-	
+	_vReaders[0].store(0);
+	_vReaders[1].store(0);
 }
 
+//No PostMsg() may be running. Queued messages are dropped; Flush() first
+//to have them delivered.
 ookMsgDispatcher::~ookMsgDispatcher()
 {
+	ookMsgRoutes* routes = _pRoutes.load();
+	routes->CloseMailboxes();
+	
+	delete routes;
+	
+	for(size_t i = 0; i < _vRetired.size(); i++)
+		delete _vRetired[i].pRoutes;
+}
+
+/*! 
+ \brief Adds an observer and returns its id for UnregisterObserver(). The
+ dispatcher owns obs and deletes it once it is unregistered and no longer
+ in use, or with the dispatcher.
+ */
+ook_subscription_id ookMsgDispatcher::RegisterObserver(ookMsgObserverAbs* obs)
+{
+	boost::mutex::scoped_lock lock(_writeMut);
+	
+	ookMsgRoutes* routes = new ookMsgRoutes(*_pRoutes.load());
+	subscriber_ptr sub(new ookMsgSubscriber(++_lNextId, obs));
+	sub->SetProfiler(_pProfiler);
+	
+	routes->Add(sub, this->GetMailbox(sub, routes->GetExecutor()));
+	this->Publish(routes);
+	
+	return sub->GetId();
+}
+
+/*! 
+ \brief Adds an observer for messages posted with a topic that matches
+ the pattern topic, such as "orders.*.filled", and of the observer's type.
+ It doesn't get messages posted without a topic. Throws an ookException,
+ after deleting obs, if the pattern isn't valid.
+ */
+ook_subscription_id ookMsgDispatcher::RegisterObserver(const string& topic, ookMsgObserverAbs* obs)
+{
+	if(!ookTopicTrie::IsValidPattern(topic))
+	{
+		delete obs;
+		throw ookException("ookMsgDispatcher: topic patterns are dot separated levels, with * for a level and # only at the end");
+	}
+	
+	boost::mutex::scoped_lock lock(_writeMut);
+	
+	ookMsgRoutes* routes = new ookMsgRoutes(*_pRoutes.load());
+	subscriber_ptr sub(new ookMsgSubscriber(++_lNextId, obs, topic));
+	sub->SetProfiler(_pProfiler);
+	
+	routes->Add(sub, this->GetMailbox(sub, routes->GetExecutor()));
+	this->Publish(routes);
+	
+	return sub->GetId();
+}
+
+/*! 
+ \brief Removes an observer. Returns false if id isn't registered.
+ 
+ No delivery to the observer starts after this returns. When asynchronous,
+ its queued messages are dropped and a delivery in progress is waited for,
+ unless this is called from that delivery. When synchronous, a PostMsg()
+ on another thread may still be inside the observer's handler, so stop
+ posting threads first if the handler's object is about to be destroyed.
+ 
+ Safe to call at any time, including from an observer's handler.
+ */
+bool ookMsgDispatcher::UnregisterObserver(ook_subscription_id id)
+{
+	subscriber_ptr sub;
+	mailbox_ptr box;
+	mailbox_ptr oldBox;
+	
+	{
+		boost::mutex::scoped_lock lock(_writeMut);
+		
+		ookMsgRoutes* routes = new ookMsgRoutes(*_pRoutes.load());
+		
+		if(!routes->Remove(id, sub, box))
+		{
+			delete routes;
+			return false;
+		}
+		
+		//Versions already loaded by PostMsg() still list it
+		sub->Deactivate();
+		
+		this->Publish(routes);
+		
+		//During SetAsync() the mailbox it replaces may still be delivering
+		for(size_t i = 0; i < _vHandingOver.size(); i++)
+			if(_vHandingOver[i] && (_vHandingOver[i]->GetObserver() == sub->GetObserver()))
+				oldBox = _vHandingOver[i];
+	}
+	
+	//Outside the lock; the delivery waited for may register observers
+	if(oldBox)
+		oldBox->Close();
+	
+	if(box)
+		box->Close();
+	
+	return true;
+}
+
+size_t ookMsgDispatcher::GetObserverCount()
+{
+	int iSlot;
+	size_t iCount = this->EnterRead(iSlot)->GetSize();
+	this->LeaveRead(iSlot);
 	
+	return iCount;
 }
 
-void ookMsgDispatcher::RegisterObserver(ookMsgObserverAbs* obs)
+/*! 
+ \brief Sends msg to every observer that accepts it. When asynchronous,
+ returns false if any observer's queue refused it (OOK_OVERFLOW_REJECT).
+ 
+ Takes no lock; observers may be registered and unregistered while it
+ runs, and it sees the list as it was when it started.
+ */
+bool ookMsgDispatcher::PostMsg(ookMessage* msg)
 {
-	_vObservers.push_back(obs);
+	ookDispatchProfiler* profiler = _pProfiler;
+	ook_clock::time_point tStart;
+	bool bSampled = false;
+	
+	if(profiler)
+	{
+		bSampled = this->StartTrace(msg);
+		
+		if(msg->GetTraceId())
+			tStart = ookClock::Now();
+	}
+	
+	if(_pLog)
+	{
+		msg->SetLogOffset(_pLog->Append(msg));
+		
+		if(_bWaitDurable && (msg->GetLogOffset() >= 0))
+			_pLog->WaitDurable(msg->GetLogOffset());
+	}
+	
+	int iSlot;
+	ookMsgRoutes* routes = this->EnterRead(iSlot);
+	bool bQueued;
+	
+	try
+	{
+		bQueued = routes->Post(msg);
+	}
+	catch(...)
+	{
+		this->LeaveRead(iSlot);
+		throw;
+	}
+	
+	this->LeaveRead(iSlot);
+	
+	if(profiler && msg->GetTraceId())
+		this->EndTrace(msg, "ookMsgDispatcher::PostMsg", tStart, bSampled);
+	
+	return bQueued;
+}
+
+/*! 
+ \brief Sets msg's topic and posts it, to the observers of its type and
+ to those whose topic pattern matches.
+ */
+bool ookMsgDispatcher::PostMsg(const string& topic, ookMessage* msg)
+{
+	msg->SetTopic(topic);
+	return this->PostMsg(msg);
+}
+
+/*! 
+ \brief Posts iCount messages as one batch. Each observer still sees them
+ in order, and mixed in with other posts as for PostMsg(), but when
+ synchronous one observer gets its share of a run before the next one
+ does. Returns false if any message was refused by a queue.
+ 
+ Messages go to the log one by one, and with bWaitDurable the wait is
+ once, for the last of them.
+ */
+bool ookMsgDispatcher::PostBatch(ookMessage** vMsgs, size_t iCount)
+{
+	if(iCount == 0)
+		return true;
+	
+	ookDispatchProfiler* profiler = _pProfiler;
+	ook_clock::time_point tStart;
+	vector<size_t> vSampled;
+	bool bTraced = false;
+	
+	if(profiler)
+	{
+		for(size_t i = 0; i < iCount; i++)
+		{
+			if(this->StartTrace(vMsgs[i]))
+				vSampled.push_back(i);
+			
+			if(vMsgs[i]->GetTraceId())
+				bTraced = true;
+		}
+		
+		if(bTraced)
+			tStart = ookClock::Now();
+	}
+	
+	if(_pLog)
+	{
+		boost::int64_t lLast = -1;
+		
+		for(size_t i = 0; i < iCount; i++)
+		{
+			vMsgs[i]->SetLogOffset(_pLog->Append(vMsgs[i]));
+			lLast = std::max(lLast, vMsgs[i]->GetLogOffset());
+		}
+		
+		if(_bWaitDurable && (lLast >= 0))
+			_pLog->WaitDurable(lLast);
+	}
+	
+	int iSlot;
+	ookMsgRoutes* routes = this->EnterRead(iSlot);
+	bool bQueued;
+	
+	try
+	{
+		bQueued = routes->PostBatch(vMsgs, iCount);
+	}
+	catch(...)
+	{
+		this->LeaveRead(iSlot);
+		throw;
+	}
+	
+	this->LeaveRead(iSlot);
+	
+	for(size_t i = 0; bTraced && (i < iCount); i++)
+	{
+		if(!vMsgs[i]->GetTraceId())
+			continue;
+		
+		bool bSampled = (std::find(vSampled.begin(), vSampled.end(), i) != vSampled.end());
+		this->EndTrace(vMsgs[i], "ookMsgDispatcher::PostBatch", tStart, bSampled);
+	}
+	
+	return bQueued;
+}
+
+bool ookMsgDispatcher::PostBatch(const vector<ookMessage*>& vMsgs)
+{
+	if(vMsgs.empty())
+		return true;
+	
+	return this->PostBatch(const_cast<ookMessage**>(&vMsgs[0]), vMsgs.size());
+}
+
+/*! 
+ \brief Sets msg's priority and posts it. When asynchronous, it is queued
+ in that lane of each observer's queue and goes ahead of any less urgent
+ backlog.
+ */
+bool ookMsgDispatcher::PostMsg(ookMessage* msg, ookMsgPriority priority)
+{
+	msg->SetPriority(priority);
+	return this->PostMsg(msg);
+}
+
+/*! 
+ \brief Switches to asynchronous delivery on pool, or back to synchronous
+ delivery with NULL. Each lane of an observer's queue holds up to
+ iQueueSize messages (0 for no limit) and policy says what PostMsg() does
+ when it is full.
+ 
+ Nothing is lost in the switch. Each old queue hands what it holds, and
+ whatever reaches it later, to the observer's new queue, which starts
+ delivering once the old one has finished its delivery in progress; going
+ synchronous, the calling thread delivers the backlog. Don't call it from
+ an observer's handler. Keep pool alive until the dispatcher is destroyed
+ or switched away from it.
+ */
+void ookMsgDispatcher::SetAsync(ookExecutor* pool, size_t iQueueSize, ookOverflowPolicy policy)
+{
+	//One switch at a time, so a queue is never handed to one still held
+	boost::mutex::scoped_lock switchLock(_switchMut);
+	
+	this->Switch(pool, iQueueSize, policy);
+}
+
+//SetAsync() with _switchMut held
+void ookMsgDispatcher::Switch(ookExecutor* pool, size_t iQueueSize, ookOverflowPolicy policy)
+{
+	vector<mailbox_ptr> vOld;
+	vector<mailbox_ptr> vNew;
+	
+	{
+		boost::mutex::scoped_lock lock(_writeMut);
+		
+		ookMsgRoutes* current = _pRoutes.load();
+		ookMsgRoutes* routes = new ookMsgRoutes(pool);
+		vector<subscriber_ptr> vSubs;
+		
+		_iQueueSize = iQueueSize;
+		_policy = policy;
+		
+		for(size_t i = 0; i < current->GetSize(); i++)
+		{
+			subscriber_ptr sub = current->GetSubscriber(i);
+			mailbox_ptr box = this->GetMailbox(sub, pool);
+			
+			//Queues, but waits for the old mailbox before delivering
+			if(box)
+				box->Hold();
+			
+			vSubs.push_back(sub);
+			vNew.push_back(box);
+			vOld.push_back(current->GetMailbox(i));
+		}
+		
+		routes->Add(vSubs, vNew);
+		this->Publish(routes);
+		
+		//For UnregisterObserver() to close while they hand over
+		_vHandingOver = vOld;
+	}
+	
+	//Outside the lock; the delivery waited for may register observers
+	for(size_t i = 0; i < vNew.size(); i++)
+	{
+		if(vOld[i])
+			vOld[i]->Handover(vNew[i]);
+		
+		if(vNew[i])
+			vNew[i]->Release();
+	}
+	
+	boost::mutex::scoped_lock lock(_writeMut);
+	_vHandingOver.clear();
+}
+
+bool ookMsgDispatcher::IsAsync()
+{
+	int iSlot;
+	bool bAsync = (this->EnterRead(iSlot)->GetExecutor() != NULL);
+	this->LeaveRead(iSlot);
+	
+	return bAsync;
+}
+
+/*! 
+ \brief Blocks until every message posted before the call has been
+ delivered. Does nothing when synchronous.
+ */
+void ookMsgDispatcher::Flush()
+{
+	int iSlot;
+	this->EnterRead(iSlot)->Flush();
+	this->LeaveRead(iSlot);
+}
+
+/*! 
+ \brief How asynchronous queues pick the lane they deliver from next:
+ OOK_LANES_STRICT (the default) or OOK_LANES_WEIGHTED, where each round
+ lane i gets up to vWeights[i] messages. Weights not given are left as
+ they were, 8:4:2:1 from control down to bulk to begin with. Control
+ messages go first under either policy, so its weight is unused.
+ Existing queues are rebuilt with the new schedule, handing over what
+ they hold, as SetAsync() does.
+ */
+void ookMsgDispatcher::SetLanes(ookLanePolicy policy, const vector<int>& vWeights)
+{
+	//Held to the end, so a SetAsync() can't come between reading the
+	//executor and rebuilding on it
+	boost::mutex::scoped_lock switchLock(_switchMut);
+	
+	ookExecutor* pool;
+	size_t iQueueSize;
+	ookOverflowPolicy overflow;
+	
+	{
+		boost::mutex::scoped_lock lock(_writeMut);
+		
+		_lanes.policy = policy;
+		
+		for(size_t i = 0; (i < vWeights.size()) && (i < OOK_MSG_LANES); i++)
+			_lanes.vWeights[i] = vWeights[i];
+		
+		pool = _pRoutes.load()->GetExecutor();
+		iQueueSize = _iQueueSize;
+		overflow = _policy;
+	}
+	
+	//Rebuild the mailboxes with the new schedule
+	if(pool)
+		this->Switch(pool, iQueueSize, overflow);
+}
+
+ookDispatchStats& ookMsgDispatcher::GetStats()
+{
+	return *_stats;
+}
+
+/*! 
+ \brief Counters and latency for one lane only, to see how long urgent
+ messages wait while GetStats() is dominated by bulk ones.
+ */
+ookDispatchStats& ookMsgDispatcher::GetLaneStats(ookMsgPriority lane)
+{
+	return *_lanes.vStats[std::min(std::max((int) lane, 0), OOK_MSG_LANES - 1)];
+}
+
+/*! 
+ \brief Writes every message PostMsg() is given to log before delivering
+ it, stamping it with its offset. With bWaitDurable, PostMsg() waits for
+ the message to reach the disk first, so an observer is never handed a
+ message a crash could lose; the flusher's group commit keeps that cheap
+ when many threads post. Without it, delivery runs ahead of the disk by
+ up to one group. NULL stops logging. Set before messages flow.
+ */
+void ookMsgDispatcher::SetLog(ookMsgLog* log, bool bWaitDurable)
+{
+	_pLog = log;
+	_bWaitDurable = bWaitDurable;
+}
+
+/*! 
+ \brief Times every call into every observer, counting calls and
+ exceptions per observer, and records spans for the posts profiler
+ samples (see ookDispatchProfiler). NULL turns it off. Set before
+ messages flow, and keep profiler alive as long as the dispatcher.
+ */
+void ookMsgDispatcher::SetProfiler(ookDispatchProfiler* profiler)
+{
+	boost::mutex::scoped_lock lock(_writeMut);
+	
+	_pProfiler = profiler;
+	
+	ookMsgRoutes* routes = _pRoutes.load();
+	
+	for(size_t i = 0; i < routes->GetSize(); i++)
+		routes->GetSubscriber(i)->SetProfiler(profiler);
+}
+
+ookDispatchProfiler* ookMsgDispatcher::GetProfiler()
+{
+	return _pProfiler;
+}
+
+/*
+ Observer lists are copy-on-write with epoch based reclamation, a simple
+ form of RCU. Readers count themselves in one of two counters, picked by
+ the parity of _iEpoch, before loading _pRoutes, and leave once done with
+ it. A writer swaps in a new version and bumps the epoch, so new readers
+ use the other counter. The old version can be freed once each counter has
+ been seen at zero after the swap: every reader that could have loaded it
+ had counted itself in before the swap and has now left.
+ 
+ Writers never wait for readers. A version not yet freeable stays on the
+ retired list until a later write or the destructor.
+ */
+ookMsgRoutes* ookMsgDispatcher::EnterRead(int& iSlot)
+{
+	iSlot = _iEpoch.load(boost::memory_order_relaxed) & 1;
+	_vReaders[iSlot].fetch_add(1);
+	
+	return _pRoutes.load();
+}
+
+void ookMsgDispatcher::LeaveRead(int iSlot)
+{
+	_vReaders[iSlot].fetch_sub(1, boost::memory_order_release);
+}
+
+//Samples msg for tracing, unless it is already traced, say by a dispatcher
+//it was posted to before. Returns true if it was picked here.
+bool ookMsgDispatcher::StartTrace(ookMessage* msg)
+{
+	if(msg->GetTraceId())
+		return false;
+	
+	boost::uint64_t lTraceId = _pProfiler->Sample();
+	
+	if(!lTraceId)
+		return false;
+	
+	msg->SetTraceId(lTraceId);
+	
+	return true;
+}
+
+//Records the post's span. A message picked here that nobody holds a
+//reference to may be posted again, so its id is cleared for the next post.
+void ookMsgDispatcher::EndTrace(ookMessage* msg, const char* pStep, ook_clock::time_point tStart, bool bSampled)
+{
+	_pProfiler->RecordSpan(msg->GetTraceId(), pStep, tStart, ookClock::Now(), msg);
+	
+	if(bSampled && (msg->GetRefCount() == 0))
+		msg->SetTraceId(0);
+}
+
+mailbox_ptr ookMsgDispatcher::GetMailbox(subscriber_ptr sub, ookExecutor* pool)
+{
+	if(!pool)
+		return mailbox_ptr();
+	
+	return mailbox_ptr(new ookMsgMailbox(sub, pool, _iQueueSize, _policy, _stats, _lanes));
+}
+
+//Called with _writeMut held
+void ookMsgDispatcher::Publish(ookMsgRoutes* routes)
+{
+	ookRetiredRoutes retired;
+	retired.pRoutes = _pRoutes.exchange(routes);
+	retired.bDrained[0] = false;
+	retired.bDrained[1] = false;
+	
+	_vRetired.push_back(retired);
+	_iEpoch.fetch_add(1);
+	
+	this->Reclaim();
 }
 
-void ookMsgDispatcher::PostMsg(ookMessage* msg)
+//Called with _writeMut held
+void ookMsgDispatcher::Reclaim()
 {
-	for(int i = 0; i < _vObservers.size(); i++)
+	for(size_t i = 0; i < _vRetired.size(); )
 	{
-		if(_vObservers[i]->Accepts(msg))
+		ookRetiredRoutes& retired = _vRetired[i];
+		
+		for(int iSlot = 0; iSlot < 2; iSlot++)
+			if(!retired.bDrained[iSlot] && (_vReaders[iSlot].load() == 0))
+				retired.bDrained[iSlot] = true;
+		
+		if(retired.bDrained[0] && retired.bDrained[1])
 		{
-			_vObservers[i]->SendMessage(msg);
-		}		
+			delete retired.pRoutes;
+			_vRetired.erase(_vRetired.begin() + i);
+		}
+		else
+			i++;
 	}
 }
\ No newline at end of file
@@ -33,6 +33,14 @@
 
 #include "ookLibs/ookCore/typedefs.h"
 #include "ookLibs/ookCore/ookMsgObserverAbs.h"
+#include "ookLibs/ookCore/ookMsgRoutes.h"
+#include "ookLibs/ookCore/ookMsgMailbox.h"
+#include "ookLibs/ookCore/ookDispatchStats.h"
+#include "ookLibs/ookCore/ookMsgLog.h"
+#include "ookLibs/ookCore/ookDispatchProfiler.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "boost/thread/mutex.hpp"
+#include "boost/atomic.hpp"
 
 //Define the ookMsgObserver function pointer
 
@@ -45,16 +53,77 @@ public:
 	ookMsgDispatcher();
 	virtual ~ookMsgDispatcher();
 
-	void RegisterObserver(ookMsgObserverAbs* obs);
+	ook_subscription_id RegisterObserver(ookMsgObserverAbs* obs);
+	ook_subscription_id RegisterObserver(const string& topic, ookMsgObserverAbs* obs);
+	bool UnregisterObserver(ook_subscription_id id);
+	size_t GetObserverCount();
 	
-	void PostMsg(ookMessage* msg);
+	bool PostMsg(ookMessage* msg);
+	bool PostMsg(const string& topic, ookMessage* msg);
+	bool PostMsg(ookMessage* msg, ookMsgPriority priority);
+	bool PostBatch(ookMessage** vMsgs, size_t iCount);
+	bool PostBatch(const vector<ookMessage*>& vMsgs);
+	
+	void SetAsync(ookExecutor* pool, size_t iQueueSize = 1024, ookOverflowPolicy policy = OOK_OVERFLOW_BLOCK);
+	bool IsAsync();
+	void Flush();
+	
+	void SetLanes(ookLanePolicy policy, const vector<int>& vWeights = vector<int>());
+	
+	ookDispatchStats& GetStats();
+	ookDispatchStats& GetLaneStats(ookMsgPriority lane);
+	
+	void SetLog(ookMsgLog* log, bool bWaitDurable = false);
+	
+	void SetProfiler(ookDispatchProfiler* profiler);
+	ookDispatchProfiler* GetProfiler();
 
 protected:
+	
+	ookMsgRoutes* EnterRead(int& iSlot);
+	void LeaveRead(int iSlot);
+	
+	mailbox_ptr GetMailbox(subscriber_ptr sub, ookExecutor* pool);
+	void Switch(ookExecutor* pool, size_t iQueueSize, ookOverflowPolicy policy);
+	void Publish(ookMsgRoutes* routes);
+	void Reclaim();
+	
+	bool StartTrace(ookMessage* msg);
+	void EndTrace(ookMessage* msg, const char* pStep, ook_clock::time_point tStart, bool bSampled);
 
 
 private:
 
-	vector<ookMsgObserverAbs*> _vObservers;
+	ookMsgDispatcher(const ookMsgDispatcher&);
+	ookMsgDispatcher& operator=(const ookMsgDispatcher&);
+	
+	//The published routes, and the readers inside PostMsg() by epoch parity
+	boost::atomic<ookMsgRoutes*> _pRoutes;
+	boost::atomic<int> _iEpoch;
+	boost::atomic<long> _vReaders[2];
+	
+	//Replaced routes waiting for the readers that may still use them
+	struct ookRetiredRoutes
+	{
+		ookMsgRoutes* pRoutes;
+		bool bDrained[2];
+	};
+	
+	boost::mutex _writeMut;
+	boost::mutex _switchMut;
+	vector<mailbox_ptr> _vHandingOver;
+	vector<ookRetiredRoutes> _vRetired;
+	ook_subscription_id _lNextId;
+	
+	size_t _iQueueSize;
+	ookOverflowPolicy _policy;
+	boost::shared_ptr<ookDispatchStats> _stats;
+	ookMsgLanes _lanes;
+	
+	ookMsgLog* _pLog;
+	bool _bWaitDurable;
+	
+	ookDispatchProfiler* _pProfiler;
 
 };
 
@@ -0,0 +1,702 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookCore/ookMsgLog.h"
+#include "ookLibs/ookCore/ookException.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "ookLibs/ookCore/ookCrc32c.h"
+
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+/*!
+ \class ookMsgLog
+ \headerfile ookMsgLog.h "ookLibs/ookCore/ookMsgLog.h"
+ \brief An append-only, on-disk log of messages, which a dispatcher can
+ write every post through (see ookMsgDispatcher::SetLog()) so observers
+ can catch up on what they missed.
+ 
+ \code
+ 
+ ookMsgLog log;
+ log.RegisterType<ookQuoteMessage>();
+ log.Open("/var/lib/feed/quotes");
+ 
+ dispatcher.SetLog(&log);
+ 
+ //After a restart, the observer picks up after the last quote it handled
+ log.Replay(lLastOffset + 1, &quoteObserver);
+ 
+ \endcode
+ 
+ Every message appended gets the next offset, counting from 0 over the
+ life of the log, and is stamped with it (ookMessage::GetLogOffset()), so
+ an observer can remember how far it got. Replay() and ookMsgLogCursor
+ read messages back from any offset still kept.
+ 
+ Appends use group commit. Append() only encodes the message into the
+ pending group and returns its offset; a flusher thread writes the whole
+ group with one write() and, with OOK_LOG_SYNC_GROUP, one fdatasync(),
+ while the next group builds up behind it. The busier the log, the bigger
+ the groups and the less each message pays for the disk. WaitDurable()
+ blocks until a message is on disk, for callers who need to know before
+ they go on. Appends block when SetMaxPending() bytes are waiting.
+ 
+ The log is a directory of ookLogSegment files. When the one being
+ written passes SetSegmentSize() it is sealed and memory mapped, and a
+ new one is started. Compact(), also run at every such roll, deletes the
+ oldest sealed segments while the log is over SetRetention()'s size, or
+ they are older than its age limit. Retention only ever drops whole
+ segments from the front; records aren't rewritten or merged.
+ 
+ On Open() a record cut short by a crash at the end of the log is
+ dropped. Only message classes registered with RegisterType() are
+ logged; others are posted as usual but not kept. Uses POSIX file calls.
+ */
+ookMsgLog::ookMsgLog()
+	: _iPending(0), _lNextOffset(0), _lDurable(-1), _lGroups(0), _bOpen(false), _bClosing(false), _bFailed(false), _iWriting(0),
+		_sync(OOK_LOG_SYNC_GROUP), _iSegmentSize(64 * 1024 * 1024), _iMaxPending(16 * 1024 * 1024),
+		_lLingerMicros(0), _lRetainBytes(0), _lRetainSeconds(0)
+{
+	
+}
+
+ookMsgLog::~ookMsgLog()
+{
+	try
+	{
+		this->Close();
+	}
+	catch (...)
+	{
+	}
+}
+
+ookMsgCodecRegistry& ookMsgLog::GetCodecs()
+{
+	return _codecs;
+}
+
+/*! 
+ \brief Opens the log in dir, creating the directory if need be, and
+ recovers what is there. Throws the system error if dir can't be used.
+ */
+void ookMsgLog::Open(const string& dir)
+{
+	if(this->IsOpen())
+		throw ookException("ookMsgLog::Open called on a log that is already open");
+	
+	if((mkdir(dir.c_str(), 0755) != 0) && (errno != EEXIST))
+		throw system::error_code(errno, system::system_category());
+	
+	DIR* pDir = opendir(dir.c_str());
+	
+	if(!pDir)
+		throw system::error_code(errno, system::system_category());
+	
+	vector<boost::int64_t> vBases;
+	struct dirent* pEntry;
+	
+	while((pEntry = readdir(pDir)) != NULL)
+	{
+		boost::int64_t lBase;
+		
+		if(ookLogSegment::ParseName(pEntry->d_name, lBase))
+			vBases.push_back(lBase);
+	}
+	
+	closedir(pDir);
+	
+	std::sort(vBases.begin(), vBases.end());
+	
+	if(vBases.empty())
+		vBases.push_back(0);
+	
+	vector<log_segment_ptr> vSegments;
+	
+	for(size_t i = 0; i < vBases.size(); i++)
+	{
+		bool bLast = (i == vBases.size() - 1);
+		log_segment_ptr seg(new ookLogSegment(ookLogSegment::MakePath(dir, vBases[i]), vBases[i]));
+		
+		seg->Open(bLast);
+		seg->Recover(bLast);
+		
+		vSegments.push_back(seg);
+	}
+	
+	{
+		boost::mutex::scoped_lock lock(_segMut);
+		_vSegments.swap(vSegments);
+		_active = _vSegments.back();
+	}
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		_dir = dir;
+		_lNextOffset = _active->GetEnd();
+		_lDurable = _lNextOffset - 1;
+		_iPending = 0;
+		_bClosing = false;
+		_bFailed = false;
+		_bOpen = true;
+	}
+	
+	_flusher = boost::thread(boost::bind(&ookMsgLog::FlushLoop, this));
+}
+
+/*! 
+ \brief Writes out whatever is pending and closes the log. Appends fail
+ from the moment this is called.
+ */
+void ookMsgLog::Close()
+{
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		if(!_bOpen)
+			return;
+		
+		_bClosing = true;
+		_cond.notify_all();
+		_spaceCond.notify_all();
+	}
+	
+	_flusher.join();
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		_bOpen = false;
+		
+		//WaitDurable() on an offset that never made it gives up now
+		_durableCond.notify_all();
+	}
+	
+	boost::mutex::scoped_lock lock(_segMut);
+	
+	_vSegments.clear();
+	_active.reset();
+}
+
+bool ookMsgLog::IsOpen()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _bOpen;
+}
+
+/*! 
+ \brief Adds msg to the pending group and returns its offset, or -1 if
+ its class isn't registered or the log is closed or has failed. Doesn't
+ wait for the disk; see WaitDurable().
+ */
+boost::int64_t ookMsgLog::Append(ookMessage* msg)
+{
+	const ookMsgTypeCodec* codec = _codecs.FindCodec(msg->GetType());
+	
+	if(!codec)
+		return -1;
+	
+	//Sized outside the lock; only the copy into the group is inside it
+	size_t iBody;
+	size_t iEntry = _codecs.GetEntrySize(msg, codec, iBody);
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	while(_bOpen && !_bClosing && !_bFailed && (_iPending > 0) && (_iPending + iEntry > _iMaxPending))
+		_spaceCond.wait(lock);
+	
+	if(!_bOpen || _bClosing || _bFailed)
+		return -1;
+	
+	//_vPending only grows, and _iPending says how much of it is in use, so
+	//steady appends neither allocate nor clear memory
+	size_t iStart = _iPending;
+	_iPending += OOK_LOG_HEADER_SIZE + iEntry;
+	
+	if(_iPending > _vPending.size())
+		_vPending.resize(std::max(_iPending, _vPending.size() * 2));
+	
+	char* pRecord = &_vPending[iStart];
+	
+	ookMsgWriter body(pRecord + OOK_LOG_HEADER_SIZE, iEntry);
+	_codecs.WriteEntry(msg, codec, iBody, body);
+	
+	ookMsgWriter header(pRecord, OOK_LOG_HEADER_SIZE);
+	header.WriteFixed32((boost::uint32_t) iEntry);
+	header.WriteFixed32(ookCrc32c::Compute(pRecord + OOK_LOG_HEADER_SIZE, iEntry));
+	
+	//The flusher only waits on an empty group
+	if(iStart == 0)
+		_cond.notify_one();
+	
+	return _lNextOffset++;
+}
+
+/*! 
+ \brief Blocks until the message at lOffset has been written, and with
+ OOK_LOG_SYNC_GROUP flushed to disk. Returns false if the log failed or
+ closed first.
+ */
+bool ookMsgLog::WaitDurable(boost::int64_t lOffset)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	while((_lDurable < lOffset) && !_bFailed && _bOpen)
+		_durableCond.wait(lock);
+	
+	return _lDurable >= lOffset;
+}
+
+/*! 
+ \brief Blocks until everything appended so far is durable.
+ */
+bool ookMsgLog::Flush()
+{
+	boost::int64_t lLast;
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		lLast = _lNextOffset - 1;
+	}
+	
+	return this->WaitDurable(lLast);
+}
+
+/*! 
+ \brief Hands obs every message from lFrom up to what has been written,
+ in offset order, that it accepts. Messages dropped by retention are
+ skipped. Returns the number delivered.
+ */
+size_t ookMsgLog::Replay(boost::int64_t lFrom, ookMsgObserverAbs* obs)
+{
+	ookMsgLogCursor cursor(this, lFrom);
+	msg_ptr msg;
+	size_t iCount = 0;
+	
+	while(cursor.Next(msg))
+	{
+		if(!obs->Accepts(msg.get()))
+			continue;
+		
+		obs->SendMessage(msg.get());
+		iCount++;
+	}
+	
+	return iCount;
+}
+
+/*! 
+ \brief Groups written so far; GetEndOffset() over this is the average
+ group.
+ */
+long ookMsgLog::GetGroupCount()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _lGroups;
+}
+
+/*! 
+ \brief The oldest offset still kept.
+ */
+boost::int64_t ookMsgLog::GetStartOffset()
+{
+	boost::mutex::scoped_lock lock(_segMut);
+	
+	if(_vSegments.empty())
+		return 0;
+	
+	return _vSegments.front()->GetBase();
+}
+
+/*! 
+ \brief The offset the next message appended will get.
+ */
+boost::int64_t ookMsgLog::GetEndOffset()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _lNextOffset;
+}
+
+/*! 
+ \brief The last offset known to be durable, -1 if none.
+ */
+boost::int64_t ookMsgLog::GetDurableOffset()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _lDurable;
+}
+
+void ookMsgLog::SetSync(ookLogSync sync)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_sync = sync;
+}
+
+/*! 
+ \brief The size at which the segment being written is sealed and a new
+ one started, 64MB by default.
+ */
+void ookMsgLog::SetSegmentSize(size_t iBytes)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_iSegmentSize = iBytes;
+}
+
+/*! 
+ \brief The most bytes Append() lets wait for the flusher before it
+ blocks, 16MB by default.
+ */
+void ookMsgLog::SetMaxPending(size_t iBytes)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_iMaxPending = iBytes;
+}
+
+/*! 
+ \brief How long the flusher lets a group build up before writing it,
+ 0 (the default) to write as soon as there is anything. Lingering trades
+ that much latency for fewer, bigger writes when appends come steadily
+ but not fast enough to fill groups on their own.
+ */
+void ookMsgLog::SetLinger(long lMicros)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_lLingerMicros = lMicros;
+}
+
+/*! 
+ \brief Keep at most lMaxBytes of sealed segments, and none last written
+ more than lMaxAgeSeconds ago. 0 turns either limit off; both are off by
+ default.
+ */
+void ookMsgLog::SetRetention(boost::uint64_t lMaxBytes, long lMaxAgeSeconds)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_lRetainBytes = lMaxBytes;
+	_lRetainSeconds = lMaxAgeSeconds;
+}
+
+/*! 
+ \brief Deletes sealed segments the retention policy no longer keeps,
+ oldest first. The segment being written is always kept. Returns the
+ number deleted.
+ */
+size_t ookMsgLog::Compact()
+{
+	boost::uint64_t lMaxBytes;
+	long lMaxAge;
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		lMaxBytes = _lRetainBytes;
+		lMaxAge = _lRetainSeconds;
+	}
+	
+	vector<log_segment_ptr> vDropped;
+	
+	{
+		boost::mutex::scoped_lock lock(_segMut);
+		
+		boost::uint64_t lTotal = 0;
+		for(size_t i = 0; i < _vSegments.size(); i++)
+			lTotal += _vSegments[i]->GetSize();
+		
+		time_t tNow = time(NULL);
+		
+		while((_vSegments.size() > 1) && _vSegments.front()->IsSealed())
+		{
+			log_segment_ptr seg = _vSegments.front();
+			
+			bool bTooBig = (lMaxBytes > 0) && (lTotal > lMaxBytes);
+			bool bTooOld = (lMaxAge > 0) && ((tNow - seg->GetModified()) > lMaxAge);
+			
+			if(!bTooBig && !bTooOld)
+				break;
+			
+			lTotal -= seg->GetSize();
+			vDropped.push_back(seg);
+			_vSegments.erase(_vSegments.begin());
+		}
+	}
+	
+	//Cursors still reading one keep it mapped until they move on
+	for(size_t i = 0; i < vDropped.size(); i++)
+		vDropped[i]->Remove();
+	
+	return vDropped.size();
+}
+
+/*
+ The segment holding lOffset, or the oldest one if lOffset has been
+ dropped, or the newest if it hasn't been written yet. An offset lost when
+ recovery cut a segment short gets the next one.
+ */
+log_segment_ptr ookMsgLog::FindSegment(boost::int64_t lOffset)
+{
+	boost::mutex::scoped_lock lock(_segMut);
+	
+	for(size_t i = _vSegments.size(); i > 0; i--)
+	{
+		if(_vSegments[i - 1]->GetBase() > lOffset)
+			continue;
+		
+		if((i < _vSegments.size()) && _vSegments[i - 1]->IsSealed() && (lOffset >= _vSegments[i - 1]->GetEnd()))
+			return _vSegments[i];
+		
+		return _vSegments[i - 1];
+	}
+	
+	if(_vSegments.empty())
+		return log_segment_ptr();
+	
+	return _vSegments.front();
+}
+
+void ookMsgLog::FlushLoop()
+{
+	while(true)
+	{
+		boost::int64_t lLast;
+		ookLogSync sync;
+		size_t iSegmentSize;
+		
+		{
+			boost::mutex::scoped_lock lock(_mut);
+			
+			while((_iPending == 0) && !_bClosing)
+				_cond.wait(lock);
+			
+			if(_iPending == 0)
+				break;
+			
+			//Give the group a moment to fill, unless it's already full
+			if(_lLingerMicros > 0)
+			{
+				ook_clock::time_point deadline = ook_clock::now() + boost::chrono::microseconds(_lLingerMicros);
+				
+				while(!_bClosing && (_iPending < (_iMaxPending / 2)))
+					if(_cond.wait_until(lock, deadline) == boost::cv_status::timeout)
+						break;
+			}
+			
+			_lGroups++;
+			
+			//Take the group; appends start the next one in the buffer we
+			//wrote last time
+			_vWriting.swap(_vPending);
+			_iWriting = _iPending;
+			_iPending = 0;
+			lLast = _lNextOffset - 1;
+			sync = _sync;
+			iSegmentSize = _iSegmentSize;
+			
+			_spaceCond.notify_all();
+		}
+		
+		try
+		{
+			_active->Append(&_vWriting[0], _iWriting);
+			
+			if(sync == OOK_LOG_SYNC_GROUP)
+				_active->Sync();
+			
+			{
+				boost::mutex::scoped_lock lock(_mut);
+				
+				_lDurable = lLast;
+				_durableCond.notify_all();
+			}
+			
+			if(_active->GetSize() >= iSegmentSize)
+				this->Roll(lLast + 1);
+		}
+		catch (system::error_code& e)
+		{
+			std::cerr << "Something bad happened in ookMsgLog::FlushLoop: " << e.message() << "\n";
+			
+			boost::mutex::scoped_lock lock(_mut);
+			
+			_bFailed = true;
+			_durableCond.notify_all();
+			_spaceCond.notify_all();
+			break;
+		}
+	}
+	
+	//Close() waits for us, and nothing is appended once it has been called
+	try
+	{
+		if(_active && !_bFailed)
+			_active->Sync();
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Something bad happened in ookMsgLog::FlushLoop: " << e.message() << "\n";
+	}
+	
+	boost::mutex::scoped_lock lock(_mut);
+	_durableCond.notify_all();
+}
+
+/*
+ Starts a new segment at lNextBase and seals the old one. The new one is
+ listed before the old is sealed, so a cursor that finds its segment
+ sealed always has somewhere to go next
+ */
+void ookMsgLog::Roll(boost::int64_t lNextBase)
+{
+	log_segment_ptr seg(new ookLogSegment(ookLogSegment::MakePath(_dir, lNextBase), lNextBase));
+	seg->Open(true);
+	
+	log_segment_ptr old = _active;
+	
+	{
+		boost::mutex::scoped_lock lock(_segMut);
+		
+		_vSegments.push_back(seg);
+		_active = seg;
+	}
+	
+	old->Sync();
+	old->Seal();
+	
+	this->Compact();
+}
+
+/*!
+ \class ookMsgLogCursor
+ \headerfile ookMsgLog.h "ookLibs/ookCore/ookMsgLog.h"
+ \brief Reads an ookMsgLog forward from an offset.
+ 
+ \code
+ 
+ ookMsgLogCursor cursor(&log, lFrom);
+ msg_ptr msg;
+ 
+ while(cursor.Next(msg))
+ 	Handle(msg.get(), msg->GetLogOffset());
+ 
+ \endcode
+ 
+ Next() returns false once it has caught up with what the flusher has
+ written; calling it again later picks up anything written since, so a
+ cursor can follow a live log. If the cursor's offset has been dropped by
+ retention it skips ahead to the oldest message kept. One cursor is for
+ one thread; any number may read a log at once.
+ */
+ookMsgLogCursor::ookMsgLogCursor(ookMsgLog* log, boost::int64_t lOffset)
+	: _log(log), _lOffset(lOffset), _iPos(0), _bPositioned(false)
+{
+	
+}
+
+ookMsgLogCursor::~ookMsgLogCursor()
+{
+	
+}
+
+/*! 
+ \brief Reads the next message, stamped with its offset. Messages of
+ classes the log has no codec for are skipped.
+ */
+bool ookMsgLogCursor::Next(msg_ptr& msg)
+{
+	while(true)
+	{
+		if(!_seg)
+		{
+			_seg = _log->FindSegment(_lOffset);
+			_bPositioned = false;
+			
+			if(!_seg)
+				return false;
+			
+			if(_lOffset < _seg->GetBase())
+				_lOffset = _seg->GetBase();
+		}
+		
+		//Sealed first: once it is, the end we read next is final
+		bool bSealed = _seg->IsSealed();
+		
+		if(_lOffset >= _seg->GetEnd())
+		{
+			if(!bSealed)
+				return false;
+			
+			_seg.reset();
+			continue;
+		}
+		
+		if(!_bPositioned)
+		{
+			_iPos = _seg->FindPosition(_lOffset);
+			_bPositioned = true;
+		}
+		
+		ookBufferView record;
+		
+		if(!_seg->ReadRecord(_iPos, record))
+			return false;
+		
+		ookMsgReader reader(record);
+		msg = _log->GetCodecs().ReadEntry(reader);
+		
+		boost::int64_t lOffset = _lOffset++;
+		
+		if(!msg)
+			continue;
+		
+		msg->SetLogOffset(lOffset);
+		
+		return true;
+	}
+}
+
+/*! 
+ \brief Moves the cursor so the next message read is the one at lOffset.
+ */
+void ookMsgLogCursor::Seek(boost::int64_t lOffset)
+{
+	_lOffset = lOffset;
+	_seg.reset();
+}
+
+/*! 
+ \brief The offset of the message Next() will read.
+ */
+boost::int64_t ookMsgLogCursor::GetOffset() const
+{
+	return _lOffset;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_LOG_H_
+#define OOK_MSG_LOG_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgObserverAbs.h"
+#include "ookLibs/ookCore/ookMsgCodecRegistry.h"
+#include "ookLibs/ookCore/ookLogSegment.h"
+#include "boost/thread.hpp"
+#include "boost/cstdint.hpp"
+
+//When appended records are flushed to the disk
+enum ookLogSync
+{
+	OOK_LOG_SYNC_NONE,		//Written to the OS; survives the process, not the machine
+	OOK_LOG_SYNC_GROUP		//fdatasync() after every group written
+};
+
+class ookMsgLog
+{
+public:
+	
+	ookMsgLog();
+	virtual ~ookMsgLog();
+	
+	template <class M>
+	void RegisterType()
+	{
+		_codecs.RegisterType<M>();
+	}
+	
+	ookMsgCodecRegistry& GetCodecs();
+	
+	void Open(const string& dir);
+	void Close();
+	bool IsOpen();
+	
+	boost::int64_t Append(ookMessage* msg);
+	bool WaitDurable(boost::int64_t lOffset);
+	bool Flush();
+	
+	size_t Replay(boost::int64_t lFrom, ookMsgObserverAbs* obs);
+	
+	boost::int64_t GetStartOffset();
+	boost::int64_t GetEndOffset();
+	boost::int64_t GetDurableOffset();
+	long GetGroupCount();
+	
+	void SetSync(ookLogSync sync);
+	void SetSegmentSize(size_t iBytes);
+	void SetMaxPending(size_t iBytes);
+	void SetLinger(long lMicros);
+	void SetRetention(boost::uint64_t lMaxBytes, long lMaxAgeSeconds);
+	size_t Compact();
+	
+protected:
+	
+	friend class ookMsgLogCursor;
+	
+	log_segment_ptr FindSegment(boost::int64_t lOffset);
+	
+	void FlushLoop();
+	void Roll(boost::int64_t lNextBase);
+	
+private:
+	
+	ookMsgLog(const ookMsgLog&);
+	ookMsgLog& operator=(const ookMsgLog&);
+	
+	ookMsgCodecRegistry _codecs;
+	string _dir;
+	
+	//Records appended since the last group went out, and their offsets
+	boost::mutex _mut;
+	boost::condition_variable _cond;
+	boost::condition_variable _spaceCond;
+	boost::condition_variable _durableCond;
+	vector<char> _vPending;
+	size_t _iPending;
+	boost::int64_t _lNextOffset;
+	boost::int64_t _lDurable;
+	long _lGroups;
+	bool _bOpen;
+	bool _bClosing;
+	bool _bFailed;
+	
+	//The flusher's group, and the segment it writes to
+	boost::thread _flusher;
+	vector<char> _vWriting;
+	size_t _iWriting;
+	log_segment_ptr _active;
+	
+	boost::mutex _segMut;
+	vector<log_segment_ptr> _vSegments;
+	
+	ookLogSync _sync;
+	size_t _iSegmentSize;
+	size_t _iMaxPending;
+	long _lLingerMicros;
+	boost::uint64_t _lRetainBytes;
+	long _lRetainSeconds;
+};
+
+class ookMsgLogCursor
+{
+public:
+	
+	ookMsgLogCursor(ookMsgLog* log, boost::int64_t lOffset = 0);
+	virtual ~ookMsgLogCursor();
+	
+	bool Next(msg_ptr& msg);
+	void Seek(boost::int64_t lOffset);
+	boost::int64_t GetOffset() const;
+	
+protected:
+	
+private:
+	
+	ookMsgLog* _log;
+	log_segment_ptr _seg;
+	boost::int64_t _lOffset;
+	size_t _iPos;
+	bool _bPositioned;
+};
+
+#endif
\ No newline at end of file
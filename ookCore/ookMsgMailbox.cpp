@@ -0,0 +1,586 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookMsgMailbox
+ \headerfile ookMsgMailbox.h "ookLibs/ookCore/ookMsgMailbox.h"
+ \brief One observer's queue in an asynchronous ookMsgDispatcher.
+ 
+ Push() queues a message and, if the mailbox isn't already scheduled,
+ hands a Drain() task to the executor. Only one Drain() runs per mailbox
+ at a time, so an observer sees its messages one at a time and in the
+ order they were posted, while different observers run in parallel on
+ the pool. A busy mailbox delivers OOK_MAILBOX_BATCH messages and then
+ requeues itself behind other work, so one chatty observer can't hold a
+ worker forever. An observer that TakesBatches() is handed up to that
+ many in a single DeliverBatch() call instead, all taken under one lock.
+ 
+ Messages wait in one of OOK_MSG_LANES lanes, picked by their priority
+ (see ookMessage::SetPriority()), and each delivery takes the next message
+ from the lane the schedule picks:
+ 
+ - OOK_LANES_STRICT always takes the most urgent lane that has anything.
+   A steady flow of high priority messages starves the bulk lane.
+ - OOK_LANES_WEIGHTED takes up to vWeights[i] messages from lane i in
+   turn, so every lane gets its share of the observer's time.
+ 
+ Either way the control lane goes first, and within a lane messages keep
+ the order they were posted in. A control message posted behind thousands
+ of bulk ones is the next delivered, not the last.
+ 
+ Each lane holds at most iCapacity messages (0 is unbounded), so a bulk
+ backlog never fills the room urgent messages need. When a lane is full,
+ Push() does what the policy says:
+ 
+ - OOK_OVERFLOW_BLOCK waits for the observer to make room. Never use it
+   for an observer that posts to its own dispatcher, it can wait on itself.
+ - OOK_OVERFLOW_DROP_OLDEST throws the lane's oldest message away.
+ - OOK_OVERFLOW_REJECT refuses the new message and returns false.
+ 
+ When the dispatcher switches executors or lane settings it builds a new
+ mailbox per observer and the old one hands over to it (see Handover()),
+ so nothing queued is lost and the observer is still called on one thread
+ at a time.
+ 
+ Drain() tasks hold a reference to the mailbox, and the mailbox to the
+ observer, so tasks still sitting in the executor after the observer is
+ unregistered find the mailbox closed and do nothing.
+ */
+#include "ookLibs/ookCore/ookMsgMailbox.h"
+#include "ookLibs/ookCore/ookMsgRoutes.h"
+
+//Strict, with weights of 8:4:2:1 ready for OOK_LANES_WEIGHTED
+ookMsgLanes::ookMsgLanes()
+	: policy(OOK_LANES_STRICT)
+{
+	for(int i = 0; i < OOK_MSG_LANES; i++)
+	{
+		vWeights[i] = 1 << (OOK_MSG_LANES - 1 - i);
+		vStats[i].reset(new ookDispatchStats());
+	}
+}
+
+ookMsgMailbox::ookMsgMailbox(subscriber_ptr sub, ookExecutor* pool, size_t iCapacity,
+														 ookOverflowPolicy policy, boost::shared_ptr<ookDispatchStats> stats, const ookMsgLanes& lanes)
+	: _sub(sub), _pPool(pool), _iCapacity(iCapacity), _policy(policy), _stats(stats), _lanes(lanes),
+		_iQueued(0), _iLane(OOK_MSG_LANES - 1), _iCredit(0), _bScheduled(false), _bBusy(false), _bClosed(false), _bForward(false), _iIdleWaiters(0)
+{
+	for(int i = 0; i < OOK_MSG_LANES; i++)
+	{
+		_vEnqueued[i] = 0;
+		_vDone[i] = 0;
+	}
+}
+
+ookMsgMailbox::~ookMsgMailbox()
+{
+	
+}
+
+/*! 
+ \brief Queues msg for the observer. Returns false if it was refused,
+ either by OOK_OVERFLOW_REJECT or because the mailbox is closed.
+ */
+bool ookMsgMailbox::Push(msg_ptr msg, ook_clock::time_point tPosted)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	if(!this->Enqueue(lock, msg, tPosted))
+		return _bForward ? this->Forward(lock, &msg, 1, tPosted) : false;
+	
+	if(_bScheduled)
+		return true;
+	
+	_bScheduled = true;
+	lock.unlock();
+	
+	_pPool->Execute(boost::bind(&ookMsgMailbox::Drain, shared_from_this()));
+	
+	return true;
+}
+
+/*! 
+ \brief Queues iCount messages under one lock and schedules one Drain()
+ for them all. Returns false if any of them was refused; the others are
+ still queued.
+ */
+bool ookMsgMailbox::PushBatch(const msg_ptr* vMsgs, size_t iCount, ook_clock::time_point tPosted)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	bool bQueued = true;
+	
+	for(size_t i = 0; i < iCount; i++)
+	{
+		if(this->Enqueue(lock, vMsgs[i], tPosted))
+			continue;
+		
+		//Handed over while waiting for room; the rest go to the successor
+		if(_bForward)
+			return this->Forward(lock, vMsgs + i, iCount - i, tPosted) && bQueued;
+		
+		bQueued = false;
+	}
+	
+	if(_bScheduled || (_iQueued == 0))
+		return bQueued;
+	
+	_bScheduled = true;
+	lock.unlock();
+	
+	_pPool->Execute(boost::bind(&ookMsgMailbox::Drain, shared_from_this()));
+	
+	return bQueued;
+}
+
+/*! 
+ \brief Blocks until everything queued so far has been delivered or
+ dropped. Messages posted after the call aren't waited for, so it returns
+ even while other threads keep posting.
+ */
+void ookMsgMailbox::WaitIdle()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	boost::uint64_t vTarget[OOK_MSG_LANES];
+	
+	for(int i = 0; i < OOK_MSG_LANES; i++)
+		vTarget[i] = _vEnqueued[i];
+	
+	_iIdleWaiters++;
+	
+	for(int i = 0; (i < OOK_MSG_LANES) && !_bClosed; )
+	{
+		if(_vDone[i] < vTarget[i])
+			_idleCond.wait(lock);
+		else
+			i++;
+	}
+	
+	_iIdleWaiters--;
+}
+
+//Puts msg in its lane, making room as the overflow policy says. Called
+//with lock held; leaves scheduling to the caller.
+bool ookMsgMailbox::Enqueue(boost::mutex::scoped_lock& lock, const msg_ptr& msg, ook_clock::time_point tPosted)
+{
+	int iLane = std::min(std::max((int) msg->GetPriority(), 0), OOK_MSG_LANES - 1);
+	std::deque<ookQueuedMsg>& lane = _vLanes[iLane];
+	ookDispatchStats& laneStats = *_lanes.vStats[iLane];
+	
+	while(!_bClosed && (_iCapacity > 0) && (lane.size() >= _iCapacity))
+	{
+		if(_policy == OOK_OVERFLOW_REJECT)
+		{
+			_stats->RecordRejected();
+			laneStats.RecordRejected();
+			return false;
+		}
+		
+		if(_policy == OOK_OVERFLOW_DROP_OLDEST)
+		{
+			lane.pop_front();
+			_iQueued--;
+			_vDone[iLane]++;
+			_stats->RecordDropped();
+			laneStats.RecordDropped();
+			continue;
+		}
+		
+		//A batch fills the lane before its Drain() is scheduled
+		if(!_bScheduled)
+		{
+			_bScheduled = true;
+			lock.unlock();
+			
+			_pPool->Execute(boost::bind(&ookMsgMailbox::Drain, shared_from_this()));
+			
+			lock.lock();
+			continue;
+		}
+		
+		_spaceCond.wait(lock);
+	}
+	
+	if(_bForward)
+		return false;
+	
+	if(_bClosed)
+	{
+		_stats->RecordRejected();
+		laneStats.RecordRejected();
+		return false;
+	}
+	
+	ookQueuedMsg item;
+	item.msg = msg;
+	item.tPosted = tPosted;
+	
+	lane.push_back(item);
+	_iQueued++;
+	_vEnqueued[iLane]++;
+	_stats->RecordQueued();
+	laneStats.RecordQueued();
+	
+	return true;
+}
+
+/*! 
+ \brief Throws away whatever is queued, refuses anything posted later and
+ waits for a delivery in progress to finish. Afterwards the observer is
+ never called again, so it is safe to destroy. Called from inside the
+ observer's own delivery it can't wait for that, and returns at once.
+ */
+void ookMsgMailbox::Close()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_bClosed = true;
+	
+	for(int iLane = 0; iLane < OOK_MSG_LANES; iLane++)
+	{
+		for(size_t i = 0; i < _vLanes[iLane].size(); i++)
+		{
+			_stats->RecordDropped();
+			_lanes.vStats[iLane]->RecordDropped();
+		}
+		
+		_vDone[iLane] += _vLanes[iLane].size();
+		_vLanes[iLane].clear();
+	}
+	
+	_iQueued = 0;
+	_spaceCond.notify_all();
+	_idleCond.notify_all();
+	
+	while(_bBusy && (_busyThread != boost::this_thread::get_id()))
+		_idleCond.wait(lock);
+}
+
+/*! 
+ \brief Keeps a new mailbox from delivering until Release(). Messages are
+ still queued meanwhile.
+ */
+void ookMsgMailbox::Hold()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_bScheduled = true;
+}
+
+/*! 
+ \brief Lets a mailbox held by Hold() deliver what it has queued.
+ */
+void ookMsgMailbox::Release()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	if(_bClosed || (_iQueued == 0))
+	{
+		_bScheduled = false;
+		_idleCond.notify_all();
+		return;
+	}
+	
+	lock.unlock();
+	
+	_pPool->Execute(boost::bind(&ookMsgMailbox::Drain, shared_from_this()));
+}
+
+/*! 
+ \brief Retires this mailbox in favour of next, a held mailbox for the same
+ observer that is already published. Waits for a delivery in progress to
+ finish, then moves the backlog to the front of next's lanes, ahead of
+ anything posted to next meanwhile, and passes on what is posted here
+ later. Release next afterwards.
+ 
+ With no next, the dispatcher has gone synchronous: the backlog is
+ delivered on the calling thread, and later posts on the posting thread.
+ */
+void ookMsgMailbox::Handover(boost::shared_ptr<ookMsgMailbox> next)
+{
+	std::deque<ookQueuedMsg> vTaken[OOK_MSG_LANES];
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		_bClosed = true;
+		_bForward = true;
+		_next = next;
+		_spaceCond.notify_all();
+		_idleCond.notify_all();
+		
+		while(_bBusy && (_busyThread != boost::this_thread::get_id()))
+			_idleCond.wait(lock);
+		
+		for(int i = 0; i < OOK_MSG_LANES; i++)
+		{
+			_vDone[i] += _vLanes[i].size();
+			vTaken[i].swap(_vLanes[i]);
+		}
+		
+		_iQueued = 0;
+	}
+	
+	if(next)
+	{
+		next->TakeOver(vTaken);
+		return;
+	}
+	
+	for(int i = 0; i < OOK_MSG_LANES; i++)
+	{
+		for(size_t j = 0; j < vTaken[i].size(); j++)
+		{
+			ookQueuedMsg& item = vTaken[i][j];
+			boost::chrono::nanoseconds latency = ookClock::Now() - item.tPosted;
+			
+			_stats->RecordDelivered(latency);
+			_lanes.vStats[i]->RecordDelivered(latency);
+			
+			_sub->Deliver(item.msg.get(), &item.tPosted);
+		}
+	}
+}
+
+size_t ookMsgMailbox::GetSize()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _iQueued;
+}
+
+ookMsgObserverAbs* ookMsgMailbox::GetObserver()
+{
+	return _sub->GetObserver();
+}
+
+//Passes on messages posted after Handover()
+bool ookMsgMailbox::Forward(boost::mutex::scoped_lock& lock, const msg_ptr* vMsgs, size_t iCount, ook_clock::time_point tPosted)
+{
+	boost::shared_ptr<ookMsgMailbox> next = _next;
+	lock.unlock();
+	
+	if(next)
+		return next->PushBatch(vMsgs, iCount, tPosted);
+	
+	for(size_t i = 0; (i < iCount) && _sub->IsActive(); i++)
+		_sub->Deliver(vMsgs[i].get());
+	
+	return true;
+}
+
+//Puts a predecessor's backlog ahead of what is queued here. Lanes may end
+//up over capacity until it is delivered; posters wait or drop as usual.
+void ookMsgMailbox::TakeOver(std::deque<ookQueuedMsg>* vLanes)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	for(int i = 0; i < OOK_MSG_LANES; i++)
+	{
+		if(_bClosed)
+		{
+			for(size_t j = 0; j < vLanes[i].size(); j++)
+			{
+				_stats->RecordDropped();
+				_lanes.vStats[i]->RecordDropped();
+			}
+			
+			continue;
+		}
+		
+		_vLanes[i].insert(_vLanes[i].begin(), vLanes[i].begin(), vLanes[i].end());
+		_iQueued += vLanes[i].size();
+		_vEnqueued[i] += vLanes[i].size();
+	}
+}
+
+void ookMsgMailbox::Drain()
+{
+	if(_sub->GetObserver()->TakesBatches())
+	{
+		this->DrainBatch();
+		return;
+	}
+	
+	for(int i = 0; i < OOK_MAILBOX_BATCH; i++)
+	{
+		ookQueuedMsg item;
+		int iLane;
+		
+		{
+			boost::mutex::scoped_lock lock(_mut);
+			
+			if(_bClosed || (_iQueued == 0))
+			{
+				_bScheduled = false;
+				_idleCond.notify_all();
+				return;
+			}
+			
+			iLane = this->NextLane();
+			item = _vLanes[iLane].front();
+			_vLanes[iLane].pop_front();
+			_iQueued--;
+			_bBusy = true;
+			_busyThread = boost::this_thread::get_id();
+			
+			//Posters may be waiting on different lanes
+			if(_policy == OOK_OVERFLOW_BLOCK)
+				_spaceCond.notify_all();
+		}
+		
+		boost::chrono::nanoseconds latency = ookClock::Now() - item.tPosted;
+		_stats->RecordDelivered(latency);
+		_lanes.vStats[iLane]->RecordDelivered(latency);
+		
+		//Catches what the observer throws, so the worker carries on
+		_sub->Deliver(item.msg.get(), &item.tPosted);
+		
+		boost::mutex::scoped_lock lock(_mut);
+		_bBusy = false;
+		_vDone[iLane]++;
+		
+		if(_bClosed || (_iIdleWaiters > 0))
+			_idleCond.notify_all();
+	}
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		if(_bClosed || (_iQueued == 0))
+		{
+			_bScheduled = false;
+			_idleCond.notify_all();
+			return;
+		}
+	}
+	
+	//Still scheduled; go to the back of the executor's queue
+	_pPool->Execute(boost::bind(&ookMsgMailbox::Drain, shared_from_this()));
+}
+
+//Drain() for an observer that takes batches: everything queued, up to
+//OOK_MAILBOX_BATCH in lane order, goes in one DeliverBatch() call
+void ookMsgMailbox::DrainBatch()
+{
+	msg_ptr vItems[OOK_MAILBOX_BATCH];
+	ookMessage* vMsgs[OOK_MAILBOX_BATCH];
+	ook_clock::time_point vPosted[OOK_MAILBOX_BATCH];
+	int vLane[OOK_MAILBOX_BATCH];
+	size_t iCount = 0;
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		if(_bClosed || (_iQueued == 0))
+		{
+			_bScheduled = false;
+			_idleCond.notify_all();
+			return;
+		}
+		
+		ook_clock::time_point tNow = ookClock::Now();
+		
+		while((iCount < OOK_MAILBOX_BATCH) && (_iQueued > 0))
+		{
+			int iLane = this->NextLane();
+			ookQueuedMsg& item = _vLanes[iLane].front();
+			
+			_stats->RecordDelivered(tNow - item.tPosted);
+			_lanes.vStats[iLane]->RecordDelivered(tNow - item.tPosted);
+			
+			vItems[iCount].swap(item.msg);
+			vMsgs[iCount] = vItems[iCount].get();
+			vPosted[iCount] = item.tPosted;
+			vLane[iCount] = iLane;
+			iCount++;
+			
+			_vLanes[iLane].pop_front();
+			_iQueued--;
+		}
+		
+		_bBusy = true;
+		_busyThread = boost::this_thread::get_id();
+		
+		if(_policy == OOK_OVERFLOW_BLOCK)
+			_spaceCond.notify_all();
+	}
+	
+	//An observer that throws loses the rest of that batch, not the worker
+	_sub->DeliverBatch(vMsgs, iCount, vPosted);
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		_bBusy = false;
+		
+		for(size_t i = 0; i < iCount; i++)
+			_vDone[vLane[i]]++;
+		
+		if(_bClosed || (_iQueued == 0))
+		{
+			_bScheduled = false;
+			_idleCond.notify_all();
+			return;
+		}
+		
+		if(_iIdleWaiters > 0)
+			_idleCond.notify_all();
+	}
+	
+	_pPool->Execute(boost::bind(&ookMsgMailbox::Drain, shared_from_this()));
+}
+
+/*
+ Called with _mut held and something queued. Weighted scheduling is a
+ round robin over the lanes below control: _iLane may take _iCredit more
+ messages before the turn passes on, and an empty lane passes at once.
+ */
+int ookMsgMailbox::NextLane()
+{
+	if(!_vLanes[OOK_PRIORITY_CONTROL].empty())
+		return OOK_PRIORITY_CONTROL;
+	
+	if(_lanes.policy == OOK_LANES_STRICT)
+	{
+		for(int i = OOK_PRIORITY_CONTROL + 1; i < OOK_MSG_LANES - 1; i++)
+			if(!_vLanes[i].empty())
+				return i;
+		
+		return OOK_MSG_LANES - 1;
+	}
+	
+	while((_iCredit <= 0) || _vLanes[_iLane].empty())
+	{
+		_iLane = (_iLane % (OOK_MSG_LANES - 1)) + 1;
+		_iCredit = std::max(_lanes.vWeights[_iLane], 1);
+	}
+	
+	_iCredit--;
+	
+	return _iLane;
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_MAILBOX_H_
+#define OOK_MSG_MAILBOX_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgObserverAbs.h"
+#include "ookLibs/ookCore/ookDispatchStats.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/thread.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/enable_shared_from_this.hpp"
+
+#include <deque>
+
+//Messages one worker delivers from a mailbox before letting others run
+#define OOK_MAILBOX_BATCH 64
+
+class ookMsgSubscriber;
+typedef boost::shared_ptr<ookMsgSubscriber> subscriber_ptr;
+
+//What PostMsg() does when an observer's queue is full
+enum ookOverflowPolicy
+{
+	OOK_OVERFLOW_BLOCK,
+	OOK_OVERFLOW_DROP_OLDEST,
+	OOK_OVERFLOW_REJECT
+};
+
+//How a mailbox picks the lane it delivers from next
+enum ookLanePolicy
+{
+	OOK_LANES_STRICT,
+	OOK_LANES_WEIGHTED
+};
+
+//A mailbox's lane settings and the per lane stats, shared by the dispatcher
+struct ookMsgLanes
+{
+	ookMsgLanes();
+	
+	ookLanePolicy policy;
+	int vWeights[OOK_MSG_LANES];
+	boost::shared_ptr<ookDispatchStats> vStats[OOK_MSG_LANES];
+};
+
+struct ookQueuedMsg
+{
+	msg_ptr msg;
+	ook_clock::time_point tPosted;
+};
+
+class ookMsgMailbox : public boost::enable_shared_from_this<ookMsgMailbox>
+{
+public:
+	
+	ookMsgMailbox(subscriber_ptr sub, ookExecutor* pool, size_t iCapacity,
+								ookOverflowPolicy policy, boost::shared_ptr<ookDispatchStats> stats, const ookMsgLanes& lanes);
+	virtual ~ookMsgMailbox();
+	
+	bool Push(msg_ptr msg, ook_clock::time_point tPosted);
+	bool PushBatch(const msg_ptr* vMsgs, size_t iCount, ook_clock::time_point tPosted);
+	
+	void WaitIdle();
+	void Close();
+	
+	void Hold();
+	void Release();
+	void Handover(boost::shared_ptr<ookMsgMailbox> next);
+	
+	size_t GetSize();
+	ookMsgObserverAbs* GetObserver();
+	
+protected:
+	
+	bool Enqueue(boost::mutex::scoped_lock& lock, const msg_ptr& msg, ook_clock::time_point tPosted);
+	bool Forward(boost::mutex::scoped_lock& lock, const msg_ptr* vMsgs, size_t iCount, ook_clock::time_point tPosted);
+	void TakeOver(std::deque<ookQueuedMsg>* vLanes);
+	void Drain();
+	void DrainBatch();
+	int NextLane();
+	
+private:
+	
+	subscriber_ptr _sub;
+	ookExecutor* _pPool;
+	size_t _iCapacity;
+	ookOverflowPolicy _policy;
+	boost::shared_ptr<ookDispatchStats> _stats;
+	ookMsgLanes _lanes;
+	
+	std::deque<ookQueuedMsg> _vLanes[OOK_MSG_LANES];
+	size_t _iQueued;
+	int _iLane;
+	int _iCredit;
+	bool _bScheduled;
+	bool _bBusy;
+	bool _bClosed;
+	boost::thread::id _busyThread;
+	
+	//Set by Handover(); later posts go to _next, or straight to the
+	//observer when there is none
+	bool _bForward;
+	boost::shared_ptr<ookMsgMailbox> _next;
+	
+	//Messages each lane has taken in and finished with, delivered or
+	//dropped, for WaitIdle(); lanes are FIFO, so these say which are done
+	boost::uint64_t _vEnqueued[OOK_MSG_LANES];
+	boost::uint64_t _vDone[OOK_MSG_LANES];
+	int _iIdleWaiters;
+	
+	boost::mutex _mut;
+	boost::condition_variable _spaceCond;
+	boost::condition_variable _idleCond;
+};
+
+typedef boost::shared_ptr<ookMsgMailbox> mailbox_ptr;
+
+#endif
\ No newline at end of file
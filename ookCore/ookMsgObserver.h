@@ -37,6 +37,7 @@
 #include "ookLibs/ookCore/typedefs.h"
 #include "ookLibs/ookCore/ookMsgObserverAbs.h"
 #include "ookLibs/ookCore/ookMessage.h"
+#include "boost/type_traits/is_same.hpp"
 
 template <class H, class M>
 class ookMsgObserver : public ookMsgObserverAbs
@@ -82,6 +83,24 @@ public:
 	{
 		return dynamic_cast<M*>(msg) != 0;
 	}	
+	
+	//If M has no OOK_MESSAGE_TYPE() of its own, M::StaticType() is its
+	//parent's and can't be trusted for routing
+	const ookMsgType* GetMsgType() const
+	{
+		if(boost::is_same<typename M::ook_msg_self, M>::value)
+			return M::StaticType();
+		
+		return NULL;
+	}
+	
+	void Deliver(ookMessage* msg)
+	{
+		if(boost::is_same<typename M::ook_msg_self, M>::value)
+			(_handler->*_handlerFunc)(static_cast<M*>(msg));
+		else
+			this->SendMessage(msg);
+	}
 
 protected:
 	
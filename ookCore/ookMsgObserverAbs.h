@@ -43,13 +43,27 @@ public:
 	
 	ookMsgObserverAbs() {}
 	ookMsgObserverAbs(const ookMsgObserverAbs& observer) {}
-	~ookMsgObserverAbs(){}
+	virtual ~ookMsgObserverAbs(){}
 	
 	ookMsgObserverAbs& operator = (const ookMsgObserverAbs& observer);
 	
 	virtual void SendMessage(ookMessage* pNf) = 0;
 	virtual bool Accepts(ookMessage* pNf) = 0;
 	
+	//Observers with a type are routed to by ookMsgDispatcher's type index
+	//and handed messages through Deliver() without any Accepts() check
+	virtual const ookMsgType* GetMsgType() const { return NULL; }
+	virtual void Deliver(ookMessage* pNf) { this->SendMessage(pNf); }
+	
+	//Observers that would rather take several messages per call; see
+	//ookMsgBatchObserver and ookMsgDispatcher::PostBatch()
+	virtual bool TakesBatches() const { return false; }
+	virtual void DeliverBatch(ookMessage** vMsgs, size_t iCount)
+	{
+		for(size_t i = 0; i < iCount; i++)
+			this->Deliver(vMsgs[i]);
+	}
+	
 //	virtual bool equals(const AbstractObserver& observer) const = 0;	
 //	virtual AbstractObserver* clone() const = 0;	
 	
@@ -0,0 +1,145 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_POOL_H_
+#define OOK_MSG_POOL_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookThread/ookMPMCQueue.h"
+#include "boost/intrusive_ptr.hpp"
+#include "boost/atomic.hpp"
+
+/*!
+ \brief Recycles messages of class M, so steady message traffic doesn't
+ allocate.
+ 
+ \code
+ 
+ boost::intrusive_ptr<ookTextMessage> msg = ookMsgPool<ookTextMessage>::Global().Acquire();
+ msg->SetMessage(payload);
+ dispatcher.PostMsg(msg.get());
+ 
+ \endcode
+ 
+ Acquire() hands out a cached message, or a new one when the cache is
+ empty. When its last reference is released, on whatever thread, the
+ message goes back in the cache, or is deleted if the cache is full.
+ Messages come back as they were left, apart from what OnRecycle() clears,
+ so set every field after Acquire(). A recycled ookTextMessage keeps its
+ string's capacity, so refilling it doesn't allocate either.
+ 
+ The cache is an ookMPMCQueue, so Acquire() and the release are lock free
+ and any thread may do either. Messages are usually released on another
+ thread than the one that made them, which a shared cache handles without
+ messages piling up in one thread's cache.
+ 
+ The pool must outlive its messages. Global() is never destroyed, for
+ messages that live until exit. M must be default constructible.
+ */
+template <class M>
+class ookMsgPool : public ookMsgRecycler
+{
+public:
+	
+	ookMsgPool(size_t iCapacity = 1024)
+		: _free(iCapacity), _lHits(0), _lMisses(0)
+	{
+		
+	}
+	
+	virtual ~ookMsgPool()
+	{
+		M* msg = NULL;
+		
+		while(_free.TryPop(msg))
+			delete msg;
+	}
+	
+	boost::intrusive_ptr<M> Acquire()
+	{
+		M* msg = NULL;
+		
+		if(_free.TryPop(msg))
+			_lHits.fetch_add(1, boost::memory_order_relaxed);
+		else
+		{
+			msg = new M();
+			msg->SetRecycler(this);
+			
+			_lMisses.fetch_add(1, boost::memory_order_relaxed);
+		}
+		
+		return boost::intrusive_ptr<M>(msg);
+	}
+	
+	virtual void Recycle(ookMessage* msg)
+	{
+		M* recycled = static_cast<M*>(msg);
+		recycled->OnRecycle();
+		
+		if(!_free.TryPush(recycled))
+			delete recycled;
+	}
+	
+	size_t GetCachedCount()
+	{
+		return _free.GetSize();
+	}
+	
+	long GetHitCount() const
+	{
+		return _lHits.load(boost::memory_order_relaxed);
+	}
+	
+	long GetMissCount() const
+	{
+		return _lMisses.load(boost::memory_order_relaxed);
+	}
+	
+	static ookMsgPool<M>& Global()
+	{
+		static ookMsgPool<M>* pool = new ookMsgPool<M>();
+		return *pool;
+	}
+	
+protected:
+	
+private:
+	
+	ookMsgPool(const ookMsgPool&);
+	ookMsgPool& operator=(const ookMsgPool&);
+	
+	ookMPMCQueue<M*> _free;
+	boost::atomic<long> _lHits;
+	boost::atomic<long> _lMisses;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,579 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookMsgRoutes
+ \headerfile ookMsgRoutes.h "ookLibs/ookCore/ookMsgRoutes.h"
+ \brief One version of an ookMsgDispatcher's observer list, with its type
+ index.
+ 
+ The dispatcher never changes a published ookMsgRoutes. Registering or
+ unregistering copies the current one, changes the copy and swaps it in,
+ so PostMsg() can walk a routes object with no lock while it is being
+ replaced. The copy shares the ookMsgSubscribers, so deactivating one is
+ seen by every version at once.
+ 
+ Post() walks the lists for the message's type and its parents, so it only
+ visits interested observers and calls them without a dynamic_cast.
+ Observers of the message's own type go first, then those of its parent
+ type and so on up to ookMessage, each group in registration order.
+ Observers whose message class has no OOK_MESSAGE_TYPE() come last.
+ 
+ Observers registered with a topic pattern are kept in an ookTopicTrie
+ instead. A message with a topic also goes to the ones whose pattern
+ matches it and whose type it is, after the others and in registration
+ order. Only the matching patterns are visited.
+ 
+ PostBatch() splits the batch into runs of messages with the same type and
+ topic, which all go to the same observers, and looks the observers up
+ once per run. Each observer then gets the whole run in one DeliverBatch()
+ call, or one PushBatch() onto its mailbox. Observers without a type still
+ check each message with Accepts().
+ */
+#include "ookLibs/ookCore/ookMsgRoutes.h"
+#include "ookLibs/ookCore/ookException.h"
+#include "boost/core/demangle.hpp"
+
+#include <algorithm>
+#include <typeinfo>
+
+/*! 
+ \class ookMsgSubscriber
+ \headerfile ookMsgRoutes.h "ookLibs/ookCore/ookMsgRoutes.h"
+ \brief A registered observer. Owns the observer, which is deleted with
+ the last routes version or mailbox still using it.
+ 
+ Every call into the observer goes through Deliver() or DeliverBatch(),
+ which keep what it throws from reaching the thread that posted or the
+ worker, and time the call when there is a profiler.
+ */
+ookMsgSubscriber::ookMsgSubscriber(ook_subscription_id id, ookMsgObserverAbs* obs, const string& topic)
+	: _id(id), _observer(obs), _pType(obs->GetMsgType()), _topic(topic), _bActive(true),
+		_pProfiler(NULL), _pProfile(NULL)
+{
+	
+}
+
+ookMsgSubscriber::~ookMsgSubscriber()
+{
+	
+}
+
+ook_subscription_id ookMsgSubscriber::GetId() const
+{
+	return _id;
+}
+
+const ookMsgType* ookMsgSubscriber::GetType() const
+{
+	return _pType;
+}
+
+/*! 
+ \brief The topic pattern the observer was registered with, empty for one
+ that gets every message of its type.
+ */
+const string& ookMsgSubscriber::GetTopic() const
+{
+	return _topic;
+}
+
+/*! 
+ \brief True if the observer takes msg's class, by type when it has one.
+ */
+bool ookMsgSubscriber::Accepts(ookMessage* msg) const
+{
+	if(_pType)
+		return msg->GetType()->IsA(_pType);
+	
+	return _observer->Accepts(msg);
+}
+
+ookMsgObserverAbs* ookMsgSubscriber::GetObserver() const
+{
+	return _observer.get();
+}
+
+boost::shared_ptr<ookMsgObserverAbs> ookMsgSubscriber::GetSharedObserver() const
+{
+	return _observer;
+}
+
+bool ookMsgSubscriber::IsActive() const
+{
+	return _bActive.load(boost::memory_order_acquire);
+}
+
+void ookMsgSubscriber::Deactivate()
+{
+	_bActive.store(false, boost::memory_order_release);
+}
+
+/*! 
+ \brief Starts timing the observer's calls into a profile of its own in
+ profiler. Set by ookMsgDispatcher::SetProfiler() before messages flow.
+ */
+void ookMsgSubscriber::SetProfiler(ookDispatchProfiler* profiler)
+{
+	_pProfiler = profiler;
+	_pProfile = NULL;
+	
+	if(profiler)
+		_pProfile = profiler->AddObserver(_id, boost::core::demangle(typeid(*_observer).name()), _topic);
+}
+
+/*! 
+ \brief Hands msg to the observer. pPosted is when it was queued, for
+ the trace, or NULL when delivered straight from PostMsg().
+ */
+void ookMsgSubscriber::Deliver(ookMessage* msg, const ook_clock::time_point* pPosted)
+{
+	if(!_pProfile)
+		this->Invoke(&msg, 1);
+	else
+		this->DeliverBatch(&msg, 1, pPosted);
+}
+
+/*! 
+ \brief Hands the messages to the observer in one call if it takes
+ batches, otherwise one call each. vPosted, if not NULL, holds when each
+ was queued.
+ */
+void ookMsgSubscriber::DeliverBatch(ookMessage** vMsgs, size_t iCount, const ook_clock::time_point* vPosted)
+{
+	ookObserverProfile* profile = _pProfile;
+	
+	if((iCount > 1) && !_observer->TakesBatches())
+	{
+		for(size_t i = 0; i < iCount; i++)
+		{
+			if(!profile)
+				this->Invoke(vMsgs + i, 1);
+			else
+				this->DeliverBatch(vMsgs + i, 1, vPosted ? vPosted + i : NULL);
+		}
+		
+		return;
+	}
+	
+	if(!profile)
+	{
+		this->Invoke(vMsgs, iCount);
+		return;
+	}
+	
+	ook_clock::time_point tStart = ookClock::Now();
+	bool bOk = this->Invoke(vMsgs, iCount);
+	ook_clock::time_point tEnd = ookClock::Now();
+	
+	profile->RecordCall(tEnd - tStart, iCount);
+	
+	if(!bOk)
+		profile->RecordException();
+	
+	for(size_t i = 0; i < iCount; i++)
+		if(vMsgs[i]->GetTraceId())
+			_pProfiler->RecordSpan(vMsgs[i]->GetTraceId(), profile->GetName(), tStart, tEnd, vMsgs[i], vPosted ? vPosted + i : NULL, !bOk);
+}
+
+//Calls the observer. An exception loses the messages of that call, and is
+//reported here instead of unwinding into the network thread or worker.
+bool ookMsgSubscriber::Invoke(ookMessage** vMsgs, size_t iCount)
+{
+	try
+	{
+		if(iCount == 1)
+			_observer->Deliver(vMsgs[0]);
+		else
+			_observer->DeliverBatch(vMsgs, iCount);
+		
+		return true;
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookMsgSubscriber::Invoke: " << e.what() << "\n";
+	}
+	catch(...)
+	{
+		std::cerr << "Oh noes! Unknown error in ookMsgSubscriber::Invoke()\n";
+	}
+	
+	return false;
+}
+
+ookMsgRoutes::ookMsgRoutes(ookExecutor* pool)
+	: _pPool(pool)
+{
+	
+}
+
+ookMsgRoutes::~ookMsgRoutes()
+{
+	
+}
+
+/*! 
+ \brief Adds a subscriber with its mailbox, NULL when synchronous.
+ */
+void ookMsgRoutes::Add(subscriber_ptr sub, mailbox_ptr box)
+{
+	_vSubscribers.push_back(sub);
+	_vMailboxes.push_back(box);
+	
+	this->BuildIndex();
+}
+
+/*! 
+ \brief Adds subscribers in order, each with the mailbox at the same
+ index, indexing once for them all.
+ */
+void ookMsgRoutes::Add(const vector<subscriber_ptr>& vSubs, const vector<mailbox_ptr>& vBoxes)
+{
+	_vSubscribers.insert(_vSubscribers.end(), vSubs.begin(), vSubs.end());
+	_vMailboxes.insert(_vMailboxes.end(), vBoxes.begin(), vBoxes.end());
+	
+	this->BuildIndex();
+}
+
+/*! 
+ \brief Removes subscriber id, handing it back with its mailbox. Returns
+ false if there is no such subscriber.
+ */
+bool ookMsgRoutes::Remove(ook_subscription_id id, subscriber_ptr& sub, mailbox_ptr& box)
+{
+	for(size_t i = 0; i < _vSubscribers.size(); i++)
+	{
+		if(_vSubscribers[i]->GetId() != id)
+			continue;
+		
+		sub = _vSubscribers[i];
+		box = _vMailboxes[i];
+		
+		_vSubscribers.erase(_vSubscribers.begin() + i);
+		_vMailboxes.erase(_vMailboxes.begin() + i);
+		
+		this->BuildIndex();
+		
+		return true;
+	}
+	
+	return false;
+}
+
+/*! 
+ \brief See ookMsgDispatcher::PostMsg().
+ */
+bool ookMsgRoutes::Post(ookMessage* msg)
+{
+	msg_ptr copy;
+	ook_clock::time_point tPosted;
+	bool bQueued = true;
+	
+	if(_pPool)
+		tPosted = ookClock::Now();
+	
+	for(const ookMsgType* type = msg->GetType(); type; type = type->GetParent())
+	{
+		size_t iId = type->GetId();
+		
+		if(iId >= _vTypeIndex.size())
+			continue;
+		
+		const vector<size_t>& vIndex = _vTypeIndex[iId];
+		
+		for(size_t i = 0; i < vIndex.size(); i++)
+			if(!this->Deliver(vIndex[i], msg, copy, tPosted))
+				bQueued = false;
+	}
+	
+	for(size_t i = 0; i < _vUntyped.size(); i++)
+	{
+		if(!_vSubscribers[_vUntyped[i]]->GetObserver()->Accepts(msg))
+			continue;
+		
+		if(!this->Deliver(_vUntyped[i], msg, copy, tPosted))
+			bQueued = false;
+	}
+	
+	if(_topics.IsEmpty() || msg->GetTopic().empty())
+		return bQueued;
+	
+	//Matches come back in trie order; deliver them in registration order
+	vector<size_t> vMatches;
+	_topics.Match(msg->GetTopic(), vMatches);
+	std::sort(vMatches.begin(), vMatches.end());
+	
+	for(size_t i = 0; i < vMatches.size(); i++)
+	{
+		if(!_vSubscribers[vMatches[i]]->Accepts(msg))
+			continue;
+		
+		if(!this->Deliver(vMatches[i], msg, copy, tPosted))
+			bQueued = false;
+	}
+	
+	return bQueued;
+}
+
+/*! 
+ \brief See ookMsgDispatcher::PostBatch().
+ */
+bool ookMsgRoutes::PostBatch(ookMessage** vMsgs, size_t iCount)
+{
+	vector<msg_ptr> vCopies;
+	vector<size_t> vMatches;
+	ook_clock::time_point tPosted;
+	bool bQueued = true;
+	
+	if(_pPool)
+		tPosted = ookClock::Now();
+	
+	for(size_t iStart = 0, iRun = 0; iStart < iCount; iStart += iRun)
+	{
+		ookMessage* first = vMsgs[iStart];
+		
+		for(iRun = 1; iStart + iRun < iCount; iRun++)
+		{
+			ookMessage* msg = vMsgs[iStart + iRun];
+			
+			if((msg->GetType() != first->GetType()) || (msg->GetTopic() != first->GetTopic()))
+				break;
+		}
+		
+		ookMessage** vRun = vMsgs + iStart;
+		vCopies.clear();
+		
+		for(const ookMsgType* type = first->GetType(); type; type = type->GetParent())
+		{
+			size_t iId = type->GetId();
+			
+			if(iId >= _vTypeIndex.size())
+				continue;
+			
+			const vector<size_t>& vIndex = _vTypeIndex[iId];
+			
+			for(size_t i = 0; i < vIndex.size(); i++)
+				if(!this->DeliverRun(vIndex[i], vRun, iRun, vCopies, tPosted))
+					bQueued = false;
+		}
+		
+		for(size_t i = 0; i < _vUntyped.size(); i++)
+			if(!this->DeliverEach(_vUntyped[i], vRun, iRun, vCopies, tPosted))
+				bQueued = false;
+		
+		if(_topics.IsEmpty() || first->GetTopic().empty())
+			continue;
+		
+		vMatches.clear();
+		_topics.Match(first->GetTopic(), vMatches);
+		std::sort(vMatches.begin(), vMatches.end());
+		
+		for(size_t i = 0; i < vMatches.size(); i++)
+		{
+			ookMsgSubscriber* sub = _vSubscribers[vMatches[i]].get();
+			bool bOk = true;
+			
+			if(!sub->GetType())
+				bOk = this->DeliverEach(vMatches[i], vRun, iRun, vCopies, tPosted);
+			else if(sub->Accepts(first))
+				bOk = this->DeliverRun(vMatches[i], vRun, iRun, vCopies, tPosted);
+			
+			if(!bOk)
+				bQueued = false;
+		}
+	}
+	
+	return bQueued;
+}
+
+void ookMsgRoutes::Flush()
+{
+	for(size_t i = 0; i < _vMailboxes.size(); i++)
+		if(_vMailboxes[i])
+			_vMailboxes[i]->WaitIdle();
+}
+
+void ookMsgRoutes::CloseMailboxes()
+{
+	for(size_t i = 0; i < _vMailboxes.size(); i++)
+		if(_vMailboxes[i])
+			_vMailboxes[i]->Close();
+}
+
+ookExecutor* ookMsgRoutes::GetExecutor() const
+{
+	return _pPool;
+}
+
+size_t ookMsgRoutes::GetSize() const
+{
+	return _vSubscribers.size();
+}
+
+subscriber_ptr ookMsgRoutes::GetSubscriber(size_t i) const
+{
+	return _vSubscribers[i];
+}
+
+mailbox_ptr ookMsgRoutes::GetMailbox(size_t i) const
+{
+	return _vMailboxes[i];
+}
+
+void ookMsgRoutes::BuildIndex()
+{
+	_vTypeIndex.clear();
+	_vUntyped.clear();
+	_topics.Clear();
+	
+	for(size_t i = 0; i < _vSubscribers.size(); i++)
+	{
+		const ookMsgType* type = _vSubscribers[i]->GetType();
+		
+		if(!_vSubscribers[i]->GetTopic().empty())
+		{
+			_topics.Add(_vSubscribers[i]->GetTopic(), i);
+			continue;
+		}
+		
+		if(!type)
+		{
+			_vUntyped.push_back(i);
+			continue;
+		}
+		
+		size_t iId = type->GetId();
+		
+		if(iId >= _vTypeIndex.size())
+			_vTypeIndex.resize(iId + 1);
+		
+		_vTypeIndex[iId].push_back(i);
+	}
+}
+
+//Calls the observer, or queues msg for it. A message the caller holds a
+//reference to is queued as it is; otherwise a copy is made, once somebody
+//wants it, and shared by all of them.
+bool ookMsgRoutes::Deliver(size_t iRoute, ookMessage* msg, msg_ptr& copy, ook_clock::time_point tPosted)
+{
+	ookMsgSubscriber* sub = _vSubscribers[iRoute].get();
+	
+	//Unregistered after this version was loaded
+	if(!sub->IsActive())
+		return true;
+	
+	if(!_pPool)
+	{
+		sub->Deliver(msg);
+		return true;
+	}
+	
+	if(!copy)
+	{
+		if(msg->GetRefCount() > 0)
+			copy.reset(msg);
+		else
+			copy.reset(msg->Clone());
+		
+		if(!copy)
+			throw ookException("ookMsgDispatcher: message can't be queued, its class has no Clone()");
+	}
+	
+	return _vMailboxes[iRoute]->Push(copy, tPosted);
+}
+
+//Hands a run of messages the observer is known to take over in one go
+bool ookMsgRoutes::DeliverRun(size_t iRoute, ookMessage** vMsgs, size_t iCount, vector<msg_ptr>& vCopies, ook_clock::time_point tPosted)
+{
+	ookMsgSubscriber* sub = _vSubscribers[iRoute].get();
+	
+	if(!sub->IsActive())
+		return true;
+	
+	if(!_pPool)
+	{
+		sub->DeliverBatch(vMsgs, iCount);
+		return true;
+	}
+	
+	this->CopyRun(vMsgs, iCount, vCopies);
+	
+	return _vMailboxes[iRoute]->PushBatch(&vCopies[0], iCount, tPosted);
+}
+
+//For observers without a type, which have to be asked about each message
+bool ookMsgRoutes::DeliverEach(size_t iRoute, ookMessage** vMsgs, size_t iCount, vector<msg_ptr>& vCopies, ook_clock::time_point tPosted)
+{
+	bool bQueued = true;
+	
+	for(size_t i = 0; i < iCount; i++)
+	{
+		if(!_vSubscribers[iRoute]->GetObserver()->Accepts(vMsgs[i]))
+			continue;
+		
+		msg_ptr copy;
+		
+		if(_pPool)
+		{
+			this->CopyRun(vMsgs, iCount, vCopies);
+			copy = vCopies[i];
+		}
+		
+		if(!this->Deliver(iRoute, vMsgs[i], copy, tPosted))
+			bQueued = false;
+	}
+	
+	return bQueued;
+}
+
+//The queued form of each message in the run, as Deliver() makes it, made
+//once for all the observers
+void ookMsgRoutes::CopyRun(ookMessage** vMsgs, size_t iCount, vector<msg_ptr>& vCopies)
+{
+	if(!vCopies.empty())
+		return;
+	
+	vCopies.resize(iCount);
+	
+	for(size_t i = 0; i < iCount; i++)
+	{
+		if(vMsgs[i]->GetRefCount() > 0)
+			vCopies[i].reset(vMsgs[i]);
+		else
+			vCopies[i].reset(vMsgs[i]->Clone());
+		
+		if(!vCopies[i])
+		{
+			vCopies.clear();
+			throw ookException("ookMsgDispatcher: message can't be queued, its class has no Clone()");
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_ROUTES_H_
+#define OOK_MSG_ROUTES_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgObserverAbs.h"
+#include "ookLibs/ookCore/ookMsgMailbox.h"
+#include "ookLibs/ookCore/ookDispatchProfiler.h"
+#include "ookLibs/ookCore/ookTopicTrie.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "boost/shared_ptr.hpp"
+#include "boost/atomic.hpp"
+
+typedef long ook_subscription_id;
+
+class ookMsgSubscriber
+{
+public:
+	
+	ookMsgSubscriber(ook_subscription_id id, ookMsgObserverAbs* obs, const string& topic = "");
+	virtual ~ookMsgSubscriber();
+	
+	ook_subscription_id GetId() const;
+	const ookMsgType* GetType() const;
+	const string& GetTopic() const;
+	bool Accepts(ookMessage* msg) const;
+	ookMsgObserverAbs* GetObserver() const;
+	boost::shared_ptr<ookMsgObserverAbs> GetSharedObserver() const;
+	
+	bool IsActive() const;
+	void Deactivate();
+	
+	void SetProfiler(ookDispatchProfiler* profiler);
+	
+	void Deliver(ookMessage* msg, const ook_clock::time_point* pPosted = NULL);
+	void DeliverBatch(ookMessage** vMsgs, size_t iCount, const ook_clock::time_point* vPosted = NULL);
+	
+protected:
+	
+	bool Invoke(ookMessage** vMsgs, size_t iCount);
+	
+private:
+	
+	ookMsgSubscriber(const ookMsgSubscriber&);
+	ookMsgSubscriber& operator=(const ookMsgSubscriber&);
+	
+	ook_subscription_id _id;
+	boost::shared_ptr<ookMsgObserverAbs> _observer;
+	const ookMsgType* _pType;
+	string _topic;
+	boost::atomic<bool> _bActive;
+	
+	ookDispatchProfiler* _pProfiler;
+	ookObserverProfile* _pProfile;
+};
+
+typedef boost::shared_ptr<ookMsgSubscriber> subscriber_ptr;
+
+class ookMsgRoutes
+{
+public:
+	
+	ookMsgRoutes(ookExecutor* pool = NULL);
+	virtual ~ookMsgRoutes();
+	
+	void Add(subscriber_ptr sub, mailbox_ptr box);
+	void Add(const vector<subscriber_ptr>& vSubs, const vector<mailbox_ptr>& vBoxes);
+	bool Remove(ook_subscription_id id, subscriber_ptr& sub, mailbox_ptr& box);
+	
+	bool Post(ookMessage* msg);
+	bool PostBatch(ookMessage** vMsgs, size_t iCount);
+	
+	void Flush();
+	void CloseMailboxes();
+	
+	ookExecutor* GetExecutor() const;
+	size_t GetSize() const;
+	subscriber_ptr GetSubscriber(size_t i) const;
+	mailbox_ptr GetMailbox(size_t i) const;
+	
+protected:
+	
+	void BuildIndex();
+	bool Deliver(size_t iRoute, ookMessage* msg, msg_ptr& copy, ook_clock::time_point tPosted);
+	bool DeliverRun(size_t iRoute, ookMessage** vMsgs, size_t iCount, vector<msg_ptr>& vCopies, ook_clock::time_point tPosted);
+	bool DeliverEach(size_t iRoute, ookMessage** vMsgs, size_t iCount, vector<msg_ptr>& vCopies, ook_clock::time_point tPosted);
+	void CopyRun(ookMessage** vMsgs, size_t iCount, vector<msg_ptr>& vCopies);
+	
+private:
+	
+	ookExecutor* _pPool;
+	
+	//In registration order; mailboxes only when asynchronous
+	vector<subscriber_ptr> _vSubscribers;
+	vector<mailbox_ptr> _vMailboxes;
+	
+	//Route indexes by the id of the message type they observe, and the
+	//ones without a type that still need Accepts()
+	vector< vector<size_t> > _vTypeIndex;
+	vector<size_t> _vUntyped;
+	
+	//Routes registered with a topic pattern, which are in neither of those
+	ookTopicTrie _topics;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,515 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_SCHEMA_H_
+#define OOK_MSG_SCHEMA_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMsgWire.h"
+#include "ookLibs/ookCore/ookBuffer.h"
+#include "ookLibs/ookCore/ookException.h"
+
+#include <string.h>
+
+/*
+ Declares the fields ookMsgCodec encodes for a message class, and the
+ schema version it writes. Each field has a tag, which is what goes on the
+ wire instead of its name:
+ 
+ class ookQuoteMessage : public ookMessage
+ {
+ 	OOK_MESSAGE_TYPE(ookQuoteMessage, ookMessage)
+ 
+ public:
+ 	
+ 	string symbol;
+ 	double price;
+ 	long qty;
+ 	long stamp;
+ 	
+ 	OOK_MSG_SCHEMA(2)
+ 		OOK_MSG_FIELD(1, symbol)
+ 		OOK_MSG_FIELD(2, price)
+ 		OOK_MSG_FIELD(3, qty)
+ 		OOK_MSG_FIELD_FIXED(4, stamp)		//Added in version 2
+ 	OOK_MSG_SCHEMA_END
+ };
+ 
+ Tags must go up in the order fields are listed. To evolve a schema, add
+ fields with new tags and bump the version; never reuse or renumber a tag.
+ Old readers skip fields they don't know, and new readers leave fields an
+ old writer didn't send at their default value.
+ 
+ Integers and bools are varints, zigzagged when signed. OOK_MSG_FIELD_FIXED
+ writes an integer in 4 or 8 bytes instead, which is smaller for values
+ that use most of their bits, like timestamps and hashes. float and double
+ are always fixed. string, ookBufferView and vectors of any of these are
+ length prefixed.
+ 
+ The macros leave the class body in the public section.
+ */
+#define OOK_MSG_SCHEMA(iVersion) \
+public: \
+	static int GetSchemaVersion() \
+	{ \
+		return iVersion; \
+	} \
+	template <class V> \
+	void VisitFields(V& ookVisitor) \
+	{
+
+#define OOK_MSG_FIELD(iTag, field) \
+		ookVisitor.Field(iTag, field);
+
+#define OOK_MSG_FIELD_FIXED(iTag, field) \
+		ookVisitor.Field(iTag, ookMsgFixed(field));
+
+#define OOK_MSG_SCHEMA_END \
+	} \
+public:
+
+//An integer field written fixed width, see OOK_MSG_FIELD_FIXED
+template <class T>
+struct ookMsgFixedRef
+{
+	explicit ookMsgFixedRef(T& ref) : value(ref) {}
+	
+	T& value;
+};
+
+template <class T>
+inline ookMsgFixedRef<T> ookMsgFixed(T& ref)
+{
+	return ookMsgFixedRef<T>(ref);
+}
+
+/*
+ How each field type goes on the wire. Size() is the number of bytes
+ Write() puts out for the value, not counting the key. Types without a
+ specialization don't compile as fields.
+ */
+template <class T>
+struct ookFieldCodec;
+
+#define OOK_FIELD_CODEC_UNSIGNED(T) \
+template <> \
+struct ookFieldCodec<T> \
+{ \
+	static ookWireType GetWireType() { return OOK_WIRE_VARINT; } \
+	static size_t Size(T v) { return ookMsgWriter::GetVarintSize((boost::uint64_t) v); } \
+	static void Write(ookMsgWriter& w, T v) { w.WriteVarint((boost::uint64_t) v); } \
+	static void Read(ookMsgReader& r, T& v) { v = (T) r.ReadVarint(); } \
+};
+
+#define OOK_FIELD_CODEC_SIGNED(T) \
+template <> \
+struct ookFieldCodec<T> \
+{ \
+	static ookWireType GetWireType() { return OOK_WIRE_VARINT; } \
+	static size_t Size(T v) { return ookMsgWriter::GetVarintSize(ookMsgWriter::ZigZag(v)); } \
+	static void Write(ookMsgWriter& w, T v) { w.WriteVarint(ookMsgWriter::ZigZag(v)); } \
+	static void Read(ookMsgReader& r, T& v) { v = (T) ookMsgReader::UnZigZag(r.ReadVarint()); } \
+};
+
+OOK_FIELD_CODEC_UNSIGNED(bool)
+OOK_FIELD_CODEC_UNSIGNED(unsigned char)
+OOK_FIELD_CODEC_UNSIGNED(unsigned short)
+OOK_FIELD_CODEC_UNSIGNED(unsigned int)
+OOK_FIELD_CODEC_UNSIGNED(unsigned long)
+OOK_FIELD_CODEC_SIGNED(char)
+OOK_FIELD_CODEC_SIGNED(short)
+OOK_FIELD_CODEC_SIGNED(int)
+OOK_FIELD_CODEC_SIGNED(long)
+
+template <>
+struct ookFieldCodec<float>
+{
+	static ookWireType GetWireType() { return OOK_WIRE_FIXED32; }
+	static size_t Size(float) { return 4; }
+	
+	static void Write(ookMsgWriter& w, float v)
+	{
+		boost::uint32_t iBits;
+		memcpy(&iBits, &v, 4);
+		w.WriteFixed32(iBits);
+	}
+	
+	static void Read(ookMsgReader& r, float& v)
+	{
+		boost::uint32_t iBits = r.ReadFixed32();
+		memcpy(&v, &iBits, 4);
+	}
+};
+
+template <>
+struct ookFieldCodec<double>
+{
+	static ookWireType GetWireType() { return OOK_WIRE_FIXED64; }
+	static size_t Size(double) { return 8; }
+	
+	static void Write(ookMsgWriter& w, double v)
+	{
+		boost::uint64_t iBits;
+		memcpy(&iBits, &v, 8);
+		w.WriteFixed64(iBits);
+	}
+	
+	static void Read(ookMsgReader& r, double& v)
+	{
+		boost::uint64_t iBits = r.ReadFixed64();
+		memcpy(&v, &iBits, 8);
+	}
+};
+
+template <class T>
+struct ookFieldCodec<ookMsgFixedRef<T> >
+{
+	static ookWireType GetWireType() { return (sizeof(T) > 4) ? OOK_WIRE_FIXED64 : OOK_WIRE_FIXED32; }
+	static size_t Size(const ookMsgFixedRef<T>&) { return (sizeof(T) > 4) ? 8 : 4; }
+	
+	static void Write(ookMsgWriter& w, const ookMsgFixedRef<T>& f)
+	{
+		if(sizeof(T) > 4)
+			w.WriteFixed64((boost::uint64_t) f.value);
+		else
+			w.WriteFixed32((boost::uint32_t) f.value);
+	}
+	
+	static void Read(ookMsgReader& r, const ookMsgFixedRef<T>& f)
+	{
+		if(sizeof(T) > 4)
+			f.value = (T) r.ReadFixed64();
+		else
+			f.value = (T) r.ReadFixed32();
+	}
+};
+
+template <>
+struct ookFieldCodec<string>
+{
+	static ookWireType GetWireType() { return OOK_WIRE_BYTES; }
+	static size_t Size(const string& v) { return ookMsgWriter::GetVarintSize(v.size()) + v.size(); }
+	
+	static void Write(ookMsgWriter& w, const string& v)
+	{
+		w.WriteVarint(v.size());
+		w.WriteBytes(v.data(), v.size());
+	}
+	
+	static void Read(ookMsgReader& r, string& v)
+	{
+		size_t iSize = (size_t) r.ReadVarint();
+		const char* pBytes = r.ReadBytes(iSize);
+		v.assign(pBytes, iSize);
+	}
+};
+
+//Decoded as a slice of the message's buffer when there is one
+template <>
+struct ookFieldCodec<ookBufferView>
+{
+	static ookWireType GetWireType() { return OOK_WIRE_BYTES; }
+	static size_t Size(const ookBufferView& v) { return ookMsgWriter::GetVarintSize(v.GetSize()) + v.GetSize(); }
+	
+	static void Write(ookMsgWriter& w, const ookBufferView& v)
+	{
+		w.WriteVarint(v.GetSize());
+		w.WriteBytes(v.GetData(), v.GetSize());
+	}
+	
+	static void Read(ookMsgReader& r, ookBufferView& v)
+	{
+		v = r.ReadView((size_t) r.ReadVarint());
+	}
+};
+
+//Elements are packed one after another, each without a key
+template <class T>
+struct ookFieldCodec<vector<T> >
+{
+	static ookWireType GetWireType() { return OOK_WIRE_BYTES; }
+	
+	static size_t Size(const vector<T>& v)
+	{
+		size_t iBody = GetBodySize(v);
+		return ookMsgWriter::GetVarintSize(iBody) + iBody;
+	}
+	
+	static void Write(ookMsgWriter& w, const vector<T>& v)
+	{
+		w.WriteVarint(GetBodySize(v));
+		
+		for(size_t i = 0; i < v.size(); i++)
+			ookFieldCodec<T>::Write(w, v[i]);
+	}
+	
+	static void Read(ookMsgReader& r, vector<T>& v)
+	{
+		size_t iBody = (size_t) r.ReadVarint();
+		
+		if(iBody > r.GetRemaining())
+			throw ookException("ookMsgReader: message is truncated");
+		
+		size_t iEnd = r.GetPosition() + iBody;
+		
+		v.clear();
+		
+		while(r.GetPosition() < iEnd)
+		{
+			v.push_back(T());
+			ookFieldCodec<T>::Read(r, v.back());
+		}
+		
+		if(r.GetPosition() != iEnd)
+			throw ookException("ookMsgReader: vector element overruns its field");
+	}
+	
+	static size_t GetBodySize(const vector<T>& v)
+	{
+		size_t iBody = 0;
+		
+		for(size_t i = 0; i < v.size(); i++)
+			iBody += ookFieldCodec<T>::Size(v[i]);
+		
+		return iBody;
+	}
+};
+
+//Adds up the encoded size of each field
+class ookMsgSizer
+{
+public:
+	
+	ookMsgSizer() : _iSize(0) {}
+	
+	template <class T>
+	void Field(int iTag, const T& value)
+	{
+		_iSize += ookMsgWriter::GetKeySize(iTag) + ookFieldCodec<T>::Size(value);
+	}
+	
+	size_t GetSize() const { return _iSize; }
+	
+private:
+	
+	size_t _iSize;
+};
+
+class ookMsgEncoder
+{
+public:
+	
+	ookMsgEncoder(ookMsgWriter& writer) : _writer(writer) {}
+	
+	template <class T>
+	void Field(int iTag, const T& value)
+	{
+		_writer.WriteKey(iTag, ookFieldCodec<T>::GetWireType());
+		ookFieldCodec<T>::Write(_writer, value);
+	}
+	
+private:
+	
+	ookMsgWriter& _writer;
+};
+
+/*
+ Walks the schema's fields and the message's keys together. Both are in
+ tag order, so a key below the field's tag is one this schema doesn't have
+ and is skipped, and a key above it means the writer didn't send the field.
+ */
+class ookMsgDecoder
+{
+public:
+	
+	ookMsgDecoder(ookMsgReader& reader) : _reader(reader), _iTag(0), _wire(OOK_WIRE_VARINT)
+	{
+		this->Next();
+	}
+	
+	template <class T>
+	void Field(int iTag, T& value)
+	{
+		this->Find(iTag);
+		
+		if(_iTag != iTag)
+		{
+			value = T();
+			return;
+		}
+		
+		if(_wire != ookFieldCodec<T>::GetWireType())
+			throw ookException("ookMsgDecoder: field's wire type doesn't match the schema");
+		
+		ookFieldCodec<T>::Read(_reader, value);
+		this->Next();
+	}
+	
+	template <class T>
+	void Field(int iTag, const ookMsgFixedRef<T>& value)
+	{
+		this->Find(iTag);
+		
+		if(_iTag != iTag)
+		{
+			value.value = T();
+			return;
+		}
+		
+		if(_wire != ookFieldCodec<ookMsgFixedRef<T> >::GetWireType())
+			throw ookException("ookMsgDecoder: field's wire type doesn't match the schema");
+		
+		ookFieldCodec<ookMsgFixedRef<T> >::Read(_reader, value);
+		this->Next();
+	}
+	
+	//Skips whatever a newer writer sent after the last field we know
+	void Finish()
+	{
+		while(_iTag > 0)
+		{
+			_reader.Skip(_wire);
+			this->Next();
+		}
+	}
+	
+private:
+	
+	void Next()
+	{
+		if(!_reader.ReadKey(_iTag, _wire))
+			_iTag = 0;
+		else if(_iTag <= 0)
+			throw ookException("ookMsgDecoder: bad field tag");
+	}
+	
+	void Find(int iTag)
+	{
+		while((_iTag > 0) && (_iTag < iTag))
+		{
+			_reader.Skip(_wire);
+			this->Next();
+		}
+	}
+	
+	ookMsgReader& _reader;
+	int _iTag;
+	ookWireType _wire;
+};
+
+/*!
+ \brief Encodes and decodes messages declared with OOK_MSG_SCHEMA.
+ 
+ \code
+ 
+ buffer_ptr buf = ookMsgCodec::Encode(quote);
+ 
+ ookQuoteMessage copy;
+ int iVersion = ookMsgCodec::Decode(ookBufferView(buf), copy);
+ 
+ \endcode
+ 
+ An encoded message is its schema version as a varint, then its fields in
+ tag order. Encode() sizes the message first and writes it into a buffer
+ of exactly that size, with no strings or other temporaries in between, so
+ the result can go straight into an ookBinaryMessage or onto a socket.
+ Decode() returns the version the message was written with, for readers
+ that need to tell a field left out from one set to its default.
+ */
+class ookMsgCodec
+{
+public:
+	
+	template <class M>
+	static size_t GetSize(const M& msg)
+	{
+		ookMsgSizer sizer;
+		
+		//VisitFields() is shared with decoding, so it isn't const
+		const_cast<M&>(msg).VisitFields(sizer);
+		
+		return ookMsgWriter::GetVarintSize(M::GetSchemaVersion()) + sizer.GetSize();
+	}
+	
+	template <class M>
+	static void Encode(const M& msg, ookMsgWriter& writer)
+	{
+		ookMsgEncoder encoder(writer);
+		
+		writer.WriteVarint(M::GetSchemaVersion());
+		const_cast<M&>(msg).VisitFields(encoder);
+	}
+	
+	template <class M>
+	static size_t Encode(const M& msg, char* pOut, size_t iSize)
+	{
+		ookMsgWriter writer(pOut, iSize);
+		Encode(msg, writer);
+		
+		return writer.GetPosition();
+	}
+	
+	template <class M>
+	static buffer_ptr Encode(const M& msg)
+	{
+		buffer_ptr buf = ookBuffer::Create(GetSize(msg));
+		Encode(msg, buf->GetData(), buf->GetSize());
+		
+		return buf;
+	}
+	
+	template <class M>
+	static int Decode(ookMsgReader& reader, M& msg)
+	{
+		int iVersion = (int) reader.ReadVarint();
+		
+		ookMsgDecoder decoder(reader);
+		msg.VisitFields(decoder);
+		decoder.Finish();
+		
+		return iVersion;
+	}
+	
+	template <class M>
+	static int Decode(const char* pData, size_t iSize, M& msg)
+	{
+		ookMsgReader reader(pData, iSize);
+		return Decode(reader, msg);
+	}
+	
+	template <class M>
+	static int Decode(const ookBufferView& view, M& msg)
+	{
+		ookMsgReader reader(view);
+		return Decode(reader, msg);
+	}
+};
+
+#endif
\ No newline at end of file
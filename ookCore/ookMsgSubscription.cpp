@@ -0,0 +1,137 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookMsgSubscription
+ \headerfile ookMsgSubscription.h "ookLibs/ookCore/ookMsgSubscription.h"
+ \brief Scoped registration of an observer with an ookMsgDispatcher: the
+ observer is unregistered when the subscription is destroyed.
+ 
+ \code
+ 
+ {
+ 	ookMsgSubscription sub(&dispatcher, new ookMsgObserver<ookFeed, ookTextMessage>(&feed, &ookFeed::HandleMsg));
+ 	...
+ }	//feed gets no more messages from here on
+ 
+ \endcode
+ 
+ The dispatcher must outlive the subscription. See
+ ookMsgDispatcher::UnregisterObserver() for what is guaranteed about
+ deliveries already in progress.
+ */
+#include "ookLibs/ookCore/ookMsgSubscription.h"
+
+ookMsgSubscription::ookMsgSubscription()
+	: _pDispatcher(NULL), _id(0)
+{
+	
+}
+
+ookMsgSubscription::ookMsgSubscription(ookMsgDispatcher* dispatcher, ookMsgObserverAbs* obs)
+	: _pDispatcher(dispatcher), _id(dispatcher->RegisterObserver(obs))
+{
+	
+}
+
+ookMsgSubscription::ookMsgSubscription(ookMsgDispatcher* dispatcher, const string& topic, ookMsgObserverAbs* obs)
+	: _pDispatcher(dispatcher), _id(dispatcher->RegisterObserver(topic, obs))
+{
+	
+}
+
+ookMsgSubscription::~ookMsgSubscription()
+{
+	try
+	{
+		this->Unsubscribe();
+	}
+	catch(...)
+	{
+	}
+}
+
+/*! 
+ \brief Unsubscribes the current observer, if any, and registers obs with
+ dispatcher instead.
+ */
+void ookMsgSubscription::Reset(ookMsgDispatcher* dispatcher, ookMsgObserverAbs* obs)
+{
+	this->Unsubscribe();
+	
+	_id = dispatcher->RegisterObserver(obs);
+	_pDispatcher = dispatcher;
+}
+
+/*! 
+ \brief As Reset(), registering obs for the topic pattern topic.
+ */
+void ookMsgSubscription::Reset(ookMsgDispatcher* dispatcher, const string& topic, ookMsgObserverAbs* obs)
+{
+	this->Unsubscribe();
+	
+	_id = dispatcher->RegisterObserver(topic, obs);
+	_pDispatcher = dispatcher;
+}
+
+void ookMsgSubscription::Unsubscribe()
+{
+	if(!_pDispatcher)
+		return;
+	
+	_pDispatcher->UnregisterObserver(_id);
+	
+	_pDispatcher = NULL;
+	_id = 0;
+}
+
+/*! 
+ \brief Leaves the observer registered and forgets it, returning its id.
+ */
+ook_subscription_id ookMsgSubscription::Release()
+{
+	ook_subscription_id id = _id;
+	
+	_pDispatcher = NULL;
+	_id = 0;
+	
+	return id;
+}
+
+bool ookMsgSubscription::IsSubscribed() const
+{
+	return _pDispatcher != NULL;
+}
+
+ook_subscription_id ookMsgSubscription::GetId() const
+{
+	return _id;
+}
\ No newline at end of file
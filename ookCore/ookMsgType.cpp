@@ -0,0 +1,102 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookMsgType
+ \headerfile ookMsgType.h "ookLibs/ookCore/ookMsgType.h"
+ \brief Compact run time identity of a message class, and of the class it
+ derives from.
+ 
+ Every class declared with OOK_MESSAGE_TYPE() gets exactly one ookMsgType,
+ created the first time the class's StaticType() is called. Ids are
+ small consecutive ints, so they can index a vector. A message reports
+ its type with one virtual call to GetType(), and the parent chain is
+ what lets an observer of ookTextMessage also receive ookQuoteMessages.
+ This takes the place of a dynamic_cast per observer when dispatching.
+ 
+ A subclass without the macro inherits its parent's type and is routed
+ as the parent.
+ */
+#include "ookLibs/ookCore/ookMsgType.h"
+#include "boost/atomic.hpp"
+
+//Function-local so it is ready whenever the first type is created
+static boost::atomic<int>& ookMsgTypeCounter()
+{
+	static boost::atomic<int> iCounter(0);
+	return iCounter;
+}
+
+ookMsgType::ookMsgType(const char* name, const ookMsgType* parent)
+	: _iId(ookMsgTypeCounter().fetch_add(1)), _name(name), _pParent(parent)
+{
+	
+}
+
+ookMsgType::~ookMsgType()
+{
+	
+}
+
+int ookMsgType::GetId() const
+{
+	return _iId;
+}
+
+string ookMsgType::GetName() const
+{
+	return _name ? _name : "";
+}
+
+const ookMsgType* ookMsgType::GetParent() const
+{
+	return _pParent;
+}
+
+/*! 
+ \brief True if this is type or derives from it.
+ */
+bool ookMsgType::IsA(const ookMsgType* type) const
+{
+	for(const ookMsgType* t = this; t; t = t->GetParent())
+		if(t == type)
+			return true;
+	
+	return false;
+}
+
+/*! 
+ \brief Number of types created so far; every id is below it.
+ */
+int ookMsgType::GetTypeCount()
+{
+	return ookMsgTypeCounter().load();
+}
\ No newline at end of file
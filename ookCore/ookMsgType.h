@@ -0,0 +1,91 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_TYPE_H_
+#define OOK_MSG_TYPE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+
+/*
+ Declares the message type of class C, derived from message class P. Put
+ it in the class body of every ookMessage subclass that observers should
+ be able to ask for by type:
+ 
+ class ookQuoteMessage : public ookTextMessage
+ {
+ 	OOK_MESSAGE_TYPE(ookQuoteMessage, ookTextMessage)
+ 
+ public:
+ 	...
+ };
+ 
+ The macro leaves the class body in the public section.
+ */
+#define OOK_MESSAGE_TYPE(C, P) \
+public: \
+	typedef C ook_msg_self; \
+	static const ookMsgType* StaticType() \
+	{ \
+		static const ookMsgType type(#C, P::StaticType()); \
+		return &type; \
+	} \
+	virtual const ookMsgType* GetType() const \
+	{ \
+		return C::StaticType(); \
+	}
+
+class ookMsgType
+{
+public:
+	
+	ookMsgType(const char* name, const ookMsgType* parent);
+	virtual ~ookMsgType();
+	
+	int GetId() const;
+	string GetName() const;
+	const ookMsgType* GetParent() const;
+	
+	bool IsA(const ookMsgType* type) const;
+	
+	static int GetTypeCount();
+	
+protected:
+	
+private:
+	
+	ookMsgType(const ookMsgType&);
+	ookMsgType& operator=(const ookMsgType&);
+	
+	int _iId;
+	const char* _name;
+	const ookMsgType* _pParent;
+};
+
+#endif
\ No newline at end of file
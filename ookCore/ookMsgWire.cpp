@@ -0,0 +1,273 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookMsgWriter
+ \headerfile ookMsgWire.h "ookLibs/ookCore/ookMsgWire.h"
+ \brief Writes the primitives of the ookMsgSchema wire format into a
+ caller's buffer.
+ 
+ Varints are little endian base 128, seven bits a byte with the high bit
+ set on all but the last; signed values are zigzagged first so small
+ negatives stay short. Fixed values are little endian whatever the host.
+ A field is a key, its tag shifted up past an ookWireType, then the value;
+ OOK_WIRE_BYTES values are a varint length and that many bytes.
+ 
+ The writer never grows its buffer: ookMsgCodec sizes the message first.
+ Writing past the end throws an ookException.
+ */
+
+/*! 
+ \class ookMsgReader
+ \headerfile ookMsgWire.h "ookLibs/ookCore/ookMsgWire.h"
+ \brief Reads what ookMsgWriter wrote, checking every read against the
+ end of the input.
+ 
+ A reader made from an ookBufferView hands out byte fields with
+ ReadView() as slices of that buffer, without copying them. Truncated or
+ malformed input throws an ookException.
+ */
+#include "ookLibs/ookCore/ookMsgWire.h"
+#include "ookLibs/ookCore/ookException.h"
+
+#include <string.h>
+
+ookMsgWriter::ookMsgWriter(char* pOut, size_t iSize)
+	: _pOut(pOut), _iSize(iSize), _iPos(0)
+{
+	
+}
+
+void ookMsgWriter::Reserve(size_t iSize)
+{
+	if(iSize > _iSize - _iPos)
+		throw ookException("ookMsgWriter ran out of room");
+}
+
+void ookMsgWriter::WriteVarint(boost::uint64_t iValue)
+{
+	this->Reserve(GetVarintSize(iValue));
+	
+	while(iValue >= 0x80)
+	{
+		_pOut[_iPos++] = (char) ((iValue & 0x7f) | 0x80);
+		iValue >>= 7;
+	}
+	
+	_pOut[_iPos++] = (char) iValue;
+}
+
+void ookMsgWriter::WriteFixed32(boost::uint32_t iValue)
+{
+	this->Reserve(4);
+	
+	for(int i = 0; i < 4; i++)
+		_pOut[_iPos++] = (char) (iValue >> (8 * i));
+}
+
+void ookMsgWriter::WriteFixed64(boost::uint64_t iValue)
+{
+	this->Reserve(8);
+	
+	for(int i = 0; i < 8; i++)
+		_pOut[_iPos++] = (char) (iValue >> (8 * i));
+}
+
+/*! 
+ \brief Writes the bytes as they are; the caller writes the length.
+ */
+void ookMsgWriter::WriteBytes(const char* pData, size_t iSize)
+{
+	this->Reserve(iSize);
+	
+	if(iSize > 0)
+		memcpy(_pOut + _iPos, pData, iSize);
+	
+	_iPos += iSize;
+}
+
+void ookMsgWriter::WriteKey(int iTag, ookWireType wire)
+{
+	this->WriteVarint(((boost::uint64_t) iTag << OOK_WIRE_TYPE_BITS) | wire);
+}
+
+size_t ookMsgWriter::GetPosition() const
+{
+	return _iPos;
+}
+
+size_t ookMsgWriter::GetKeySize(int iTag)
+{
+	return GetVarintSize((boost::uint64_t) iTag << OOK_WIRE_TYPE_BITS);
+}
+
+ookMsgReader::ookMsgReader(const char* pData, size_t iSize)
+	: _pData(pData), _iSize(iSize), _iPos(0)
+{
+	
+}
+
+ookMsgReader::ookMsgReader(const ookBufferView& view)
+	: _view(view), _pData(view.GetData()), _iSize(view.GetSize()), _iPos(0)
+{
+	
+}
+
+void ookMsgReader::Require(size_t iSize)
+{
+	if(iSize > _iSize - _iPos)
+		throw ookException("ookMsgReader: message is truncated");
+}
+
+boost::uint64_t ookMsgReader::ReadVarint()
+{
+	boost::uint64_t iValue = 0;
+	
+	for(int iShift = 0; iShift < 64; iShift += 7)
+	{
+		this->Require(1);
+		
+		unsigned char c = (unsigned char) _pData[_iPos++];
+		iValue |= (boost::uint64_t) (c & 0x7f) << iShift;
+		
+		if(!(c & 0x80))
+			return iValue;
+	}
+	
+	throw ookException("ookMsgReader: varint is too long");
+}
+
+boost::uint32_t ookMsgReader::ReadFixed32()
+{
+	this->Require(4);
+	
+	boost::uint32_t iValue = 0;
+	
+	for(int i = 0; i < 4; i++)
+		iValue |= (boost::uint32_t) (unsigned char) _pData[_iPos++] << (8 * i);
+	
+	return iValue;
+}
+
+boost::uint64_t ookMsgReader::ReadFixed64()
+{
+	this->Require(8);
+	
+	boost::uint64_t iValue = 0;
+	
+	for(int i = 0; i < 8; i++)
+		iValue |= (boost::uint64_t) (unsigned char) _pData[_iPos++] << (8 * i);
+	
+	return iValue;
+}
+
+/*! 
+ \brief Returns a pointer to the next iSize bytes of the input and moves
+ past them. It points into the input, so it is only good as long as that.
+ */
+const char* ookMsgReader::ReadBytes(size_t iSize)
+{
+	this->Require(iSize);
+	
+	const char* pBytes = _pData + _iPos;
+	_iPos += iSize;
+	
+	return pBytes;
+}
+
+/*! 
+ \brief Returns the next iSize bytes as a view. A slice of the input
+ buffer when the reader was made from one, otherwise a copy.
+ */
+ookBufferView ookMsgReader::ReadView(size_t iSize)
+{
+	size_t iStart = _iPos;
+	const char* pBytes = this->ReadBytes(iSize);
+	
+	if(iSize == 0)
+		return ookBufferView();
+	
+	if(_view.GetBuffer())
+		return _view.Slice(iStart, iSize);
+	
+	buffer_ptr buf = ookBuffer::Create(iSize);
+	memcpy(buf->GetData(), pBytes, iSize);
+	
+	return ookBufferView(buf);
+}
+
+/*! 
+ \brief Reads the next field key. Returns false at the end of the input.
+ */
+bool ookMsgReader::ReadKey(int& iTag, ookWireType& wire)
+{
+	if(this->IsDone())
+		return false;
+	
+	boost::uint64_t iKey = this->ReadVarint();
+	
+	iTag = (int) (iKey >> OOK_WIRE_TYPE_BITS);
+	wire = (ookWireType) (iKey & ((1 << OOK_WIRE_TYPE_BITS) - 1));
+	
+	return true;
+}
+
+/*! 
+ \brief Moves past the value of a field this reader has no use for, such
+ as one added by a newer version of the schema.
+ */
+void ookMsgReader::Skip(ookWireType wire)
+{
+	switch(wire)
+	{
+		case OOK_WIRE_VARINT:	this->ReadVarint();	break;
+		case OOK_WIRE_FIXED64:	this->ReadBytes(8);	break;
+		case OOK_WIRE_FIXED32:	this->ReadBytes(4);	break;
+		case OOK_WIRE_BYTES:	this->ReadBytes((size_t) this->ReadVarint());	break;
+		default:
+			throw ookException("ookMsgReader: unknown wire type");
+	}
+}
+
+size_t ookMsgReader::GetPosition() const
+{
+	return _iPos;
+}
+
+size_t ookMsgReader::GetRemaining() const
+{
+	return _iSize - _iPos;
+}
+
+bool ookMsgReader::IsDone() const
+{
+	return (_iPos >= _iSize);
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_WIRE_H_
+#define OOK_MSG_WIRE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookBuffer.h"
+#include "boost/cstdint.hpp"
+
+//How a field's value is laid out, kept in the low bits of its key
+enum ookWireType
+{
+	OOK_WIRE_VARINT = 0,
+	OOK_WIRE_FIXED64 = 1,
+	OOK_WIRE_BYTES = 2,
+	OOK_WIRE_FIXED32 = 5
+};
+
+#define OOK_WIRE_TYPE_BITS 3
+
+class ookMsgWriter
+{
+public:
+	
+	ookMsgWriter(char* pOut, size_t iSize);
+	
+	void WriteVarint(boost::uint64_t iValue);
+	void WriteFixed32(boost::uint32_t iValue);
+	void WriteFixed64(boost::uint64_t iValue);
+	void WriteBytes(const char* pData, size_t iSize);
+	void WriteKey(int iTag, ookWireType wire);
+	
+	size_t GetPosition() const;
+	
+	static size_t GetVarintSize(boost::uint64_t iValue);
+	static size_t GetKeySize(int iTag);
+	
+	static boost::uint64_t ZigZag(boost::int64_t iValue);
+	
+protected:
+	
+	void Reserve(size_t iSize);
+	
+private:
+	
+	char* _pOut;
+	size_t _iSize;
+	size_t _iPos;
+};
+
+class ookMsgReader
+{
+public:
+	
+	ookMsgReader(const char* pData, size_t iSize);
+	ookMsgReader(const ookBufferView& view);
+	
+	boost::uint64_t ReadVarint();
+	boost::uint32_t ReadFixed32();
+	boost::uint64_t ReadFixed64();
+	const char* ReadBytes(size_t iSize);
+	ookBufferView ReadView(size_t iSize);
+	bool ReadKey(int& iTag, ookWireType& wire);
+	
+	void Skip(ookWireType wire);
+	
+	size_t GetPosition() const;
+	size_t GetRemaining() const;
+	bool IsDone() const;
+	
+	static boost::int64_t UnZigZag(boost::uint64_t iValue);
+	
+protected:
+	
+	void Require(size_t iSize);
+	
+private:
+	
+	ookBufferView _view;
+	const char* _pData;
+	size_t _iSize;
+	size_t _iPos;
+};
+
+inline size_t ookMsgWriter::GetVarintSize(boost::uint64_t iValue)
+{
+	size_t iBytes = 1;
+	
+	while(iValue >= 0x80)
+	{
+		iValue >>= 7;
+		iBytes++;
+	}
+	
+	return iBytes;
+}
+
+inline boost::uint64_t ookMsgWriter::ZigZag(boost::int64_t iValue)
+{
+	return ((boost::uint64_t) iValue << 1) ^ (boost::uint64_t) (iValue >> 63);
+}
+
+inline boost::int64_t ookMsgReader::UnZigZag(boost::uint64_t iValue)
+{
+	return (boost::int64_t) (iValue >> 1) ^ -(boost::int64_t) (iValue & 1);
+}
+
+#endif
\ No newline at end of file
@@ -53,12 +53,17 @@ ookTextMessage::~ookTextMessage()
 	
 }
 
-string ookTextMessage::GetMsg()
+ookMessage* ookTextMessage::Clone() const
+{
+	return new ookTextMessage(*this);
+}
+
+const string& ookTextMessage::GetMsg() const
 {
 	return _msg;
 }
 
-void ookTextMessage::SetMessage(string msg)
+void ookTextMessage::SetMessage(const string& msg)
 {
 	_msg = msg;
 }
\ No newline at end of file
@@ -33,17 +33,26 @@
 
 #include "ookLibs/ookCore/typedefs.h"
 #include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgSchema.h"
 
 class ookTextMessage : public ookMessage
 {
+	OOK_MESSAGE_TYPE(ookTextMessage, ookMessage)
+	
 public:
 	
 	ookTextMessage();
 	ookTextMessage(string msg);
 	virtual ~ookTextMessage();
 	
-	string GetMsg();
-	void SetMessage(string msg);
+	virtual ookMessage* Clone() const;
+	
+	const string& GetMsg() const;
+	void SetMessage(const string& msg);
+	
+	OOK_MSG_SCHEMA(1)
+		OOK_MSG_FIELD(1, _msg)
+	OOK_MSG_SCHEMA_END
 	
 protected:
 	
@@ -0,0 +1,260 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookTopicTrie
+ \headerfile ookTopicTrie.h "ookLibs/ookCore/ookTopicTrie.h"
+ \brief Topic patterns indexed level by level, for finding the ones a
+ topic matches without trying each.
+ 
+ Topics are levels separated by dots, such as "orders.AAPL.filled". In a
+ pattern, a "*" level matches any one level and a final "#" matches the
+ rest of the topic, zero or more levels:
+ 
+ \code
+ 
+ orders.*.filled	orders.AAPL.filled, not orders.AAPL.part.filled
+ orders.#		orders, orders.AAPL, orders.AAPL.part.filled
+ *.*.filled		any three level topic ending in filled
+ 
+ \endcode
+ 
+ Each pattern adds a value, such as a route number, at the node for its
+ last level. Match() walks the topic down the trie, following a level's
+ literal child and its "*" child and collecting any "#" child on the way,
+ so it costs about the topic's depth times the wildcard branches taken,
+ plus the matches. Levels are looked up without copying the topic.
+ 
+ The trie is built once and then only read, so a built one can be matched
+ from any number of threads.
+ */
+#include "ookLibs/ookCore/ookTopicTrie.h"
+#include "ookLibs/ookCore/ookException.h"
+
+//Marks a match that has used up the whole topic
+#define OOK_TOPIC_END string::npos
+
+ookTopicTrie::ookTopicTrie()
+	: _iPatterns(0)
+{
+	this->AddNode();
+}
+
+ookTopicTrie::~ookTopicTrie()
+{
+	
+}
+
+/*! 
+ \brief Adds pattern with iValue. Throws an ookException if the pattern
+ isn't valid (see IsValidPattern()).
+ */
+void ookTopicTrie::Add(const string& pattern, size_t iValue)
+{
+	if(!IsValidPattern(pattern))
+		throw ookException("ookTopicTrie: topic patterns are dot separated levels, with * for a level and # only at the end");
+	
+	size_t iNode = 0;
+	size_t iPos = 0;
+	
+	while(true)
+	{
+		size_t iEnd = pattern.find('.', iPos);
+		string level = pattern.substr(iPos, (iEnd == string::npos) ? string::npos : iEnd - iPos);
+		
+		//Adding a node may move the others, so nodes are only held by index
+		size_t iChild;
+		
+		if(level == "*")
+		{
+			iChild = _vNodes[iNode].iStar;
+			
+			if(!iChild)
+			{
+				iChild = this->AddNode();
+				_vNodes[iNode].iStar = iChild;
+			}
+		}
+		else if(level == "#")
+		{
+			iChild = _vNodes[iNode].iHash;
+			
+			if(!iChild)
+			{
+				iChild = this->AddNode();
+				_vNodes[iNode].iHash = iChild;
+			}
+		}
+		else
+		{
+			boost::unordered_map<string, size_t>::iterator it = _vNodes[iNode].children.find(level);
+			
+			if(it != _vNodes[iNode].children.end())
+				iChild = it->second;
+			else
+			{
+				iChild = this->AddNode();
+				_vNodes[iNode].children[level] = iChild;
+			}
+		}
+		
+		iNode = iChild;
+		
+		if(iEnd == string::npos)
+			break;
+		
+		iPos = iEnd + 1;
+	}
+	
+	_vNodes[iNode].vValues.push_back(iValue);
+	_iPatterns++;
+}
+
+void ookTopicTrie::Clear()
+{
+	_vNodes.clear();
+	_iPatterns = 0;
+	
+	this->AddNode();
+}
+
+/*! 
+ \brief Appends the values of every pattern topic matches to vValues,
+ each once, in no particular order.
+ */
+void ookTopicTrie::Match(const string& topic, vector<size_t>& vValues) const
+{
+	if(_iPatterns > 0)
+		this->MatchFrom(0, topic, 0, vValues);
+}
+
+size_t ookTopicTrie::GetSize() const
+{
+	return _iPatterns;
+}
+
+bool ookTopicTrie::IsEmpty() const
+{
+	return (_iPatterns == 0);
+}
+
+/*! 
+ \brief True if pattern is non empty dot separated levels, with no empty
+ level, "*" only as a whole level, and "#" only as the whole last level.
+ */
+bool ookTopicTrie::IsValidPattern(const string& pattern)
+{
+	if(pattern.empty())
+		return false;
+	
+	size_t iPos = 0;
+	
+	while(true)
+	{
+		size_t iEnd = pattern.find('.', iPos);
+		size_t iLast = (iEnd == string::npos) ? pattern.size() : iEnd;
+		boost::string_view level(pattern.data() + iPos, iLast - iPos);
+		
+		if(level.empty())
+			return false;
+		
+		if((level.size() > 1) && (level.find_first_of("*#") != boost::string_view::npos))
+			return false;
+		
+		if((level == "#") && (iEnd != string::npos))
+			return false;
+		
+		if(iEnd == string::npos)
+			return true;
+		
+		iPos = iEnd + 1;
+	}
+}
+
+/*! 
+ \brief True if topic matches pattern. Builds a one pattern trie, so it
+ is for checking a single pair, not for routing.
+ */
+bool ookTopicTrie::Matches(const string& pattern, const string& topic)
+{
+	ookTopicTrie trie;
+	trie.Add(pattern, 0);
+	
+	vector<size_t> vValues;
+	trie.Match(topic, vValues);
+	
+	return !vValues.empty();
+}
+
+//Matches the topic from iPos, the start of a level, below iNode. Patterns
+//line up with the topic one level at a time and "#" only ends them, so
+//no node is reached twice and values need no de-duplicating.
+void ookTopicTrie::MatchFrom(size_t iNode, const string& topic, size_t iPos, vector<size_t>& vValues) const
+{
+	const ookTopicNode& node = _vNodes[iNode];
+	
+	//"#" takes whatever is left, including nothing
+	if(node.iHash)
+	{
+		const vector<size_t>& vHash = _vNodes[node.iHash].vValues;
+		vValues.insert(vValues.end(), vHash.begin(), vHash.end());
+	}
+	
+	if(iPos == OOK_TOPIC_END)
+	{
+		vValues.insert(vValues.end(), node.vValues.begin(), node.vValues.end());
+		return;
+	}
+	
+	size_t iEnd = topic.find('.', iPos);
+	size_t iLast = (iEnd == string::npos) ? topic.size() : iEnd;
+	size_t iNext = (iEnd == string::npos) ? OOK_TOPIC_END : iEnd + 1;
+	
+	if(!node.children.empty())
+	{
+		boost::string_view level(topic.data() + iPos, iLast - iPos);
+		
+		boost::unordered_map<string, size_t>::const_iterator it =
+			node.children.find(level, ookTopicLevelHash(), ookTopicLevelEqual());
+		
+		if(it != node.children.end())
+			this->MatchFrom(it->second, topic, iNext, vValues);
+	}
+	
+	if(node.iStar)
+		this->MatchFrom(node.iStar, topic, iNext, vValues);
+}
+
+size_t ookTopicTrie::AddNode()
+{
+	_vNodes.push_back(ookTopicNode());
+	return _vNodes.size() - 1;
+}
\ No newline at end of file
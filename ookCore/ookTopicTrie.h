@@ -0,0 +1,101 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_TOPIC_TRIE_H_
+#define OOK_TOPIC_TRIE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/unordered_map.hpp"
+#include "boost/utility/string_view.hpp"
+#include "boost/functional/hash.hpp"
+
+//Hashes a topic level in place, the same as boost::hash<string> would
+struct ookTopicLevelHash
+{
+	size_t operator()(const boost::string_view& level) const
+	{
+		return boost::hash_range(level.begin(), level.end());
+	}
+};
+
+struct ookTopicLevelEqual
+{
+	bool operator()(const boost::string_view& a, const string& b) const
+	{
+		return (a == boost::string_view(b));
+	}
+	
+	bool operator()(const string& a, const boost::string_view& b) const
+	{
+		return (boost::string_view(a) == b);
+	}
+};
+
+//A pattern level; children are indexes into the trie's node list, 0 for none
+struct ookTopicNode
+{
+	ookTopicNode() : iStar(0), iHash(0) {}
+	
+	boost::unordered_map<string, size_t> children;
+	size_t iStar;
+	size_t iHash;
+	vector<size_t> vValues;
+};
+
+class ookTopicTrie
+{
+public:
+	
+	ookTopicTrie();
+	virtual ~ookTopicTrie();
+	
+	void Add(const string& pattern, size_t iValue);
+	void Clear();
+	
+	void Match(const string& topic, vector<size_t>& vValues) const;
+	
+	size_t GetSize() const;
+	bool IsEmpty() const;
+	
+	static bool IsValidPattern(const string& pattern);
+	static bool Matches(const string& pattern, const string& topic);
+	
+protected:
+	
+	void MatchFrom(size_t iNode, const string& topic, size_t iPos, vector<size_t>& vValues) const;
+	size_t AddNode();
+	
+private:
+	
+	vector<ookTopicNode> _vNodes;
+	size_t _iPatterns;
+};
+
+#endif
\ No newline at end of file
@@ -198,6 +198,13 @@ typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssl_socket;
 typedef boost::shared_ptr<ssl_socket> ssl_socket_ptr;
 #endif
 
+#ifndef acceptor_ptr
+/*!
+ boost::shared_ptr<tcp::acceptor>
+ */
+typedef boost::shared_ptr<tcp::acceptor> acceptor_ptr;
+#endif
+
 #ifndef base_method
 /*!
  boost::asio::ssl::context_base::method
@@ -0,0 +1,588 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookNet/ookBridgePeer.h"
+#include "ookLibs/ookNet/ookMsgBridge.h"
+#include "ookLibs/ookNet/ookListener.h"
+#include "ookLibs/ookCore/ookException.h"
+
+/*!
+ \class ookBridgePeer
+ \headerfile ookBridgePeer.h "ookLibs/ookNet/ookBridgePeer.h"
+ \brief One connection of an ookMsgBridge, made or accepted.
+ 
+ Run() reads frames from the socket and acts on them: subscriptions
+ register an ookBridgeObserver on the bridge's dispatcher, and message
+ batches are decoded and posted to it. A second thread, the writer,
+ drains what the observers queue with Send() and writes it out, as many
+ messages to a frame as have built up, up to OOK_BRIDGE_BATCH. Publishers
+ only ever pay for the queue push; encoding and the socket write happen
+ on the writer.
+ 
+ A frame is a 4 byte little endian length followed by a body made with
+ ookMsgWriter. The body starts with an ookBridgeFrame:
+ 
+ SUBSCRIBE    id, type name, topic pattern (empty for either matches any)
+ UNSUBSCRIBE  id
+ MESSAGES     count, then an ookMsgCodecRegistry entry for each
+ 
+ Messages are encoded with their class's schema (see ookMsgCodec), by the
+ codec the bridge has for the nearest registered type. Decoded byte fields
+ view the frame they came in, so a batch's buffer lives until the last
+ message from it is released.
+ 
+ Delivery is at most once: whatever is still queued when the connection
+ closes is dropped. A full queue drops its oldest message by default, so
+ a slow or stalled peer never holds up a local publisher; the loss shows
+ in GetDroppedCount(). OOK_OVERFLOW_BLOCK (see SetQueueSize()) is there
+ for backpressure instead, at the price of publishers waiting on the
+ network.
+ */
+ookBridgePeer::ookBridgePeer(ookMsgBridge* bridge, socket_ptr sock)
+	: _bridge(bridge), _sock(sock), _iCapacity(4096), _policy(OOK_OVERFLOW_DROP_OLDEST), _bClosed(false),
+		_lSent(0), _lReceived(0), _lBatches(0), _lDropped(0)
+{
+	
+}
+
+ookBridgePeer::~ookBridgePeer()
+{
+	try
+	{
+		this->Stop();
+		this->Join();
+	}
+	catch (...)
+	{
+	}
+}
+
+/*! 
+ \brief Queues msg for the peer. The message is shared if it is ref
+ counted and cloned if not, so the caller may reuse it straight away.
+ When the queue is full the overflow policy decides: block until there is
+ room, drop the oldest queued message, or turn this one away.
+ 
+ \return false if the message was turned away or the connection is closed.
+ */
+bool ookBridgePeer::Send(ookMessage* msg)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	//Checked under the lock, so the bridge is known to be alive below
+	if(_bClosed)
+		return false;
+	
+	const ookMsgTypeCodec* codec = _bridge->GetCodecs().FindCodec(msg->GetType());
+	
+	if(!codec)
+		return false;
+	
+	while(_queue.size() >= _iCapacity)
+	{
+		if(_policy == OOK_OVERFLOW_REJECT)
+		{
+			_lDropped++;
+			return false;
+		}
+		
+		if(_policy == OOK_OVERFLOW_DROP_OLDEST)
+		{
+			_queue.pop_front();
+			_lDropped++;
+			continue;
+		}
+		
+		_spaceCond.wait(lock);
+		
+		if(_bClosed)
+			return false;
+	}
+	
+	ookBridgeOut out;
+	out.codec = codec;
+	
+	if(msg->GetRefCount() > 0)
+		out.msg.reset(msg);
+	else
+		out.msg.reset(msg->Clone());
+	
+	_queue.push_back(out);
+	
+	//The writer only waits on an empty queue
+	if(_queue.size() == 1)
+		_cond.notify_one();
+	
+	return true;
+}
+
+/*! 
+ \brief Asks the peer to forward messages of type typeName, and/or with
+ a topic matching topic, under the id lId. Either may be empty.
+ */
+void ookBridgePeer::SendSubscribe(long lId, const string& typeName, const string& topic)
+{
+	size_t iBody = ookMsgWriter::GetVarintSize(OOK_BRIDGE_SUBSCRIBE) + ookMsgWriter::GetVarintSize(lId) + 
+		ookMsgWriter::GetVarintSize(typeName.size()) + typeName.size() + 
+		ookMsgWriter::GetVarintSize(topic.size()) + topic.size();
+	
+	string frame(sizeof(boost::uint32_t) + iBody, '\0');
+	ookMsgWriter writer(&frame[0], frame.size());
+	
+	writer.WriteFixed32((boost::uint32_t) iBody);
+	writer.WriteVarint(OOK_BRIDGE_SUBSCRIBE);
+	writer.WriteVarint(lId);
+	writer.WriteVarint(typeName.size());
+	writer.WriteBytes(typeName.data(), typeName.size());
+	writer.WriteVarint(topic.size());
+	writer.WriteBytes(topic.data(), topic.size());
+	
+	this->SendControl(frame);
+}
+
+void ookBridgePeer::SendUnsubscribe(long lId)
+{
+	size_t iBody = ookMsgWriter::GetVarintSize(OOK_BRIDGE_UNSUBSCRIBE) + ookMsgWriter::GetVarintSize(lId);
+	
+	string frame(sizeof(boost::uint32_t) + iBody, '\0');
+	ookMsgWriter writer(&frame[0], frame.size());
+	
+	writer.WriteFixed32((boost::uint32_t) iBody);
+	writer.WriteVarint(OOK_BRIDGE_UNSUBSCRIBE);
+	writer.WriteVarint(lId);
+	
+	this->SendControl(frame);
+}
+
+//Control frames go out ahead of any queued messages and are never dropped
+void ookBridgePeer::SendControl(const string& frame)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	if(_bClosed)
+		return;
+	
+	_vControl.push_back(frame);
+	_cond.notify_one();
+}
+
+/*! 
+ \brief Bounds the outgoing queue. See Send() for the policies.
+ */
+void ookBridgePeer::SetQueueSize(size_t iSize, ookOverflowPolicy policy)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_iCapacity = (iSize > 0) ? iSize : 1;
+	_policy = policy;
+	_spaceCond.notify_all();
+}
+
+string ookBridgePeer::GetRemoteAddress()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	system::error_code err;
+	
+	if(!_sock)
+		return "";
+	
+	return ookListener::AddressToString(_sock->remote_endpoint(err));
+}
+
+long ookBridgePeer::GetSentCount() const
+{
+	return _lSent;
+}
+
+long ookBridgePeer::GetReceivedCount() const
+{
+	return _lReceived;
+}
+
+/*! 
+ \brief Frames of messages written; GetSentCount() over this is the
+ average batch.
+ */
+long ookBridgePeer::GetBatchCount() const
+{
+	return _lBatches;
+}
+
+/*! 
+ \brief Messages lost to a full queue under the DROP_OLDEST or REJECT
+ policies.
+ */
+long ookBridgePeer::GetDroppedCount() const
+{
+	return _lDropped;
+}
+
+ookBufferView ookBridgePeer::ReadFrame()
+{
+	char hdrBuf[sizeof(boost::uint32_t)];
+	system::error_code error;
+	
+	long iRead = asio::read(*_sock, asio::buffer(hdrBuf, sizeof(hdrBuf)), error);
+	
+	if((iRead != (long) sizeof(hdrBuf)) || error)
+		throw error;
+	
+	ookMsgReader hdr(hdrBuf, sizeof(hdrBuf));
+	boost::uint32_t iSize = hdr.ReadFixed32();
+	
+	if((iSize == 0) || (iSize > OOK_BRIDGE_MAX_FRAME))
+		throw ookException("ookBridgePeer: bad frame size");
+	
+	buffer_ptr buf = ookBuffer::Create(iSize);
+	
+	iRead = asio::read(*_sock, asio::buffer(buf->GetData(), iSize), error);
+	
+	if((iRead != (long) iSize) || error)
+		throw error;
+	
+	return ookBufferView(buf);
+}
+
+void ookBridgePeer::HandleFrame(const ookBufferView& frame)
+{
+	ookMsgReader reader(frame);
+	
+	switch(reader.ReadVarint())
+	{
+		case OOK_BRIDGE_SUBSCRIBE:
+			this->HandleSubscribe(reader);
+			break;
+			
+		case OOK_BRIDGE_UNSUBSCRIBE:
+			this->HandleUnsubscribe(reader);
+			break;
+			
+		case OOK_BRIDGE_MESSAGES:
+			this->HandleMessages(reader);
+			break;
+			
+		default:
+			//From a newer peer; the length prefix lets us step over it
+			break;
+	}
+}
+
+void ookBridgePeer::HandleSubscribe(ookMsgReader& reader)
+{
+	long lId = (long) reader.ReadVarint();
+	
+	size_t iSize = (size_t) reader.ReadVarint();
+	string typeName(reader.ReadBytes(iSize), iSize);
+	
+	iSize = (size_t) reader.ReadVarint();
+	string topic(reader.ReadBytes(iSize), iSize);
+	
+	const ookMsgType* type = NULL;
+	
+	if(!typeName.empty())
+	{
+		const ookMsgTypeCodec* codec = _bridge->GetCodecs().GetCodec(typeName);
+		
+		if(!codec)
+		{
+			std::cerr << "Something bad happened in ookBridgePeer::HandleSubscribe: no codec for " << typeName << "\n";
+			return;
+		}
+		
+		type = codec->GetType();
+	}
+	
+	ookMsgDispatcher* dispatcher = _bridge->GetDispatcher();
+	ookMsgObserverAbs* obs = new ookBridgeObserver(shared_from_this(), type);
+	ook_subscription_id id;
+	
+	try
+	{
+		if(topic.empty())
+			id = dispatcher->RegisterObserver(obs);
+		else
+			id = dispatcher->RegisterObserver(topic, obs);
+	}
+	catch (std::exception& e)
+	{
+		//RegisterObserver() has deleted obs
+		std::cerr << "Something bad happened in ookBridgePeer::HandleSubscribe: " << e.what() << "\n";
+		return;
+	}
+	
+	ook_subscription_id oldId = 0;
+	bool bReplaced = false;
+	
+	{
+		boost::mutex::scoped_lock lock(_subMut);
+		
+		std::map<long, ook_subscription_id>::iterator it = _subs.find(lId);
+		
+		if(it != _subs.end())
+		{
+			oldId = it->second;
+			bReplaced = true;
+		}
+		
+		_subs[lId] = id;
+	}
+	
+	if(bReplaced)
+		dispatcher->UnregisterObserver(oldId);
+}
+
+void ookBridgePeer::HandleUnsubscribe(ookMsgReader& reader)
+{
+	long lId = (long) reader.ReadVarint();
+	ook_subscription_id id;
+	
+	{
+		boost::mutex::scoped_lock lock(_subMut);
+		
+		std::map<long, ook_subscription_id>::iterator it = _subs.find(lId);
+		
+		if(it == _subs.end())
+			return;
+		
+		id = it->second;
+		_subs.erase(it);
+	}
+	
+	_bridge->GetDispatcher()->UnregisterObserver(id);
+}
+
+/*
+ Posts each message in the batch to the local dispatcher as if it had
+ been published here, apart from the origin, which marks it as ours so
+ our observers don't send it on again
+ */
+void ookBridgePeer::HandleMessages(ookMsgReader& reader)
+{
+	size_t iCount = (size_t) reader.ReadVarint();
+	
+	//The frame's messages are posted together; vHeld keeps them alive
+	vector<msg_ptr> vHeld;
+	vector<ookMessage*> vMsgs;
+	
+	vHeld.reserve(std::min(iCount, (size_t) OOK_BRIDGE_BATCH));
+	vMsgs.reserve(vHeld.capacity());
+	
+	for(size_t i = 0; i < iCount; i++)
+	{
+		msg_ptr msg = _bridge->GetCodecs().ReadEntry(reader);
+		
+		if(!msg)
+			continue;
+		
+		msg->SetOrigin(this);
+		
+		vHeld.push_back(msg);
+		vMsgs.push_back(msg.get());
+	}
+	
+	_lReceived += vMsgs.size();
+	_bridge->GetDispatcher()->PostBatch(vMsgs);
+}
+
+void ookBridgePeer::WriteLoop()
+{
+	vector<string> vControl;
+	
+	try
+	{
+		while(true)
+		{
+			{
+				boost::mutex::scoped_lock lock(_mut);
+				
+				while(_queue.empty() && _vControl.empty() && !_bClosed)
+					_cond.wait(lock);
+				
+				if(_bClosed)
+					break;
+				
+				vControl.swap(_vControl);
+				
+				size_t iCount = std::min(_queue.size(), (size_t) OOK_BRIDGE_BATCH);
+				
+				_vBatch.assign(_queue.begin(), _queue.begin() + iCount);
+				_queue.erase(_queue.begin(), _queue.begin() + iCount);
+				
+				if(iCount > 0)
+					_spaceCond.notify_all();
+			}
+			
+			this->WriteBatch(vControl);
+			
+			vControl.clear();
+			_vBatch.clear();
+		}
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Connection Closed: " << e.message() << "\n";
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookBridgePeer::WriteLoop: " << e.what() << "\n";
+	}
+	
+	//Whatever ended the writer, the connection is no use without it
+	this->CloseQueue();
+	this->OnStop();
+	
+	_vBatch.clear();
+}
+
+//Puts the control frames and one frame holding all of _vBatch in a single write
+void ookBridgePeer::WriteBatch(const vector<string>& vControl)
+{
+	size_t iTotal = 0;
+	
+	for(size_t i = 0; i < vControl.size(); i++)
+		iTotal += vControl[i].size();
+	
+	ookMsgCodecRegistry& codecs = _bridge->GetCodecs();
+	size_t iBody = 0;
+	
+	if(!_vBatch.empty())
+	{
+		_vSizes.resize(_vBatch.size());
+		
+		iBody = ookMsgWriter::GetVarintSize(OOK_BRIDGE_MESSAGES) + ookMsgWriter::GetVarintSize(_vBatch.size());
+		
+		for(size_t i = 0; i < _vBatch.size(); i++)
+			iBody += codecs.GetEntrySize(_vBatch[i].msg.get(), _vBatch[i].codec, _vSizes[i]);
+		
+		if(iBody > OOK_BRIDGE_MAX_FRAME)
+			throw ookException("ookBridgePeer::WriteBatch: batch is bigger than OOK_BRIDGE_MAX_FRAME");
+		
+		iTotal += sizeof(boost::uint32_t) + iBody;
+	}
+	
+	if(iTotal == 0)
+		return;
+	
+	_vOut.resize(iTotal);
+	ookMsgWriter writer(&_vOut[0], _vOut.size());
+	
+	for(size_t i = 0; i < vControl.size(); i++)
+		writer.WriteBytes(vControl[i].data(), vControl[i].size());
+	
+	if(!_vBatch.empty())
+	{
+		writer.WriteFixed32((boost::uint32_t) iBody);
+		writer.WriteVarint(OOK_BRIDGE_MESSAGES);
+		writer.WriteVarint(_vBatch.size());
+		
+		for(size_t i = 0; i < _vBatch.size(); i++)
+			codecs.WriteEntry(_vBatch[i].msg.get(), _vBatch[i].codec, _vSizes[i], writer);
+	}
+	
+	asio::write(*_sock, asio::buffer(&_vOut[0], writer.GetPosition()));
+	
+	if(!_vBatch.empty())
+	{
+		_lSent += (long) _vBatch.size();
+		_lBatches++;
+	}
+}
+
+//Turns Send() away from now on and wakes anyone waiting on the queue
+void ookBridgePeer::CloseQueue()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_bClosed = true;
+	_queue.clear();
+	_vControl.clear();
+	
+	_cond.notify_all();
+	_spaceCond.notify_all();
+}
+
+void ookBridgePeer::UnregisterAll()
+{
+	std::map<long, ook_subscription_id> subs;
+	
+	{
+		boost::mutex::scoped_lock lock(_subMut);
+		subs.swap(_subs);
+	}
+	
+	std::map<long, ook_subscription_id>::iterator it;
+	for(it = subs.begin(); it != subs.end(); it++)
+		_bridge->GetDispatcher()->UnregisterObserver(it->second);
+}
+
+//Run() is blocked reading and the writer may be blocked writing; both fail out
+void ookBridgePeer::OnStop()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	system::error_code err;
+	
+	if(_sock)
+		_sock->shutdown(boost::asio::socket_base::shutdown_both, err);
+}
+
+void ookBridgePeer::Run()
+{
+	_writer = boost::thread(boost::bind(&ookBridgePeer::WriteLoop, this));
+	
+	try
+	{
+		while(this->IsRunning() && _sock->is_open())
+			this->HandleFrame(this->ReadFrame());
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Connection Closed: " << e.message() << "\n";
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookBridgePeer::Run: " << e.what() << "\n";
+	}
+	
+	//Stop the writer before the observers that feed it, so a publisher
+	//blocked on a full queue is let go first
+	this->CloseQueue();
+	this->OnStop();
+	_writer.join();
+	
+	this->UnregisterAll();
+	
+	//The dispatcher may hold our observers, and so us, past the bridge, but
+	//the socket belongs to the bridge's io_service and must go with it
+	socket_ptr sock;
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		sock.swap(_sock);
+	}
+}
\ No newline at end of file
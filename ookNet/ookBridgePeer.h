@@ -0,0 +1,185 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_BRIDGE_PEER_H_
+#define OOK_BRIDGE_PEER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMessage.h"
+#include "ookLibs/ookCore/ookMsgObserverAbs.h"
+#include "ookLibs/ookCore/ookMsgMailbox.h"
+#include "ookLibs/ookCore/ookMsgRoutes.h"
+#include "ookLibs/ookCore/ookMsgWire.h"
+#include "ookLibs/ookCore/ookBuffer.h"
+#include "ookLibs/ookThread/ookThread.h"
+#include "ookLibs/ookCore/ookMsgCodecRegistry.h"
+#include "boost/enable_shared_from_this.hpp"
+#include "boost/atomic.hpp"
+
+#include <deque>
+#include <map>
+
+//Most messages the writer puts in one frame
+#define OOK_BRIDGE_BATCH 256
+
+//Frames bigger than this are taken for a broken or hostile peer
+#define OOK_BRIDGE_MAX_FRAME (64 * 1024 * 1024)
+
+//What a bridge frame carries, the first varint of its body
+enum ookBridgeFrame
+{
+	OOK_BRIDGE_SUBSCRIBE = 1,
+	OOK_BRIDGE_UNSUBSCRIBE = 2,
+	OOK_BRIDGE_MESSAGES = 3
+};
+
+class ookMsgBridge;
+
+class ookBridgePeer : public ookThread, public boost::enable_shared_from_this<ookBridgePeer>
+{
+public:
+	
+	ookBridgePeer(ookMsgBridge* bridge, socket_ptr sock);
+	virtual ~ookBridgePeer();
+	
+	bool Send(ookMessage* msg);
+	void SendSubscribe(long lId, const string& typeName, const string& topic);
+	void SendUnsubscribe(long lId);
+	
+	void SetQueueSize(size_t iSize, ookOverflowPolicy policy);
+	string GetRemoteAddress();
+	
+	long GetSentCount() const;
+	long GetReceivedCount() const;
+	long GetBatchCount() const;
+	long GetDroppedCount() const;
+	
+protected:
+	
+	virtual void Run();
+	virtual void OnStop();
+	
+	ookBufferView ReadFrame();
+	void HandleFrame(const ookBufferView& frame);
+	void HandleSubscribe(ookMsgReader& reader);
+	void HandleUnsubscribe(ookMsgReader& reader);
+	void HandleMessages(ookMsgReader& reader);
+	
+	void SendControl(const string& frame);
+	void WriteLoop();
+	void WriteBatch(const vector<string>& vControl);
+	void CloseQueue();
+	void UnregisterAll();
+	
+private:
+	
+	struct ookBridgeOut
+	{
+		msg_ptr msg;
+		const ookMsgTypeCodec* codec;
+	};
+	
+	ookMsgBridge* _bridge;
+	socket_ptr _sock;
+	boost::thread _writer;
+	
+	//Outgoing messages and control frames, filled by Send() and drained by
+	//the writer
+	boost::mutex _mut;
+	boost::condition_variable _cond;
+	boost::condition_variable _spaceCond;
+	std::deque<ookBridgeOut> _queue;
+	vector<string> _vControl;
+	size_t _iCapacity;
+	ookOverflowPolicy _policy;
+	bool _bClosed;
+	
+	//The writer's batch and frame, reused so steady traffic doesn't allocate
+	vector<ookBridgeOut> _vBatch;
+	vector<size_t> _vSizes;
+	vector<char> _vOut;
+	
+	//The peer's subscription ids and the local observers serving them
+	boost::mutex _subMut;
+	std::map<long, ook_subscription_id> _subs;
+	
+	boost::atomic<long> _lSent;
+	boost::atomic<long> _lReceived;
+	boost::atomic<long> _lBatches;
+	boost::atomic<long> _lDropped;
+};
+
+typedef boost::shared_ptr<ookBridgePeer> bridge_peer_ptr;
+
+/*!
+ \brief Stands in on the local dispatcher for one subscription of a
+ remote peer, queueing what it is delivered for the peer's writer.
+ Messages that came in over a bridge are left alone, so nothing is sent
+ back where it came from or passed on to a third process.
+ */
+class ookBridgeObserver : public ookMsgObserverAbs
+{
+public:
+	
+	ookBridgeObserver(bridge_peer_ptr peer, const ookMsgType* type)
+		: _peer(peer), _pType(type)
+	{
+		
+	}
+	
+	void SendMessage(ookMessage* msg)
+	{
+		if(this->Accepts(msg))
+			this->Deliver(msg);
+	}
+	
+	bool Accepts(ookMessage* msg)
+	{
+		return (_pType == NULL) || msg->GetType()->IsA(_pType);
+	}
+	
+	const ookMsgType* GetMsgType() const
+	{
+		return _pType;
+	}
+	
+	void Deliver(ookMessage* msg)
+	{
+		if(msg->GetOrigin() == NULL)
+			_peer->Send(msg);
+	}
+	
+private:
+	
+	bridge_peer_ptr _peer;
+	const ookMsgType* _pType;
+};
+
+#endif
\ No newline at end of file
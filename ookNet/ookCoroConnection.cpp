@@ -0,0 +1,253 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookCoroConnection
+ \headerfile ookCoroConnection.h "ookLibs/ookNet/ookCoroConnection.h"
+ \brief Connection handler that runs as a coroutine on ookCoroServer's
+ io_service threads, instead of owning a thread like ookTCPServerThread.
+ 
+ Run(), Read() and WriteMsg() read just like the blocking versions. Each
+ takes the ook_yield the coroutine was started with, and where the thread
+ version would block, the coroutine suspends and frees the thread for
+ other connections. The default Run() is the same loop as
+ ookTCPServerThread::Run():
+ 
+ \code
+ 
+ void ookEchoConnection::Run(ook_yield yield)
+ {
+ 	while(this->IsOpen())
+ 	{
+ 		string msg = this->Read(yield);		//Suspends until a frame is in
+ 		this->WriteMsg(msg, yield);		//Suspends until it is sent
+ 	}
+ }
+ 
+ \endcode
+ 
+ The wire format is the same as ookTCPServerThread, so existing clients
+ work unchanged. Read() throws the system::error_code that ended the
+ connection, just as the thread version does.
+ 
+ A connection's coroutine and Close() are serialized on its strand, so it
+ only ever runs on one thread at a time and needs no locking of its own.
+ Anything it shares with other connections still does.
+ */
+#include "ookLibs/ookNet/ookCoroConnection.h"
+#include "ookLibs/ookCore/ookMsgPool.h"
+#include "ookLibs/ookCore/ookBinaryMessage.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+ookCoroConnection::ookCoroConnection(socket_ptr sock, ookMsgDispatcher* dispatcher)
+	: _sock(sock), _strand(sock->get_executor()), _dispatcher(dispatcher), _bOpen(true), _bBinary(false)
+{
+	
+}
+
+ookCoroConnection::~ookCoroConnection()
+{
+	
+}
+
+string ookCoroConnection::Read(ook_yield yield)
+{
+	int messageSize = this->ReadFrameSize(yield);
+	system::error_code error;
+	
+	//Now fetch the message
+	_readBuf.resize(messageSize);
+	
+	size_t iRead = asio::async_read(*_sock, asio::buffer(&_readBuf[0], messageSize), yield[error]);
+	
+	if(error)
+		throw error;
+	
+	if(iRead != (size_t) messageSize)
+		throw system::error_code(asio::error::eof);
+	
+	return string(&_readBuf[0], messageSize);
+}
+
+/*! 
+ \brief Reads the next frame into a buffer of its own and returns a view
+ of it, for handing on without copying.
+ */
+ookBufferView ookCoroConnection::ReadBuffer(ook_yield yield)
+{
+	int messageSize = this->ReadFrameSize(yield);
+	system::error_code error;
+	
+	buffer_ptr buf = ookBuffer::Create(messageSize);
+	
+	size_t iRead = asio::async_read(*_sock, asio::buffer(buf->GetData(), messageSize), yield[error]);
+	
+	if(error)
+		throw error;
+	
+	if(iRead != (size_t) messageSize)
+		throw system::error_code(asio::error::eof);
+	
+	return ookBufferView(buf);
+}
+
+//Reads a frame header and returns the size of the frame that follows it
+int ookCoroConnection::ReadFrameSize(ook_yield yield)
+{
+	system::error_code error;
+	
+	//Fetch the message header which sets out the size of the upcoming message
+	char hdrBuf[sizeof(int) + 1];
+	
+	size_t iRead = asio::async_read(*_sock, asio::buffer(hdrBuf, sizeof(int)), yield[error]);
+	
+	if(error)
+		throw error;
+	
+	if(iRead != sizeof(int))
+		throw system::error_code(asio::error::eof);
+	
+	hdrBuf[sizeof(int)] = '\0';
+	
+	int messageSize = atoi(hdrBuf);
+	
+	if(messageSize <= 0)
+		throw system::error_code(asio::error::invalid_argument);
+	
+	return messageSize;
+}
+
+/*! 
+ \brief Posts the message to the server's dispatcher. Override it to
+ answer on the connection; unlike the thread version, it can WriteMsg()
+ straight away with yield.
+ */
+void ookCoroConnection::HandleMsg(string msg, ook_yield /*yield*/)
+{
+	if(!_dispatcher)
+		return;
+	
+	//Pooled and ref counted, so an asynchronous dispatcher queues it as is
+	boost::intrusive_ptr<ookTextMessage> message = ookMsgPool<ookTextMessage>::Global().Acquire();
+	message->SetMessage(msg);
+	_dispatcher->PostMsg(message.get());
+}
+
+/*! 
+ \brief Posts the frame to the server's dispatcher as an ookBinaryMessage
+ sharing the read buffer, so observers see the bytes as they came off the
+ socket.
+ */
+void ookCoroConnection::HandleBuffer(const ookBufferView& payload, ook_yield /*yield*/)
+{
+	if(!_dispatcher)
+		return;
+	
+	boost::intrusive_ptr<ookBinaryMessage> message = ookMsgPool<ookBinaryMessage>::Global().Acquire();
+	message->SetPayload(payload);
+	_dispatcher->PostMsg(message.get());
+}
+
+void ookCoroConnection::WriteMsg(string msg, ook_yield yield)
+{
+	//Convert the int length value to our header string
+	string msgHdr = ookString::ConvertInt2String((int) msg.length());
+	msgHdr = ookString::LeftPad(msgHdr, '0', sizeof(int));
+	
+	string msgBuf = msgHdr + msg;
+	system::error_code error;
+	
+	asio::async_write(*_sock, asio::buffer(msgBuf), yield[error]);
+	
+	if(error)
+		std::cerr << "Something bad happened in ookCoroConnection::WriteMsg: " << error.message() << "\n";
+}
+
+void ookCoroConnection::Run(ook_yield yield)
+{
+	while(this->IsOpen() && _sock->is_open())
+	{
+		if(_bBinary)
+			this->HandleBuffer(this->ReadBuffer(yield), yield);
+		else
+		{
+			string msg = this->Read(yield);
+			this->HandleMsg(msg, yield);
+		}
+	}
+}
+
+/*! 
+ \brief Reads frames with ReadBuffer() and posts them as ookBinaryMessages
+ instead of ookTextMessages. Must be set before the connection is run.
+ */
+void ookCoroConnection::SetBinary(bool bBinary)
+{
+	_bBinary = bBinary;
+}
+
+bool ookCoroConnection::IsBinary() const
+{
+	return _bBinary;
+}
+
+/*! 
+ \brief Shuts the connection down from any thread. A Read() in progress
+ fails and Run() ends.
+ */
+void ookCoroConnection::Close()
+{
+	if(_bOpen.exchange(false))
+		asio::post(_strand, boost::bind(&ookCoroConnection::DoClose, shared_from_this()));
+}
+
+bool ookCoroConnection::IsOpen() const
+{
+	return _bOpen.load();
+}
+
+socket_ptr ookCoroConnection::GetSocket()
+{
+	return _sock;
+}
+
+ook_strand& ookCoroConnection::GetStrand()
+{
+	return _strand;
+}
+
+void ookCoroConnection::DoClose()
+{
+	system::error_code err;
+	
+	_sock->shutdown(asio::socket_base::shutdown_both, err);
+	_sock->close(err);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_CORO_CONNECTION_H_
+#define OOK_CORO_CONNECTION_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMsgDispatcher.h"
+#include "ookLibs/ookCore/ookTextMessage.h"
+#include "ookLibs/ookCore/ookBuffer.h"
+
+//asio's stackful coroutines still sit on Boost.Coroutine v1
+#ifndef BOOST_COROUTINES_NO_DEPRECATION_WARNING
+#define BOOST_COROUTINES_NO_DEPRECATION_WARNING
+#endif
+
+#include "boost/asio/spawn.hpp"
+#include "boost/asio/strand.hpp"
+#include "boost/enable_shared_from_this.hpp"
+#include "boost/atomic.hpp"
+
+typedef asio::yield_context ook_yield;
+typedef asio::strand<tcp::socket::executor_type> ook_strand;
+
+class ookCoroConnection : public boost::enable_shared_from_this<ookCoroConnection>
+{
+public:
+	
+	ookCoroConnection(socket_ptr sock, ookMsgDispatcher* dispatcher);
+	virtual ~ookCoroConnection();
+	
+	virtual string Read(ook_yield yield);
+	virtual void HandleMsg(string msg, ook_yield yield);
+	virtual void WriteMsg(string msg, ook_yield yield);
+	
+	virtual ookBufferView ReadBuffer(ook_yield yield);
+	virtual void HandleBuffer(const ookBufferView& payload, ook_yield yield);
+	
+	virtual void Run(ook_yield yield);
+	
+	void Close();
+	bool IsOpen() const;
+	
+	void SetBinary(bool bBinary);
+	bool IsBinary() const;
+	
+	socket_ptr GetSocket();
+	ook_strand& GetStrand();
+	
+protected:
+	
+	int ReadFrameSize(ook_yield yield);
+	void DoClose();
+	
+private:
+	
+	socket_ptr _sock;
+	ook_strand _strand;
+	ookMsgDispatcher* _dispatcher;
+	boost::atomic<bool> _bOpen;
+	bool _bBinary;
+	
+	//Reused for every frame, so a connection's reads don't allocate
+	vector<char> _readBuf;
+};
+
+typedef boost::shared_ptr<ookCoroConnection> coro_conn_ptr;
+
+#endif
\ No newline at end of file
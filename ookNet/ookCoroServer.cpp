@@ -0,0 +1,273 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookCoroServer
+ \headerfile ookCoroServer.h "ookLibs/ookNet/ookCoroServer.h"
+ \brief TCP server that runs each connection as a coroutine on a small
+ pool of io_service threads.
+ 
+ ookTCPServer gives every connection a thread (or a pool worker) that
+ blocks in Read(), so each one costs a full thread stack. Here a
+ connection is an ookCoroConnection whose Run() suspends instead of
+ blocking, and the threads only run whichever connections have data.
+ A connection costs its coroutine stack (64KB by default, see
+ SetStackSize()) plus its socket and buffers.
+ 
+ \code
+ 
+ class ookEchoConnection : public ookCoroConnection { ... };
+ 
+ class ookEchoServer : public ookCoroServer
+ {
+ public:
+ 	ookEchoServer(int iPort) : ookCoroServer(iPort, 4) {}
+ 
+ protected:
+ 	virtual coro_conn_ptr GetConnection(socket_ptr sock)
+ 	{
+ 		return coro_conn_ptr(new ookEchoConnection(sock));
+ 	}
+ };
+ 
+ \endcode
+ 
+ The server thread is one of the io_service threads; Run() starts the
+ rest and Stop() ends them all. Without a thread count the server uses
+ one per hardware thread.
+ */
+#include "ookLibs/ookNet/ookCoroServer.h"
+
+ookCoroServer::ookCoroServer(int iPort, int iThreads)
+	: _iPort(iPort), _iThreads(iThreads), _iStackSize(64 * 1024), _bBinary(false)
+{
+	//_dispatcher owns the observer and deletes it along with the server
+	_dispatcher.RegisterObserver(new ookMsgObserver<ookCoroServer, ookTextMessage>(this, &ookCoroServer::HandleMsg));
+}
+
+ookCoroServer::~ookCoroServer()
+{
+	try
+	{
+		this->Stop();
+		this->Join();
+		
+		//Suspended connections are destroyed with the io_service; drop our
+		//references first so nothing outlives it
+		_connections.clear();
+		_vAcceptors.clear();
+	}
+	catch (...)
+	{
+	}
+}
+
+/*! 
+ \brief Same as ookTCPServer::AddListenEndpoint(). Endpoints must be added
+ before Start().
+ */
+void ookCoroServer::AddListenEndpoint(string address, int iPort, bool bV6Only)
+{
+	_vListenEndpoints.push_back(ookListenEndpoint(address, iPort, bV6Only));
+}
+
+/*! 
+ \brief Stack size for each connection's coroutine. The stack is the bulk
+ of what a connection costs, but Run() and everything it calls must fit in
+ it, so keep deep call chains and large locals out of handlers. Values
+ below the platform minimum are raised to it. Only affects connections
+ accepted afterwards.
+ */
+void ookCoroServer::SetStackSize(size_t iBytes)
+{
+	_iStackSize = iBytes;
+}
+
+size_t ookCoroServer::GetStackSize() const
+{
+	return std::max(_iStackSize, boost::coroutines::stack_traits::minimum_size());
+}
+
+/*! 
+ \brief Posts frames as ookBinaryMessages; see ookTCPServer::SetBinary().
+ */
+void ookCoroServer::SetBinary(bool bBinary)
+{
+	_bBinary = bBinary;
+}
+
+size_t ookCoroServer::GetConnectionCount()
+{
+	boost::mutex::scoped_lock lock(_connMut);
+	return _connections.size();
+}
+
+/*! 
+ \brief See ookTCPServer::GetDispatcher(). A synchronous dispatcher runs
+ observers on the io_service threads, where a slow one stalls every
+ connection on that thread, so asynchronous is the better fit here.
+ */
+ookMsgDispatcher* ookCoroServer::GetDispatcher()
+{
+	return &_dispatcher;
+}
+
+coro_conn_ptr ookCoroServer::GetConnection(socket_ptr sock)
+{
+	return coro_conn_ptr(new ookCoroConnection(sock, &_dispatcher));
+}
+
+void ookCoroServer::HandleMsg(ookTextMessage* msg)
+{
+	cout << "Received message: " << msg->GetMsg() << endl;
+}
+
+//Every io_service thread ends when the io_service is stopped
+void ookCoroServer::OnStop()
+{
+	_ioService.stop();
+}
+
+//Accepts on one acceptor for the life of the server, starting a coroutine
+//for each connection on that connection's strand
+void ookCoroServer::Accept(acceptor_ptr accptr, ook_yield yield)
+{
+	while(this->IsRunning())
+	{
+		socket_ptr sock = boost::shared_ptr<tcp::socket>(new tcp::socket(_ioService));
+		system::error_code err;
+		
+		accptr->async_accept(*sock, yield[err]);
+		
+		if(err == asio::error::operation_aborted)
+			break;
+		
+		if(err)
+		{
+			std::cerr << "Something bad happened in ookCoroServer::Accept: " << err.message() << "\n";
+			continue;
+		}
+		
+		system::error_code epErr;
+		cout << "Accepted new client from " << ookListener::AddressToString(sock->remote_endpoint(epErr)) << endl;
+		
+		coro_conn_ptr conn = this->GetConnection(sock);
+		conn->SetBinary(_bBinary);
+		
+		{
+			boost::mutex::scoped_lock lock(_connMut);
+			_connections.insert(conn);
+		}
+		
+		asio::spawn(conn->GetStrand(), boost::bind(&ookCoroServer::RunConnection, this, conn, _1), 
+					boost::coroutines::attributes(this->GetStackSize()));
+	}
+}
+
+//Body of a connection's coroutine. The coroutine's own unwind exception
+//isn't a std::exception, so it passes through to Boost.Coroutine untouched.
+void ookCoroServer::RunConnection(coro_conn_ptr conn, ook_yield yield)
+{
+	try
+	{
+		conn->Run(yield);
+	}
+	catch (system::error_code& e)
+	{
+		cout << "Connection Closed: " << e.message() << endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookCoroServer::RunConnection: " << e.what() << "\n";
+	}
+	
+	conn->Close();
+	
+	boost::mutex::scoped_lock lock(_connMut);
+	_connections.erase(conn);
+}
+
+void ookCoroServer::RunIOService()
+{
+	try
+	{
+		_ioService.run();
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookCoroServer::RunIOService: " << e.what() << "\n";
+	}
+}
+
+void ookCoroServer::Run()
+{
+	try
+	{
+		vector<ookListenEndpoint> vEndpoints = _vListenEndpoints;
+		
+		if(vEndpoints.empty())
+			vEndpoints.push_back(ookListenEndpoint("", _iPort));
+		
+		for(size_t i = 0; i < vEndpoints.size(); i++)
+		{
+			acceptor_ptr accptr = ookListener::Open(_ioService, vEndpoints[i]);
+			_vAcceptors.push_back(accptr);
+			
+			cout << "Listening on " << accptr->local_endpoint() << endl;
+			
+			asio::spawn(_ioService, boost::bind(&ookCoroServer::Accept, this, accptr, _1), 
+						boost::coroutines::attributes(this->GetStackSize()));
+		}
+		
+		int iThreads = _iThreads;
+		
+		if(iThreads <= 0)
+			iThreads = std::max(1, (int) boost::thread::hardware_concurrency());
+		
+		//This thread is one of the io_service threads
+		boost::thread_group helpers;
+		
+		for(int i = 1; i < iThreads; i++)
+			helpers.create_thread(boost::bind(&ookCoroServer::RunIOService, this));
+		
+		this->RunIOService();
+		
+		helpers.join_all();
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Something bad happened in ookCoroServer::Run: " << e.message() << "\n";
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookCoroServer::Run: " << e.what() << "\n";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_CORO_SERVER_H_
+#define OOK_CORO_SERVER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookTextMsgHandler.h"
+#include "ookLibs/ookCore/ookMsgDispatcher.h"
+#include "ookLibs/ookCore/ookMsgObserver.h"
+#include "ookLibs/ookThread/ookThread.h"
+#include "ookLibs/ookNet/ookCoroConnection.h"
+#include "ookLibs/ookNet/ookListener.h"
+
+#include <set>
+
+class ookCoroServer : public ookThread, public ookTextMsgHandler
+{
+public:
+	
+	ookCoroServer(int iPort, int iThreads = 0);
+	virtual ~ookCoroServer();
+	
+	void AddListenEndpoint(string address, int iPort, bool bV6Only = false);
+	void SetStackSize(size_t iBytes);
+	size_t GetStackSize() const;
+	void SetBinary(bool bBinary);
+	size_t GetConnectionCount();
+	
+	ookMsgDispatcher* GetDispatcher();
+	
+	virtual void HandleMsg(ookTextMessage* msg);
+	virtual void Run();
+	
+protected:
+	
+	virtual coro_conn_ptr GetConnection(socket_ptr sock);
+	
+	virtual void OnStop();
+	
+	void Accept(acceptor_ptr accptr, ook_yield yield);
+	void RunConnection(coro_conn_ptr conn, ook_yield yield);
+	void RunIOService();
+	
+private:
+	
+	int			_iPort;
+	int			_iThreads;
+	size_t		_iStackSize;
+	bool		_bBinary;
+	asio::io_service _ioService;
+	ookMsgDispatcher _dispatcher;
+	vector<ookListenEndpoint> _vListenEndpoints;
+	vector<acceptor_ptr> _vAcceptors;
+	boost::mutex _connMut;
+	std::set<coro_conn_ptr> _connections;
+	
+};
+
+#endif
\ No newline at end of file
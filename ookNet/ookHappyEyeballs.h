@@ -0,0 +1,175 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_HAPPY_EYEBALLS_H_
+#define OOK_HAPPY_EYEBALLS_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+
+#include "boost/function.hpp"
+
+/*!
+ \brief Connects to the first reachable endpoint in a list, racing
+ attempts in the manner of RFC 8305 ("Happy Eyeballs").
+ 
+ The endpoints are reordered so that address families alternate, keeping
+ the family of the first (preferred) endpoint in front. One attempt is
+ started; if it has not finished after the attempt delay (250ms by default)
+ or it fails, the next one is started alongside it. The first attempt to
+ connect wins and every other attempt is closed.
+ 
+ S is the socket type, tcp::socket or ssl_socket. A fresh socket is made
+ for each attempt with the supplied factory, and the winner is returned.
+ Connect() runs the io_service until the race is over and leaves it ready
+ for further use.
+ */
+template <class S>
+class ookHappyEyeballs
+{
+public:
+	
+	typedef boost::shared_ptr<S> S_ptr;
+	typedef boost::function<S_ptr ()> S_factory;
+	
+	static S_ptr Connect(asio::io_service& io, const vector<tcp::endpoint>& endpoints,
+											 S_factory factory, system::error_code& err,
+											 posix_time::time_duration attemptDelay = posix_time::milliseconds(250))
+	{
+		ookHappyEyeballs<S> race(io, endpoints, factory, attemptDelay);
+		return race.Run(err);
+	}
+	
+protected:
+	
+	ookHappyEyeballs(asio::io_service& io, const vector<tcp::endpoint>& endpoints,
+									 S_factory factory, posix_time::time_duration attemptDelay)
+		: _io(io), _factory(factory), _delay(attemptDelay), _timer(io), _iNext(0)
+	{
+		//Interleave the address families, preferred family first
+		vector<tcp::endpoint> vFirst, vSecond;
+		for(size_t i = 0; i < endpoints.size(); i++)
+		{
+			if(endpoints[i].address().is_v6() == endpoints[0].address().is_v6())
+				vFirst.push_back(endpoints[i]);
+			else
+				vSecond.push_back(endpoints[i]);
+		}
+		
+		for(size_t i = 0; (i < vFirst.size()) || (i < vSecond.size()); i++)
+		{
+			if(i < vFirst.size())
+				_vEndpoints.push_back(vFirst[i]);
+			if(i < vSecond.size())
+				_vEndpoints.push_back(vSecond[i]);
+		}
+	}
+	
+	S_ptr Run(system::error_code& err)
+	{
+		_err = asio::error::host_not_found;
+		
+		this->LaunchNext();
+		
+		_io.reset();
+		_io.run();
+		_io.reset();
+		
+		err = _winner ? system::error_code() : _err;
+		
+		return _winner;
+	}
+	
+	void LaunchNext()
+	{
+		if(_winner || (_iNext >= _vEndpoints.size()))
+			return;
+		
+		size_t idx = _iNext++;
+		
+		_vAttempts.push_back(_factory());
+		_vAttempts.back()->lowest_layer().async_connect(_vEndpoints[idx],
+			boost::bind(&ookHappyEyeballs<S>::OnConnect, this, _vAttempts.size() - 1, asio::placeholders::error));
+		
+		if(_iNext < _vEndpoints.size())
+		{
+			_timer.expires_from_now(_delay);
+			_timer.async_wait(boost::bind(&ookHappyEyeballs<S>::OnTimer, this, asio::placeholders::error));
+		}
+	}
+	
+	void OnTimer(const system::error_code& err)
+	{
+		if(err != asio::error::operation_aborted)
+			this->LaunchNext();
+	}
+	
+	void OnConnect(size_t idx, const system::error_code& err)
+	{
+		if(_winner)
+			return;
+		
+		system::error_code ignored;
+		
+		if(!err)
+		{
+			_winner = _vAttempts[idx];
+			_timer.cancel(ignored);
+			
+			for(size_t i = 0; i < _vAttempts.size(); i++)
+				if(i != idx)
+					_vAttempts[i]->lowest_layer().close(ignored);
+			
+			return;
+		}
+		
+		_err = err;
+		_vAttempts[idx]->lowest_layer().close(ignored);
+		
+		//A failed attempt starts the next one right away rather than waiting out the delay
+		_timer.cancel(ignored);
+		this->LaunchNext();
+	}
+	
+private:
+	
+	asio::io_service& _io;
+	S_factory _factory;
+	posix_time::time_duration _delay;
+	asio::deadline_timer _timer;
+	
+	vector<tcp::endpoint> _vEndpoints;
+	size_t _iNext;
+	
+	vector<S_ptr> _vAttempts;
+	S_ptr _winner;
+	system::error_code _err;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,476 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookKTLS
+ \headerfile ookKTLS.h "ookLibs/ookNet/ookKTLS.h"
+ \brief Hands the transmit side of an established OpenSSL session to the
+ Linux kernel (kTLS), so writes and sendfile() are encrypted in the kernel
+ instead of OpenSSL's user-space record layer.
+ 
+ asio's ssl::stream drives OpenSSL through a memory BIO, so OpenSSL's own
+ SSL_OP_ENABLE_KTLS never sees the socket. Instead the traffic secrets are
+ captured with the keylog callback during the handshake, the record keys
+ are derived from them here, and they are installed with
+ setsockopt(TCP_ULP "tls") and setsockopt(SOL_TLS, TLS_TX).
+ 
+ Supported: TLS 1.2 and 1.3 with AES-128-GCM, AES-256-GCM and
+ ChaCha20-Poly1305. Anything else, a non-Linux build or a kernel without
+ the tls module makes EnableTX() return false, and the caller keeps using
+ OpenSSL for writes.
+ 
+ Only the transmit side moves; reads still go through OpenSSL. Once TX is
+ in the kernel OpenSSL must not write again, so PrepareConnection() turns
+ off TLS 1.3 session tickets (which would advance the record sequence
+ after the handshake) and TLS 1.2 renegotiation. The connection should be
+ closed at the TCP level rather than with an SSL shutdown.
+ */
+#include "ookLibs/ookNet/ookKTLS.h"
+
+#include "openssl/kdf.h"
+#include "boost/thread/once.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#include <sys/socket.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
+//The NSS key log lines captured for each SSL during its handshake, and the
+//keylog callback each context had before ours
+static int s_iKeylogIndex = -1;
+static int s_iChainIndex = -1;
+static boost::once_flag s_keylogOnce = BOOST_ONCE_INIT;
+
+struct ookKTLSChain
+{
+	void (*pPrevious)(const SSL* ssl, const char* line);
+};
+
+static void ookKTLSCleanse(vector<uchar>& v)
+{
+	if(!v.empty())
+		OPENSSL_cleanse(&v[0], v.size());
+}
+
+static void ookKTLSFreeKeylog(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+	string* log = static_cast<string*>(ptr);
+	
+	if(log && !log->empty())
+		OPENSSL_cleanse(&(*log)[0], log->size());
+	
+	delete log;
+}
+
+static void ookKTLSFreeChain(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+{
+	delete static_cast<ookKTLSChain*>(ptr);
+}
+
+static void ookKTLSInitIndexes()
+{
+	s_iKeylogIndex = SSL_get_ex_new_index(0, NULL, NULL, NULL, ookKTLSFreeKeylog);
+	s_iChainIndex = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, ookKTLSFreeChain);
+}
+
+static void ookKTLSKeylogCB(const SSL* ssl, const char* line)
+{
+	string* log = static_cast<string*>(SSL_get_ex_data(ssl, s_iKeylogIndex));
+	
+	if(log == NULL)
+	{
+		log = new string();
+		
+		//Room for a handshake's lines, so appends don't leave copies behind
+		log->reserve(2048);
+		SSL_set_ex_data(const_cast<SSL*>(ssl), s_iKeylogIndex, log);
+	}
+	
+	log->append(line);
+	log->append("\n");
+	
+	//The application's own key logging, if it had any
+	ookKTLSChain* chain = static_cast<ookKTLSChain*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), s_iChainIndex));
+	
+	if(chain && chain->pPrevious)
+		chain->pPrevious(ssl, line);
+}
+
+static bool ookKTLSHexDecode(const char* pHex, size_t iLen, vector<uchar>& out)
+{
+	if(iLen % 2)
+		return false;
+	
+	out.clear();
+	for(size_t i = 0; i < iLen; i += 2)
+	{
+		char digits[3] = { pHex[i], pHex[i + 1], 0 };
+		out.push_back((uchar) strtoul(digits, NULL, 16));
+	}
+	
+	return true;
+}
+
+/*! 
+ \brief Installs the keylog callback kTLS needs on a context. A callback
+ the application set before is still called with every line. Call it
+ once, before any handshake on the context.
+ */
+void ookKTLS::PrepareContext(SSL_CTX* ctx)
+{
+	boost::call_once(s_keylogOnce, ookKTLSInitIndexes);
+	
+	void (*pPrevious)(const SSL* ssl, const char* line) = SSL_CTX_get_keylog_callback(ctx);
+	
+	if(pPrevious == ookKTLSKeylogCB)
+		return;
+	
+	ookKTLSChain* chain = new ookKTLSChain();
+	chain->pPrevious = pPrevious;
+	
+	delete static_cast<ookKTLSChain*>(SSL_CTX_get_ex_data(ctx, s_iChainIndex));
+	SSL_CTX_set_ex_data(ctx, s_iChainIndex, chain);
+	SSL_CTX_set_keylog_callback(ctx, ookKTLSKeylogCB);
+}
+
+/*! 
+ \brief Wipes and frees the secrets captured for ssl. EnableTX() calls it
+ once it has the keys; they would otherwise stay in memory as long as the
+ connection.
+ */
+void ookKTLS::ClearSecrets(SSL* ssl)
+{
+	if(s_iKeylogIndex < 0)
+		return;
+	
+	string* log = static_cast<string*>(SSL_get_ex_data(ssl, s_iKeylogIndex));
+	
+	SSL_set_ex_data(ssl, s_iKeylogIndex, NULL);
+	ookKTLSFreeKeylog(NULL, log, NULL, 0, 0, NULL);
+}
+
+/*! 
+ \brief Per connection settings that keep OpenSSL from writing records
+ after the handshake. Call it before the handshake.
+ */
+void ookKTLS::PrepareConnection(SSL* ssl)
+{
+	SSL_set_num_tickets(ssl, 0);
+	SSL_set_options(ssl, SSL_OP_NO_RENEGOTIATION);
+}
+
+bool ookKTLS::FindSecret(SSL* ssl, string label, vector<uchar>& secret)
+{
+	if(s_iKeylogIndex < 0)
+		return false;
+	
+	string* log = static_cast<string*>(SSL_get_ex_data(ssl, s_iKeylogIndex));
+	if(log == NULL)
+		return false;
+	
+	//Lines are "<label> <client random> <secret>", all hex. Read in place,
+	//so no copies of the secret are left in freed memory.
+	const char* pLog = log->c_str();
+	size_t iLine = 0;
+	
+	while(iLine < log->size())
+	{
+		size_t iEnd = log->find('\n', iLine);
+		if(iEnd == string::npos)
+			iEnd = log->size();
+		
+		size_t iRandom = iLine + label.length();
+		size_t iSecret = log->find(' ', iRandom + 1);
+		
+		if((log->compare(iLine, label.length(), label) == 0) && (iRandom < iEnd) && (pLog[iRandom] == ' ') &&
+			 (iSecret != string::npos) && (iSecret < iEnd))
+			return ookKTLSHexDecode(pLog + iSecret + 1, iEnd - iSecret - 1, secret);
+		
+		iLine = iEnd + 1;
+	}
+	
+	return false;
+}
+
+bool ookKTLS::HKDFExpandLabel(const EVP_MD* md, const vector<uchar>& secret, string label,
+															size_t iLen, vector<uchar>& out)
+{
+	//struct HkdfLabel { uint16 length; opaque label<7..255>; opaque context<0..255>; }
+	string fullLabel = "tls13 " + label;
+	vector<uchar> info;
+	info.push_back((uchar) (iLen >> 8));
+	info.push_back((uchar) (iLen & 0xff));
+	info.push_back((uchar) fullLabel.length());
+	info.insert(info.end(), fullLabel.begin(), fullLabel.end());
+	info.push_back(0);
+	
+	out.resize(iLen);
+	size_t iOutLen = iLen;
+	
+	EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+	bool bOk = (pctx != NULL) &&
+		(EVP_PKEY_derive_init(pctx) > 0) &&
+		(EVP_PKEY_CTX_hkdf_mode(pctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0) &&
+		(EVP_PKEY_CTX_set_hkdf_md(pctx, md) > 0) &&
+		(EVP_PKEY_CTX_set1_hkdf_key(pctx, &secret[0], (int) secret.size()) > 0) &&
+		(EVP_PKEY_CTX_add1_hkdf_info(pctx, &info[0], (int) info.size()) > 0) &&
+		(EVP_PKEY_derive(pctx, &out[0], &iOutLen) > 0) &&
+		(iOutLen == iLen);
+	
+	EVP_PKEY_CTX_free(pctx);
+	
+	return bOk;
+}
+
+bool ookKTLS::TLS12PRF(const EVP_MD* md, const vector<uchar>& secret, string label,
+											 const vector<uchar>& seed, size_t iLen, vector<uchar>& out)
+{
+	out.resize(iLen);
+	size_t iOutLen = iLen;
+	
+	EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, NULL);
+	bool bOk = (pctx != NULL) &&
+		(EVP_PKEY_derive_init(pctx) > 0) &&
+		(EVP_PKEY_CTX_set_tls1_prf_md(pctx, md) > 0) &&
+		(EVP_PKEY_CTX_set1_tls1_prf_secret(pctx, &secret[0], (int) secret.size()) > 0) &&
+		(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, (const uchar*) label.data(), (int) label.length()) > 0) &&
+		(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, &seed[0], (int) seed.size()) > 0) &&
+		(EVP_PKEY_derive(pctx, &out[0], &iOutLen) > 0) &&
+		(iOutLen == iLen);
+	
+	EVP_PKEY_CTX_free(pctx);
+	
+	return bOk;
+}
+
+/*! 
+ \brief Derives the server's transmit key, nonce and record sequence for
+ the session on ssl. Must be called right after the handshake, before any
+ application data has been written through OpenSSL.
+ 
+ \return false if the protocol or cipher is unsupported or the secrets
+ were not captured (PrepareContext() not called).
+ */
+bool ookKTLS::DeriveTXKeys(SSL* ssl, ookKTLSKeys& keys)
+{
+	const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+	if(cipher == NULL)
+		return false;
+	
+	keys.iVersion = SSL_version(ssl);
+	keys.iCipherNid = SSL_CIPHER_get_cipher_nid(cipher);
+	
+	const EVP_MD* md = SSL_CIPHER_get_handshake_digest(cipher);
+	
+	size_t iKeyLen = 0;
+	switch(keys.iCipherNid)
+	{
+		case NID_aes_128_gcm:				iKeyLen = 16; break;
+		case NID_aes_256_gcm:				iKeyLen = 32; break;
+		case NID_chacha20_poly1305:	iKeyLen = 32; break;
+		default:										return false;
+	}
+	
+	bool bChaCha = (keys.iCipherNid == NID_chacha20_poly1305);
+	vector<uchar> fullIV;
+	
+	if(keys.iVersion == TLS1_3_VERSION)
+	{
+		vector<uchar> secret;
+		if(!FindSecret(ssl, "SERVER_TRAFFIC_SECRET_0", secret))
+			return false;
+		
+		bool bOk = HKDFExpandLabel(md, secret, "key", iKeyLen, keys.key) &&
+			HKDFExpandLabel(md, secret, "iv", 12, fullIV);
+		
+		ookKTLSCleanse(secret);
+		
+		if(!bOk)
+			return false;
+		
+		//The handshake is protected by other keys; application data starts at 0
+		keys.recSeq.assign(8, 0);
+	}
+	else if(keys.iVersion == TLS1_2_VERSION)
+	{
+		vector<uchar> master;
+		if(!FindSecret(ssl, "CLIENT_RANDOM", master))
+			return false;
+		
+		//key_block = client key | server key | client IV | server IV (AEAD: no MAC keys)
+		size_t iFixedIVLen = bChaCha ? 12 : 4;
+		vector<uchar> seed(SSL3_RANDOM_SIZE * 2);
+		SSL_get_server_random(ssl, &seed[0], SSL3_RANDOM_SIZE);
+		SSL_get_client_random(ssl, &seed[SSL3_RANDOM_SIZE], SSL3_RANDOM_SIZE);
+		
+		vector<uchar> block;
+		bool bOk = TLS12PRF(md, master, "key expansion", seed, (iKeyLen + iFixedIVLen) * 2, block);
+		
+		ookKTLSCleanse(master);
+		
+		if(!bOk)
+		{
+			ookKTLSCleanse(block);
+			return false;
+		}
+		
+		keys.key.assign(block.begin() + iKeyLen, block.begin() + iKeyLen * 2);
+		fullIV.assign(block.begin() + iKeyLen * 2 + iFixedIVLen, block.begin() + (iKeyLen + iFixedIVLen) * 2);
+		ookKTLSCleanse(block);
+		
+		//The server's Finished went out as record 0 under these keys
+		keys.recSeq.assign(8, 0);
+		keys.recSeq[7] = 1;
+	}
+	else
+		return false;
+	
+	if(bChaCha)
+	{
+		keys.salt.clear();
+		keys.iv = fullIV;
+	}
+	else if(keys.iVersion == TLS1_3_VERSION)
+	{
+		keys.salt.assign(fullIV.begin(), fullIV.begin() + 4);
+		keys.iv.assign(fullIV.begin() + 4, fullIV.end());
+	}
+	else
+	{
+		//TLS 1.2 GCM: 4 byte implicit salt, explicit nonce follows the sequence number
+		keys.salt = fullIV;
+		keys.iv = keys.recSeq;
+	}
+	
+	return true;
+}
+
+/*! 
+ \brief Attaches the kernel TLS ULP to fd and installs the transmit keys.
+ 
+ \return false if the kernel or build has no kTLS support for the session.
+ */
+bool ookKTLS::InstallTX(int fd, const ookKTLSKeys& keys)
+{
+	#ifdef __linux__
+		union
+		{
+			struct tls12_crypto_info_aes_gcm_128 aes128;
+			struct tls12_crypto_info_aes_gcm_256 aes256;
+			#ifdef TLS_CIPHER_CHACHA20_POLY1305
+			struct tls12_crypto_info_chacha20_poly1305 chacha;
+			#endif
+		} info;
+		
+		memset(&info, 0, sizeof(info));
+		socklen_t iInfoLen = 0;
+		
+		unsigned short iVersion = (keys.iVersion == TLS1_3_VERSION) ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+		
+		switch(keys.iCipherNid)
+		{
+			case NID_aes_128_gcm:
+				info.aes128.info.version = iVersion;
+				info.aes128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+				memcpy(info.aes128.key, &keys.key[0], sizeof(info.aes128.key));
+				memcpy(info.aes128.salt, &keys.salt[0], sizeof(info.aes128.salt));
+				memcpy(info.aes128.iv, &keys.iv[0], sizeof(info.aes128.iv));
+				memcpy(info.aes128.rec_seq, &keys.recSeq[0], sizeof(info.aes128.rec_seq));
+				iInfoLen = sizeof(info.aes128);
+				break;
+				
+			case NID_aes_256_gcm:
+				info.aes256.info.version = iVersion;
+				info.aes256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+				memcpy(info.aes256.key, &keys.key[0], sizeof(info.aes256.key));
+				memcpy(info.aes256.salt, &keys.salt[0], sizeof(info.aes256.salt));
+				memcpy(info.aes256.iv, &keys.iv[0], sizeof(info.aes256.iv));
+				memcpy(info.aes256.rec_seq, &keys.recSeq[0], sizeof(info.aes256.rec_seq));
+				iInfoLen = sizeof(info.aes256);
+				break;
+				
+			#ifdef TLS_CIPHER_CHACHA20_POLY1305
+			case NID_chacha20_poly1305:
+				info.chacha.info.version = iVersion;
+				info.chacha.info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+				memcpy(info.chacha.key, &keys.key[0], sizeof(info.chacha.key));
+				memcpy(info.chacha.iv, &keys.iv[0], sizeof(info.chacha.iv));
+				memcpy(info.chacha.rec_seq, &keys.recSeq[0], sizeof(info.chacha.rec_seq));
+				iInfoLen = sizeof(info.chacha);
+				break;
+			#endif
+				
+			default:
+				return false;
+		}
+		
+		if(setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) < 0)
+			return false;
+		
+		bool bOk = (setsockopt(fd, SOL_TLS, TLS_TX, &info, iInfoLen) == 0);
+		
+		//Don't leave key material lying around on the stack
+		OPENSSL_cleanse(&info, sizeof(info));
+		
+		return bOk;
+	#else
+		return false;
+	#endif
+}
+
+/*! 
+ \brief DeriveTXKeys() followed by InstallTX(). The captured secrets are
+ wiped either way; nothing needs them after this.
+ */
+bool ookKTLS::EnableTX(SSL* ssl, int fd)
+{
+	ookKTLSKeys keys;
+	
+	bool bDerived = ookKTLS::DeriveTXKeys(ssl, keys);
+	ookKTLS::ClearSecrets(ssl);
+	
+	bool bOk = bDerived && ookKTLS::InstallTX(fd, keys);
+	
+	ookKTLSCleanse(keys.key);
+	
+	return bOk;
+}
\ No newline at end of file
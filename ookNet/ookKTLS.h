@@ -0,0 +1,78 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_KTLS_H_
+#define OOK_KTLS_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+
+/*!
+ \brief Transmit-side record state pulled out of a finished OpenSSL
+ handshake, in the layout the kernel's TLS_TX socket option wants.
+ */
+struct ookKTLSKeys
+{
+	ookKTLSKeys() : iVersion(0), iCipherNid(0) {}
+	
+	int iVersion;				//TLS1_2_VERSION or TLS1_3_VERSION
+	int iCipherNid;			//NID_aes_128_gcm, NID_aes_256_gcm or NID_chacha20_poly1305
+	
+	vector<uchar> key;
+	vector<uchar> salt;	//Implicit nonce part; empty for ChaCha20-Poly1305
+	vector<uchar> iv;		//Explicit nonce (TLS 1.2 GCM) or the rest of the static IV
+	vector<uchar> recSeq;
+};
+
+class ookKTLS
+{
+public:
+	
+	static void PrepareContext(SSL_CTX* ctx);
+	static void PrepareConnection(SSL* ssl);
+	
+	static bool DeriveTXKeys(SSL* ssl, ookKTLSKeys& keys);
+	static bool InstallTX(int fd, const ookKTLSKeys& keys);
+	static bool EnableTX(SSL* ssl, int fd);
+	static void ClearSecrets(SSL* ssl);
+	
+protected:
+	
+	static bool HKDFExpandLabel(const EVP_MD* md, const vector<uchar>& secret, string label,
+															size_t iLen, vector<uchar>& out);
+	static bool TLS12PRF(const EVP_MD* md, const vector<uchar>& secret, string label,
+											 const vector<uchar>& seed, size_t iLen, vector<uchar>& out);
+	static bool FindSecret(SSL* ssl, string label, vector<uchar>& secret);
+	
+private:
+	
+	ookKTLS();
+};
+
+#endif
\ No newline at end of file
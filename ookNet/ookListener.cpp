@@ -0,0 +1,116 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookListener
+ \headerfile ookListener.h "ookLibs/ookNet/ookListener.h"
+ \brief Opens listening acceptors for ookTCPServer and ookSSLServer.
+ 
+ The address of an ookListenEndpoint selects what gets bound:
+ 
+ - "" or "::" binds every interface as a dual-stack IPv6 socket, so IPv4
+ clients arrive as v4-mapped addresses on the same acceptor. If the host
+ has no IPv6 support this falls back to every IPv4 interface. Set bV6Only
+ to refuse IPv4 clients on "::".
+ - "0.0.0.0" binds every IPv4 interface only.
+ - Any other numeric address binds only that address.
+ */
+#include "ookLibs/ookNet/ookListener.h"
+
+acceptor_ptr ookListener::Open(asio::io_service& io, const ookListenEndpoint& ep)
+{
+	system::error_code err;
+	acceptor_ptr accptr;
+	
+	if(ep.address.empty() || (ep.address == "::"))
+	{
+		accptr = ookListener::Open(io, tcp::endpoint(tcp::v6(), ep.iPort), true, ep.bV6Only, err);
+		
+		//No IPv6 on this host; serve IPv4 rather than nothing
+		if(err && !ep.bV6Only && (err != asio::error::address_in_use))
+			accptr = ookListener::Open(io, tcp::endpoint(tcp::v4(), ep.iPort), false, false, err);
+	}
+	else
+	{
+		asio::ip::address addr = asio::ip::address::from_string(ep.address, err);
+		
+		if(!err)
+			accptr = ookListener::Open(io, tcp::endpoint(addr, ep.iPort), addr.is_v6(), ep.bV6Only, err);
+	}
+	
+	if(err)
+		throw err;
+	
+	return accptr;
+}
+
+acceptor_ptr ookListener::Open(asio::io_service& io, const tcp::endpoint& ep, bool bSetV6Only, bool bV6Only,
+															 system::error_code& err)
+{
+	acceptor_ptr accptr(new tcp::acceptor(io));
+	
+	accptr->open(ep.protocol(), err);
+	
+	if(!err && bSetV6Only)
+		accptr->set_option(asio::ip::v6_only(bV6Only), err);
+	
+	if(!err)
+		accptr->set_option(tcp::acceptor::reuse_address(true), err);
+	
+	if(!err)
+		accptr->bind(ep, err);
+	
+	if(!err)
+		accptr->listen(asio::socket_base::max_connections, err);
+	
+	if(err)
+	{
+		system::error_code ignored;
+		accptr->close(ignored);
+		accptr.reset();
+	}
+	
+	return accptr;
+}
+
+/*! 
+ \brief Formats an endpoint's address for logging, showing IPv4 clients
+ of a dual-stack acceptor as plain IPv4 rather than ::ffff:a.b.c.d.
+ */
+string ookListener::AddressToString(const tcp::endpoint& ep)
+{
+	asio::ip::address addr = ep.address();
+	
+	if(addr.is_v6() && addr.to_v6().is_v4_mapped())
+		return addr.to_v6().to_v4().to_string();
+	
+	return addr.to_string();
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_LISTENER_H_
+#define OOK_LISTENER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+
+/*!
+ \brief One address/port pair a server listens on.
+ */
+struct ookListenEndpoint
+{
+	ookListenEndpoint(string addr = "", int port = 0, bool v6Only = false)
+		: address(addr), iPort(port), bV6Only(v6Only) {}
+	
+	string address;
+	int iPort;
+	bool bV6Only;
+};
+
+class ookListener
+{
+public:
+	
+	static acceptor_ptr Open(asio::io_service& io, const ookListenEndpoint& ep);
+	static string AddressToString(const tcp::endpoint& ep);
+	
+protected:
+	
+	static acceptor_ptr Open(asio::io_service& io, const tcp::endpoint& ep, bool bSetV6Only, bool bV6Only,
+													 system::error_code& err);
+	
+private:
+	
+	ookListener();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,339 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ookLibs/ookNet/ookMsgBridge.h"
+#include "ookLibs/ookNet/ookListener.h"
+#include "ookLibs/ookNet/ookResolver.h"
+#include "ookLibs/ookNet/ookHappyEyeballs.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+/*!
+ \class ookMsgBridge
+ \headerfile ookMsgBridge.h "ookLibs/ookNet/ookMsgBridge.h"
+ \brief Links a local ookMsgDispatcher with the dispatchers of other
+ processes, so observers get messages published in any of them.
+ 
+ \code
+ 
+ //Process A: publishes quotes, listens for bridges on 1400
+ ookMsgBridge bridge(&dispatcher, 1400);
+ bridge.RegisterType<ookQuoteMessage>();
+ bridge.Start();
+ 
+ //Process B: wants A's quotes for one symbol
+ ookMsgBridge bridge(&dispatcher);
+ bridge.RegisterType<ookQuoteMessage>();
+ bridge.Subscribe<ookQuoteMessage>("quotes.MSFT.#");
+ bridge.Connect("a.example.com", 1400);
+ 
+ \endcode
+ 
+ Subscribe() asks every connected peer, and every peer that connects
+ later, to forward the messages of a type, or with a topic matching a
+ pattern, or both. Each peer registers an observer for it on its own
+ dispatcher, and what that observer is delivered is queued and sent over
+ in batches (see ookBridgePeer). Messages that arrive are posted to our
+ dispatcher like any other, so observers can't tell them from local ones.
+ 
+ Nothing about a local post changes: the dispatcher calls its observers
+ as before, and a peer's observer is just one more, which queues the
+ message and returns. Messages are sent only by the process that
+ published them, never relayed, so every process that wants them needs a
+ bridge to the publisher.
+ 
+ A peer that can't keep up loses its oldest queued messages rather than
+ slowing the publisher down. SetQueueSize() with OOK_OVERFLOW_BLOCK opts
+ into backpressure instead: publishing then waits for room, so a stalled
+ peer stalls every thread that posts to the dispatcher, pool workers
+ included.
+ 
+ Both ends must register the same message classes, which need an
+ OOK_MESSAGE_TYPE() and an OOK_MSG_SCHEMA(). Register them before Start()
+ and Connect(); the codec registry isn't locked. The dispatcher must
+ outlive the bridge.
+ */
+ookMsgBridge::ookMsgBridge(ookMsgDispatcher* dispatcher, int iPort)
+	: _dispatcher(dispatcher), _iPort(iPort), _lNextId(1), _iQueueSize(4096), _policy(OOK_OVERFLOW_DROP_OLDEST)
+{
+	
+}
+
+ookMsgBridge::~ookMsgBridge()
+{
+	try
+	{
+		this->Stop();
+		this->Join();
+		
+		vector<bridge_peer_ptr> vPeers;
+		
+		{
+			boost::mutex::scoped_lock lock(_peerMut);
+			vPeers.swap(_vPeers);
+		}
+		
+		for(size_t i = 0; i < vPeers.size(); i++)
+			vPeers[i]->Stop();
+		
+		//The peers' observers are unregistered by the time they're joined
+		for(size_t i = 0; i < vPeers.size(); i++)
+			vPeers[i]->Join();
+	}
+	catch (...)
+	{
+	}
+}
+
+/*! 
+ \brief The message classes the bridge can send and receive. A message
+ whose own class isn't registered goes out as its nearest registered
+ parent.
+ */
+ookMsgCodecRegistry& ookMsgBridge::GetCodecs()
+{
+	return _codecs;
+}
+
+/*! 
+ \brief Asks our peers for messages of the type called typeName, with a
+ topic matching the pattern topic. An empty type name takes every
+ registered type, and an empty topic any topic or none.
+ 
+ \return an id for Unsubscribe().
+ */
+long ookMsgBridge::Subscribe(const string& typeName, const string& topic)
+{
+	if(!topic.empty() && !ookTopicTrie::IsValidPattern(topic))
+		throw ookException("ookMsgBridge::Subscribe: bad topic pattern");
+	
+	boost::mutex::scoped_lock lock(_peerMut);
+	
+	long lId = _lNextId++;
+	
+	ookBridgeSub& sub = _subs[lId];
+	sub.typeName = typeName;
+	sub.topic = topic;
+	
+	for(size_t i = 0; i < _vPeers.size(); i++)
+		_vPeers[i]->SendSubscribe(lId, typeName, topic);
+	
+	return lId;
+}
+
+bool ookMsgBridge::Unsubscribe(long lId)
+{
+	boost::mutex::scoped_lock lock(_peerMut);
+	
+	if(_subs.erase(lId) == 0)
+		return false;
+	
+	for(size_t i = 0; i < _vPeers.size(); i++)
+		_vPeers[i]->SendUnsubscribe(lId);
+	
+	return true;
+}
+
+/*! 
+ \brief Connects to the bridge listening at host:iPort and starts
+ exchanging messages with it. Blocks until the connection is made.
+ 
+ \return false if no address for host could be reached.
+ */
+bool ookMsgBridge::Connect(const string& host, int iPort)
+{
+	system::error_code err;
+	
+	vector<tcp::endpoint> endpoints = ookResolver::Instance().Resolve(host, ookString::ConvertInt2String(iPort), err);
+	
+	if(err)
+	{
+		std::cerr << "Something bad happened in ookMsgBridge::Connect: " << err.message() << "\n";
+		return false;
+	}
+	
+	socket_ptr sock;
+	
+	{
+		//ookHappyEyeballs runs the io_service it's given until it's done
+		boost::mutex::scoped_lock lock(_connectMut);
+		
+		sock = ookHappyEyeballs<tcp::socket>::Connect(_connectService, endpoints, 
+																									boost::bind(&ookMsgBridge::CreateSocket, this), err);
+	}
+	
+	if(err)
+	{
+		std::cerr << "Something bad happened in ookMsgBridge::Connect: " << err.message() << "\n";
+		return false;
+	}
+	
+	sock->set_option(tcp::no_delay(true), err);
+	
+	this->AddPeer(sock);
+	
+	return true;
+}
+
+/*! 
+ \brief Bounds each peer's outgoing queue, and says what publishing to a
+ peer whose queue is full does; OOK_OVERFLOW_DROP_OLDEST to begin with.
+ Applies to peers that connect from now on.
+ */
+void ookMsgBridge::SetQueueSize(size_t iSize, ookOverflowPolicy policy)
+{
+	boost::mutex::scoped_lock lock(_peerMut);
+	
+	_iQueueSize = iSize;
+	_policy = policy;
+}
+
+ookMsgDispatcher* ookMsgBridge::GetDispatcher()
+{
+	return _dispatcher;
+}
+
+/*! 
+ \brief The connected peers, for their counters.
+ */
+vector<bridge_peer_ptr> ookMsgBridge::GetPeers()
+{
+	boost::mutex::scoped_lock lock(_peerMut);
+	
+	this->CleanPeers();
+	
+	return _vPeers;
+}
+
+size_t ookMsgBridge::GetPeerCount()
+{
+	boost::mutex::scoped_lock lock(_peerMut);
+	
+	this->CleanPeers();
+	
+	return _vPeers.size();
+}
+
+socket_ptr ookMsgBridge::CreateSocket()
+{
+	return socket_ptr(new tcp::socket(_connectService));
+}
+
+//Sends the new peer our subscriptions and starts it, all under _peerMut so
+//a Subscribe() racing with it reaches the peer exactly once
+void ookMsgBridge::AddPeer(socket_ptr sock)
+{
+	bridge_peer_ptr peer(new ookBridgePeer(this, sock));
+	
+	boost::mutex::scoped_lock lock(_peerMut);
+	
+	this->CleanPeers();
+	
+	peer->SetQueueSize(_iQueueSize, _policy);
+	
+	std::map<long, ookBridgeSub>::iterator it;
+	for(it = _subs.begin(); it != _subs.end(); it++)
+		peer->SendSubscribe(it->first, it->second.typeName, it->second.topic);
+	
+	_vPeers.push_back(peer);
+	peer->Start();
+}
+
+/*
+ Drops peers whose Run() has returned. A peer is kept until then even once
+ it is stopping, since its own thread must not be the one to delete it.
+ Called with _peerMut held.
+ */
+void ookMsgBridge::CleanPeers()
+{
+	for(size_t i = 0; i < _vPeers.size(); )
+	{
+		if(!_vPeers[i]->IsRunning() && _vPeers[i]->Join(boost::chrono::nanoseconds(0)))
+			_vPeers.erase(_vPeers.begin() + i);
+		else
+			i++;
+	}
+}
+
+//Run() spends its life in the io_service, so stopping that ends it
+void ookMsgBridge::OnStop()
+{
+	_ioService.stop();
+}
+
+void ookMsgBridge::Accept()
+{
+	socket_ptr sock(new tcp::socket(_ioService));
+	_acceptor->async_accept(*sock, boost::bind(&ookMsgBridge::HandleAccept, this, sock, asio::placeholders::error));
+}
+
+void ookMsgBridge::HandleAccept(socket_ptr sock, const system::error_code& err)
+{
+	if(!err)
+	{
+		system::error_code epErr;
+		cout << "Accepted new bridge from " << ookListener::AddressToString(sock->remote_endpoint(epErr)) << endl;
+		
+		sock->set_option(tcp::no_delay(true), epErr);
+		
+		this->AddPeer(sock);
+	}
+	
+	if(this->IsRunning() && (err != asio::error::operation_aborted))
+		this->Accept();
+}
+
+/*! 
+ \brief Accepts bridges on the port given to the constructor. Without a
+ port there is nothing to do here; Connect() works without Start().
+ */
+void ookMsgBridge::Run()
+{
+	if(_iPort <= 0)
+		return;
+	
+	try
+	{
+		_acceptor = ookListener::Open(_ioService, ookListenEndpoint("", _iPort));
+		
+		cout << "Bridge listening on " << _acceptor->local_endpoint() << endl;
+		
+		this->Accept();
+		
+		_ioService.run();
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Something bad happened in ookMsgBridge::Run: " << e.message() << "\n";
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookMsgBridge::Run: " << e.what() << "\n";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MSG_BRIDGE_H_
+#define OOK_MSG_BRIDGE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookCore/ookMsgDispatcher.h"
+#include "ookLibs/ookCore/ookMsgMailbox.h"
+#include "ookLibs/ookThread/ookThread.h"
+#include "ookLibs/ookCore/ookMsgCodecRegistry.h"
+#include "ookLibs/ookNet/ookBridgePeer.h"
+
+#include <map>
+
+class ookMsgBridge : public ookThread
+{
+public:
+	
+	ookMsgBridge(ookMsgDispatcher* dispatcher, int iPort = 0);
+	virtual ~ookMsgBridge();
+	
+	template <class M>
+	void RegisterType()
+	{
+		_codecs.RegisterType<M>();
+	}
+	
+	ookMsgCodecRegistry& GetCodecs();
+	
+	template <class M>
+	long Subscribe(const string& topic = "")
+	{
+		return this->Subscribe(M::StaticType()->GetName(), topic);
+	}
+	
+	long Subscribe(const string& typeName, const string& topic);
+	bool Unsubscribe(long lId);
+	
+	bool Connect(const string& host, int iPort);
+	
+	void SetQueueSize(size_t iSize, ookOverflowPolicy policy = OOK_OVERFLOW_DROP_OLDEST);
+	
+	ookMsgDispatcher* GetDispatcher();
+	vector<bridge_peer_ptr> GetPeers();
+	size_t GetPeerCount();
+	
+protected:
+	
+	virtual void Run();
+	virtual void OnStop();
+	
+	void Accept();
+	void HandleAccept(socket_ptr sock, const system::error_code& err);
+	
+	socket_ptr CreateSocket();
+	void AddPeer(socket_ptr sock);
+	void CleanPeers();
+	
+private:
+	
+	ookMsgDispatcher* _dispatcher;
+	int _iPort;
+	
+	asio::io_service _ioService;
+	acceptor_ptr _acceptor;
+	
+	//Outgoing connections are raced on their own io_service, see Connect()
+	asio::io_service _connectService;
+	boost::mutex _connectMut;
+	
+	ookMsgCodecRegistry _codecs;
+	
+	//Our subscriptions, which every peer is sent when it connects
+	struct ookBridgeSub
+	{
+		string typeName;
+		string topic;
+	};
+	
+	boost::mutex _peerMut;
+	vector<bridge_peer_ptr> _vPeers;
+	std::map<long, ookBridgeSub> _subs;
+	long _lNextId;
+	
+	size_t _iQueueSize;
+	ookOverflowPolicy _policy;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,259 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookResolver
+ \headerfile ookResolver.h "ookLibs/ookNet/ookResolver.h"
+ \brief Asynchronous host name resolver with an in-process cache shared
+ by every client.
+ 
+ Lookups run on a small pool of background threads (OOK_RESOLVER_THREADS),
+ so a slow or dead resolver never blocks a caller that already has an answer
+ cached, and one hung query does not hold up lookups of other hosts. Only
+ OOK_RESOLVER_THREADS hung queries at once can delay the rest. Cached answers are
+ served until they expire; after that they are still served (stale) while a
+ single refresh runs in the background. Only a host that has never resolved
+ makes the caller wait, and then for at most the configured timeout.
+ Concurrent lookups of the same host share one query.
+ 
+ getaddrinfo() does not report record TTLs, so entries live for a
+ configurable TTL (60 seconds by default). Failures are cached for the
+ negative TTL (5 seconds by default) so reconnect loops do not hammer DNS.
+ 
+ Numeric addresses are returned immediately and never cached.
+ */
+#include "ookLibs/ookNet/ookResolver.h"
+
+ookResolver::ookResolver()
+	: _work(new asio::io_service::work(_ioService)),
+		_ttl(posix_time::seconds(60)), _negativeTTL(posix_time::seconds(5)),
+		_timeout(posix_time::seconds(5))
+{
+	//asio's async_resolve() funnels every query through one internal thread,
+	//so run blocking lookups on our own threads instead
+	for(int i = 0; i < OOK_RESOLVER_THREADS; i++)
+		_workers.create_thread(boost::bind(&asio::io_service::run, &_ioService));
+}
+
+ookResolver::~ookResolver()
+{
+	try
+	{
+		_work.reset();
+		_ioService.stop();
+		_workers.join_all();
+	}
+	catch(...)
+	{
+	}
+}
+
+/*! 
+ \brief Returns the process wide resolver shared by ookTCPClient and
+ ookSSLClient.
+ */
+ookResolver& ookResolver::Instance()
+{
+	static ookResolver instance;
+	return instance;
+}
+
+void ookResolver::SetTTL(long lSeconds)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_ttl = posix_time::seconds(lSeconds);
+}
+
+void ookResolver::SetNegativeTTL(long lSeconds)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_negativeTTL = posix_time::seconds(lSeconds);
+}
+
+void ookResolver::SetTimeout(long lMillis)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	_timeout = posix_time::milliseconds(lMillis);
+}
+
+void ookResolver::Flush()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	//Keep entries with a query in flight so their waiters still get woken
+	std::map<string, ookResolverEntry>::iterator it = _cache.begin();
+	while(it != _cache.end())
+	{
+		if(it->second.bPending)
+			++it;
+		else
+			_cache.erase(it++);
+	}
+}
+
+/*! 
+ \brief Resolves host and port to a list of endpoints.
+ 
+ \param host	Host name or numeric IPv4/IPv6 address.
+ \param port	Service name or port number.
+ \param err	Set if no endpoints could be found within the timeout.
+ 
+ \return The endpoints in the order the system resolver returned them.
+ */
+vector<tcp::endpoint> ookResolver::Resolve(string host, string port, system::error_code& err)
+{
+	vector<tcp::endpoint> vRet;
+	err = system::error_code();
+	
+	//Literal addresses need no lookup at all
+	system::error_code addrErr;
+	asio::ip::address addr = asio::ip::address::from_string(host, addrErr);
+	if(!addrErr)
+	{
+		vRet.push_back(tcp::endpoint(addr, (unsigned short) atoi(port.c_str())));
+		return vRet;
+	}
+	
+	string key = host + ":" + port;
+	posix_time::ptime now = posix_time::microsec_clock::universal_time();
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	ookResolverEntry& entry = _cache[key];
+	
+	if(!entry.endpoints.empty())
+	{
+		//Serve what we have; refresh in the background if it is stale
+		if((now >= entry.expires) && !entry.bPending)
+			this->StartLookup(key, host, port);
+		
+		return entry.endpoints;
+	}
+	
+	if(!entry.bPending && entry.error && (now < entry.expires))
+	{
+		err = entry.error;
+		return vRet;
+	}
+	
+	if(!entry.bPending)
+		this->StartLookup(key, host, port);
+	
+	posix_time::ptime deadline = now + _timeout;
+	
+	while(entry.bPending)
+	{
+		if(!_cond.timed_wait(lock, deadline))
+			break;
+	}
+	
+	if(!entry.endpoints.empty())
+		vRet = entry.endpoints;
+	else if(entry.bPending)
+		err = asio::error::timed_out;
+	else
+		err = entry.error;
+	
+	return vRet;
+}
+
+/*! 
+ \brief Starts a background lookup so a later Resolve() finds the answer
+ already cached.
+ */
+void ookResolver::Prefetch(string host, string port)
+{
+	system::error_code addrErr;
+	asio::ip::address::from_string(host, addrErr);
+	if(!addrErr)
+		return;
+	
+	string key = host + ":" + port;
+	posix_time::ptime now = posix_time::microsec_clock::universal_time();
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	ookResolverEntry& entry = _cache[key];
+	
+	if(!entry.bPending && (entry.expires.is_not_a_date_time() || (now >= entry.expires)))
+		this->StartLookup(key, host, port);
+}
+
+//Must be called with _mut held
+void ookResolver::StartLookup(string key, string host, string port)
+{
+	_cache[key].bPending = true;
+	
+	_ioService.post(boost::bind(&ookResolver::Lookup, this, key, host, port));
+}
+
+//Runs on a pool thread; blocks in getaddrinfo()
+void ookResolver::Lookup(string key, string host, string port)
+{
+	tcp::resolver resolver(_ioService);
+	tcp::resolver::query query(host, port);
+	system::error_code err;
+	tcp::resolver::iterator it = resolver.resolve(query, err);
+	
+	this->OnResolve(key, err, it);
+}
+
+void ookResolver::OnResolve(string key, const system::error_code& err, tcp::resolver::iterator it)
+{
+	posix_time::ptime now = posix_time::microsec_clock::universal_time();
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	ookResolverEntry& entry = _cache[key];
+	entry.bPending = false;
+	
+	vector<tcp::endpoint> vFound;
+	if(!err)
+	{
+		for(tcp::resolver::iterator end; it != end; ++it)
+			vFound.push_back(it->endpoint());
+	}
+	
+	if(!vFound.empty())
+	{
+		entry.endpoints = vFound;
+		entry.error = system::error_code();
+		entry.expires = now + _ttl;
+	}
+	else
+	{
+		//Keep serving any stale answer, but do not retry until the negative TTL passes
+		entry.error = err ? err : asio::error::host_not_found;
+		entry.expires = now + _negativeTTL;
+	}
+	
+	_cond.notify_all();
+}
\ No newline at end of file
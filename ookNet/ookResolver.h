@@ -0,0 +1,95 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_RESOLVER_H_
+#define OOK_RESOLVER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+
+#include "boost/thread.hpp"
+#include "boost/scoped_ptr.hpp"
+
+#include <map>
+
+#define OOK_RESOLVER_THREADS 4
+
+/*!
+ \brief A cached lookup. Endpoints are kept past their expiry so they can
+ be served while a refresh is in flight.
+ */
+struct ookResolverEntry
+{
+	ookResolverEntry() : bPending(false) {}
+	
+	vector<tcp::endpoint> endpoints;
+	system::error_code error;
+	posix_time::ptime expires;
+	bool bPending;
+};
+
+class ookResolver
+{
+public:
+	
+	ookResolver();
+	virtual ~ookResolver();
+	
+	static ookResolver& Instance();
+	
+	vector<tcp::endpoint> Resolve(string host, string port, system::error_code& err);
+	void Prefetch(string host, string port);
+	void Flush();
+	
+	void SetTTL(long lSeconds);
+	void SetNegativeTTL(long lSeconds);
+	void SetTimeout(long lMillis);
+	
+protected:
+	
+	void StartLookup(string key, string host, string port);
+	void Lookup(string key, string host, string port);
+	void OnResolve(string key, const system::error_code& err, tcp::resolver::iterator it);
+	
+private:
+	
+	asio::io_service _ioService;
+	boost::scoped_ptr<asio::io_service::work> _work;
+	boost::thread_group _workers;
+	
+	boost::mutex _mut;
+	boost::condition_variable _cond;
+	std::map<string, ookResolverEntry> _cache;
+	
+	posix_time::time_duration _ttl;
+	posix_time::time_duration _negativeTTL;
+	posix_time::time_duration _timeout;
+};
+
+#endif
\ No newline at end of file
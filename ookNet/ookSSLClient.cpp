@@ -42,6 +42,7 @@ ookSSLClient::~ookSSLClient()
 	try
 	{
 		this->Stop();		
+		this->Join();
 	}
 	catch(...)
 	{
@@ -192,31 +193,31 @@ string ookSSLClient::Read()
 		system::error_code error;	
 	
 		//Fetch the message header which sets out the size of the upcoming message
-		char* hdrBuf = new char[messageHeaderSize];
+		boost::scoped_array<char> hdrBuf(new char[messageHeaderSize + 1]);
 	
-		long iRead = _sock->read_some(asio::buffer(hdrBuf, messageHeaderSize), error);	
+		long iRead = asio::read(*_sock, asio::buffer(hdrBuf.get(), messageHeaderSize), error);	
 	
 		if((iRead == 0) || (iRead != messageHeaderSize) || error)
 			throw error;
 	
 		hdrBuf[messageHeaderSize] = '\0';
 	
-		messageSize = atoi(hdrBuf);
+		messageSize = atoi(hdrBuf.get());
 	
 		if(messageSize <= 0)
 			throw error;
 	
 		//Now fetch the message
-		char* msgBuf = new char[messageSize];
+		boost::scoped_array<char> msgBuf(new char[messageSize + 1]);
 	
-		iRead = _sock->read_some(asio::buffer(msgBuf, messageSize), error);	
+		iRead = asio::read(*_sock, asio::buffer(msgBuf.get(), messageSize), error);	
 	
 		if((iRead == 0) || (iRead != messageSize) || error)
 			throw error;	
 	
 		msgBuf[messageSize] = '\0';
 	
-		ret = msgBuf;
+		ret.assign(msgBuf.get(), messageSize);
 	}
 	catch (system::error_code& e)
 	{
@@ -291,25 +292,66 @@ bool ookSSLClient::DoHandshake()
 	return false;
 }
 
+ssl_socket_ptr ookSSLClient::CreateSocket()
+{
+	return ssl_socket_ptr(new ssl_socket(_io_service, _context));
+}
+
+void ookSSLClient::OnConnect()
+{
+	//Override to do any work once the handshake is done, e.g. send a greeting
+}
+
+/*
+ Wakes a Read() blocked in OpenSSL by shutting down the TCP socket under
+ it; see ookTCPClient::OnStop().
+ */
+void ookSSLClient::OnStop()
+{
+	boost::mutex::scoped_lock lock(_sockMut);
+	
+	if(_sock)
+	{
+		system::error_code err;
+		_sock->lowest_layer().shutdown(tcp::socket::shutdown_both, err);
+	}
+}
+
 void ookSSLClient::Run()
 {
 	try 
 	{	
-		tcp::resolver resolver(_io_service);
-		tcp::resolver::query query(tcp::v4(), _ipaddr, ookString::ConvertInt2String(_iPort));
-		tcp::resolver::iterator iterator = resolver.resolve(query);
+		system::error_code err;
+		
+		vector<tcp::endpoint> endpoints = ookResolver::Instance().Resolve(_ipaddr, ookString::ConvertInt2String(_iPort), err);
+		
+		if(err)
+			throw err;
 	
 //		_context.set_verify_mode(boost::asio::ssl::context::verify_none); 
 //		_context.load_verify_file("ca.pem");		
 	
-		_sock = boost::shared_ptr<ssl_socket>(new ssl_socket(_io_service, _context));	
+		ssl_socket_ptr sock = ookHappyEyeballs<ssl_socket>::Connect(_io_service, endpoints, 
+																																boost::bind(&ookSSLClient::CreateSocket, this), err);
 		
-		_sock->lowest_layer().connect(*iterator);	
+		if(err)
+			throw err;
+		
+		{
+			boost::mutex::scoped_lock lock(_sockMut);
+			_sock = sock;
+		}
+		
+		//Stop() may have come in while we were connecting
+		if(!this->IsRunning())
+			return;
 	
 		if(this->DoHandshake())
 		{
 			try
 			{
+				this->OnConnect();
+				
 				while(this->IsRunning())
 				{
 					this->HandleMsg(this->Read());
@@ -37,6 +37,8 @@
 #include "ookLibs/ookCore/ookMsgObserver.h"
 #include "ookLibs/ookThread/ookThread.h"
 #include "ookLibs/ookNet/ookSSLServerThread.h"
+#include "ookLibs/ookNet/ookResolver.h"
+#include "ookLibs/ookNet/ookHappyEyeballs.h"
 
 class ookSSLClient  : public ookThread
 {
@@ -69,15 +71,20 @@ public:
 protected:
 
 		virtual bool DoHandshake();
+		virtual void OnConnect();
+		virtual void OnStop();
+		ssl_socket_ptr CreateSocket();
 	
 private:
 
 	string	_ipaddr;
 	int			_iPort;
 	
-	ssl_socket_ptr _sock;
+	//The io_service and context must outlive the socket, so they are declared first
 	asio::io_service _io_service;
 	asio::ssl::context _context;
+	ssl_socket_ptr _sock;
+	boost::mutex _sockMut;
 };
 
 
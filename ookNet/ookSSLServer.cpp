@@ -31,8 +31,9 @@
 #include "ookLibs/ookNet/ookSSLServer.h"
 
 ookSSLServer::ookSSLServer(int iPort, base_method mthd)
-	: _iPort(iPort), _context(_io_service, mthd)
+	: _iPort(iPort), _bKTLS(false), _bBinary(false), _pThreadPool(NULL), _context(_io_service, mthd)
 {	
+	//_dispatcher owns the observer and deletes it along with the server
 	_dispatcher.RegisterObserver(new ookMsgObserver<ookSSLServer, ookTextMessage>(this, &ookSSLServer::HandleMsg));
 }
 
@@ -41,6 +42,11 @@ ookSSLServer::~ookSSLServer()
 	try
 	{
 		this->Stop();
+		this->Join();
+		
+		//Connection threads post to _dispatcher, which is destroyed before
+		//the thread list, so stop and join them now
+		_vServerThreads.clear();
 	}
 	catch (...)
 	{
@@ -154,6 +160,61 @@ void ookSSLServer::UseTmpDHFile(string filename)
 		throw err;
 }
 
+/*! 
+ \brief Offloads record encryption for writes to the kernel (kTLS) on
+ connections accepted from now on. Connections fall back to OpenSSL when
+ the kernel or negotiated cipher doesn't support it; see ookKTLS.
+ */
+void ookSSLServer::SetKTLS(bool bKTLS)
+{
+	if(bKTLS)
+		ookKTLS::PrepareContext(_context.native_handle());
+
+	_bKTLS = bKTLS;
+}
+
+/*! 
+ \brief Posts frames as ookBinaryMessages; see ookTCPServer::SetBinary().
+ */
+void ookSSLServer::SetBinary(bool bBinary)
+{
+	_bBinary = bBinary;
+}
+
+/*! 
+ \brief Runs connection threads on pool; see ookTCPServer::SetThreadPool().
+ */
+void ookSSLServer::SetThreadPool(ookExecutor* pool)
+{
+	_pThreadPool = pool;
+}
+
+/*! 
+ \brief See ookTCPServer::SetConnectionThreadOptions().
+ */
+void ookSSLServer::SetConnectionThreadOptions(const ookThreadOptions& opts)
+{
+	_connOptions = opts;
+}
+
+/*! 
+ \brief See ookTCPServer::GetDispatcher().
+ */
+ookMsgDispatcher* ookSSLServer::GetDispatcher()
+{
+	return &_dispatcher;
+}
+
+/*
+ Listen endpoints work as in ookTCPServer: by default the server listens
+ dual-stack on every interface on the constructor's port, and adding
+ endpoints replaces that default. Endpoints must be added before Start().
+ */
+void ookSSLServer::AddListenEndpoint(string address, int iPort, bool bV6Only)
+{
+	_vListenEndpoints.push_back(ookListenEndpoint(address, iPort, bV6Only));
+}
+
 ssl_thread_ptr ookSSLServer::GetServerThread(ssl_socket_ptr sock)
 {
 	ssl_thread_ptr thrd(new ookSSLServerThread(sock, &_dispatcher));
@@ -206,36 +267,67 @@ void ookSSLServer::HandleMsg(ookTextMessage* msg)
 	cout << "Received message: " << msg->GetMsg() << endl;
 }
 
+//Run() spends its life in the io_service, so stopping that ends it
+void ookSSLServer::OnStop()
+{
+	_io_service.stop();
+}
+
+void ookSSLServer::Accept(acceptor_ptr accptr)
+{
+	ssl_socket_ptr sock = boost::shared_ptr<ssl_socket>(new ssl_socket(_io_service, _context));
+	accptr->async_accept(sock->lowest_layer(), boost::bind(&ookSSLServer::HandleAccept, this, accptr, sock, asio::placeholders::error));
+}
+
+void ookSSLServer::HandleAccept(acceptor_ptr accptr, ssl_socket_ptr sock, const system::error_code& err)
+{
+	if(!err)
+	{
+		system::error_code epErr;
+		cout << "Accepted new client from " << ookListener::AddressToString(sock->lowest_layer().remote_endpoint(epErr)) << endl;			
+		
+		//Declare a server thread and start it up
+		ssl_thread_ptr thrd = this->GetServerThread(sock);
+		thrd->SetKTLS(_bKTLS);
+		thrd->SetBinary(_bBinary);
+		thrd->SetOptions(_connOptions);
+		
+		if(_pThreadPool)
+			thrd->Start(*_pThreadPool);
+		else
+			thrd->Start();	
+	}
+	
+	if(this->IsRunning() && (err != asio::error::operation_aborted))
+		this->Accept(accptr);
+}
+
 void ookSSLServer::Run()
 {
 	try
 	{
-
-		tcp::acceptor accptr(_io_service, tcp::endpoint(tcp::v4(), _iPort));
+		vector<ookListenEndpoint> vEndpoints = _vListenEndpoints;
 		
-		//Now that the context and acceptor are initialized, we can start the io service
-		//_io_service.run();
+		if(vEndpoints.empty())
+			vEndpoints.push_back(ookListenEndpoint("", _iPort));
 		
-		while(this->IsRunning())
-		{			
-			boost::system::error_code err;
-
-			ssl_socket_ptr sock = boost::shared_ptr<ssl_socket>(new ssl_socket(_io_service, _context));
-			accptr.accept(sock->lowest_layer(), err);
-			
-			asio::ip::tcp::endpoint remote_ep = sock->lowest_layer().remote_endpoint();
+		//Every acceptor runs on our one io_service, so accepts from all of
+		//them are handled on this thread and share the server thread list
+		for(size_t i = 0; i < vEndpoints.size(); i++)
+		{
+			acceptor_ptr accptr = ookListener::Open(_io_service, vEndpoints[i]);
+			_vAcceptors.push_back(accptr);
 			
-			cout << "Accepted new client from " << remote_ep.address().to_string() << endl;			
+			cout << "Listening on " << accptr->local_endpoint() << endl;
 			
-			if(!err)
-			{
-				//Declare a server thread and start it up
-				ssl_thread_ptr thrd = this->GetServerThread(sock);
-				thrd->Start();	
-			}
+			this->Accept(accptr);
 		}
 		
-		//_io_service.stop();
+		_io_service.run();
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Something bad happened in ookSSLServer::Run: " << e.message() << endl;
 	}
 	catch (std::exception& e)
 	{
@@ -38,6 +38,7 @@
 //#include "ookLibs/ookCrypt/ookSSLContext.h"
 #include "ookLibs/ookThread/ookThread.h"
 #include "ookLibs/ookNet/ookSSLServerThread.h"
+#include "ookLibs/ookNet/ookListener.h"
 
 typedef boost::shared_ptr<ookSSLServerThread> ssl_thread_ptr;
 
@@ -51,6 +52,8 @@ public:
 	ookSSLServer(int iPort, base_method mthd = asio::ssl::context_base::sslv23);
 	virtual ~ookSSLServer();
 
+	void AddListenEndpoint(string address, int iPort, bool bV6Only = false);
+
 	virtual void HandleMsg(ookTextMessage* msg);
 	virtual void Run();
 
@@ -69,19 +72,40 @@ public:
 	void UseRSAPrivateKeyFile(string filename, base_file_format frmt);
 	void UseTmpDHFile(string filename);
 
+	void SetKTLS(bool bKTLS);
+	void SetBinary(bool bBinary);
+	void SetThreadPool(ookExecutor* pool);
+	void SetConnectionThreadOptions(const ookThreadOptions& opts);
+	
+	ookMsgDispatcher* GetDispatcher();
+
 protected:
 
 	virtual ssl_thread_ptr GetServerThread(ssl_socket_ptr sock);
 	vector<ssl_thread_ptr>& GetServerThreads();
 	void CleanServerThreads();
 
+	virtual void OnStop();
+	
+	void Accept(acceptor_ptr accptr);
+	void HandleAccept(acceptor_ptr accptr, ssl_socket_ptr sock, const system::error_code& err);
+
 	int			_iPort;	
-	vector<ssl_thread_ptr> _vServerThreads;
-	ookMsgDispatcher _dispatcher;
+	bool		_bKTLS;
+	bool		_bBinary;
+	ookExecutor* _pThreadPool;
+	ookThreadOptions _connOptions;
+	vector<ookListenEndpoint> _vListenEndpoints;
 	
+	//The io_service and context must outlive the server threads' sockets,
+	//so they are declared first
   asio::io_service _io_service;
   asio::ssl::context _context;	
 	
+	vector<acceptor_ptr> _vAcceptors;
+	vector<ssl_thread_ptr> _vServerThreads;
+	ookMsgDispatcher _dispatcher;
+	
 private:
 
 
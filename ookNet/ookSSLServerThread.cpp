@@ -29,9 +29,19 @@
  POSSIBILITY OF SUCH DAMAGE.
  */
 #include "ookLibs/ookNet/ookSSLServerThread.h"
+#include "ookLibs/ookCore/ookMsgPool.h"
+#include "ookLibs/ookCore/ookBinaryMessage.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 ookSSLServerThread::ookSSLServerThread(ssl_socket_ptr sock, ookMsgDispatcher* dispatcher) 
-: _sock(sock), _dispatcher(dispatcher)
+: _sock(sock), _dispatcher(dispatcher), _bBinary(false), _bKTLS(false), _bKTLSActive(false)
 {
 	
 }
@@ -41,6 +51,7 @@ ookSSLServerThread::~ookSSLServerThread()
 	try 
 	{
 		this->Stop();		
+		this->Join();
 	}
 	catch (...) 
 	{
@@ -51,45 +62,84 @@ string ookSSLServerThread::Read()
 {
 	string ret;
 	
-	//Initialize our size variables
-	int messageSize = 0;
-	int messageHeaderSize = sizeof(int); 
-	system::error_code error;	
+	int messageSize = this->ReadFrameSize();
+	system::error_code error;
 	
-	//Fetch the message header which sets out the size of the upcoming message
-	char* hdrBuf = new char[messageHeaderSize];
+	//Now fetch the message
+	boost::scoped_array<char> msgBuf(new char[messageSize + 1]);
 	
-	long iRead = _sock->read_some(asio::buffer(hdrBuf, messageHeaderSize), error);	
+	long iRead = asio::read(*_sock, asio::buffer(msgBuf.get(), messageSize), error);	
 	
-	if((iRead == 0) || (iRead != messageHeaderSize) || error)
-		throw error;
+	if((iRead == 0) || (iRead != messageSize) || error)
+		throw error;	
 	
-	hdrBuf[messageHeaderSize] = '\0';
+	msgBuf[messageSize] = '\0';
 	
-	messageSize = atoi(hdrBuf);
+	ret.assign(msgBuf.get(), messageSize);
 	
-	if(messageSize <= 0)
-		throw error;
+	return ret;
+}
+
+/*! 
+ \brief Reads the next frame into a buffer of its own and returns a view
+ of it, for handing on without copying.
+ */
+ookBufferView ookSSLServerThread::ReadBuffer()
+{
+	int messageSize = this->ReadFrameSize();
+	system::error_code error;
 	
-	//Now fetch the message
-	char* msgBuf = new char[messageSize];
+	buffer_ptr buf = ookBuffer::Create(messageSize);
 	
-	iRead = _sock->read_some(asio::buffer(msgBuf, messageSize), error);	
+	long iRead = asio::read(*_sock, asio::buffer(buf->GetData(), messageSize), error);
 	
 	if((iRead == 0) || (iRead != messageSize) || error)
-		throw error;	
+		throw error;
 	
-	msgBuf[messageSize] = '\0';
+	return ookBufferView(buf);
+}
+
+//Reads a frame header and returns the size of the frame that follows it
+int ookSSLServerThread::ReadFrameSize()
+{
+	int messageHeaderSize = sizeof(int);
+	system::error_code error;
 	
-	ret = msgBuf;
+	//Fetch the message header which sets out the size of the upcoming message
+	char hdrBuf[sizeof(int) + 1];
 	
-	return ret;
+	long iRead = asio::read(*_sock, asio::buffer(hdrBuf, messageHeaderSize), error);
+	
+	if((iRead == 0) || (iRead != messageHeaderSize) || error)
+		throw error;
+	
+	hdrBuf[messageHeaderSize] = '\0';
+	
+	int messageSize = atoi(hdrBuf);
+	
+	if(messageSize <= 0)
+		throw error;
+	
+	return messageSize;
 }
 
 void ookSSLServerThread::HandleMsg(string msg)
 {
-	ookTextMessage message(msg);
-	_dispatcher->PostMsg(&message);
+	//Pooled and ref counted, so an asynchronous dispatcher queues it as is
+	boost::intrusive_ptr<ookTextMessage> message = ookMsgPool<ookTextMessage>::Global().Acquire();
+	message->SetMessage(msg);
+	_dispatcher->PostMsg(message.get());
+}
+
+/*! 
+ \brief Posts the frame to the dispatcher as an ookBinaryMessage sharing
+ the read buffer, so observers see the bytes as they came off the socket.
+ */
+void ookSSLServerThread::HandleBuffer(const ookBufferView& payload)
+{
+	boost::intrusive_ptr<ookBinaryMessage> message = ookMsgPool<ookBinaryMessage>::Global().Acquire();
+	message->SetPayload(payload);
+	_dispatcher->PostMsg(message.get());
 }
 
 void ookSSLServerThread::WriteMsg(string msg)
@@ -105,7 +155,11 @@ void ookSSLServerThread::WriteMsg(string msg)
 		
 		string msgBuf = msgHdr + msg;
 		
-		asio::write(*_sock, asio::buffer(msgBuf, msgBuf.length()));
+		//With kernel TLS the socket encrypts, so we write around OpenSSL
+		if(_bKTLSActive)
+			asio::write(_sock->next_layer(), asio::buffer(msgBuf, msgBuf.length()));
+		else
+			asio::write(*_sock, asio::buffer(msgBuf, msgBuf.length()));
 	}
 	catch (system::error_code& e)
 	{
@@ -123,6 +177,9 @@ bool ookSSLServerThread::DoHandshake()
 	{
 		system::error_code error;	
 
+		if(_bKTLS)
+			ookKTLS::PrepareConnection(_sock->native_handle());
+
 		_sock->handshake(boost::asio::ssl::stream_base::server, error);
 
 		if(error)
@@ -131,6 +188,14 @@ bool ookSSLServerThread::DoHandshake()
 			return false;
 		}
 
+		if(_bKTLS)
+		{
+			_bKTLSActive = ookKTLS::EnableTX(_sock->native_handle(), _sock->lowest_layer().native_handle());
+			
+			if(!_bKTLSActive)
+				cout << "Kernel TLS unavailable, using OpenSSL for writes" << endl;
+		}
+
 		return true;
 	}
 	catch (system::error_code& e) 
@@ -155,11 +220,14 @@ void ookSSLServerThread::Run()
 
 			while(this->IsRunning())
 			{
-				this->HandleMsg(this->Read());
+				if(_bBinary)
+					this->HandleBuffer(this->ReadBuffer());
+				else
+					this->HandleMsg(this->Read());
 			}
 		}
 
-		_sock->shutdown();
+		this->Close();
 	}
 	catch (system::error_code& e)
 	{
@@ -169,4 +237,147 @@ void ookSSLServerThread::Run()
 	{
 		std::cerr << "Oh noes! Unknown error in ookSSLServerThread::Run()" << endl;		
 	}		
+}
+
+/*! 
+ \brief Reads frames with ReadBuffer() and posts them as ookBinaryMessages
+ instead of ookTextMessages. Must be set before the thread is started.
+ */
+void ookSSLServerThread::SetBinary(bool bBinary)
+{
+	_bBinary = bBinary;
+}
+
+bool ookSSLServerThread::IsBinary() const
+{
+	return _bBinary;
+}
+
+/*! 
+ \brief Requests kernel TLS offload for writes. Must be set before the
+ thread is started; the server's context must have been prepared with
+ ookKTLS::PrepareContext() (ookSSLServer::SetKTLS() does both).
+ */
+void ookSSLServerThread::SetKTLS(bool bKTLS)
+{
+	_bKTLS = bKTLS;
+}
+
+/*! 
+ \brief True once the handshake is done and the kernel took the transmit
+ keys. False if kTLS was not requested or fell back to OpenSSL.
+ */
+bool ookSSLServerThread::IsKTLSActive() const
+{
+	return _bKTLSActive;
+}
+
+/*! 
+ \brief Streams a file's raw bytes to the client. With kernel TLS this is
+ sendfile(2), so the data never comes up to user space; otherwise it is
+ read in chunks and written through OpenSSL.
+ */
+void ookSSLServerThread::SendFile(string path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	
+	if(fd < 0)
+		throw system::error_code(errno, system::system_category());
+	
+	try
+	{
+		#ifdef __linux__
+		if(_bKTLSActive)
+		{
+			struct stat st;
+			if(fstat(fd, &st) < 0)
+				throw system::error_code(errno, system::system_category());
+			
+			int sockFd = _sock->lowest_layer().native_handle();
+			off_t offset = 0;
+			
+			while(offset < st.st_size)
+			{
+				ssize_t iSent = sendfile(sockFd, fd, &offset, st.st_size - offset);
+				
+				if(iSent < 0)
+				{
+					if(errno == EINTR)
+						continue;
+					
+					if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+					{
+						system::error_code waitErr;
+						_sock->next_layer().wait(tcp::socket::wait_write, waitErr);
+						
+						if(waitErr)
+							throw waitErr;
+						
+						continue;
+					}
+					
+					throw system::error_code(errno, system::system_category());
+				}
+				
+				if(iSent == 0)
+					break;
+			}
+			
+			close(fd);
+			return;
+		}
+		#endif
+		
+		boost::scoped_array<char> buf(new char[16384]);
+		
+		for(;;)
+		{
+			ssize_t iRead = read(fd, buf.get(), 16384);
+			
+			if(iRead < 0)
+			{
+				if(errno == EINTR)
+					continue;
+				
+				throw system::error_code(errno, system::system_category());
+			}
+			
+			if(iRead == 0)
+				break;
+			
+			asio::write(*_sock, asio::buffer(buf.get(), iRead));
+		}
+	}
+	catch(...)
+	{
+		close(fd);
+		throw;
+	}
+	
+	close(fd);
+}
+
+/*
+ Shutting down the TCP socket wakes a Read() blocked in OpenSSL. An SSL
+ level shutdown from this thread would race the reader for the SSL object.
+ */
+void ookSSLServerThread::OnStop()
+{
+	system::error_code err;
+	_sock->lowest_layer().shutdown(tcp::socket::shutdown_both, err);
+}
+
+/*
+ An SSL shutdown writes a close_notify alert through OpenSSL, which no
+ longer owns the transmit sequence once kernel TLS is active, so in that
+ case we only close at the TCP level.
+ */
+void ookSSLServerThread::Close()
+{
+	system::error_code err;
+	
+	if(_bKTLSActive)
+		_sock->lowest_layer().shutdown(tcp::socket::shutdown_both, err);
+	else
+		_sock->shutdown(err);
 }
\ No newline at end of file
@@ -34,8 +34,10 @@
 #include "ookLibs/ookCore/typedefs.h"
 #include "ookLibs/ookCore/ookMsgDispatcher.h"
 #include "ookLibs/ookCore/ookTextMessage.h"
+#include "ookLibs/ookCore/ookBuffer.h"
 #include "ookLibs/ookThread/ookThread.h"
 #include "ookLibs/ookUtil/ookString.h"
+#include "ookLibs/ookNet/ookKTLS.h"
 
 #include "boost/bind.hpp"
 #include "boost/asio.hpp"
@@ -60,17 +62,35 @@ public:
 	virtual string Read();
 	virtual void WriteMsg(string msg);
 	virtual void HandleMsg(string msg);		
+	
+	virtual ookBufferView ReadBuffer();
+	virtual void HandleBuffer(const ookBufferView& payload);
 
 	virtual void Run();	
 
+	void SendFile(string path);
+
+	void SetKTLS(bool bKTLS);
+	bool IsKTLSActive() const;
+	
+	void SetBinary(bool bBinary);
+	bool IsBinary() const;
+
 protected:
 
+	int ReadFrameSize();
 	virtual bool DoHandshake();
+	virtual void OnStop();
+	void Close();
 
 private:
 
 	ssl_socket_ptr _sock;
 	ookMsgDispatcher* _dispatcher;
+	
+	bool _bBinary;
+	bool _bKTLS;
+	bool _bKTLSActive;
 };
 
 
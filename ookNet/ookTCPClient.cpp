@@ -42,6 +42,7 @@ ookTCPClient::~ookTCPClient()
 	try
 	{
 		this->Stop();		
+		this->Join();
 	}
 	catch(...)
 	{
@@ -58,31 +59,31 @@ string ookTCPClient::Read()
 	system::error_code error;	
 	
 	//Fetch the message header which sets out the size of the upcoming message
-	char* hdrBuf = new char[messageHeaderSize];
+	boost::scoped_array<char> hdrBuf(new char[messageHeaderSize + 1]);
 	
-	long iRead = _sock->read_some(asio::buffer(hdrBuf, messageHeaderSize), error);	
+	long iRead = asio::read(*_sock, asio::buffer(hdrBuf.get(), messageHeaderSize), error);	
 	
 	if((iRead == 0) || (iRead != messageHeaderSize) || error)
 		throw error;
 	
 	hdrBuf[messageHeaderSize] = '\0';
 	
-	messageSize = atoi(hdrBuf);
+	messageSize = atoi(hdrBuf.get());
 	
 	if(messageSize <= 0)
 		throw error;
 	
 	//Now fetch the message
-	char* msgBuf = new char[messageSize];
+	boost::scoped_array<char> msgBuf(new char[messageSize + 1]);
 	
-	iRead = _sock->read_some(asio::buffer(msgBuf, messageSize), error);	
+	iRead = asio::read(*_sock, asio::buffer(msgBuf.get(), messageSize), error);	
 	
 	if((iRead == 0) || (iRead != messageSize) || error)
 		throw error;	
 	
 	msgBuf[messageSize] = '\0';
 	
-	ret = msgBuf;
+	ret.assign(msgBuf.get(), messageSize);
 	
 	return ret;
 }
@@ -116,17 +117,59 @@ void ookTCPClient::WriteMsg(string msg)
 	}	
 }
 
+socket_ptr ookTCPClient::CreateSocket()
+{
+	return socket_ptr(new tcp::socket(_ioService));
+}
+
+void ookTCPClient::OnConnect()
+{
+	//Override to do any work once the connection is up, e.g. send a greeting
+}
+
+/*
+ Wakes a Read() blocked on the socket. The socket is published under
+ _sockMut because Run() creates it on the client's own thread.
+ */
+void ookTCPClient::OnStop()
+{
+	boost::mutex::scoped_lock lock(_sockMut);
+	
+	if(_sock)
+	{
+		system::error_code err;
+		_sock->shutdown(tcp::socket::shutdown_both, err);
+	}
+}
+
 void ookTCPClient::Run()
 {
-	tcp::resolver resolver(_ioService);
-	tcp::resolver::query query(tcp::v4(), _ipaddr, ookString::ConvertInt2String(_iPort));
-	tcp::resolver::iterator iterator = resolver.resolve(query);
+	system::error_code err;
+	
+	vector<tcp::endpoint> endpoints = ookResolver::Instance().Resolve(_ipaddr, ookString::ConvertInt2String(_iPort), err);
+	
+	if(err)
+		throw err;
+	
+	socket_ptr sock = ookHappyEyeballs<tcp::socket>::Connect(_ioService, endpoints, 
+																													 boost::bind(&ookTCPClient::CreateSocket, this), err);
 	
-	_sock = auto_ptr<tcp::socket>(new tcp::socket(_ioService));	
-	_sock->connect(*iterator);	
+	if(err)
+		throw err;
+	
+	{
+		boost::mutex::scoped_lock lock(_sockMut);
+		_sock = sock;
+	}
+	
+	//Stop() may have come in while we were connecting
+	if(!this->IsRunning())
+		return;
 	
 	try
 	{
+		this->OnConnect();
+		
 		while(this->IsRunning()  && _sock->is_open())
 		{
 			this->HandleMsg(this->Read());
@@ -33,6 +33,8 @@
 
 #include "ookLibs/ookCore/typedefs.h"
 #include "ookLibs/ookThread/ookThread.h"
+#include "ookLibs/ookNet/ookResolver.h"
+#include "ookLibs/ookNet/ookHappyEyeballs.h"
 
 class ookTCPClient : public ookThread
 {
@@ -51,14 +53,19 @@ public:
 	
 protected:
 	
+	virtual void OnConnect();
+	virtual void OnStop();
+	socket_ptr CreateSocket();
 	
 private:
 	
 	string	_ipaddr;
 	int			_iPort;
 	
-	socket_ptr _sock;
+	//The io_service must outlive the socket, so it is declared first
 	asio::io_service _ioService;
+	socket_ptr _sock;
+	boost::mutex _sockMut;
 	
 };
 
@@ -31,8 +31,9 @@
 #include "ookLibs/ookNet/ookTCPServer.h"
 
 ookTCPServer::ookTCPServer(int iPort)
-	: _iPort(iPort)
+	: _iPort(iPort), _bBinary(false), _pThreadPool(NULL)
 {
+	//_dispatcher owns the observer and deletes it along with the server
 	_dispatcher.RegisterObserver(new ookMsgObserver<ookTCPServer, ookTextMessage>(this, &ookTCPServer::HandleMsg));
 }
 
@@ -41,12 +42,74 @@ ookTCPServer::~ookTCPServer()
 	try
 	{
 		this->Stop();
+		this->Join();
+		
+		//Connection threads post to _dispatcher, which is destroyed before
+		//the thread list, so stop and join them now
+		_vServerThreads.clear();
 	}
 	catch (...)
 	{
 	}		
 }
 
+/*! 
+ \brief Runs connection threads as tasks on pool instead of giving each
+ connection a new thread. Each connection holds a worker while it is open,
+ so use an elastic pool sized for the expected connection count. NULL
+ (the default) goes back to a thread per connection.
+ */
+void ookTCPServer::SetThreadPool(ookExecutor* pool)
+{
+	_pThreadPool = pool;
+}
+
+/*! 
+ \brief Placement, scheduling and name for connection threads. Only used
+ with a thread per connection; pooled connections run with the pool's
+ options.
+ */
+void ookTCPServer::SetConnectionThreadOptions(const ookThreadOptions& opts)
+{
+	_connOptions = opts;
+}
+
+/*! 
+ \brief Has connections accepted from now on post each frame as an
+ ookBinaryMessage viewing the bytes read, rather than copying them into an
+ ookTextMessage. See ookTCPServerThread::SetBinary().
+ */
+void ookTCPServer::SetBinary(bool bBinary)
+{
+	_bBinary = bBinary;
+}
+
+/*! 
+ \brief The dispatcher connection threads post received messages to. Make
+ it asynchronous with SetAsync() before Start() to keep slow observers
+ from holding up the connections' reads.
+ */
+ookMsgDispatcher* ookTCPServer::GetDispatcher()
+{
+	return &_dispatcher;
+}
+
+/*
+ By default the server listens on every interface, IPv6 and IPv4 alike, on
+ the port given to the constructor. Adding endpoints replaces that default;
+ all of them feed the same server thread list and dispatcher:
+ 
+ server.AddListenEndpoint("::", 1313);             //Dual-stack, all interfaces
+ server.AddListenEndpoint("10.0.0.5", 1314);       //One IPv4 interface
+ server.AddListenEndpoint("::1", 1313, true);      //IPv6 loopback only
+ 
+ Endpoints must be added before Start().
+ */
+void ookTCPServer::AddListenEndpoint(string address, int iPort, bool bV6Only)
+{
+	_vListenEndpoints.push_back(ookListenEndpoint(address, iPort, bV6Only));
+}
+
 tcp_thread_ptr ookTCPServer::GetServerThread(socket_ptr sock)
 {
 	tcp_thread_ptr thrd(new ookTCPServerThread(sock, &_dispatcher));
@@ -101,29 +164,70 @@ void ookTCPServer::HandleMsg(ookTextMessage* msg)
 	cout << "Received message: " << msg->GetMsg() << endl;
 }
 
+//Run() spends its life in the io_service, so stopping that ends it
+void ookTCPServer::OnStop()
+{
+	_ioService.stop();
+}
+
+void ookTCPServer::Accept(acceptor_ptr accptr)
+{
+	//Get a new socket_ptr and wait for a new connection on it
+	socket_ptr sock = boost::shared_ptr<tcp::socket>(new tcp::socket(_ioService));
+	accptr->async_accept(*sock, boost::bind(&ookTCPServer::HandleAccept, this, accptr, sock, asio::placeholders::error));
+}
+
+void ookTCPServer::HandleAccept(acceptor_ptr accptr, socket_ptr sock, const system::error_code& err)
+{
+	if(!err)
+	{
+		system::error_code epErr;
+		cout << "Accepted new client from " << ookListener::AddressToString(sock->remote_endpoint(epErr)) << endl;
+		
+		//Declare a server thread and start it up
+		tcp_thread_ptr thrd = this->GetServerThread(sock);
+		thrd->SetBinary(_bBinary);
+		thrd->SetOptions(_connOptions);
+		
+		if(_pThreadPool)
+			thrd->Start(*_pThreadPool);
+		else
+			thrd->Start();	
+		
+		//Do some cleanup on teh thread vector
+		this->CleanServerThreads();
+	}
+	
+	if(this->IsRunning() && (err != asio::error::operation_aborted))
+		this->Accept(accptr);
+}
+
 void ookTCPServer::Run()
 {
 	try
 	{
-		tcp::acceptor accptr(_ioService, tcp::endpoint(tcp::v4(), _iPort));
-
-		while(this->IsRunning())
+		vector<ookListenEndpoint> vEndpoints = _vListenEndpoints;
+		
+		if(vEndpoints.empty())
+			vEndpoints.push_back(ookListenEndpoint("", _iPort));
+		
+		//Every acceptor runs on our one io_service, so accepts from all of
+		//them are handled on this thread and share the server thread list
+		for(size_t i = 0; i < vEndpoints.size(); i++)
 		{
-			//Get a new socket_ptr and accept a new connection
-			socket_ptr sock = boost::shared_ptr<tcp::socket>(new tcp::socket(_ioService));
-			accptr.accept(*sock);
-	
-			asio::ip::tcp::endpoint remote_ep = sock->remote_endpoint();
+			acceptor_ptr accptr = ookListener::Open(_ioService, vEndpoints[i]);
+			_vAcceptors.push_back(accptr);
 			
-			cout << "Accepted new client from " << remote_ep.address().to_string() << endl;
+			cout << "Listening on " << accptr->local_endpoint() << endl;
 			
-			//Declare a server thread and start it up
-			tcp_thread_ptr thrd = this->GetServerThread(sock);
-			thrd->Start();	
-
-			//Do some cleanup on teh thread vector
-			this->CleanServerThreads();
+			this->Accept(accptr);
 		}
+		
+		_ioService.run();
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Something bad happened in ookTCPServer::Run: " << e.message() << "\n";
 	}
 	catch (std::exception& e)
 	{
@@ -37,6 +37,7 @@
 #include "ookLibs/ookCore/ookMsgObserver.h"
 #include "ookLibs/ookThread/ookThread.h"
 #include "ookLibs/ookNet/ookTCPServerThread.h"
+#include "ookLibs/ookNet/ookListener.h"
 
 typedef boost::shared_ptr<ookTCPServerThread> tcp_thread_ptr;
 
@@ -47,6 +48,13 @@ public:
 	ookTCPServer(int iPort);	
 	virtual ~ookTCPServer();
 	
+	void AddListenEndpoint(string address, int iPort, bool bV6Only = false);
+	void SetThreadPool(ookExecutor* pool);
+	void SetConnectionThreadOptions(const ookThreadOptions& opts);
+	void SetBinary(bool bBinary);
+	
+	ookMsgDispatcher* GetDispatcher();
+	
 	virtual void HandleMsg(ookTextMessage* msg);
 	virtual void Run();
 	
@@ -56,10 +64,20 @@ protected:
 	vector<tcp_thread_ptr>& GetServerThreads();
 	void CleanServerThreads();
 	
+	virtual void OnStop();
+	
+	void Accept(acceptor_ptr accptr);
+	void HandleAccept(acceptor_ptr accptr, socket_ptr sock, const system::error_code& err);
+	
 private:
 	
 	int			_iPort;	
+	bool		_bBinary;
+	ookExecutor* _pThreadPool;
+	ookThreadOptions _connOptions;
 	asio::io_service _ioService;	
+	vector<ookListenEndpoint> _vListenEndpoints;
+	vector<acceptor_ptr> _vAcceptors;
 	vector<tcp_thread_ptr> _vServerThreads;
 	ookMsgDispatcher _dispatcher;
 	
@@ -29,9 +29,11 @@
  POSSIBILITY OF SUCH DAMAGE.
  */
 #include "ookLibs/ookNet/ookTCPServerThread.h"
+#include "ookLibs/ookCore/ookMsgPool.h"
+#include "ookLibs/ookCore/ookBinaryMessage.h"
 
 ookTCPServerThread::ookTCPServerThread(socket_ptr sock, ookMsgDispatcher* dispatcher) 
-: _sock(sock), _dispatcher(dispatcher)
+: _sock(sock), _dispatcher(dispatcher), _bBinary(false)
 
 {
 	
@@ -42,6 +44,7 @@ ookTCPServerThread::~ookTCPServerThread()
 	try 
 	{
 		this->Stop();		
+		this->Join();
 	}
 	catch (...) 
 	{
@@ -52,45 +55,105 @@ string ookTCPServerThread::Read()
 {
 	string ret;
 	
-	//Initialize our size variables
-	int messageSize = 0;
-	int messageHeaderSize = sizeof(int); 
-	system::error_code error;	
+	int messageSize = this->ReadFrameSize();
+	system::error_code error;
+	
+	//Now fetch the message
+	boost::scoped_array<char> msgBuf(new char[messageSize + 1]);
+	
+	long iRead = asio::read(*_sock, asio::buffer(msgBuf.get(), messageSize), error);	
+	
+	if((iRead == 0) || (iRead != messageSize) || error)
+		throw error;	
+	
+	msgBuf[messageSize] = '\0';
+	
+	ret.assign(msgBuf.get(), messageSize);
+	_tReadEnd = ookClock::Now();
+	
+	return ret;
+}
+
+/*! 
+ \brief Reads the next frame into a buffer of its own and returns a view
+ of it, for handing on without copying.
+ */
+ookBufferView ookTCPServerThread::ReadBuffer()
+{
+	int messageSize = this->ReadFrameSize();
+	system::error_code error;
+	
+	buffer_ptr buf = ookBuffer::Create(messageSize);
+	
+	long iRead = asio::read(*_sock, asio::buffer(buf->GetData(), messageSize), error);
+	
+	if((iRead == 0) || (iRead != messageSize) || error)
+		throw error;
+	
+	_tReadEnd = ookClock::Now();
+	
+	return ookBufferView(buf);
+}
+
+//Reads a frame header and returns the size of the frame that follows it
+int ookTCPServerThread::ReadFrameSize()
+{
+	int messageHeaderSize = sizeof(int);
+	system::error_code error;
 	
 	//Fetch the message header which sets out the size of the upcoming message
-	char* hdrBuf = new char[messageHeaderSize];
+	char hdrBuf[sizeof(int) + 1];
 	
-	long iRead = _sock->read_some(asio::buffer(hdrBuf, messageHeaderSize), error);	
+	long iRead = asio::read(*_sock, asio::buffer(hdrBuf, messageHeaderSize), error);
 	
 	if((iRead == 0) || (iRead != messageHeaderSize) || error)
 		throw error;
 	
 	hdrBuf[messageHeaderSize] = '\0';
 	
-	messageSize = atoi(hdrBuf);
+	int messageSize = atoi(hdrBuf);
 	
 	if(messageSize <= 0)
 		throw error;
 	
-	//Now fetch the message
-	char* msgBuf = new char[messageSize];
-	
-	iRead = _sock->read_some(asio::buffer(msgBuf, messageSize), error);	
+	_tReadStart = ookClock::Now();
 	
-	if((iRead == 0) || (iRead != messageSize) || error)
-		throw error;	
-	
-	msgBuf[messageSize] = '\0';
-	
-	ret = msgBuf;
+	return messageSize;
+}
+
+/*
+ If the dispatcher's profiler picked the frame's message for tracing, its
+ trace starts with the time from the frame's header arriving to its last
+ byte, so the spans show the message's whole way from the socket.
+ */
+void ookTCPServerThread::TraceRead(ookMessage* msg)
+{
+	ookDispatchProfiler* profiler = _dispatcher->GetProfiler();
 	
-	return ret;
+	//Not timed by a Read() overridden in a subclass
+	if(profiler && msg->GetTraceId() && (_tReadEnd > _tReadStart))
+		profiler->RecordSpan(msg->GetTraceId(), "ookTCPServerThread::Read", _tReadStart, _tReadEnd, msg);
 }
 
 void ookTCPServerThread::HandleMsg(string msg)
 {
-	ookTextMessage message(msg);
-	_dispatcher->PostMsg(&message);
+	//Pooled and ref counted, so an asynchronous dispatcher queues it as is
+	boost::intrusive_ptr<ookTextMessage> message = ookMsgPool<ookTextMessage>::Global().Acquire();
+	message->SetMessage(msg);
+	_dispatcher->PostMsg(message.get());
+	this->TraceRead(message.get());
+}
+
+/*! 
+ \brief Posts the frame to the dispatcher as an ookBinaryMessage sharing
+ the read buffer, so observers see the bytes as they came off the socket.
+ */
+void ookTCPServerThread::HandleBuffer(const ookBufferView& payload)
+{
+	boost::intrusive_ptr<ookBinaryMessage> message = ookMsgPool<ookBinaryMessage>::Global().Acquire();
+	message->SetPayload(payload);
+	_dispatcher->PostMsg(message.get());
+	this->TraceRead(message.get());
 }
 
 void ookTCPServerThread::WriteMsg(string msg)
@@ -114,6 +177,30 @@ void ookTCPServerThread::WriteMsg(string msg)
 	}			
 }
 
+/*! 
+ \brief Reads frames with ReadBuffer() and posts them as ookBinaryMessages
+ instead of ookTextMessages. Must be set before the thread is started.
+ */
+void ookTCPServerThread::SetBinary(bool bBinary)
+{
+	_bBinary = bBinary;
+}
+
+bool ookTCPServerThread::IsBinary() const
+{
+	return _bBinary;
+}
+
+/*
+ Run() is usually blocked in Read(), where it can't see the stop flag, so
+ shut the socket down underneath it
+ */
+void ookTCPServerThread::OnStop()
+{
+	system::error_code err;
+	_sock->shutdown(boost::asio::socket_base::shutdown_both, err);
+}
+
 void ookTCPServerThread::Run()
 {
 	try
@@ -122,7 +209,10 @@ void ookTCPServerThread::Run()
 
 		while(this->IsRunning() && _sock->is_open())
 		{
-			this->HandleMsg(this->Read());
+			if(_bBinary)
+				this->HandleBuffer(this->ReadBuffer());
+			else
+				this->HandleMsg(this->Read());
 		}
 
 		_sock->shutdown(boost::asio::socket_base::shutdown_both);
@@ -34,6 +34,7 @@
 #include "ookLibs/ookCore/typedefs.h"
 #include "ookLibs/ookCore/ookMsgDispatcher.h"
 #include "ookLibs/ookCore/ookTextMessage.h"
+#include "ookLibs/ookCore/ookBuffer.h"
 #include "ookLibs/ookThread/ookThread.h"
 #include "ookLibs/ookNet/ookTCPServerThread.h"
 #include "ookLibs/ookUtil/ookString.h"
@@ -50,15 +51,29 @@ public:
 	virtual void HandleMsg(string msg);	
 	virtual void WriteMsg(string msg);
 	
+	virtual ookBufferView ReadBuffer();
+	virtual void HandleBuffer(const ookBufferView& payload);
+	
 	virtual void Run();	
 	
+	void SetBinary(bool bBinary);
+	bool IsBinary() const;
+	
 protected:
 	
+	int ReadFrameSize();
+	void TraceRead(ookMessage* msg);
+	virtual void OnStop();
 	
 private:
 	
 	socket_ptr _sock;
 	ookMsgDispatcher* _dispatcher;
+	bool _bBinary;
+	
+	//When the frame being handled started and finished arriving
+	ook_clock::time_point _tReadStart;
+	ook_clock::time_point _tReadEnd;
 };
 
 #endif
\ No newline at end of file
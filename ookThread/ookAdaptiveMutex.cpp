@@ -0,0 +1,140 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookAdaptiveMutex
+ \headerfile ookAdaptiveMutex.h "ookLibs/ookThread/ookAdaptiveMutex.h"
+ \brief Mutex that spins for a while before it parks the thread.
+ 
+ Most critical sections are a few hundred nanoseconds, far less than the
+ cost of a futex sleep and wake up. Lock() spins first, with the limit
+ set from a running average of how many spins earlier acquisitions took,
+ the same way glibc's PTHREAD_MUTEX_ADAPTIVE_NP works. Only when spinning
+ fails does it park on a futex (boost::atomic wait/notify). An
+ uncontended Lock()/Unlock() pair is one compare and swap and one
+ exchange, and Unlock() only makes a system call if somebody is parked.
+ 
+ On a single CPU the owner can't run while we spin, so the spin phase is
+ skipped.
+ 
+ \code
+ 
+ ookAdaptiveMutex mut;
+ 
+ {
+ 	ookLockGuard<ookAdaptiveMutex> lock(mut);
+ 	_table[key] = value;
+ }
+ 
+ \endcode
+ */
+#include "ookLibs/ookThread/ookAdaptiveMutex.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/thread/thread.hpp"
+
+ookAdaptiveMutex::ookAdaptiveMutex(int iMaxSpin)
+	: _iState(0), _iSpin(0), _iMaxSpin(iMaxSpin)
+{
+	if(!ookAdaptiveMutex::IsSpinningUseful())
+		_iMaxSpin = 0;
+}
+
+ookAdaptiveMutex::~ookAdaptiveMutex()
+{
+	
+}
+
+void ookAdaptiveMutex::Lock()
+{
+	int iExpected = 0;
+	
+	if(_iState.compare_exchange_strong(iExpected, 1, boost::memory_order_acquire, boost::memory_order_relaxed))
+		return;
+	
+	//Spin a little past what it has taken lately, so the estimate can grow
+	int iSpin = _iSpin.load(boost::memory_order_relaxed);
+	int iLimit = std::min(_iMaxSpin, (iSpin * 2) + 10);
+	
+	for(int i = 0; i < iLimit; i++)
+	{
+		ookClock::CpuRelax();
+		
+		if(_iState.load(boost::memory_order_relaxed) == 0)
+		{
+			iExpected = 0;
+			
+			if(_iState.compare_exchange_strong(iExpected, 1, boost::memory_order_acquire, boost::memory_order_relaxed))
+			{
+				_iSpin.store(iSpin + ((i - iSpin) / 8), boost::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+	
+	if(iLimit > 0)
+		_iSpin.store(iSpin + ((iLimit - iSpin) / 8), boost::memory_order_relaxed);
+	
+	//Mark the lock as having sleepers so Unlock() knows to wake one
+	while(_iState.exchange(2, boost::memory_order_acquire) != 0)
+		_iState.wait(2, boost::memory_order_relaxed);
+}
+
+bool ookAdaptiveMutex::TryLock()
+{
+	int iExpected = 0;
+	
+	return _iState.compare_exchange_strong(iExpected, 1, boost::memory_order_acquire, boost::memory_order_relaxed);
+}
+
+void ookAdaptiveMutex::Unlock()
+{
+	if(_iState.exchange(0, boost::memory_order_release) == 2)
+		_iState.notify_one();
+}
+
+/*! 
+ \brief Spins the lock currently allows itself before parking.
+ */
+int ookAdaptiveMutex::GetSpinEstimate() const
+{
+	return std::min(_iMaxSpin, (_iSpin.load(boost::memory_order_relaxed) * 2) + 10);
+}
+
+/*! 
+ \brief False on single CPU machines, where a spinning waiter only keeps
+ the lock holder from running.
+ */
+bool ookAdaptiveMutex::IsSpinningUseful()
+{
+	static const bool bUseful = (boost::thread::hardware_concurrency() > 1);
+	
+	return bUseful;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_ADAPTIVE_MUTEX_H_
+#define OOK_ADAPTIVE_MUTEX_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/atomic.hpp"
+
+class ookAdaptiveMutex
+{
+public:
+	
+	ookAdaptiveMutex(int iMaxSpin = 100);
+	virtual ~ookAdaptiveMutex();
+	
+	void Lock();
+	bool TryLock();
+	void Unlock();
+	
+	int GetSpinEstimate() const;
+	
+	static bool IsSpinningUseful();
+	
+protected:
+	
+private:
+	
+	ookAdaptiveMutex(const ookAdaptiveMutex&);
+	ookAdaptiveMutex& operator=(const ookAdaptiveMutex&);
+	
+	//0 unlocked, 1 locked, 2 locked and somebody may be parked on it
+	boost::atomic<int> _iState;
+	
+	//Running average of the spins it took to get the lock
+	boost::atomic<int> _iSpin;
+	int _iMaxSpin;
+};
+
+#endif
\ No newline at end of file
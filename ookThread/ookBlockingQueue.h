@@ -0,0 +1,323 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_BLOCKING_QUEUE_H_
+#define OOK_BLOCKING_QUEUE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookQueueSignal.h"
+#include "boost/atomic.hpp"
+
+/*!
+ \brief Blocking front end for ookSPSCQueue or ookMPMCQueue.
+ 
+ The underlying queue stays lock-free. Push() and Pop() first try it
+ directly, then spin briefly, and only then park on a futex through
+ ookQueueSignal. A hand-off with nobody asleep is the lock-free operation
+ plus one fence and one load; nothing ever takes a mutex.
+ 
+ \code
+ 
+ ookBlockingQueue< ookMPMCQueue<ookMessage*> > inbox(4096);
+ 
+ //Producers
+ inbox.Push(msg);
+ 
+ //Consumer, false once closed and drained
+ ookMessage* batch[64];
+ size_t iCount;
+ 
+ while((iCount = inbox.PopBatch(batch, 64)) > 0)
+ 	...
+ 
+ \endcode
+ 
+ Close() wakes everybody. Pushes fail from then on, and pops drain what
+ is left before they fail.
+ 
+ A consumer that lives in an event loop can use EnableEventFd() instead
+ of blocking in Pop(): register the descriptor, call ArmEventFd() before
+ going back to the loop, and DisarmEventFd() when the descriptor fires.
+ ArmEventFd() returns false if there is already something to pop, and
+ then the loop should drain the queue rather than wait.
+ 
+ With an ookSPSCQueue the single producer and single consumer rule still
+ applies to the blocking calls.
+ */
+template<class Q>
+class ookBlockingQueue
+{
+public:
+	
+	typedef typename Q::value_type value_type;
+	
+	ookBlockingQueue(size_t iCapacity = 1024)
+		: _queue(iCapacity), _bClosed(false)
+	{
+		
+	}
+	
+	virtual ~ookBlockingQueue()
+	{
+		
+	}
+	
+	bool TryPush(const value_type& item)
+	{
+		if(_bClosed.load(boost::memory_order_acquire) || !_queue.TryPush(item))
+			return false;
+		
+		_notEmpty.Notify();
+		return true;
+	}
+	
+	/*!
+	 \brief Waits for room and pushes.
+	 
+	 \return false if the queue is closed.
+	 */
+	bool Push(const value_type& item)
+	{
+		return this->PushWait(item, NULL);
+	}
+	
+	/*!
+	 \return false if the queue is closed or the deadline passed first.
+	 */
+	bool PushUntil(const value_type& item, ook_clock::time_point deadline)
+	{
+		return this->PushWait(item, &deadline);
+	}
+	
+	/*!
+	 \brief Pushes all of items, waiting for room as needed.
+	 
+	 \return The number pushed, which is less than iCount only if the queue
+	 was closed.
+	 */
+	size_t PushBatch(const value_type* items, size_t iCount)
+	{
+		size_t iDone = 0;
+		
+		while((iDone < iCount) && !_bClosed.load(boost::memory_order_acquire))
+		{
+			size_t iPushed = _queue.TryPushBatch(items + iDone, iCount - iDone);
+			
+			if(iPushed > 0)
+			{
+				_notEmpty.Notify();
+				iDone += iPushed;
+			}
+			else if(this->PushWait(items[iDone], NULL))
+				iDone++;
+		}
+		
+		return iDone;
+	}
+	
+	bool TryPop(value_type& item)
+	{
+		if(!_queue.TryPop(item))
+			return false;
+		
+		_notFull.Notify();
+		return true;
+	}
+	
+	/*!
+	 \brief Waits for an item.
+	 
+	 \return false if the queue is closed and empty.
+	 */
+	bool Pop(value_type& item)
+	{
+		return this->PopWait(item, NULL);
+	}
+	
+	/*!
+	 \return false if the queue is closed and empty, or the deadline passed
+	 first.
+	 */
+	bool PopUntil(value_type& item, ook_clock::time_point deadline)
+	{
+		return this->PopWait(item, &deadline);
+	}
+	
+	/*!
+	 \brief Waits for at least one item, then takes up to iMax.
+	 
+	 \return The number popped, 0 only if the queue is closed and empty.
+	 */
+	size_t PopBatch(value_type* items, size_t iMax)
+	{
+		if(iMax == 0)
+			return 0;
+		
+		size_t iPopped = _queue.TryPopBatch(items, iMax);
+		
+		if(iPopped == 0)
+		{
+			if(!this->PopWait(items[0], NULL))
+				return 0;
+			
+			iPopped = 1 + _queue.TryPopBatch(items + 1, iMax - 1);
+		}
+		
+		_notFull.Notify();
+		return iPopped;
+	}
+	
+	void Close()
+	{
+		_bClosed.store(true, boost::memory_order_release);
+		
+		_notEmpty.NotifyAll();
+		_notFull.NotifyAll();
+	}
+	
+	bool IsClosed() const
+	{
+		return _bClosed.load(boost::memory_order_acquire);
+	}
+	
+	int EnableEventFd()
+	{
+		return _notEmpty.EnableEventFd();
+	}
+	
+	bool ArmEventFd()
+	{
+		_notEmpty.Prepare();
+		
+		return (_queue.IsEmpty() && !this->IsClosed());
+	}
+	
+	void DisarmEventFd()
+	{
+		_notEmpty.ClearEventFd();
+	}
+	
+	size_t GetSize() const
+	{
+		return _queue.GetSize();
+	}
+	
+	size_t GetCapacity() const
+	{
+		return _queue.GetCapacity();
+	}
+	
+protected:
+	
+	bool PushWait(const value_type& item, const ook_clock::time_point* deadline)
+	{
+		int iSpins = 0;
+		
+		while(true)
+		{
+			if(_bClosed.load(boost::memory_order_acquire))
+				return false;
+			
+			if(_queue.TryPush(item))
+				break;
+			
+			if(ookQueueSignal::Spin(iSpins))
+				continue;
+			
+			int iEpoch = _notFull.Prepare();
+			
+			if(_bClosed.load(boost::memory_order_acquire))
+				return false;
+			
+			if(_queue.TryPush(item))
+				break;
+			
+			if(!deadline)
+				_notFull.Wait(iEpoch);
+			else if(!_notFull.WaitUntil(iEpoch, *deadline))
+				return this->TryPush(item);
+		}
+		
+		_notEmpty.Notify();
+		return true;
+	}
+	
+	bool PopWait(value_type& item, const ook_clock::time_point* deadline)
+	{
+		int iSpins = 0;
+		
+		while(true)
+		{
+			if(_queue.TryPop(item))
+				break;
+			
+			//Closed, but a push may have landed just before the flag
+			if(_bClosed.load(boost::memory_order_acquire))
+			{
+				if(_queue.TryPop(item))
+					break;
+				
+				return false;
+			}
+			
+			if(ookQueueSignal::Spin(iSpins))
+				continue;
+			
+			int iEpoch = _notEmpty.Prepare();
+			
+			if(_queue.TryPop(item))
+				break;
+			
+			if(_bClosed.load(boost::memory_order_acquire))
+				continue;
+			
+			if(!deadline)
+				_notEmpty.Wait(iEpoch);
+			else if(!_notEmpty.WaitUntil(iEpoch, *deadline))
+				return this->TryPop(item);
+		}
+		
+		_notFull.Notify();
+		return true;
+	}
+	
+private:
+	
+	ookBlockingQueue(const ookBlockingQueue&);
+	ookBlockingQueue& operator=(const ookBlockingQueue&);
+	
+	Q _queue;
+	boost::atomic<bool> _bClosed;
+	
+	ookQueueSignal _notEmpty;
+	ookQueueSignal _notFull;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookClock
+ \headerfile ookClock.h "ookLibs/ookThread/ookClock.h"
+ \brief Sleeps against the monotonic clock, so wall clock steps and NTP
+ slewing don't stretch or cut them short.
+ 
+ On POSIX systems SleepUntil() is clock_nanosleep(CLOCK_MONOTONIC,
+ TIMER_ABSTIME), which resumes correctly after a signal and has no
+ accumulated rounding. boost::chrono::steady_clock reads the same clock,
+ so its time points map directly onto the timespec.
+ */
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/thread/thread.hpp"
+
+#include <time.h>
+#include <errno.h>
+
+ook_clock::time_point ookClock::Now()
+{
+	return ook_clock::now();
+}
+
+void ookClock::SleepFor(boost::chrono::nanoseconds duration)
+{
+	if(duration.count() > 0)
+		ookClock::SleepUntil(ook_clock::now() + duration);
+}
+
+void ookClock::SleepUntil(ook_clock::time_point deadline)
+{
+	#if defined(_POSIX_MONOTONIC_CLOCK) && (_POSIX_MONOTONIC_CLOCK >= 0) && defined(BOOST_CHRONO_HAS_CLOCK_STEADY)
+		long long llNanos = boost::chrono::duration_cast<boost::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+		
+		struct timespec ts;
+		ts.tv_sec = (time_t) (llNanos / 1000000000LL);
+		ts.tv_nsec = (long) (llNanos % 1000000000LL);
+		
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		{
+		}
+	#else
+		boost::this_thread::sleep_until(deadline);
+	#endif
+}
+
+/*! 
+ \brief Hint to the CPU that we are in a spin loop.
+ */
+void ookClock::CpuRelax()
+{
+	#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+		__builtin_ia32_pause();
+	#elif defined(__GNUC__) && defined(__aarch64__)
+		__asm__ __volatile__("yield");
+	#endif
+}
+
+/*! 
+ \class ookHybridWait
+ \headerfile ookClock.h "ookLibs/ookThread/ookClock.h"
+ \brief Waits in three stages for low latency loops. It blocks in the
+ kernel while the deadline is far off, yields the CPU as it gets close,
+ and spins for the final stretch.
+ 
+ A plain sleep can wake up tens of microseconds late, or more under load.
+ Spinning through the last few microseconds gets us to within a clock read
+ of the deadline, and it only burns CPU for that last short window.
+ 
+ \code
+ 
+ ookHybridWait waiter(boost::chrono::microseconds(10), boost::chrono::microseconds(100));
+ 
+ waiter.WaitFor(boost::chrono::microseconds(250));
+ 
+ //Or poll a condition, giving up after 5ms
+ bool bReady = waiter.WaitFor(boost::bind(&Queue::HasData, &q), boost::chrono::milliseconds(5));
+ 
+ \endcode
+ */
+ookHybridWait::ookHybridWait(boost::chrono::nanoseconds spin, boost::chrono::nanoseconds yield)
+	: _spin(spin), _yield(yield), _maxBlock(boost::chrono::milliseconds(1))
+{
+	
+}
+
+ookHybridWait::~ookHybridWait()
+{
+	
+}
+
+/*! 
+ \brief Caps a single blocking sleep while polling a predicate. Each
+ sleep doubles from 50us up to this, 1ms by default.
+ */
+void ookHybridWait::SetMaxBlock(boost::chrono::nanoseconds maxBlock)
+{
+	_maxBlock = maxBlock;
+}
+
+void ookHybridWait::WaitUntil(ook_clock::time_point deadline)
+{
+	ook_clock::time_point blockUntil = deadline - _spin - _yield;
+	
+	if(ook_clock::now() < blockUntil)
+		ookClock::SleepUntil(blockUntil);
+	
+	ook_clock::time_point spinFrom = deadline - _spin;
+	
+	while(ook_clock::now() < spinFrom)
+		boost::this_thread::yield();
+	
+	while(ook_clock::now() < deadline)
+		ookClock::CpuRelax();
+}
+
+void ookHybridWait::WaitFor(boost::chrono::nanoseconds duration)
+{
+	this->WaitUntil(ook_clock::now() + duration);
+}
+
+/*! 
+ \brief Polls pred until it returns true or deadline passes. It spins for
+ the spin window, then yields for the yield window, then blocks in short
+ sleeps that back off exponentially.
+ 
+ \return the last value of pred.
+ */
+bool ookHybridWait::WaitUntil(boost::function<bool()> pred, ook_clock::time_point deadline)
+{
+	ook_clock::time_point start = ook_clock::now();
+	ook_clock::time_point spinEnd = start + _spin;
+	ook_clock::time_point yieldEnd = spinEnd + _yield;
+	
+	boost::chrono::nanoseconds block = boost::chrono::microseconds(50);
+	
+	for(;;)
+	{
+		if(pred())
+			return true;
+		
+		ook_clock::time_point now = ook_clock::now();
+		
+		if(now >= deadline)
+			return false;
+		
+		if(now < spinEnd)
+			ookClock::CpuRelax();
+		else if(now < yieldEnd)
+			boost::this_thread::yield();
+		else
+		{
+			ookClock::SleepUntil(std::min(deadline, now + block));
+			block = std::min(_maxBlock, block * 2);
+		}
+	}
+}
+
+bool ookHybridWait::WaitFor(boost::function<bool()> pred, boost::chrono::nanoseconds timeout)
+{
+	return this->WaitUntil(pred, ook_clock::now() + timeout);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_CLOCK_H_
+#define OOK_CLOCK_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/chrono.hpp"
+#include "boost/function.hpp"
+
+typedef boost::chrono::steady_clock ook_clock;
+
+class ookClock
+{
+public:
+	
+	static ook_clock::time_point Now();
+	
+	static void SleepFor(boost::chrono::nanoseconds duration);
+	static void SleepUntil(ook_clock::time_point deadline);
+	
+	static void CpuRelax();
+	
+protected:
+	
+private:
+	
+	ookClock();
+};
+
+class ookHybridWait
+{
+public:
+	
+	ookHybridWait(boost::chrono::nanoseconds spin = boost::chrono::microseconds(20),
+								boost::chrono::nanoseconds yield = boost::chrono::microseconds(200));
+	virtual ~ookHybridWait();
+	
+	void WaitUntil(ook_clock::time_point deadline);
+	void WaitFor(boost::chrono::nanoseconds duration);
+	
+	bool WaitUntil(boost::function<bool()> pred, ook_clock::time_point deadline);
+	bool WaitFor(boost::function<bool()> pred, boost::chrono::nanoseconds timeout);
+	
+	void SetMaxBlock(boost::chrono::nanoseconds maxBlock);
+	
+protected:
+	
+private:
+	
+	boost::chrono::nanoseconds _spin;
+	boost::chrono::nanoseconds _yield;
+	boost::chrono::nanoseconds _maxBlock;
+};
+
+#endif
\ No newline at end of file
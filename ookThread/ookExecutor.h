@@ -0,0 +1,88 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_EXECUTOR_H_
+#define OOK_EXECUTOR_H_
+
+/*! 
+ \class ookExecutor
+ \headerfile ookExecutor.h "ookLibs/ookThread/ookExecutor.h"
+ \brief Interface shared by the thread pools: something that runs tasks.
+ Anything taking an ookExecutor (ookThread::Start(), the servers'
+ SetThreadPool()) works with ookThreadPool and ookWorkStealingPool alike.
+ */
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/thread/future.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/function.hpp"
+#include "boost/bind.hpp"
+
+typedef boost::function<void()> ook_task;
+
+class ookExecutor
+{
+public:
+	
+	virtual ~ookExecutor()
+	{
+		
+	}
+	
+	virtual void Execute(ook_task task) = 0;
+	virtual void Shutdown() = 0;
+	
+	/*!
+	 \brief Queues task and returns a future for its result. Exceptions
+	 thrown by the task are rethrown from the future's get().
+	 */
+	template <class R>
+	boost::shared_future<R> Submit(boost::function<R()> task)
+	{
+		boost::shared_ptr<boost::packaged_task<R> > pkg(new boost::packaged_task<R>(task));
+		boost::shared_future<R> fut(pkg->get_future());
+		
+		this->Execute(boost::bind(&ookExecutor::RunPackaged<R>, pkg));
+		
+		return fut;
+	}
+	
+protected:
+	
+	template <class R>
+	static void RunPackaged(boost::shared_ptr<boost::packaged_task<R> > pkg)
+	{
+		(*pkg)();
+	}
+	
+private:
+	
+};
+
+#endif
\ No newline at end of file
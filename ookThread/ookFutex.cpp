@@ -0,0 +1,121 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookFutex
+ \headerfile ookFutex.h "ookLibs/ookThread/ookFutex.h"
+ \brief Parks threads on a boost::atomic<int>, in the kernel, until the
+ word changes.
+ 
+ Wait() returns once the word no longer holds iExpected. It can also wake
+ up spuriously, so callers re-check their condition in a loop. Deadlines
+ are on the monotonic clock, the same clock as ookClock.
+ 
+ On Linux this is FUTEX_WAIT_BITSET / FUTEX_WAKE on the atomic's storage.
+ Elsewhere it falls back to boost::atomic wait/notify, and timed waits
+ poll.
+ */
+#include "ookLibs/ookThread/ookFutex.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#endif
+
+#ifdef __linux__
+static int* ookFutexAddr(boost::atomic<int>& word)
+{
+	//boost::atomic<int> is lock free here, so its storage is exactly an int
+	return reinterpret_cast<int*>(&word);
+}
+#endif
+
+void ookFutex::Wait(boost::atomic<int>& word, int iExpected)
+{
+	#ifdef __linux__
+		syscall(SYS_futex, ookFutexAddr(word), FUTEX_WAIT_PRIVATE, iExpected, NULL, NULL, 0);
+	#else
+		word.wait(iExpected, boost::memory_order_relaxed);
+	#endif
+}
+
+/*! 
+ \brief Waits until the word changes or the deadline passes.
+ 
+ \return false if the deadline passed.
+ */
+bool ookFutex::WaitUntil(boost::atomic<int>& word, int iExpected, ook_clock::time_point deadline)
+{
+	#ifdef __linux__
+		long long llNanos = boost::chrono::duration_cast<boost::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+		
+		struct timespec ts;
+		ts.tv_sec = (time_t) (llNanos / 1000000000LL);
+		ts.tv_nsec = (long) (llNanos % 1000000000LL);
+		
+		//With FUTEX_WAIT_BITSET the timeout is absolute on CLOCK_MONOTONIC
+		if(syscall(SYS_futex, ookFutexAddr(word), FUTEX_WAIT_BITSET_PRIVATE, iExpected, &ts, NULL, FUTEX_BITSET_MATCH_ANY) == 0)
+			return true;
+		
+		return (errno != ETIMEDOUT);
+	#else
+		while(word.load(boost::memory_order_relaxed) == iExpected)
+		{
+			if(ook_clock::now() >= deadline)
+				return false;
+			
+			ookClock::SleepFor(boost::chrono::microseconds(50));
+		}
+		
+		return true;
+	#endif
+}
+
+void ookFutex::WakeOne(boost::atomic<int>& word)
+{
+	#ifdef __linux__
+		syscall(SYS_futex, ookFutexAddr(word), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	#else
+		word.notify_one();
+	#endif
+}
+
+void ookFutex::WakeAll(boost::atomic<int>& word)
+{
+	#ifdef __linux__
+		syscall(SYS_futex, ookFutexAddr(word), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+	#else
+		word.notify_all();
+	#endif
+}
\ No newline at end of file
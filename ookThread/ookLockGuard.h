@@ -0,0 +1,176 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_LOCK_GUARD_H_
+#define OOK_LOCK_GUARD_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookLockProfiler.h"
+
+/*!
+ \brief Holds a lock exclusively for the guard's scope. Works with any
+ lock that has Lock(), TryLock() and Unlock(): ookMutex, ookAdaptiveMutex
+ and ookSharedMutex.
+ 
+ Pass an ookLockSite to have the acquisition profiled while
+ ookLockProfiler is enabled:
+ 
+ \code
+ 
+ OOK_LOCK_SITE(addSite, "conn table add");
+ ookLockGuard<ookSharedMutex> lock(_tableMut, &addSite);
+ 
+ \endcode
+ */
+template<class M>
+class ookLockGuard : protected ookLockTiming
+{
+public:
+	
+	explicit ookLockGuard(M& mut, ookLockSite* site = NULL)
+		: ookLockTiming(site), _mut(mut), _bOwns(false)
+	{
+		this->Lock();
+	}
+	
+	virtual ~ookLockGuard()
+	{
+		if(_bOwns)
+			this->Unlock();
+	}
+	
+	void Lock()
+	{
+		if(this->IsTiming())
+		{
+			this->BeginWait();
+			
+			bool bContended = !_mut.TryLock();
+			
+			if(bContended)
+				_mut.Lock();
+			
+			this->EndWait(bContended);
+		}
+		else
+			_mut.Lock();
+		
+		_bOwns = true;
+	}
+	
+	void Unlock()
+	{
+		this->EndHold();
+		
+		_bOwns = false;
+		_mut.Unlock();
+	}
+	
+	bool OwnsLock() const
+	{
+		return _bOwns;
+	}
+	
+protected:
+	
+private:
+	
+	ookLockGuard(const ookLockGuard&);
+	ookLockGuard& operator=(const ookLockGuard&);
+	
+	M& _mut;
+	bool _bOwns;
+};
+
+/*!
+ \brief Holds a lock shared for the guard's scope, through LockShared(),
+ TryLockShared() and UnlockShared(). Profiles like ookLockGuard.
+ */
+template<class M>
+class ookSharedLockGuard : protected ookLockTiming
+{
+public:
+	
+	explicit ookSharedLockGuard(M& mut, ookLockSite* site = NULL)
+		: ookLockTiming(site), _mut(mut), _bOwns(false)
+	{
+		this->Lock();
+	}
+	
+	virtual ~ookSharedLockGuard()
+	{
+		if(_bOwns)
+			this->Unlock();
+	}
+	
+	void Lock()
+	{
+		if(this->IsTiming())
+		{
+			this->BeginWait();
+			
+			bool bContended = !_mut.TryLockShared();
+			
+			if(bContended)
+				_mut.LockShared();
+			
+			this->EndWait(bContended);
+		}
+		else
+			_mut.LockShared();
+		
+		_bOwns = true;
+	}
+	
+	void Unlock()
+	{
+		this->EndHold();
+		
+		_bOwns = false;
+		_mut.UnlockShared();
+	}
+	
+	bool OwnsLock() const
+	{
+		return _bOwns;
+	}
+	
+protected:
+	
+private:
+	
+	ookSharedLockGuard(const ookSharedLockGuard&);
+	ookSharedLockGuard& operator=(const ookSharedLockGuard&);
+	
+	M& _mut;
+	bool _bOwns;
+};
+
+#endif
\ No newline at end of file
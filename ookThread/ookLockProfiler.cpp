@@ -0,0 +1,319 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookLockProfiler
+ \headerfile ookLockProfiler.h "ookLibs/ookThread/ookLockProfiler.h"
+ \brief Lock contention profiling by lock site.
+ 
+ A site is one place in the code that takes a lock. It is declared once
+ as a static ookLockSite and handed to the lock guard. While profiling is
+ enabled, the guard times how long it waited for the lock and how long it
+ held it, and the site accumulates counts, totals and maxima:
+ 
+ \code
+ 
+ string ookConnTable::Lookup(string key)
+ {
+ 	OOK_LOCK_SITE(lookupSite, "conn table lookup");
+ 	ookSharedLockGuard<ookSharedMutex> lock(_mut, &lookupSite);
+ 	
+ 	...
+ }
+ 
+ ookLockProfiler::SetEnabled(true);
+ ...
+ ookLockProfiler::Report(cerr);
+ 
+ \endcode
+ 
+ Report() writes one JSON object per site, worst total wait first:
+ 
+ \code
+ 
+ {"site":"conn table lookup","file":"ookConnTable.cpp","line":88,
+  "acquires":120431,"contended":911,"wait_us_total":5120.3,
+  "wait_us_max":180.2,"hold_us_total":3011.9,"hold_us_max":12.7}
+ 
+ \endcode
+ 
+ Profiling is off by default. Then a guard with a site costs one relaxed
+ load more than one without. When profiling is on, a guard takes two clock
+ reads and a few atomic adds, which is cheap, but the numbers still
+ include that overhead.
+ */
+#include "ookLibs/ookThread/ookLockProfiler.h"
+#include "ookLibs/ookUtil/ookString.h"
+
+#include <algorithm>
+#include <iomanip>
+
+static bool ookLockSiteWaitOrder(ookLockSite* a, ookLockSite* b)
+{
+	return a->GetWaitNanos() > b->GetWaitNanos();
+}
+
+/*! 
+ \brief Sites register themselves when constructed and are never removed,
+ so they should be statics. name and file must outlive the site.
+ */
+ookLockSite::ookLockSite(const char* name, const char* file, int iLine)
+	: _name(name), _file(file), _iLine(iLine), _lAcquires(0), _lContended(0), _lWaitNanos(0),
+		_lMaxWaitNanos(0), _lHoldNanos(0), _lMaxHoldNanos(0), _pNext(NULL)
+{
+	ookLockProfiler::Register(this);
+}
+
+ookLockSite::~ookLockSite()
+{
+	
+}
+
+void ookLockSite::RecordAcquire(bool bContended, boost::chrono::nanoseconds wait)
+{
+	long lWait = (long) wait.count();
+	
+	_lAcquires.fetch_add(1, boost::memory_order_relaxed);
+	
+	if(bContended)
+		_lContended.fetch_add(1, boost::memory_order_relaxed);
+	
+	_lWaitNanos.fetch_add(lWait, boost::memory_order_relaxed);
+	ookLockSite::UpdateMax(_lMaxWaitNanos, lWait);
+}
+
+void ookLockSite::RecordRelease(boost::chrono::nanoseconds hold)
+{
+	long lHold = (long) hold.count();
+	
+	_lHoldNanos.fetch_add(lHold, boost::memory_order_relaxed);
+	ookLockSite::UpdateMax(_lMaxHoldNanos, lHold);
+}
+
+void ookLockSite::Reset()
+{
+	_lAcquires.store(0, boost::memory_order_relaxed);
+	_lContended.store(0, boost::memory_order_relaxed);
+	_lWaitNanos.store(0, boost::memory_order_relaxed);
+	_lMaxWaitNanos.store(0, boost::memory_order_relaxed);
+	_lHoldNanos.store(0, boost::memory_order_relaxed);
+	_lMaxHoldNanos.store(0, boost::memory_order_relaxed);
+}
+
+string ookLockSite::GetName() const
+{
+	return _name ? _name : "";
+}
+
+string ookLockSite::GetFile() const
+{
+	return _file ? _file : "";
+}
+
+int ookLockSite::GetLine() const
+{
+	return _iLine;
+}
+
+long ookLockSite::GetAcquireCount() const
+{
+	return _lAcquires.load(boost::memory_order_relaxed);
+}
+
+long ookLockSite::GetContendedCount() const
+{
+	return _lContended.load(boost::memory_order_relaxed);
+}
+
+long ookLockSite::GetWaitNanos() const
+{
+	return _lWaitNanos.load(boost::memory_order_relaxed);
+}
+
+long ookLockSite::GetMaxWaitNanos() const
+{
+	return _lMaxWaitNanos.load(boost::memory_order_relaxed);
+}
+
+long ookLockSite::GetHoldNanos() const
+{
+	return _lHoldNanos.load(boost::memory_order_relaxed);
+}
+
+long ookLockSite::GetMaxHoldNanos() const
+{
+	return _lMaxHoldNanos.load(boost::memory_order_relaxed);
+}
+
+ookLockSite* ookLockSite::GetNext() const
+{
+	return _pNext;
+}
+
+void ookLockSite::UpdateMax(boost::atomic<long>& lMax, long lValue)
+{
+	long lCur = lMax.load(boost::memory_order_relaxed);
+	
+	while((lValue > lCur) && !lMax.compare_exchange_weak(lCur, lValue, boost::memory_order_relaxed))
+	{
+	}
+}
+
+void ookLockProfiler::SetEnabled(bool bEnabled)
+{
+	ookLockProfiler::GetEnabledFlag().store(bEnabled, boost::memory_order_relaxed);
+}
+
+bool ookLockProfiler::IsEnabled()
+{
+	return ookLockProfiler::GetEnabledFlag().load(boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Every site constructed so far, in no particular order.
+ */
+vector<ookLockSite*> ookLockProfiler::GetSites()
+{
+	vector<ookLockSite*> vSites;
+	
+	for(ookLockSite* site = ookLockProfiler::GetSiteList().load(boost::memory_order_acquire); site; site = site->GetNext())
+		vSites.push_back(site);
+	
+	return vSites;
+}
+
+/*! 
+ \brief Writes the sites that have been used, worst total wait first.
+ */
+void ookLockProfiler::Report(ostream& out)
+{
+	vector<ookLockSite*> vSites = ookLockProfiler::GetSites();
+	std::sort(vSites.begin(), vSites.end(), ookLockSiteWaitOrder);
+	
+	//Left as the caller had them
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize iPrecision = out.precision();
+	
+	for(size_t i = 0; i < vSites.size(); i++)
+	{
+		ookLockSite* site = vSites[i];
+		
+		if(site->GetAcquireCount() == 0)
+			continue;
+		
+		out << std::fixed << std::setprecision(1) << "{\"site\":";
+		ookString::WriteJSONString(out, site->GetName());
+		out << ",\"file\":";
+		ookString::WriteJSONString(out, site->GetFile());
+		out << ",\"line\":" << site->GetLine()
+			<< ",\"acquires\":" << site->GetAcquireCount()
+			<< ",\"contended\":" << site->GetContendedCount()
+			<< ",\"wait_us_total\":" << (site->GetWaitNanos() / 1000.0)
+			<< ",\"wait_us_max\":" << (site->GetMaxWaitNanos() / 1000.0)
+			<< ",\"hold_us_total\":" << (site->GetHoldNanos() / 1000.0)
+			<< ",\"hold_us_max\":" << (site->GetMaxHoldNanos() / 1000.0)
+			<< "}" << endl;
+	}
+	
+	out.flags(flags);
+	out.precision(iPrecision);
+}
+
+void ookLockProfiler::Reset()
+{
+	vector<ookLockSite*> vSites = ookLockProfiler::GetSites();
+	
+	for(size_t i = 0; i < vSites.size(); i++)
+		vSites[i]->Reset();
+}
+
+void ookLockProfiler::Register(ookLockSite* site)
+{
+	boost::atomic<ookLockSite*>& head = ookLockProfiler::GetSiteList();
+	ookLockSite* next = head.load(boost::memory_order_relaxed);
+	
+	do
+	{
+		site->_pNext = next;
+	}
+	while(!head.compare_exchange_weak(next, site, boost::memory_order_release, boost::memory_order_relaxed));
+}
+
+//Function statics, so sites in other translation units can register
+//during static initialization
+boost::atomic<bool>& ookLockProfiler::GetEnabledFlag()
+{
+	static boost::atomic<bool> bEnabled(false);
+	
+	return bEnabled;
+}
+
+boost::atomic<ookLockSite*>& ookLockProfiler::GetSiteList()
+{
+	static boost::atomic<ookLockSite*> head(NULL);
+	
+	return head;
+}
+
+ookLockTiming::ookLockTiming(ookLockSite* site)
+	: _pSite((site && ookLockProfiler::IsEnabled()) ? site : NULL)
+{
+	
+}
+
+ookLockTiming::~ookLockTiming()
+{
+	
+}
+
+bool ookLockTiming::IsTiming() const
+{
+	return (_pSite != NULL);
+}
+
+void ookLockTiming::BeginWait()
+{
+	_start = ook_clock::now();
+}
+
+void ookLockTiming::EndWait(bool bContended)
+{
+	ook_clock::time_point now = ook_clock::now();
+	
+	_pSite->RecordAcquire(bContended, now - _start);
+	_start = now;
+}
+
+void ookLockTiming::EndHold()
+{
+	if(_pSite)
+		_pSite->RecordRelease(ook_clock::now() - _start);
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_LOCK_PROFILER_H_
+#define OOK_LOCK_PROFILER_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/atomic.hpp"
+
+//Declares a static profiling site for the lock taken on the next lines
+#define OOK_LOCK_SITE(var, name) static ookLockSite var(name, __FILE__, __LINE__)
+
+class ookLockSite
+{
+	friend class ookLockProfiler;
+	
+public:
+	
+	ookLockSite(const char* name, const char* file = NULL, int iLine = 0);
+	virtual ~ookLockSite();
+	
+	void RecordAcquire(bool bContended, boost::chrono::nanoseconds wait);
+	void RecordRelease(boost::chrono::nanoseconds hold);
+	void Reset();
+	
+	string GetName() const;
+	string GetFile() const;
+	int GetLine() const;
+	
+	long GetAcquireCount() const;
+	long GetContendedCount() const;
+	long GetWaitNanos() const;
+	long GetMaxWaitNanos() const;
+	long GetHoldNanos() const;
+	long GetMaxHoldNanos() const;
+	
+	ookLockSite* GetNext() const;
+	
+protected:
+	
+	static void UpdateMax(boost::atomic<long>& lMax, long lValue);
+	
+private:
+	
+	ookLockSite(const ookLockSite&);
+	ookLockSite& operator=(const ookLockSite&);
+	
+	const char* _name;
+	const char* _file;
+	int _iLine;
+	
+	boost::atomic<long> _lAcquires;
+	boost::atomic<long> _lContended;
+	boost::atomic<long> _lWaitNanos;
+	boost::atomic<long> _lMaxWaitNanos;
+	boost::atomic<long> _lHoldNanos;
+	boost::atomic<long> _lMaxHoldNanos;
+	
+	ookLockSite* _pNext;
+};
+
+class ookLockProfiler
+{
+public:
+	
+	static void SetEnabled(bool bEnabled);
+	static bool IsEnabled();
+	
+	static vector<ookLockSite*> GetSites();
+	static void Report(ostream& out);
+	static void Reset();
+	
+	static void Register(ookLockSite* site);
+	
+protected:
+	
+	static boost::atomic<bool>& GetEnabledFlag();
+	static boost::atomic<ookLockSite*>& GetSiteList();
+	
+private:
+	
+	ookLockProfiler();
+};
+
+/*!
+ \brief Wait and hold timing for one acquisition, shared by the lock
+ guards. Does nothing unless it has a site and profiling is enabled.
+ */
+class ookLockTiming
+{
+public:
+	
+	ookLockTiming(ookLockSite* site);
+	virtual ~ookLockTiming();
+	
+	bool IsTiming() const;
+	
+	void BeginWait();
+	void EndWait(bool bContended);
+	void EndHold();
+	
+protected:
+	
+private:
+	
+	ookLockSite* _pSite;
+	ook_clock::time_point _start;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,235 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_MPMC_QUEUE_H_
+#define OOK_MPMC_QUEUE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/atomic.hpp"
+
+//Override with -DOOK_CACHE_LINE_SIZE=128 where lines or prefetch pairs are bigger
+#ifndef OOK_CACHE_LINE_SIZE
+#define OOK_CACHE_LINE_SIZE 64
+#endif
+
+/*!
+ \brief Bounded, lock-free, multi producer multi consumer ring (Dmitry
+ Vyukov's design).
+ 
+ Every slot carries a sequence number that says whose turn it is: equal
+ to the position means free for the producer that claims that position,
+ position + 1 means full for the matching consumer. A push or pop claims
+ a position with one compare and swap on its own padded index, then
+ copies the item and publishes the slot with a release store. Producers
+ and consumers only meet on the slots themselves, never on a lock.
+ 
+ The batch calls claim a run of consecutive ready slots with a single
+ compare and swap, so a batch of n costs one contended operation instead
+ of n.
+ 
+ Capacity is rounded up to a power of two. T must be default
+ constructible and assignable. Popped slots are reset to T().
+ 
+ For a blocking version, wrap it in ookBlockingQueue.
+ */
+template<class T>
+class ookMPMCQueue
+{
+public:
+	
+	typedef T value_type;
+	
+	ookMPMCQueue(size_t iCapacity = 1024)
+		: _iEnqueuePos(0), _iDequeuePos(0)
+	{
+		_iCapacity = 2;
+		while(_iCapacity < iCapacity)
+			_iCapacity *= 2;
+		
+		_iMask = _iCapacity - 1;
+		_pCells = new ookMPMCCell[_iCapacity];
+		
+		for(size_t i = 0; i < _iCapacity; i++)
+			_pCells[i].iSeq.store(i, boost::memory_order_relaxed);
+	}
+	
+	virtual ~ookMPMCQueue()
+	{
+		delete [] _pCells;
+	}
+	
+	bool TryPush(const T& item)
+	{
+		return (this->TryPushBatch(&item, 1) == 1);
+	}
+	
+	/*!
+	 \brief Pushes as many of items as there are free slots for, in order.
+	 
+	 \return The number pushed, from the front of items.
+	 */
+	size_t TryPushBatch(const T* items, size_t iCount)
+	{
+		iCount = std::min(iCount, _iCapacity);
+		size_t iPos = _iEnqueuePos.load(boost::memory_order_relaxed);
+		
+		while(iCount > 0)
+		{
+			//A free slot stays free until its position is claimed, so the run
+			//counted here is still ours if the claim succeeds
+			size_t iRun = 0;
+			while((iRun < iCount) && (_pCells[(iPos + iRun) & _iMask].iSeq.load(boost::memory_order_acquire) == (iPos + iRun)))
+				iRun++;
+			
+			if(iRun == 0)
+			{
+				size_t iSeq = _pCells[iPos & _iMask].iSeq.load(boost::memory_order_acquire);
+				
+				//Still holds last lap's item, so the ring is full
+				if((long) (iSeq - iPos) < 0)
+					return 0;
+				
+				iPos = _iEnqueuePos.load(boost::memory_order_relaxed);
+				continue;
+			}
+			
+			if(_iEnqueuePos.compare_exchange_weak(iPos, iPos + iRun, boost::memory_order_relaxed))
+			{
+				for(size_t i = 0; i < iRun; i++)
+				{
+					ookMPMCCell& cell = _pCells[(iPos + i) & _iMask];
+					cell.data = items[i];
+					cell.iSeq.store(iPos + i + 1, boost::memory_order_release);
+				}
+				
+				return iRun;
+			}
+		}
+		
+		return 0;
+	}
+	
+	bool TryPop(T& item)
+	{
+		return (this->TryPopBatch(&item, 1) == 1);
+	}
+	
+	/*!
+	 \brief Pops up to iMax items, in order.
+	 
+	 \return The number popped.
+	 */
+	size_t TryPopBatch(T* items, size_t iMax)
+	{
+		iMax = std::min(iMax, _iCapacity);
+		size_t iPos = _iDequeuePos.load(boost::memory_order_relaxed);
+		
+		while(iMax > 0)
+		{
+			size_t iRun = 0;
+			while((iRun < iMax) && (_pCells[(iPos + iRun) & _iMask].iSeq.load(boost::memory_order_acquire) == (iPos + iRun + 1)))
+				iRun++;
+			
+			if(iRun == 0)
+			{
+				size_t iSeq = _pCells[iPos & _iMask].iSeq.load(boost::memory_order_acquire);
+				
+				//Not written yet, so the ring is empty
+				if((long) (iSeq - (iPos + 1)) < 0)
+					return 0;
+				
+				iPos = _iDequeuePos.load(boost::memory_order_relaxed);
+				continue;
+			}
+			
+			if(_iDequeuePos.compare_exchange_weak(iPos, iPos + iRun, boost::memory_order_relaxed))
+			{
+				for(size_t i = 0; i < iRun; i++)
+				{
+					ookMPMCCell& cell = _pCells[(iPos + i) & _iMask];
+					items[i] = cell.data;
+					cell.data = T();
+					cell.iSeq.store(iPos + i + _iCapacity, boost::memory_order_release);
+				}
+				
+				return iRun;
+			}
+		}
+		
+		return 0;
+	}
+	
+	//Only a snapshot
+	size_t GetSize() const
+	{
+		size_t iDequeue = _iDequeuePos.load(boost::memory_order_acquire);
+		size_t iEnqueue = _iEnqueuePos.load(boost::memory_order_acquire);
+		
+		return (iEnqueue > iDequeue) ? (iEnqueue - iDequeue) : 0;
+	}
+	
+	bool IsEmpty() const
+	{
+		return (this->GetSize() == 0);
+	}
+	
+	size_t GetCapacity() const
+	{
+		return _iCapacity;
+	}
+	
+protected:
+	
+	struct ookMPMCCell
+	{
+		boost::atomic<size_t> iSeq;
+		T data;
+	};
+	
+private:
+	
+	ookMPMCQueue(const ookMPMCQueue&);
+	ookMPMCQueue& operator=(const ookMPMCQueue&);
+	
+	char _pad0[OOK_CACHE_LINE_SIZE];
+	
+	boost::atomic<size_t> _iEnqueuePos;
+	char _pad1[OOK_CACHE_LINE_SIZE - sizeof(boost::atomic<size_t>)];
+	
+	boost::atomic<size_t> _iDequeuePos;
+	char _pad2[OOK_CACHE_LINE_SIZE - sizeof(boost::atomic<size_t>)];
+	
+	//Read only after construction
+	size_t _iCapacity;
+	size_t _iMask;
+	ookMPMCCell* _pCells;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,227 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookQueueSignal
+ \headerfile ookQueueSignal.h "ookLibs/ookThread/ookQueueSignal.h"
+ \brief Sleep and wake up for the lock-free queues, without a mutex (an
+ eventcount).
+ 
+ A waiter takes an epoch with Prepare(), checks its condition again, and
+ only then Wait()s on that epoch:
+ 
+ \code
+ 
+ while(!queue.TryPop(item))
+ {
+ 	int iEpoch = notEmpty.Prepare();
+ 	
+ 	if(queue.TryPop(item))
+ 		break;
+ 	
+ 	notEmpty.Wait(iEpoch);
+ }
+ 
+ \endcode
+ 
+ After changing the condition, the other side calls Notify(). Prepare()
+ sets a waiter flag in the epoch word. Notify() costs a fence and a load
+ while the flag is clear. When it is set, the first Notify() clears it,
+ moves the epoch on, and wakes the sleepers through ookFutex. Later
+ Notify()s don't make another system call until somebody Prepare()s
+ again. Either the waiter's second check sees the change, or Notify()
+ sees the flag, so no wake up is lost.
+ 
+ With EnableEventFd(), the wake up also writes to an eventfd, so the
+ waiting side can sit in epoll or an asio stream_descriptor instead of
+ Wait(). Prepare() before going back to the poller, and ClearEventFd()
+ once it fires.
+ */
+#include "ookLibs/ookThread/ookQueueSignal.h"
+#include "ookLibs/ookThread/ookFutex.h"
+#include "ookLibs/ookThread/ookAdaptiveMutex.h"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+//Next epoch with the waiter flag clear; unsigned so it wraps cleanly
+static int ookQueueSignalNext(int iState)
+{
+	return (int) (((unsigned int) iState + 2) & ~1u);
+}
+
+//Spins before a waiter bothers with Prepare() and the kernel
+static const int OOK_QUEUE_SPIN = 128;
+
+ookQueueSignal::ookQueueSignal()
+	: _iState(0), _iEventFd(-1)
+{
+	
+}
+
+ookQueueSignal::~ookQueueSignal()
+{
+	#ifdef __linux__
+		if(_iEventFd >= 0)
+			close(_iEventFd);
+	#endif
+}
+
+/*! 
+ \brief Registers the caller as a waiter.
+ 
+ \return The epoch to hand to Wait() or WaitUntil().
+ */
+int ookQueueSignal::Prepare()
+{
+	return _iState.fetch_or(1, boost::memory_order_seq_cst) | 1;
+}
+
+void ookQueueSignal::Wait(int iEpoch)
+{
+	ookFutex::Wait(_iState, iEpoch);
+}
+
+/*! 
+ \return false if the deadline passed without a notification.
+ */
+bool ookQueueSignal::WaitUntil(int iEpoch, ook_clock::time_point deadline)
+{
+	return ookFutex::WaitUntil(_iState, iEpoch, deadline);
+}
+
+/*! 
+ \brief Wakes the waiters, if there are any.
+ */
+void ookQueueSignal::Notify()
+{
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	
+	int iState = _iState.load(boost::memory_order_relaxed);
+	
+	//If the exchange fails another Notify() got there first and woke them
+	if((iState & 1) && _iState.compare_exchange_strong(iState, ookQueueSignalNext(iState), boost::memory_order_seq_cst, boost::memory_order_relaxed))
+		this->Wake();
+}
+
+/*! 
+ \brief Wakes the waiters unconditionally, e.g. when closing a queue.
+ */
+void ookQueueSignal::NotifyAll()
+{
+	int iState = _iState.load(boost::memory_order_relaxed);
+	
+	while(!_iState.compare_exchange_weak(iState, ookQueueSignalNext(iState), boost::memory_order_seq_cst, boost::memory_order_relaxed))
+	{
+	}
+	
+	this->Wake();
+}
+
+/*! 
+ \brief Creates the eventfd. Call it before any other thread uses the
+ signal.
+ 
+ \return The descriptor, or -1 where eventfd isn't available.
+ */
+int ookQueueSignal::EnableEventFd()
+{
+	#ifdef __linux__
+		if(_iEventFd < 0)
+		{
+			_iEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			
+			if(_iEventFd < 0)
+				throw system::error_code(errno, system::system_category());
+		}
+	#endif
+	
+	return _iEventFd;
+}
+
+int ookQueueSignal::GetEventFd() const
+{
+	return _iEventFd;
+}
+
+/*! 
+ \brief Resets the eventfd to not readable.
+ */
+void ookQueueSignal::ClearEventFd()
+{
+	#ifdef __linux__
+		if(_iEventFd >= 0)
+		{
+			uint64_t lCount = 0;
+			
+			if(read(_iEventFd, &lCount, sizeof(lCount)) < 0)
+			{
+				//EAGAIN, it was already clear
+			}
+		}
+	#endif
+}
+
+void ookQueueSignal::Wake()
+{
+	ookFutex::WakeAll(_iState);
+	
+	#ifdef __linux__
+		if(_iEventFd >= 0)
+		{
+			uint64_t lOne = 1;
+			
+			if(write(_iEventFd, &lOne, sizeof(lOne)) < 0)
+			{
+				//Only fails if the counter would overflow, and then it is readable anyway
+			}
+		}
+	#endif
+}
+
+/*! 
+ \brief One step of the brief spin before a waiter parks.
+ 
+ \return false once the caller should stop spinning and park.
+ */
+bool ookQueueSignal::Spin(int& iSpins)
+{
+	if(!ookAdaptiveMutex::IsSpinningUseful() || (iSpins >= OOK_QUEUE_SPIN))
+		return false;
+	
+	iSpins++;
+	ookClock::CpuRelax();
+	
+	return true;
+}
\ No newline at end of file
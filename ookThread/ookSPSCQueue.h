@@ -0,0 +1,220 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_SPSC_QUEUE_H_
+#define OOK_SPSC_QUEUE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "boost/atomic.hpp"
+
+//Override with -DOOK_CACHE_LINE_SIZE=128 where lines or prefetch pairs are bigger
+#ifndef OOK_CACHE_LINE_SIZE
+#define OOK_CACHE_LINE_SIZE 64
+#endif
+
+/*!
+ \brief Bounded, lock-free, single producer single consumer ring.
+ 
+ Exactly one thread may push and exactly one thread may pop. Each side
+ owns an index on its own cache line and keeps a cached copy of the other
+ side's index, so it only touches the other side's line when the cached
+ copy says the ring is full, or empty. Push and pop are then a plain copy
+ and one release store. The batch calls publish the whole batch with a
+ single store.
+ 
+ Capacity is rounded up to a power of two. T must be default
+ constructible and assignable. Popped slots are reset to T(), so the ring
+ doesn't keep shared_ptrs alive.
+ 
+ For a blocking version, wrap it in ookBlockingQueue.
+ */
+template<class T>
+class ookSPSCQueue
+{
+public:
+	
+	typedef T value_type;
+	
+	ookSPSCQueue(size_t iCapacity = 1024)
+		: _iHead(0), _iTailCache(0), _iTail(0), _iHeadCache(0)
+	{
+		_iCapacity = 2;
+		while(_iCapacity < iCapacity)
+			_iCapacity *= 2;
+		
+		_iMask = _iCapacity - 1;
+		_pSlots = new T[_iCapacity];
+	}
+	
+	virtual ~ookSPSCQueue()
+	{
+		delete [] _pSlots;
+	}
+	
+	//Producer only
+	bool TryPush(const T& item)
+	{
+		size_t iTail = _iTail.load(boost::memory_order_relaxed);
+		
+		if((iTail - _iHeadCache) == _iCapacity)
+		{
+			_iHeadCache = _iHead.load(boost::memory_order_acquire);
+			
+			if((iTail - _iHeadCache) == _iCapacity)
+				return false;
+		}
+		
+		_pSlots[iTail & _iMask] = item;
+		_iTail.store(iTail + 1, boost::memory_order_release);
+		
+		return true;
+	}
+	
+	/*!
+	 \brief Pushes as many of items as fit.
+	 
+	 \return The number pushed, from the front of items.
+	 */
+	size_t TryPushBatch(const T* items, size_t iCount)
+	{
+		size_t iTail = _iTail.load(boost::memory_order_relaxed);
+		size_t iFree = _iCapacity - (iTail - _iHeadCache);
+		
+		if(iFree < iCount)
+		{
+			_iHeadCache = _iHead.load(boost::memory_order_acquire);
+			iFree = _iCapacity - (iTail - _iHeadCache);
+		}
+		
+		size_t iPush = std::min(iFree, iCount);
+		
+		for(size_t i = 0; i < iPush; i++)
+			_pSlots[(iTail + i) & _iMask] = items[i];
+		
+		if(iPush > 0)
+			_iTail.store(iTail + iPush, boost::memory_order_release);
+		
+		return iPush;
+	}
+	
+	//Consumer only
+	bool TryPop(T& item)
+	{
+		size_t iHead = _iHead.load(boost::memory_order_relaxed);
+		
+		if(iHead == _iTailCache)
+		{
+			_iTailCache = _iTail.load(boost::memory_order_acquire);
+			
+			if(iHead == _iTailCache)
+				return false;
+		}
+		
+		T& slot = _pSlots[iHead & _iMask];
+		item = slot;
+		slot = T();
+		
+		_iHead.store(iHead + 1, boost::memory_order_release);
+		
+		return true;
+	}
+	
+	/*!
+	 \brief Pops up to iMax items into items.
+	 
+	 \return The number popped.
+	 */
+	size_t TryPopBatch(T* items, size_t iMax)
+	{
+		size_t iHead = _iHead.load(boost::memory_order_relaxed);
+		
+		if((_iTailCache - iHead) < iMax)
+			_iTailCache = _iTail.load(boost::memory_order_acquire);
+		
+		size_t iPop = std::min(_iTailCache - iHead, iMax);
+		
+		for(size_t i = 0; i < iPop; i++)
+		{
+			T& slot = _pSlots[(iHead + i) & _iMask];
+			items[i] = slot;
+			slot = T();
+		}
+		
+		if(iPop > 0)
+			_iHead.store(iHead + iPop, boost::memory_order_release);
+		
+		return iPop;
+	}
+	
+	//Any thread; only a snapshot
+	size_t GetSize() const
+	{
+		size_t iHead = _iHead.load(boost::memory_order_acquire);
+		size_t iTail = _iTail.load(boost::memory_order_acquire);
+		
+		return (iTail > iHead) ? (iTail - iHead) : 0;
+	}
+	
+	bool IsEmpty() const
+	{
+		return (this->GetSize() == 0);
+	}
+	
+	size_t GetCapacity() const
+	{
+		return _iCapacity;
+	}
+	
+protected:
+	
+private:
+	
+	ookSPSCQueue(const ookSPSCQueue&);
+	ookSPSCQueue& operator=(const ookSPSCQueue&);
+	
+	char _pad0[OOK_CACHE_LINE_SIZE];
+	
+	//Consumer's line
+	boost::atomic<size_t> _iHead;
+	size_t _iTailCache;
+	char _pad1[OOK_CACHE_LINE_SIZE - sizeof(boost::atomic<size_t>) - sizeof(size_t)];
+	
+	//Producer's line
+	boost::atomic<size_t> _iTail;
+	size_t _iHeadCache;
+	char _pad2[OOK_CACHE_LINE_SIZE - sizeof(boost::atomic<size_t>) - sizeof(size_t)];
+	
+	//Read only after construction
+	size_t _iCapacity;
+	size_t _iMask;
+	T* _pSlots;
+};
+
+#endif
\ No newline at end of file
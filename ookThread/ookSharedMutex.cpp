@@ -0,0 +1,195 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookSharedMutex
+ \headerfile ookSharedMutex.h "ookLibs/ookThread/ookSharedMutex.h"
+ \brief Reader-writer lock for read mostly data, such as config maps and
+ connection tables.
+ 
+ Any number of readers can hold the lock at once. A reader costs one
+ compare and swap on the way in and one atomic decrement on the way out.
+ There is no internal mutex, unlike boost::shared_mutex, so readers on
+ different cores don't serialize on each other.
+ 
+ Writers take priority. Once a writer is waiting, new readers hold off
+ until it is done, so a steady stream of readers can't starve it. Writers
+ queue among themselves on an ookAdaptiveMutex. Waiters spin briefly and
+ then park on a futex.
+ 
+ \code
+ 
+ ookSharedMutex _tableMut;
+ 
+ {
+ 	ookSharedLockGuard<ookSharedMutex> lock(_tableMut);
+ 	it = _table.find(key);
+ }
+ 
+ {
+ 	ookLockGuard<ookSharedMutex> lock(_tableMut);
+ 	_table[key] = conn;
+ }
+ 
+ \endcode
+ 
+ The lock is not recursive, and a reader must not try to take it
+ exclusively while it still holds it shared.
+ */
+#include "ookLibs/ookThread/ookSharedMutex.h"
+#include "ookLibs/ookThread/ookClock.h"
+
+static const int OOK_RW_WRITER = 0x40000000;
+static const int OOK_RW_PENDING = 0x20000000;
+static const int OOK_RW_READERS = 0x1FFFFFFF;
+
+//Spins before a waiter parks
+static const int OOK_RW_SPIN = 64;
+
+ookSharedMutex::ookSharedMutex()
+	: _iState(0)
+{
+	
+}
+
+ookSharedMutex::~ookSharedMutex()
+{
+	
+}
+
+void ookSharedMutex::Lock()
+{
+	_writeMut.Lock();
+	
+	//Block new readers, then wait for the ones inside to leave
+	int iState = _iState.fetch_or(OOK_RW_PENDING, boost::memory_order_relaxed) | OOK_RW_PENDING;
+	int iSpins = 0;
+	
+	while(true)
+	{
+		if((iState & OOK_RW_READERS) == 0)
+		{
+			if(_iState.compare_exchange_weak(iState, OOK_RW_WRITER, boost::memory_order_acquire, boost::memory_order_relaxed))
+				return;
+			
+			continue;
+		}
+		
+		this->WaitForChange(iState, iSpins);
+		iState = _iState.load(boost::memory_order_relaxed);
+	}
+}
+
+bool ookSharedMutex::TryLock()
+{
+	if(!_writeMut.TryLock())
+		return false;
+	
+	int iExpected = 0;
+	
+	if(_iState.compare_exchange_strong(iExpected, OOK_RW_WRITER, boost::memory_order_acquire, boost::memory_order_relaxed))
+		return true;
+	
+	_writeMut.Unlock();
+	return false;
+}
+
+void ookSharedMutex::Unlock()
+{
+	_iState.fetch_and(~OOK_RW_WRITER, boost::memory_order_release);
+	_iState.notify_all();
+	
+	_writeMut.Unlock();
+}
+
+void ookSharedMutex::LockShared()
+{
+	int iState = _iState.load(boost::memory_order_relaxed);
+	int iSpins = 0;
+	
+	while(true)
+	{
+		if((iState & (OOK_RW_WRITER | OOK_RW_PENDING)) == 0)
+		{
+			if(_iState.compare_exchange_weak(iState, iState + 1, boost::memory_order_acquire, boost::memory_order_relaxed))
+				return;
+			
+			continue;
+		}
+		
+		this->WaitForChange(iState, iSpins);
+		iState = _iState.load(boost::memory_order_relaxed);
+	}
+}
+
+bool ookSharedMutex::TryLockShared()
+{
+	int iState = _iState.load(boost::memory_order_relaxed);
+	
+	while((iState & (OOK_RW_WRITER | OOK_RW_PENDING)) == 0)
+	{
+		if(_iState.compare_exchange_weak(iState, iState + 1, boost::memory_order_acquire, boost::memory_order_relaxed))
+			return true;
+	}
+	
+	return false;
+}
+
+void ookSharedMutex::UnlockShared()
+{
+	int iState = _iState.fetch_sub(1, boost::memory_order_release) - 1;
+	
+	//Last reader out with a writer waiting. Readers park on the same word,
+	//so wake everybody to be sure the writer is among them.
+	if(iState == OOK_RW_PENDING)
+		_iState.notify_all();
+}
+
+/*! 
+ \brief Number of readers holding the lock right now. Only meant for
+ statistics; it may be stale by the time it returns.
+ */
+int ookSharedMutex::GetReaderCount() const
+{
+	return _iState.load(boost::memory_order_relaxed) & OOK_RW_READERS;
+}
+
+//Spins for a while, then parks until _iState moves away from iState
+void ookSharedMutex::WaitForChange(int iState, int& iSpins)
+{
+	if(ookAdaptiveMutex::IsSpinningUseful() && (iSpins < OOK_RW_SPIN))
+	{
+		iSpins++;
+		ookClock::CpuRelax();
+	}
+	else
+		_iState.wait(iState, boost::memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookStopToken
+ \headerfile ookStopToken.h "ookLibs/ookThread/ookStopToken.h"
+ \brief Shared, thread safe stop flag with waits that wake up as soon as a
+ stop is requested.
+ 
+ Copies share the same state, so a token can be handed to helper objects
+ or pool tasks and they all see the one RequestStop(). Checking the flag
+ is a single atomic load, cheap enough for every pass through a loop.
+ 
+ \code
+ 
+ while(!token.IsStopRequested())
+ {
+ 	this->Poll();
+ 	
+ 	//Returns early, with true, if somebody calls RequestStop()
+ 	if(token.WaitFor(boost::chrono::milliseconds(100)))
+ 		break;
+ }
+ 
+ \endcode
+ */
+#include "ookLibs/ookThread/ookStopToken.h"
+
+ookStopToken::ookStopToken()
+	: _state(new ookStopState())
+{
+	
+}
+
+ookStopToken::~ookStopToken()
+{
+	
+}
+
+void ookStopToken::RequestStop()
+{
+	boost::mutex::scoped_lock lock(_state->mut);
+	
+	_state->bStop.store(true, boost::memory_order_release);
+	_state->cond.notify_all();
+}
+
+bool ookStopToken::IsStopRequested() const
+{
+	return _state->bStop.load(boost::memory_order_acquire);
+}
+
+/*! 
+ \brief Sleeps for duration or until a stop is requested.
+ 
+ \return true if a stop was requested.
+ */
+bool ookStopToken::WaitFor(boost::chrono::nanoseconds duration) const
+{
+	return this->WaitUntil(ook_clock::now() + duration);
+}
+
+bool ookStopToken::WaitUntil(ook_clock::time_point deadline) const
+{
+	boost::mutex::scoped_lock lock(_state->mut);
+	
+	while(!_state->bStop.load(boost::memory_order_acquire))
+	{
+		if(_state->cond.wait_until(lock, deadline) == boost::cv_status::timeout)
+			break;
+	}
+	
+	return _state->bStop.load(boost::memory_order_acquire);
+}
\ No newline at end of file
@@ -28,9 +28,28 @@
  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  POSSIBILITY OF SUCH DAMAGE.
  */
+
+/*! 
+ \class ookThread
+ \headerfile ookThread.h "ookLibs/ookThread/ookThread.h"
+ \brief Base class for anything that runs its own loop, either on a
+ dedicated thread (Start()) or as a task on an executor (Start(pool)).
+ 
+ Shutdown is cooperative. Stop() sets the thread's ookStopToken, wakes
+ any SleepFor() or stop token wait in progress and calls OnStop(). A
+ subclass that blocks in I/O overrides OnStop() to unblock itself, for
+ example by shutting down its socket. Join() waits for Run() to return,
+ with or without a timeout.
+ 
+ The destructor stops and joins. By the time ~ookThread() runs, the
+ subclass part of the object is already gone, so a subclass whose Run()
+ touches its own members should call Stop() and Join() in its own
+ destructor.
+ */
 #include "ookLibs/ookThread/ookThread.h"
 
 ookThread::ookThread()
+	: _bPooled(false), _bActive(false)
 {
 	
 }
@@ -40,48 +59,252 @@ ookThread::~ookThread()
 	try
 	{
 		this->Stop();
+		this->Join();
 	}
 	catch (...)
 	{
 	}	
+	
+	//A thread deleting its own ookThread can't join itself
+	if(_pThread && _pThread->joinable())
+		_pThread->detach();
 }
 
 void ookThread::Start()
 {
-	_bKeepRunning = true;
-	_pThread = boost::shared_ptr<thread>(new thread(&ookThread::Run, this));
+	//Going active and installing the new token happen under one lock, so a
+	//concurrent Stop() either stops the previous run or sees the new token
+	boost::mutex::scoped_lock lock(_stateMut);
+	
+	if(_bActive.exchange(true))
+		throw ookException("ookThread::Start called on a thread that is already running");
+	
+	//Reap the previous run, if any
+	if(_pThread && _pThread->joinable())
+		_pThread->join();
+	
+	_stop = ookStopToken();
+	_bPooled = false;
+	_pThread = boost::shared_ptr<thread>(new thread(&ookThread::RunThread, this));
+}
+
+/*! 
+ \brief Runs this thread as a task on pool instead of on a dedicated
+ thread. The object must stay alive until Run() returns.
+ */
+void ookThread::Start(ookExecutor& pool)
+{
+	{
+		boost::mutex::scoped_lock lock(_stateMut);
+		
+		if(_bActive.exchange(true))
+			throw ookException("ookThread::Start called on a thread that is already running");
+		
+		_stop = ookStopToken();
+		_bPooled = true;
+	}
+	
+	try
+	{
+		pool.Execute(boost::bind(&ookThread::RunThread, this));
+	}
+	catch(...)
+	{
+		_bActive = false;
+		throw;
+	}
 }
 
+/*! 
+ \brief Asks Run() to finish. Safe to call from any thread, including
+ from inside Run(), and more than once. Doesn't wait; see Join().
+ */
 void ookThread::Stop()
 {
-	_bKeepRunning = false;
+	ookStopToken stop = this->GetStopToken();
+	
+	if(stop.IsStopRequested())
+		return;
+	
+	stop.RequestStop();
+	
+	try
+	{
+		this->OnStop();
+	}
+	catch(...)
+	{
+	}
 }
 
-bool ookThread::IsRunning()
+/*! 
+ \brief Waits for Run() to return. Returns straight away if the thread was
+ never started or when called from the thread itself.
+ */
+void ookThread::Join()
 {
-	return _bKeepRunning; 
+	this->Join(boost::chrono::nanoseconds::max());
 }
 
-void ookThread::Sleep(int lTimeSec)
+/*! 
+ \brief Waits up to timeout for Run() to return.
+ 
+ \return true if Run() has returned (or never started).
+ */
+bool ookThread::Join(boost::chrono::nanoseconds timeout)
 {
-	boost::xtime xt;
-	boost::xtime_get(&xt, boost::TIME_UTC);
-	xt.sec += lTimeSec;	
+	if(this->IsCurrentThread())
+		return false;
+	
+	boost::mutex::scoped_lock lock(_stateMut);
+	
+	if(timeout == boost::chrono::nanoseconds::max())
+	{
+		while(_bActive)
+			_stateCond.wait(lock);
+	}
+	else
+	{
+		ook_clock::time_point deadline = ook_clock::now() + timeout;
+		
+		while(_bActive)
+			if(_stateCond.wait_until(lock, deadline) == boost::cv_status::timeout)
+				break;
+		
+		if(_bActive)
+			return false;
+	}
 	
-	_pThread->sleep(xt);
+	//Under the lock, so only one of several joining threads joins. Run()
+	//has returned and RunThread() is done with the lock, so this is quick.
+	if(_pThread && _pThread->joinable())
+		_pThread->join();
+	
+	return true;
+}
+
+/*! 
+ \brief True between Start() and Run() returning, unless Stop() has been
+ called. Loops in Run() should check this on every pass.
+ */
+bool ookThread::IsRunning()
+{
+	return _bActive && !this->GetStopToken().IsStopRequested(); 
 }
 
-void ookThread::NanoSleep(long lTimeNanos)
+/*! 
+ \brief True when called from inside this object's Run().
+ */
+bool ookThread::IsCurrentThread()
 {
-	boost::xtime xt;
-	boost::xtime_get(&xt, boost::TIME_UTC);
-	xt.nsec += lTimeNanos;	
+	boost::mutex::scoped_lock lock(_stateMut);
 	
-	_pThread->sleep(xt);
+	return _bActive && (_runThreadId == boost::this_thread::get_id());
+}
+
+/*! 
+ \brief A copy of this run's stop token, for handing to code that should
+ give up when the thread is stopped. Start() issues a fresh token.
+ */
+ookStopToken ookThread::GetStopToken()
+{
+	//Start() may be replacing it on another thread
+	boost::mutex::scoped_lock lock(_stateMut);
+	return _stop;
+}
+
+/*! 
+ \brief Placement, scheduling and name for the thread, applied when it
+ starts. Set them before Start(). They are ignored when the thread runs
+ on a pool, because the pool's workers have their own.
+ */
+void ookThread::SetOptions(const ookThreadOptions& opts)
+{
+	_options = opts;
+}
+
+ookThreadOptions ookThread::GetOptions() const
+{
+	return _options;
+}
+
+/*! 
+ \brief Sleeps, but wakes up early if Stop() is called.
+ 
+ \return false if the sleep was cut short by Stop().
+ */
+bool ookThread::Sleep(int lTimeSec)
+{
+	return this->SleepFor(boost::chrono::seconds(lTimeSec));
+}
+
+bool ookThread::NanoSleep(long lTimeNanos)
+{
+	return this->SleepFor(boost::chrono::nanoseconds(lTimeNanos));
+}
+
+/*! 
+ \brief Sleeps on the monotonic clock (see ookClock), waking up early if
+ Stop() is called.
+ 
+ \return false if the sleep was cut short by Stop().
+ */
+bool ookThread::SleepFor(boost::chrono::nanoseconds duration)
+{
+	return !_stop.WaitFor(duration);
+}
+
+bool ookThread::SleepUntil(ook_clock::time_point deadline)
+{
+	return !_stop.WaitUntil(deadline);
 }
 
 void ookThread::Run()
 {
 	//Do your stuff here	
 	cout << "Running!" << endl;	
+}
+
+/*! 
+ \brief Called by Stop(), on the stopping thread. Override it to wake a
+ Run() that is blocked somewhere the stop token can't reach.
+ */
+void ookThread::OnStop()
+{
+	
+}
+
+void ookThread::RunThread()
+{
+	{
+		boost::mutex::scoped_lock lock(_stateMut);
+		_runThreadId = boost::this_thread::get_id();
+	}
+	
+	if(!_bPooled && !_options.IsEmpty())
+		_options.Apply();
+	
+	try
+	{
+		this->Run();
+	}
+	catch (system::error_code& e)
+	{
+		std::cerr << "Something bad happened in ookThread::Run: " << e.message() << endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Something bad happened in ookThread::Run: " << e.what() << endl;
+	}
+	catch(...)
+	{
+		std::cerr << "Oh noes! Unknown error in ookThread::Run()" << endl;
+	}
+	
+	//Once _bActive drops, Join() may return and the object may be destroyed,
+	//so nothing here touches a member after the notify
+	boost::mutex::scoped_lock lock(_stateMut);
+	_runThreadId = boost::thread::id();
+	_bActive = false;
+	_stateCond.notify_all();
 }
\ No newline at end of file
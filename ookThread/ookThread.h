@@ -34,6 +34,11 @@
 #include "ookLibs/ookCore/typedefs.h"
 #include "boost/thread.hpp"
 #include "boost/shared_ptr.hpp"
+#include "boost/atomic.hpp"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "ookLibs/ookThread/ookStopToken.h"
+#include "ookLibs/ookThread/ookThreadOptions.h"
 
 using namespace boost;
 
@@ -45,20 +50,42 @@ public:
 	virtual ~ookThread();
 	
 	void Start();
+	void Start(ookExecutor& pool);
 	void Stop();
-	void Sleep(int lTimeSec);
-	void NanoSleep(long lTimeNanos);
+	void Join();
+	bool Join(boost::chrono::nanoseconds timeout);
+	
+	bool Sleep(int lTimeSec);
+	bool NanoSleep(long lTimeNanos);
+	bool SleepFor(boost::chrono::nanoseconds duration);
+	bool SleepUntil(ook_clock::time_point deadline);
 	
 	bool IsRunning();
+	bool IsCurrentThread();
+	ookStopToken GetStopToken();
+	
+	void SetOptions(const ookThreadOptions& opts);
+	ookThreadOptions GetOptions() const;
 		
 protected:
 	
 	virtual void Run();	
+	virtual void OnStop();
+	
+	void RunThread();
 	
 private:
 	
 	boost::shared_ptr<thread> _pThread;
-	bool		_bKeepRunning;
+	ookStopToken _stop;
+	ookThreadOptions _options;
+	bool _bPooled;
+	
+	//True from Start() until Run() returns
+	boost::atomic<bool> _bActive;
+	boost::thread::id _runThreadId;
+	boost::mutex _stateMut;
+	boost::condition_variable _stateCond;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,344 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookThreadOptions
+ \headerfile ookThreadOptions.h "ookLibs/ookThread/ookThreadOptions.h"
+ \brief Where and how a thread runs: CPU affinity, NUMA node, scheduling
+ policy and priority, and a name for top/perf.
+ 
+ Set them on an ookThread with SetOptions() before Start(), or give them
+ to a pool so that every worker gets them. For a pool, bPinPerCore pins
+ worker i to the i-th available CPU and places its memory on that CPU's
+ NUMA node. The name gets the worker number appended.
+ 
+ \code
+ 
+ //Keep connection threads on socket 0, next to the NIC
+ ookThreadOptions opts;
+ opts.iNUMANode = 0;
+ opts.name = "ook-conn";
+ server.SetConnectionThreadOptions(opts);
+ 
+ //One worker per core, each allocating from its own node
+ ookThreadOptions pin;
+ pin.bPinPerCore = true;
+ pin.name = "ook-ws";
+ ookWorkStealingPool pool(0, pin);
+ 
+ \endcode
+ 
+ Everything here is best effort. It is implemented for Linux, using the
+ set_mempolicy system call directly so that libnuma isn't required.
+ Anything the platform or our privileges don't allow (real time policies
+ usually need CAP_SYS_NICE) is logged and skipped, and Apply() returns
+ false.
+ */
+#include "ookLibs/ookThread/ookThreadOptions.h"
+#include "ookLibs/ookUtil/ookString.h"
+#include "boost/thread/thread.hpp"
+#include "boost/algorithm/string/trim.hpp"
+
+#include <fstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+ookThreadOptions::ookThreadOptions()
+	: iNUMANode(-1), bPinPerCore(false), iSchedPolicy(-1), iPriority(0)
+{
+	
+}
+
+ookThreadOptions::~ookThreadOptions()
+{
+	
+}
+
+bool ookThreadOptions::IsEmpty() const
+{
+	return vCPUs.empty() && (iNUMANode < 0) && !bPinPerCore && (iSchedPolicy < 0) && name.empty();
+}
+
+/*! 
+ \brief Applies the options to the calling thread. iWorker is the worker
+ number when called for a pool worker. It picks the CPU for bPinPerCore
+ and is appended to the name.
+ 
+ \return false if any part could not be applied.
+ */
+bool ookThreadOptions::Apply(int iWorker) const
+{
+	bool bOk = true;
+	
+	#ifdef __linux__
+		vector<int> vCPUSet = vCPUs;
+		int iNode = iNUMANode;
+		
+		if(bPinPerCore && (iWorker >= 0))
+		{
+			vector<int> vAvail = vCPUSet.empty() ? ookThreadOptions::GetAvailableCPUs() : vCPUSet;
+			
+			if(iNode >= 0)
+			{
+				vector<int> vNode = ookThreadOptions::GetAllowed(ookThreadOptions::GetNUMANodeCPUs(iNode));
+				if(!vNode.empty())
+					vAvail = vNode;
+			}
+			
+			if(!vAvail.empty())
+			{
+				int iCPU = vAvail[iWorker % vAvail.size()];
+				vCPUSet.assign(1, iCPU);
+				
+				if(iNode < 0)
+					iNode = ookThreadOptions::GetNUMANodeOfCPU(iCPU);
+			}
+		}
+		else if(vCPUSet.empty() && (iNode >= 0))
+		{
+			vCPUSet = ookThreadOptions::GetAllowed(ookThreadOptions::GetNUMANodeCPUs(iNode));
+			
+			if(vCPUSet.empty())
+			{
+				std::cerr << "ookThreadOptions: none of NUMA node " << iNode << "'s CPUs are available" << endl;
+				bOk = false;
+			}
+		}
+		
+		if(!vCPUSet.empty())
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			
+			for(size_t i = 0; i < vCPUSet.size(); i++)
+				if((vCPUSet[i] >= 0) && (vCPUSet[i] < CPU_SETSIZE))
+					CPU_SET(vCPUSet[i], &set);
+			
+			int iErr = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+			if(iErr != 0)
+			{
+				std::cerr << "ookThreadOptions: could not set CPU affinity: " << strerror(iErr) << endl;
+				bOk = false;
+			}
+		}
+		
+		//First touch puts pages on the CPU's node anyway; this also covers
+		//memory touched before we got there and threads that migrate
+		if(iNode >= 0)
+		{
+			#ifdef SYS_set_mempolicy
+				unsigned long mask[16];
+				memset(mask, 0, sizeof(mask));
+				
+				if(iNode < (int) (sizeof(mask) * 8))
+				{
+					mask[iNode / (sizeof(unsigned long) * 8)] |= 1UL << (iNode % (sizeof(unsigned long) * 8));
+					
+					if(syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8) != 0)
+					{
+						std::cerr << "ookThreadOptions: could not set NUMA memory policy: " << strerror(errno) << endl;
+						bOk = false;
+					}
+				}
+			#endif
+		}
+		
+		if(iSchedPolicy >= 0)
+		{
+			struct sched_param param;
+			memset(&param, 0, sizeof(param));
+			param.sched_priority = iPriority;
+			
+			int iErr = pthread_setschedparam(pthread_self(), iSchedPolicy, &param);
+			if(iErr != 0)
+			{
+				std::cerr << "ookThreadOptions: could not set scheduling policy: " << strerror(iErr) << endl;
+				bOk = false;
+			}
+		}
+		
+		if(!name.empty())
+		{
+			string threadName = name;
+			
+			if(iWorker >= 0)
+				threadName += "-" + ookString::ConvertInt2String(iWorker);
+			
+			//The kernel keeps 15 characters plus the terminator
+			if(threadName.length() > 15)
+				threadName = threadName.substr(0, 15);
+			
+			pthread_setname_np(pthread_self(), threadName.c_str());
+		}
+	#else
+		bOk = this->IsEmpty();
+	#endif
+	
+	return bOk;
+}
+
+/*! 
+ \brief The CPUs this process may run on.
+ */
+vector<int> ookThreadOptions::GetAvailableCPUs()
+{
+	vector<int> vRet;
+	
+	#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		
+		if(sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			for(int i = 0; i < CPU_SETSIZE; i++)
+				if(CPU_ISSET(i, &set))
+					vRet.push_back(i);
+		}
+	#endif
+	
+	if(vRet.empty())
+		for(unsigned int i = 0; i < std::max(1u, boost::thread::hardware_concurrency()); i++)
+			vRet.push_back(i);
+	
+	return vRet;
+}
+
+/*! 
+ \brief The ids of the online NUMA nodes. They may have gaps, and a node
+ may have memory but no CPUs. Just node 0 if the kernel doesn't say.
+ */
+vector<int> ookThreadOptions::GetNUMANodes()
+{
+	std::ifstream in("/sys/devices/system/node/online");
+	
+	string list;
+	vector<int> vRet;
+	
+	if(in && getline(in, list))
+		vRet = ookThreadOptions::ParseCPUList(list);
+	
+	if(vRet.empty())
+		vRet.push_back(0);
+	
+	return vRet;
+}
+
+int ookThreadOptions::GetNUMANodeCount()
+{
+	return (int) ookThreadOptions::GetNUMANodes().size();
+}
+
+/*! 
+ \brief The NUMA node iCPU belongs to, or -1 if unknown.
+ */
+int ookThreadOptions::GetNUMANodeOfCPU(int iCPU)
+{
+	vector<int> vNodes = ookThreadOptions::GetNUMANodes();
+	
+	for(size_t i = 0; i < vNodes.size(); i++)
+	{
+		vector<int> vCPUs = ookThreadOptions::GetNUMANodeCPUs(vNodes[i]);
+		
+		if(std::find(vCPUs.begin(), vCPUs.end(), iCPU) != vCPUs.end())
+			return vNodes[i];
+	}
+	
+	return -1;
+}
+
+/*! 
+ \brief The CPUs on NUMA node iNode; empty if there is no such node.
+ */
+vector<int> ookThreadOptions::GetNUMANodeCPUs(int iNode)
+{
+	std::ifstream in(("/sys/devices/system/node/node" + ookString::ConvertInt2String(iNode) + "/cpulist").c_str());
+	
+	string list;
+	if(!in || !getline(in, list))
+		return vector<int>();
+	
+	return ookThreadOptions::ParseCPUList(list);
+}
+
+int ookThreadOptions::GetCurrentCPU()
+{
+	#ifdef __linux__
+		return sched_getcpu();
+	#else
+		return -1;
+	#endif
+}
+
+//The CPUs in vCPUs this process may run on; under taskset or a cgroup
+//cpuset a node's CPUs aren't all ours to pin to
+vector<int> ookThreadOptions::GetAllowed(const vector<int>& vCPUs)
+{
+	vector<int> vAvail = ookThreadOptions::GetAvailableCPUs();
+	vector<int> vRet;
+	
+	for(size_t i = 0; i < vCPUs.size(); i++)
+		if(std::find(vAvail.begin(), vAvail.end(), vCPUs[i]) != vAvail.end())
+			vRet.push_back(vCPUs[i]);
+	
+	return vRet;
+}
+
+//Parses the kernel's "0-3,8,10-11" format
+vector<int> ookThreadOptions::ParseCPUList(string list)
+{
+	vector<int> vRet;
+	vector<string> ranges = ookString::Split(list, ",");
+	
+	for(size_t i = 0; i < ranges.size(); i++)
+	{
+		string range = boost::algorithm::trim_copy(ranges[i]);
+		if(range.empty())
+			continue;
+		
+		size_t iDash = range.find('-');
+		int iFirst = atoi(range.substr(0, iDash).c_str());
+		int iLast = (iDash == string::npos) ? iFirst : atoi(range.substr(iDash + 1).c_str());
+		
+		for(int iCPU = iFirst; iCPU <= iLast; iCPU++)
+			vRet.push_back(iCPU);
+	}
+	
+	return vRet;
+}
\ No newline at end of file
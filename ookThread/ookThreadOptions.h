@@ -0,0 +1,69 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_THREAD_OPTIONS_H_
+#define OOK_THREAD_OPTIONS_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+
+class ookThreadOptions
+{
+public:
+	
+	ookThreadOptions();
+	virtual ~ookThreadOptions();
+	
+	bool Apply(int iWorker = -1) const;
+	bool IsEmpty() const;
+	
+	static vector<int> GetAvailableCPUs();
+	static vector<int> GetNUMANodes();
+	static int GetNUMANodeCount();
+	static int GetNUMANodeOfCPU(int iCPU);
+	static vector<int> GetNUMANodeCPUs(int iNode);
+	static int GetCurrentCPU();
+	
+	vector<int> vCPUs;		//Allowed CPUs; empty leaves the affinity alone
+	int iNUMANode;				//Preferred node for CPUs and memory; -1 for none
+	bool bPinPerCore;			//Pools: worker i gets the i-th available CPU to itself
+	int iSchedPolicy;			//SCHED_OTHER, SCHED_FIFO, SCHED_RR...; -1 leaves it alone
+	int iPriority;				//Static priority for SCHED_FIFO/SCHED_RR
+	string name;					//Visible in top -H, ps -L and perf; at most 15 characters
+	
+protected:
+	
+	static vector<int> ParseCPUList(string list);
+	static vector<int> GetAllowed(const vector<int>& vCPUs);
+	
+private:
+	
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,267 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookThreadPool
+ \headerfile ookThreadPool.h "ookLibs/ookThread/ookThreadPool.h"
+ \brief Executor which runs queued tasks on a set of reusable worker
+ threads, so short lived work doesn't pay for creating and tearing down a
+ thread each time.
+ 
+ A fixed pool keeps exactly iThreads workers. An elastic pool keeps
+ iMinThreads workers and adds more, up to iMaxThreads, whenever a task is
+ queued and no worker is idle. Workers above the minimum exit after
+ sitting idle for iIdleTimeoutMs.
+ 
+ \code
+ 
+ ookThreadPool pool(4, 64);
+ 
+ pool.Execute(boost::bind(&Job::Process, job));
+ 
+ boost::shared_future<int> result = pool.Submit<int>(boost::bind(&Compute, 42));
+ cout << result.get() << endl;
+ 
+ \endcode
+ 
+ ookThread subclasses can run on a pool with ookThread::Start(pool). Their
+ Run() holds a worker for as long as it loops, so long running threads
+ such as server connections should go on an elastic pool.
+ */
+#include "ookLibs/ookThread/ookThreadPool.h"
+
+/*! 
+ \brief Fixed size pool. iThreads of 0 means one worker per hardware
+ thread. Every worker applies opts when it starts; see ookThreadOptions.
+ */
+ookThreadPool::ookThreadPool(int iThreads, const ookThreadOptions& opts)
+	: _options(opts)
+{
+	if(iThreads <= 0)
+		iThreads = std::max(1u, boost::thread::hardware_concurrency());
+	
+	this->Init(iThreads, iThreads, 0);
+}
+
+/*! 
+ \brief Elastic pool which grows from iMinThreads up to iMaxThreads under
+ load.
+ */
+ookThreadPool::ookThreadPool(int iMinThreads, int iMaxThreads, int iIdleTimeoutMs, const ookThreadOptions& opts)
+	: _options(opts)
+{
+	this->Init(iMinThreads, iMaxThreads, iIdleTimeoutMs);
+}
+
+ookThreadPool::~ookThreadPool()
+{
+	try
+	{
+		this->Shutdown();
+	}
+	catch (...)
+	{
+	}
+}
+
+void ookThreadPool::Init(int iMinThreads, int iMaxThreads, int iIdleTimeoutMs)
+{
+	_iMinThreads = std::max(0, iMinThreads);
+	_iMaxThreads = std::max(std::max(1, _iMinThreads), iMaxThreads);
+	_iIdleTimeoutMs = iIdleTimeoutMs;
+	_iThreads = 0;
+	_iIdle = 0;
+	_bShutdown = false;
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	for(int i = 0; i < _iMinThreads; i++)
+		this->SpawnWorker();
+}
+
+/*! 
+ \brief Queues a task. Throws ookException once the pool is shut down.
+ */
+void ookThreadPool::Execute(ook_task task)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	if(_bShutdown)
+		throw ookException("ookThreadPool::Execute called after Shutdown");
+	
+	_queue.push_back(task);
+	
+	if(((int) _queue.size() > _iIdle) && (_iThreads < _iMaxThreads))
+	{
+		this->ReapWorkers();
+		this->SpawnWorker();
+	}
+	
+	_cond.notify_one();
+}
+
+/*! 
+ \brief Stops taking new tasks, lets the workers finish everything that is
+ already queued and joins them.
+ */
+void ookThreadPool::Shutdown()
+{
+	vector<boost::shared_ptr<boost::thread> > vJoin;
+	
+	{
+		boost::mutex::scoped_lock lock(_mut);
+		
+		_bShutdown = true;
+		_cond.notify_all();
+		
+		std::map<boost::thread::id, boost::shared_ptr<boost::thread> >::iterator it;
+		for(it = _workers.begin(); it != _workers.end(); ++it)
+			vJoin.push_back(it->second);
+		
+		vJoin.insert(vJoin.end(), _vRetired.begin(), _vRetired.end());
+		_vRetired.clear();
+	}
+	
+	for(size_t i = 0; i < vJoin.size(); i++)
+		if(vJoin[i]->get_id() != boost::this_thread::get_id())
+			vJoin[i]->join();
+}
+
+int ookThreadPool::GetThreadCount()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _iThreads;
+}
+
+int ookThreadPool::GetIdleCount()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _iIdle;
+}
+
+size_t ookThreadPool::GetQueueSize()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	return _queue.size();
+}
+
+//Called with _mut held
+void ookThreadPool::SpawnWorker()
+{
+	size_t iSlot = 0;
+	while((iSlot < _vSlots.size()) && _vSlots[iSlot])
+		iSlot++;
+	
+	if(iSlot == _vSlots.size())
+		_vSlots.push_back(true);
+	else
+		_vSlots[iSlot] = true;
+	
+	boost::shared_ptr<boost::thread> thrd(new boost::thread(&ookThreadPool::WorkerLoop, this, (int) iSlot));
+	_workers[thrd->get_id()] = thrd;
+	_iThreads++;
+}
+
+//Called with _mut held. Retired workers have left WorkerLoop, so joining
+//them here only waits out their last few instructions.
+void ookThreadPool::ReapWorkers()
+{
+	for(size_t i = 0; i < _vRetired.size(); i++)
+		_vRetired[i]->join();
+	
+	_vRetired.clear();
+}
+
+void ookThreadPool::WorkerLoop(int iSlot)
+{
+	if(!_options.IsEmpty())
+		_options.Apply(iSlot);
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	for(;;)
+	{
+		bool bTimedOut = false;
+		
+		while(_queue.empty() && !_bShutdown && !bTimedOut)
+		{
+			_iIdle++;
+			
+			if(_iThreads > _iMinThreads)
+				bTimedOut = !_cond.timed_wait(lock, boost::posix_time::milliseconds(_iIdleTimeoutMs));
+			else
+				_cond.wait(lock);
+			
+			_iIdle--;
+		}
+		
+		if(_queue.empty())
+		{
+			//Either shutting down, or an idle worker above the minimum
+			if(_bShutdown || (_iThreads > _iMinThreads))
+				break;
+			
+			continue;
+		}
+		
+		ook_task task = _queue.front();
+		_queue.pop_front();
+		
+		lock.unlock();
+		
+		try
+		{
+			task();
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << "Something bad happened in ookThreadPool::WorkerLoop: " << e.what() << endl;
+		}
+		catch(...)
+		{
+			std::cerr << "Oh noes! Unknown error in ookThreadPool::WorkerLoop()" << endl;
+		}
+		
+		lock.lock();
+	}
+	
+	_iThreads--;
+	_vSlots[iSlot] = false;
+	
+	std::map<boost::thread::id, boost::shared_ptr<boost::thread> >::iterator it = _workers.find(boost::this_thread::get_id());
+	if(it != _workers.end())
+	{
+		if(!_bShutdown)
+			_vRetired.push_back(it->second);
+		
+		_workers.erase(it);
+	}
+}
\ No newline at end of file
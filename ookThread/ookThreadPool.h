@@ -0,0 +1,87 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_THREAD_POOL_H_
+#define OOK_THREAD_POOL_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "ookLibs/ookThread/ookThreadOptions.h"
+#include "boost/thread.hpp"
+#include "boost/shared_ptr.hpp"
+
+#include <deque>
+
+class ookThreadPool : public ookExecutor
+{
+public:
+	
+	ookThreadPool(int iThreads = 0, const ookThreadOptions& opts = ookThreadOptions());
+	ookThreadPool(int iMinThreads, int iMaxThreads, int iIdleTimeoutMs = 30000,
+								const ookThreadOptions& opts = ookThreadOptions());
+	virtual ~ookThreadPool();
+	
+	virtual void Execute(ook_task task);
+	virtual void Shutdown();
+	
+	int GetThreadCount();
+	int GetIdleCount();
+	size_t GetQueueSize();
+	
+protected:
+	
+	void Init(int iMinThreads, int iMaxThreads, int iIdleTimeoutMs);
+	void SpawnWorker();
+	void ReapWorkers();
+	void WorkerLoop(int iSlot);
+	
+private:
+	
+	int _iMinThreads;
+	int _iMaxThreads;
+	int _iIdleTimeoutMs;
+	ookThreadOptions _options;
+	
+	//Worker numbers in use, so pinned workers that come and go reuse CPUs
+	vector<bool> _vSlots;
+	
+	int _iThreads;
+	int _iIdle;
+	bool _bShutdown;
+	
+	std::deque<ook_task> _queue;
+	std::map<boost::thread::id, boost::shared_ptr<boost::thread> > _workers;
+	vector<boost::shared_ptr<boost::thread> > _vRetired;
+	
+	boost::mutex _mut;
+	boost::condition_variable _cond;
+};
+
+#endif
\ No newline at end of file
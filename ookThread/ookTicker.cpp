@@ -0,0 +1,142 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookTicker
+ \headerfile ookTicker.h "ookLibs/ookThread/ookTicker.h"
+ \brief Paces a loop at a fixed period without drift.
+ 
+ Ticks are scheduled as start + n * period on the monotonic clock rather
+ than "now + period", so the time the loop body takes and any wake up
+ latency don't accumulate. If the body overruns by whole periods, those
+ ticks are skipped instead of being fired back to back. Wait() reports
+ how many were skipped.
+ 
+ \code
+ 
+ ookTicker ticker(boost::chrono::microseconds(500), true);
+ 
+ while(this->IsRunning())
+ {
+ 	long lMissed = ticker.Wait();
+ 	this->Poll();
+ }
+ 
+ \endcode
+ 
+ With bHybrid the wait spins through the last few microseconds (see
+ ookHybridWait) for sub-millisecond accuracy at the cost of some CPU.
+ */
+#include "ookLibs/ookThread/ookTicker.h"
+
+ookTicker::ookTicker(boost::chrono::nanoseconds period, bool bHybrid)
+	: _period(period), _bStarted(false), _bHybrid(bHybrid), _lMissed(0)
+{
+	if(_period.count() <= 0)
+		throw ookException("ookTicker: period must be positive");
+}
+
+ookTicker::~ookTicker()
+{
+	
+}
+
+/*! 
+ \brief (Re)starts the schedule so the first tick is one period from now.
+ Wait() calls this itself the first time.
+ */
+void ookTicker::Start()
+{
+	_next = ook_clock::now() + _period;
+	_bStarted = true;
+}
+
+/*! 
+ \brief Blocks until the next tick.
+ 
+ \return the number of ticks skipped because we were already late by one
+ or more whole periods; normally 0.
+ */
+long ookTicker::Wait()
+{
+	if(!_bStarted)
+		this->Start();
+	
+	ook_clock::time_point now = ook_clock::now();
+	long lMissed = 0;
+	
+	if(now < _next)
+	{
+		if(_bHybrid)
+			_wait.WaitUntil(_next);
+		else
+			ookClock::SleepUntil(_next);
+	}
+	else
+		lMissed = (long) ((now - _next) / _period);
+	
+	_next += _period * (lMissed + 1);
+	_lMissed += lMissed;
+	
+	return lMissed;
+}
+
+/*! 
+ \brief Changes the period from the next tick on.
+ */
+void ookTicker::SetPeriod(boost::chrono::nanoseconds period)
+{
+	if(period.count() <= 0)
+		throw ookException("ookTicker: period must be positive");
+	
+	if(_bStarted)
+		_next += period - _period;
+	
+	_period = period;
+}
+
+boost::chrono::nanoseconds ookTicker::GetPeriod() const
+{
+	return _period;
+}
+
+ook_clock::time_point ookTicker::GetNextTick() const
+{
+	return _next;
+}
+
+/*! 
+ \brief Total ticks skipped since construction.
+ */
+long ookTicker::GetMissedTicks() const
+{
+	return _lMissed;
+}
\ No newline at end of file
@@ -0,0 +1,503 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookTimerWheel
+ \headerfile ookTimerWheel.h "ookLibs/ookThread/ookTimerWheel.h"
+ \brief Hierarchical timer wheel: one thread serves every timeout, retry
+ and periodic job in the process.
+ 
+ Timers live in five wheels. The first has 256 slots of one tick each,
+ and each of the other four has 64 slots, each covering 64 times the span
+ of the wheel below. That spans 2^32 ticks, about 49 days at the default
+ 1ms tick, and longer delays are parked and re-filed as they come closer.
+ Schedule() and Cancel() link or unlink a node in a slot list, O(1)
+ whatever the number of timers. Nodes come from a slab with a free list,
+ so a million timeouts are a million small structs, not a million
+ threads or heap blocks.
+ 
+ The service thread processes one slot per tick and refiles a higher
+ wheel's slot into the lower ones when the lower wheel wraps. It does not
+ wake every tick: it skips straight to the next occupied slot or wrap,
+ and sleeps indefinitely when there are no timers.
+ 
+ Expired callbacks run on the executor given to the constructor, or on
+ the timer thread itself when there is none. Callbacks on the timer
+ thread should be short, because they delay every other timer.
+ 
+ \code
+ 
+ ookThreadPool pool(4);
+ ookTimerWheel timers(boost::chrono::milliseconds(1), &pool);
+ timers.Start();
+ 
+ ook_timer_id id = timers.Schedule(boost::chrono::seconds(30),
+                                   boost::bind(&ookConn::OnIdleTimeout, conn));
+ ...
+ timers.Cancel(id);	//Data arrived in time
+ 
+ timers.SchedulePeriodic(boost::chrono::seconds(1), boost::bind(&ookStats::Flush, &stats));
+ 
+ \endcode
+ 
+ A timer never fires early. It fires at most one tick plus scheduling
+ latency late. Periodic timers keep to their original phase and skip
+ periods they missed, like ookTicker. An id stays unique after its timer
+ is gone, so cancelling a stale id is harmless and returns false.
+ Cancel() can't recall a callback that has already been handed to the
+ executor.
+ */
+#include "ookLibs/ookThread/ookTimerWheel.h"
+
+#include <limits>
+
+static const int OOK_TW_LEVELS = 5;
+static const int OOK_TW_ROOT_BITS = 8;
+static const int OOK_TW_LEVEL_BITS = 6;
+static const int OOK_TW_ROOT_SIZE = 1 << OOK_TW_ROOT_BITS;
+static const int OOK_TW_LEVEL_SIZE = 1 << OOK_TW_LEVEL_BITS;
+static const boost::uint64_t OOK_TW_MAX_DELTA = 1ULL << (OOK_TW_ROOT_BITS + (OOK_TW_LEVELS - 1) * OOK_TW_LEVEL_BITS);
+static const boost::uint64_t OOK_TW_NEVER = std::numeric_limits<boost::uint64_t>::max();
+
+//Expiry bits that index a level's slots
+static int ookTimerWheelShift(int iLevel)
+{
+	return (iLevel == 0) ? 0 : OOK_TW_ROOT_BITS + (iLevel - 1) * OOK_TW_LEVEL_BITS;
+}
+
+//First slot of a level in the flat slot vector
+static int ookTimerWheelBase(int iLevel)
+{
+	return (iLevel == 0) ? 0 : OOK_TW_ROOT_SIZE + (iLevel - 1) * OOK_TW_LEVEL_SIZE;
+}
+
+static int ookTimerWheelLevelOf(int iSlot)
+{
+	return (iSlot < OOK_TW_ROOT_SIZE) ? 0 : 1 + (iSlot - OOK_TW_ROOT_SIZE) / OOK_TW_LEVEL_SIZE;
+}
+
+/*! 
+ \brief Constructor. tick is the resolution. Expired callbacks go to pool
+ if it isn't NULL. The wheel doesn't run until Start().
+ */
+ookTimerWheel::ookTimerWheel(boost::chrono::nanoseconds tick, ookExecutor* pool)
+	: _tick(tick), _start(ook_clock::now()), _pPool(pool), _lCurrent(0), _lNextWake(0), _iFree(-1), _iCount(0),
+		_vSlots(ookTimerWheelBase(OOK_TW_LEVELS), -1), _vLevelCounts(OOK_TW_LEVELS, 0)
+{
+	if(_tick.count() <= 0)
+		throw ookException("ookTimerWheel: tick must be positive");
+}
+
+ookTimerWheel::~ookTimerWheel()
+{
+	try
+	{
+		this->Stop();
+		this->Join();
+	}
+	catch (...)
+	{
+	}
+}
+
+/*! 
+ \brief Runs callback once, delay from now.
+ 
+ \return An id for Cancel().
+ */
+ook_timer_id ookTimerWheel::Schedule(boost::chrono::nanoseconds delay, ook_task callback)
+{
+	return this->ScheduleAt(ook_clock::now() + delay, callback);
+}
+
+ook_timer_id ookTimerWheel::ScheduleAt(ook_clock::time_point when, ook_task callback)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	return this->Add(this->GetTicksAt(when, true), 0, callback);
+}
+
+/*! 
+ \brief Runs callback every period, the first time one period from now,
+ until it is cancelled.
+ */
+ook_timer_id ookTimerWheel::SchedulePeriodic(boost::chrono::nanoseconds period, ook_task callback)
+{
+	boost::uint64_t lPeriod = std::max((boost::uint64_t) 1, (boost::uint64_t) ((period.count() + _tick.count() - 1) / _tick.count()));
+	
+	boost::mutex::scoped_lock lock(_mut);
+	
+	return this->Add(this->GetTicksAt(ook_clock::now(), true) + lPeriod, lPeriod, callback);
+}
+
+/*! 
+ \return true if the timer was pending and will now never run. false if it
+ already ran, is running, or was cancelled before.
+ */
+bool ookTimerWheel::Cancel(ook_timer_id id)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	int iNode = this->Find(id);
+	
+	if(iNode < 0)
+		return false;
+	
+	this->Unlink(iNode);
+	this->Release(iNode);
+	
+	return true;
+}
+
+bool ookTimerWheel::IsPending(ook_timer_id id)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	return (this->Find(id) >= 0);
+}
+
+void ookTimerWheel::SetExecutor(ookExecutor* pool)
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_pPool = pool;
+}
+
+size_t ookTimerWheel::GetTimerCount()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	return _iCount;
+}
+
+boost::chrono::nanoseconds ookTimerWheel::GetTick() const
+{
+	return _tick;
+}
+
+void ookTimerWheel::Run()
+{
+	vector<ook_task> due;
+	boost::mutex::scoped_lock lock(_mut);
+	
+	while(this->IsRunning())
+	{
+		boost::uint64_t lNow = this->GetTicksAt(ook_clock::now(), false);
+		
+		while(_lCurrent <= lNow)
+		{
+			//Ticks with nothing in their slot and no wrap can be skipped
+			boost::uint64_t lEvent = this->GetNextEventTick();
+			
+			if(lEvent > lNow)
+			{
+				_lCurrent = lNow + 1;
+				break;
+			}
+			
+			_lCurrent = lEvent;
+			this->Tick(due);
+		}
+		
+		if(!due.empty())
+		{
+			ookExecutor* pool = _pPool;
+			
+			lock.unlock();
+			this->Dispatch(due, pool);
+			lock.lock();
+			
+			continue;
+		}
+		
+		_lNextWake = this->GetNextEventTick();
+		
+		if(_lNextWake == OOK_TW_NEVER)
+			_cond.wait(lock);
+		else
+			_cond.wait_until(lock, _start + boost::chrono::nanoseconds(_tick.count() * (long long) _lNextWake));
+		
+		//Awake, so Add() needn't notify until the next wait
+		_lNextWake = 0;
+	}
+}
+
+void ookTimerWheel::OnStop()
+{
+	boost::mutex::scoped_lock lock(_mut);
+	
+	_cond.notify_all();
+}
+
+//Must be called with _mut held
+ook_timer_id ookTimerWheel::Add(boost::uint64_t lExpires, boost::uint64_t lPeriod, ook_task callback)
+{
+	int iNode = _iFree;
+	
+	if(iNode >= 0)
+		_iFree = _nodes[iNode].iNext;
+	else
+	{
+		iNode = (int) _nodes.size();
+		_nodes.push_back(ookTimerNode());
+	}
+	
+	ookTimerNode& node = _nodes[iNode];
+	node.callback = callback;
+	node.lExpires = lExpires;
+	node.lPeriod = lPeriod;
+	_iCount++;
+	
+	this->Insert(iNode);
+	
+	//The service thread is asleep past this timer
+	if(lExpires < _lNextWake)
+		_cond.notify_one();
+	
+	return ((ook_timer_id) node.iGeneration << 32) | (ook_timer_id) (iNode + 1);
+}
+
+//The node for id if it is still pending, otherwise -1
+int ookTimerWheel::Find(ook_timer_id id)
+{
+	long long lIndex = (long long) (id & 0xFFFFFFFFULL) - 1;
+	
+	if((lIndex < 0) || (lIndex >= (long long) _nodes.size()))
+		return -1;
+	
+	ookTimerNode& node = _nodes[(size_t) lIndex];
+	
+	if((node.iGeneration != (boost::uint32_t) (id >> 32)) || (node.iSlot < 0))
+		return -1;
+	
+	return (int) lIndex;
+}
+
+/*
+ Files a node by how far off it is: under 256 ticks in the root wheel by
+ its exact tick, otherwise in the lowest wheel whose span covers it.
+ */
+void ookTimerWheel::Insert(int iNode)
+{
+	ookTimerNode& node = _nodes[iNode];
+	
+	boost::uint64_t lExpires = std::max(node.lExpires, _lCurrent);
+	boost::uint64_t lDelta = lExpires - _lCurrent;
+	
+	//Parked at the far end, and re-filed from there when it comes round
+	if(lDelta >= OOK_TW_MAX_DELTA)
+	{
+		lDelta = OOK_TW_MAX_DELTA - 1;
+		lExpires = _lCurrent + lDelta;
+	}
+	
+	int iLevel = 0;
+	while((iLevel < OOK_TW_LEVELS - 1) && (lDelta >= (1ULL << ookTimerWheelShift(iLevel + 1))))
+		iLevel++;
+	
+	int iMask = (iLevel == 0) ? (OOK_TW_ROOT_SIZE - 1) : (OOK_TW_LEVEL_SIZE - 1);
+	int iSlot = ookTimerWheelBase(iLevel) + (int) ((lExpires >> ookTimerWheelShift(iLevel)) & iMask);
+	
+	node.iSlot = iSlot;
+	node.iPrev = -1;
+	node.iNext = _vSlots[iSlot];
+	
+	if(node.iNext >= 0)
+		_nodes[node.iNext].iPrev = iNode;
+	
+	_vSlots[iSlot] = iNode;
+	_vLevelCounts[iLevel]++;
+}
+
+void ookTimerWheel::Unlink(int iNode)
+{
+	ookTimerNode& node = _nodes[iNode];
+	
+	if(node.iPrev >= 0)
+		_nodes[node.iPrev].iNext = node.iNext;
+	else
+		_vSlots[node.iSlot] = node.iNext;
+	
+	if(node.iNext >= 0)
+		_nodes[node.iNext].iPrev = node.iPrev;
+	
+	_vLevelCounts[ookTimerWheelLevelOf(node.iSlot)]--;
+	
+	node.iSlot = -1;
+	node.iPrev = -1;
+	node.iNext = -1;
+}
+
+//Returns an unlinked node to the free list and retires its id
+void ookTimerWheel::Release(int iNode)
+{
+	ookTimerNode& node = _nodes[iNode];
+	
+	node.callback = ook_task();
+	node.iGeneration++;
+	node.iNext = _iFree;
+	
+	_iFree = iNode;
+	_iCount--;
+}
+
+//Processes tick _lCurrent, collecting what expired in due
+void ookTimerWheel::Tick(vector<ook_task>& due)
+{
+	boost::uint64_t lTick = _lCurrent;
+	
+	//The root wheel wrapped, so bring the next slot of each wheel above down,
+	//going further up only while those wrap too
+	if((lTick & (OOK_TW_ROOT_SIZE - 1)) == 0)
+	{
+		for(int iLevel = 1; iLevel < OOK_TW_LEVELS; iLevel++)
+		{
+			int iIndex = (int) ((lTick >> ookTimerWheelShift(iLevel)) & (OOK_TW_LEVEL_SIZE - 1));
+			this->Cascade(iLevel, iIndex);
+			
+			if(iIndex != 0)
+				break;
+		}
+	}
+	
+	int iSlot = (int) (lTick & (OOK_TW_ROOT_SIZE - 1));
+	
+	while(_vSlots[iSlot] >= 0)
+	{
+		int iNode = _vSlots[iSlot];
+		this->Unlink(iNode);
+		
+		ookTimerNode& node = _nodes[iNode];
+		
+		if(node.lExpires > lTick)
+		{
+			this->Insert(iNode);
+			continue;
+		}
+		
+		due.push_back(node.callback);
+		
+		if(node.lPeriod > 0)
+		{
+			node.lExpires += node.lPeriod;
+			
+			if(node.lExpires <= lTick)
+				node.lExpires += ((lTick - node.lExpires) / node.lPeriod + 1) * node.lPeriod;
+			
+			this->Insert(iNode);
+		}
+		else
+			this->Release(iNode);
+	}
+	
+	_lCurrent = lTick + 1;
+}
+
+void ookTimerWheel::Cascade(int iLevel, int iIndex)
+{
+	int iSlot = ookTimerWheelBase(iLevel) + iIndex;
+	
+	while(_vSlots[iSlot] >= 0)
+	{
+		int iNode = _vSlots[iSlot];
+		
+		this->Unlink(iNode);
+		this->Insert(iNode);
+	}
+}
+
+/*
+ The first tick at or after _lCurrent that has work: an occupied root slot,
+ or a wrap that cascades an occupied wheel above.
+ */
+boost::uint64_t ookTimerWheel::GetNextEventTick()
+{
+	boost::uint64_t lNext = OOK_TW_NEVER;
+	
+	for(int iLevel = 1; iLevel < OOK_TW_LEVELS; iLevel++)
+	{
+		if(_vLevelCounts[iLevel] > 0)
+		{
+			boost::uint64_t lMask = (1ULL << ookTimerWheelShift(iLevel)) - 1;
+			lNext = (_lCurrent + lMask) & ~lMask;
+			break;
+		}
+	}
+	
+	if(_vLevelCounts[0] > 0)
+	{
+		for(boost::uint64_t lTick = _lCurrent; (lTick < _lCurrent + OOK_TW_ROOT_SIZE) && (lTick < lNext); lTick++)
+		{
+			if(_vSlots[(int) (lTick & (OOK_TW_ROOT_SIZE - 1))] >= 0)
+				return lTick;
+		}
+	}
+	
+	return lNext;
+}
+
+boost::uint64_t ookTimerWheel::GetTicksAt(ook_clock::time_point when, bool bRoundUp)
+{
+	if(when <= _start)
+		return 0;
+	
+	long long llNanos = boost::chrono::duration_cast<boost::chrono::nanoseconds>(when - _start).count();
+	boost::uint64_t lTicks = (boost::uint64_t) (llNanos / _tick.count());
+	
+	if(bRoundUp && (llNanos % _tick.count()))
+		lTicks++;
+	
+	return lTicks;
+}
+
+void ookTimerWheel::Dispatch(vector<ook_task>& due, ookExecutor* pool)
+{
+	for(size_t i = 0; i < due.size(); i++)
+	{
+		try
+		{
+			if(pool)
+				pool->Execute(due[i]);
+			else
+				due[i]();
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << "Something bad happened in ookTimerWheel::Dispatch: " << e.what() << endl;
+		}
+		catch(...)
+		{
+			std::cerr << "Oh noes! Unknown error in ookTimerWheel::Dispatch()" << endl;
+		}
+	}
+	
+	due.clear();
+}
\ No newline at end of file
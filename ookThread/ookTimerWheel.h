@@ -0,0 +1,119 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_TIMER_WHEEL_H_
+#define OOK_TIMER_WHEEL_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookThread.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "ookLibs/ookThread/ookClock.h"
+#include "boost/cstdint.hpp"
+
+#include <deque>
+
+//Generation in the high 32 bits, slab index + 1 in the low; 0 is never a timer
+typedef boost::uint64_t ook_timer_id;
+
+class ookTimerWheel : public ookThread
+{
+public:
+	
+	ookTimerWheel(boost::chrono::nanoseconds tick = boost::chrono::milliseconds(1), ookExecutor* pool = NULL);
+	virtual ~ookTimerWheel();
+	
+	ook_timer_id Schedule(boost::chrono::nanoseconds delay, ook_task callback);
+	ook_timer_id ScheduleAt(ook_clock::time_point when, ook_task callback);
+	ook_timer_id SchedulePeriodic(boost::chrono::nanoseconds period, ook_task callback);
+	bool Cancel(ook_timer_id id);
+	bool IsPending(ook_timer_id id);
+	
+	void SetExecutor(ookExecutor* pool);
+	
+	size_t GetTimerCount();
+	boost::chrono::nanoseconds GetTick() const;
+	
+	virtual void Run();
+	
+protected:
+	
+	struct ookTimerNode
+	{
+		ookTimerNode() : lExpires(0), lPeriod(0), iGeneration(0), iPrev(-1), iNext(-1), iSlot(-1) {}
+		
+		ook_task callback;
+		boost::uint64_t lExpires;
+		boost::uint64_t lPeriod;
+		boost::uint32_t iGeneration;
+		
+		//Slot list links, or the free list through iNext
+		int iPrev;
+		int iNext;
+		int iSlot;
+	};
+	
+	virtual void OnStop();
+	
+	ook_timer_id Add(boost::uint64_t lExpires, boost::uint64_t lPeriod, ook_task callback);
+	int Find(ook_timer_id id);
+	
+	void Insert(int iNode);
+	void Unlink(int iNode);
+	void Release(int iNode);
+	
+	void Tick(vector<ook_task>& due);
+	void Cascade(int iLevel, int iIndex);
+	boost::uint64_t GetNextEventTick();
+	
+	boost::uint64_t GetTicksAt(ook_clock::time_point when, bool bRoundUp);
+	void Dispatch(vector<ook_task>& due, ookExecutor* pool);
+	
+private:
+	
+	boost::chrono::nanoseconds _tick;
+	ook_clock::time_point _start;
+	ookExecutor* _pPool;
+	
+	boost::mutex _mut;
+	boost::condition_variable _cond;
+	
+	//Next tick to process, and when the service thread means to wake up
+	boost::uint64_t _lCurrent;
+	boost::uint64_t _lNextWake;
+	
+	std::deque<ookTimerNode> _nodes;
+	int _iFree;
+	size_t _iCount;
+	
+	vector<int> _vSlots;
+	vector<size_t> _vLevelCounts;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookWorkStealingDeque
+ \headerfile ookWorkStealingDeque.h "ookLibs/ookThread/ookWorkStealingDeque.h"
+ \brief Lock-free Chase-Lev work-stealing deque of task pointers.
+ 
+ The owning worker pushes and pops at the bottom (LIFO, so it keeps
+ working on what it just spawned while that is still in cache). Other
+ workers steal from the top (FIFO, so they take the oldest and usually
+ largest piece of work). Only a pop racing a steal for the last element
+ needs a CAS.
+ 
+ The memory orderings follow Le, Pop, Cohen and Zappa Nardelli, "Correct
+ and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ */
+#include "ookLibs/ookThread/ookWorkStealingDeque.h"
+
+ookWorkStealingDeque::ookWSArray::ookWSArray(long lCap)
+	: lCapacity(lCap), lMask(lCap - 1)
+{
+	slots = new boost::atomic<ook_task*>[lCapacity];
+}
+
+ookWorkStealingDeque::ookWSArray::~ookWSArray()
+{
+	delete [] slots;
+}
+
+ook_task* ookWorkStealingDeque::ookWSArray::Get(long i) const
+{
+	return slots[i & lMask].load(boost::memory_order_relaxed);
+}
+
+void ookWorkStealingDeque::ookWSArray::Put(long i, ook_task* task)
+{
+	slots[i & lMask].store(task, boost::memory_order_relaxed);
+}
+
+ookWorkStealingDeque::ookWSArray* ookWorkStealingDeque::ookWSArray::Grow(long lBottom, long lTop) const
+{
+	ookWSArray* bigger = new ookWSArray(lCapacity * 2);
+	
+	for(long i = lTop; i < lBottom; i++)
+		bigger->Put(i, this->Get(i));
+	
+	return bigger;
+}
+
+/*! 
+ \brief Constructor. lCapacity is rounded up to a power of two; the deque
+ grows past it as needed.
+ */
+ookWorkStealingDeque::ookWorkStealingDeque(long lCapacity)
+	: _lTop(0), _lBottom(0)
+{
+	long lCap = 2;
+	while(lCap < lCapacity)
+		lCap <<= 1;
+	
+	_pArray.store(new ookWSArray(lCap), boost::memory_order_relaxed);
+}
+
+ookWorkStealingDeque::~ookWorkStealingDeque()
+{
+	//Whatever is left was never run
+	long lTop = _lTop.load(boost::memory_order_relaxed);
+	long lBottom = _lBottom.load(boost::memory_order_relaxed);
+	ookWSArray* array = _pArray.load(boost::memory_order_relaxed);
+	
+	for(long i = lTop; i < lBottom; i++)
+		delete array->Get(i);
+	
+	delete array;
+	
+	for(size_t i = 0; i < _vRetired.size(); i++)
+		delete _vRetired[i];
+}
+
+void ookWorkStealingDeque::Push(ook_task* task)
+{
+	long lBottom = _lBottom.load(boost::memory_order_relaxed);
+	long lTop = _lTop.load(boost::memory_order_acquire);
+	ookWSArray* array = _pArray.load(boost::memory_order_relaxed);
+	
+	if(lBottom - lTop > array->lCapacity - 1)
+	{
+		_vRetired.push_back(array);
+		array = array->Grow(lBottom, lTop);
+		_pArray.store(array, boost::memory_order_release);
+	}
+	
+	array->Put(lBottom, task);
+	boost::atomic_thread_fence(boost::memory_order_release);
+	_lBottom.store(lBottom + 1, boost::memory_order_relaxed);
+}
+
+/*! 
+ \brief Takes the most recently pushed task, or NULL if empty.
+ */
+ook_task* ookWorkStealingDeque::Pop()
+{
+	long lBottom = _lBottom.load(boost::memory_order_relaxed) - 1;
+	ookWSArray* array = _pArray.load(boost::memory_order_relaxed);
+	_lBottom.store(lBottom, boost::memory_order_relaxed);
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	long lTop = _lTop.load(boost::memory_order_relaxed);
+	
+	ook_task* task = NULL;
+	
+	if(lTop <= lBottom)
+	{
+		task = array->Get(lBottom);
+		
+		if(lTop == lBottom)
+		{
+			//Last element: race the thieves for it
+			if(!_lTop.compare_exchange_strong(lTop, lTop + 1, boost::memory_order_seq_cst, boost::memory_order_relaxed))
+				task = NULL;
+			
+			_lBottom.store(lBottom + 1, boost::memory_order_relaxed);
+		}
+	}
+	else
+		_lBottom.store(lBottom + 1, boost::memory_order_relaxed);
+	
+	return task;
+}
+
+/*! 
+ \brief Takes the oldest task, or NULL. bContended is set when the deque
+ was not empty but another thread won the race, so the caller may want to
+ try this victim again.
+ */
+ook_task* ookWorkStealingDeque::Steal(bool& bContended)
+{
+	bContended = false;
+	
+	long lTop = _lTop.load(boost::memory_order_acquire);
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	long lBottom = _lBottom.load(boost::memory_order_acquire);
+	
+	if(lTop >= lBottom)
+		return NULL;
+	
+	ookWSArray* array = _pArray.load(boost::memory_order_acquire);
+	ook_task* task = array->Get(lTop);
+	
+	if(!_lTop.compare_exchange_strong(lTop, lTop + 1, boost::memory_order_seq_cst, boost::memory_order_relaxed))
+	{
+		bContended = true;
+		return NULL;
+	}
+	
+	return task;
+}
+
+/*! 
+ \brief Approximate when called from a thread other than the owner.
+ */
+long ookWorkStealingDeque::GetSize() const
+{
+	long lSize = _lBottom.load(boost::memory_order_relaxed) - _lTop.load(boost::memory_order_relaxed);
+	
+	return (lSize > 0) ? lSize : 0;
+}
\ No newline at end of file
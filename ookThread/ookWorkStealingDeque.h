@@ -0,0 +1,91 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_WORK_STEALING_DEQUE_H_
+#define OOK_WORK_STEALING_DEQUE_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "boost/atomic.hpp"
+
+//Keeps the owner's and the thieves' hot indices off each other's cache line
+#ifndef OOK_CACHE_LINE_SIZE
+#define OOK_CACHE_LINE_SIZE 64
+#endif
+
+class ookWorkStealingDeque
+{
+public:
+	
+	ookWorkStealingDeque(long lCapacity = 256);
+	virtual ~ookWorkStealingDeque();
+	
+	//Owner thread only
+	void Push(ook_task* task);
+	ook_task* Pop();
+	
+	//Any thread
+	ook_task* Steal(bool& bContended);
+	long GetSize() const;
+	
+protected:
+	
+	struct ookWSArray
+	{
+		ookWSArray(long lCapacity);
+		~ookWSArray();
+		
+		ook_task* Get(long i) const;
+		void Put(long i, ook_task* task);
+		ookWSArray* Grow(long lBottom, long lTop) const;
+		
+		long lCapacity;
+		long lMask;
+		boost::atomic<ook_task*>* slots;
+	};
+	
+private:
+	
+	boost::atomic<long> _lTop;
+	char _pad0[OOK_CACHE_LINE_SIZE - sizeof(boost::atomic<long>)];
+	
+	boost::atomic<long> _lBottom;
+	boost::atomic<ookWSArray*> _pArray;
+	char _pad1[OOK_CACHE_LINE_SIZE];
+	
+	//Arrays replaced by Grow(). A thief may still be reading one, so they
+	//live as long as the deque does.
+	vector<ookWSArray*> _vRetired;
+	
+	ookWorkStealingDeque(const ookWorkStealingDeque&);
+	ookWorkStealingDeque& operator=(const ookWorkStealingDeque&);
+};
+
+#endif
\ No newline at end of file
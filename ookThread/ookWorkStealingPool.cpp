@@ -0,0 +1,353 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*! 
+ \class ookWorkStealingPool
+ \headerfile ookWorkStealingPool.h "ookLibs/ookThread/ookWorkStealingPool.h"
+ \brief Fixed size executor where every worker has its own task deque, so
+ there is no single queue for all the workers to fight over.
+ 
+ A task submitted from a worker thread (a task spawning subtasks) goes on
+ that worker's own deque, and the worker pops its deque LIFO. Submissions
+ from outside the pool go to a shared injection queue. A worker that takes
+ from it moves a batch of tasks onto its own deque. An idle worker steals
+ the oldest task from another worker's deque, starting at a random victim.
+ A worker parks on a condition variable only when nothing is pending
+ anywhere in the pool.
+ 
+ This suits many small, independent tasks, such as decrypting or
+ decompressing one message, especially when tasks fan out into more
+ tasks. Long blocking tasks are better off on an ookThreadPool.
+ */
+#include "ookLibs/ookThread/ookWorkStealingPool.h"
+
+//How many tasks a worker moves from the injection queue to its own deque
+static const long OOK_WS_INJECT_BATCH = 32;
+
+//Failed sweeps over the other workers before a worker thinks about parking
+static const int OOK_WS_SPINS = 64;
+
+//Thread local pointer to the worker running on this thread, if any
+boost::thread_specific_ptr<ookWorkStealingPool::ookWSWorker*> ookWorkStealingPool::s_pCurrentWorker;
+
+ookWorkStealingPool::ookWSWorker::ookWSWorker(ookWorkStealingPool* p, int i)
+	: pool(p), iIndex(i), iRandState(2654435761u * (i + 1)), lSteals(0)
+{
+	
+}
+
+/*! 
+ \brief Constructor. iThreads of 0 means one worker per hardware thread.
+ Every worker applies opts when it starts. With opts.bPinPerCore, worker
+ i is pinned to the i-th available CPU with NUMA local memory.
+ */
+ookWorkStealingPool::ookWorkStealingPool(int iThreads, const ookThreadOptions& opts)
+	: _options(opts), _lInjected(0), _lPending(0), _iSleepers(0), _bShutdown(false)
+{
+	if(iThreads <= 0)
+		iThreads = std::max(1u, boost::thread::hardware_concurrency());
+	
+	//Every worker exists before any of them starts looking for victims
+	for(int i = 0; i < iThreads; i++)
+		_vWorkers.push_back(new ookWSWorker(this, i));
+	
+	for(int i = 0; i < iThreads; i++)
+		_vWorkers[i]->thrd.reset(new boost::thread(&ookWorkStealingPool::WorkerLoop, this, _vWorkers[i]));
+}
+
+ookWorkStealingPool::~ookWorkStealingPool()
+{
+	try
+	{
+		this->Shutdown();
+	}
+	catch (...)
+	{
+	}
+	
+	for(size_t i = 0; i < _vWorkers.size(); i++)
+		delete _vWorkers[i];
+	
+	for(size_t i = 0; i < _injected.size(); i++)
+		delete _injected[i];
+}
+
+/*! 
+ \brief Queues a task. From one of this pool's workers it goes on that
+ worker's deque. From anywhere else it goes on the injection queue, and
+ ookException is thrown once the pool is shut down.
+ */
+void ookWorkStealingPool::Execute(ook_task task)
+{
+	ookWSWorker** ppWorker = s_pCurrentWorker.get();
+	ookWSWorker* worker = ppWorker ? *ppWorker : NULL;
+	
+	if(worker && (worker->pool != this))
+		worker = NULL;
+	
+	if(!worker && _bShutdown.load())
+		throw ookException("ookWorkStealingPool::Execute called after Shutdown");
+	
+	ook_task* pTask = new ook_task(task);
+	
+	//Pending goes up before the task is visible. A worker only parks when
+	//pending is zero, so it can never sleep through this task.
+	_lPending.fetch_add(1);
+	
+	if(worker)
+		worker->deque.Push(pTask);
+	else
+	{
+		boost::mutex::scoped_lock lock(_injectMut);
+		_injected.push_back(pTask);
+		_lInjected.store((long) _injected.size(), boost::memory_order_release);
+	}
+	
+	if(_iSleepers.load() > 0)
+		this->WakeOne();
+}
+
+/*! 
+ \brief Stops taking tasks from outside, lets the workers finish
+ everything that is pending (including tasks those spawn) and joins them.
+ */
+void ookWorkStealingPool::Shutdown()
+{
+	if(_bShutdown.exchange(true))
+		return;
+	
+	{
+		boost::mutex::scoped_lock lock(_parkMut);
+		_parkCond.notify_all();
+	}
+	
+	for(size_t i = 0; i < _vWorkers.size(); i++)
+		if(_vWorkers[i]->thrd && (_vWorkers[i]->thrd->get_id() != boost::this_thread::get_id()))
+			_vWorkers[i]->thrd->join();
+}
+
+int ookWorkStealingPool::GetThreadCount() const
+{
+	return (int) _vWorkers.size();
+}
+
+/*! 
+ \brief Total tasks taken from another worker's deque since the pool
+ started.
+ */
+long ookWorkStealingPool::GetStealCount() const
+{
+	long lSteals = 0;
+	
+	for(size_t i = 0; i < _vWorkers.size(); i++)
+		lSteals += _vWorkers[i]->lSteals.load(boost::memory_order_relaxed);
+	
+	return lSteals;
+}
+
+long ookWorkStealingPool::GetPendingCount() const
+{
+	return _lPending.load(boost::memory_order_relaxed);
+}
+
+void ookWorkStealingPool::WorkerLoop(ookWSWorker* worker)
+{
+	s_pCurrentWorker.reset(new ookWSWorker*(worker));
+	
+	if(!_options.IsEmpty())
+		_options.Apply(worker->iIndex);
+	
+	int iIdleSweeps = 0;
+	
+	for(;;)
+	{
+		ook_task* pTask = this->FindTask(worker);
+		
+		if(pTask)
+		{
+			_lPending.fetch_sub(1);
+			iIdleSweeps = 0;
+			
+			try
+			{
+				(*pTask)();
+			}
+			catch (std::exception& e)
+			{
+				std::cerr << "Something bad happened in ookWorkStealingPool::WorkerLoop: " << e.what() << endl;
+			}
+			catch(...)
+			{
+				std::cerr << "Oh noes! Unknown error in ookWorkStealingPool::WorkerLoop()" << endl;
+			}
+			
+			delete pTask;
+			continue;
+		}
+		
+		if(_lPending.load() == 0)
+		{
+			if(_bShutdown.load())
+				break;
+			
+			if(++iIdleSweeps >= OOK_WS_SPINS)
+			{
+				this->Park();
+				iIdleSweeps = 0;
+			}
+			else
+				boost::this_thread::yield();
+		}
+		else
+		{
+			//Something is queued but another worker beat us to it or is
+			//still publishing it
+			boost::this_thread::yield();
+		}
+	}
+	
+	s_pCurrentWorker.reset();
+}
+
+ook_task* ookWorkStealingPool::FindTask(ookWSWorker* worker)
+{
+	ook_task* pTask = worker->deque.Pop();
+	
+	if(!pTask)
+		pTask = this->TakeInjected(worker);
+	
+	if(!pTask)
+		pTask = this->StealFromOthers(worker);
+	
+	return pTask;
+}
+
+/*
+ Takes a batch off the injection queue: runs the first task and parks the
+ rest on our own deque where the other workers can steal them. That way
+ the shared lock is taken once per batch rather than once per task.
+ */
+ook_task* ookWorkStealingPool::TakeInjected(ookWSWorker* worker)
+{
+	if(_lInjected.load(boost::memory_order_acquire) == 0)
+		return NULL;
+	
+	ook_task* pFirst = NULL;
+	
+	{
+		boost::mutex::scoped_lock lock(_injectMut);
+		
+		if(_injected.empty())
+			return NULL;
+		
+		long lBatch = (long) _injected.size() / (long) _vWorkers.size() + 1;
+		lBatch = std::min(lBatch, OOK_WS_INJECT_BATCH);
+		
+		pFirst = _injected.front();
+		_injected.pop_front();
+		
+		for(long i = 1; (i < lBatch) && !_injected.empty(); i++)
+		{
+			worker->deque.Push(_injected.front());
+			_injected.pop_front();
+		}
+		
+		_lInjected.store((long) _injected.size(), boost::memory_order_release);
+	}
+	
+	if((worker->deque.GetSize() > 0) && (_iSleepers.load() > 0))
+		this->WakeOne();
+	
+	return pFirst;
+}
+
+/*
+ One sweep over the other workers, starting from a random one so thieves
+ spread out instead of all hitting worker 0.
+ */
+ook_task* ookWorkStealingPool::StealFromOthers(ookWSWorker* worker)
+{
+	int iWorkers = (int) _vWorkers.size();
+	
+	if(iWorkers < 2)
+		return NULL;
+	
+	//xorshift32
+	unsigned int x = worker->iRandState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	worker->iRandState = x;
+	
+	int iStart = (int) (x % (unsigned int) iWorkers);
+	
+	for(int i = 0; i < iWorkers; i++)
+	{
+		ookWSWorker* victim = _vWorkers[(iStart + i) % iWorkers];
+		
+		if(victim == worker)
+			continue;
+		
+		bool bContended = true;
+		while(bContended)
+		{
+			ook_task* pTask = victim->deque.Steal(bContended);
+			
+			if(pTask)
+			{
+				worker->lSteals.fetch_add(1, boost::memory_order_relaxed);
+				return pTask;
+			}
+		}
+	}
+	
+	return NULL;
+}
+
+void ookWorkStealingPool::Park()
+{
+	boost::mutex::scoped_lock lock(_parkMut);
+	
+	//Sleepers goes up before we look at pending, and Execute() raises
+	//pending before it looks at sleepers, so one of us always sees the other
+	_iSleepers.fetch_add(1);
+	
+	if((_lPending.load() == 0) && !_bShutdown.load())
+		_parkCond.wait(lock);
+	
+	_iSleepers.fetch_sub(1);
+}
+
+void ookWorkStealingPool::WakeOne()
+{
+	boost::mutex::scoped_lock lock(_parkMut);
+	_parkCond.notify_one();
+}
\ No newline at end of file
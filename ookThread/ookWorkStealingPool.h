@@ -0,0 +1,103 @@
+/*
+ Copyright © 2011, Ted Biggs
+ All rights reserved.
+ http://tbiggs.com
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 
+ - Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ - Neither the name of Ted Biggs, nor the names of his
+ contributors may be used to endorse or promote products
+ derived from this software without specific prior written
+ permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OOK_WORK_STEALING_POOL_H_
+#define OOK_WORK_STEALING_POOL_H_
+
+#include "ookLibs/ookCore/typedefs.h"
+#include "ookLibs/ookThread/ookExecutor.h"
+#include "ookLibs/ookThread/ookWorkStealingDeque.h"
+#include "ookLibs/ookThread/ookThreadOptions.h"
+#include "boost/thread.hpp"
+#include "boost/thread/tss.hpp"
+#include "boost/atomic.hpp"
+
+#include <deque>
+
+class ookWorkStealingPool : public ookExecutor
+{
+public:
+	
+	ookWorkStealingPool(int iThreads = 0, const ookThreadOptions& opts = ookThreadOptions());
+	virtual ~ookWorkStealingPool();
+	
+	virtual void Execute(ook_task task);
+	virtual void Shutdown();
+	
+	int GetThreadCount() const;
+	long GetStealCount() const;
+	long GetPendingCount() const;
+	
+protected:
+	
+	struct ookWSWorker
+	{
+		ookWSWorker(ookWorkStealingPool* pool, int iIndex);
+		
+		ookWorkStealingPool* pool;
+		int iIndex;
+		unsigned int iRandState;
+		ookWorkStealingDeque deque;
+		boost::atomic<long> lSteals;
+		boost::shared_ptr<boost::thread> thrd;
+	};
+	
+	void WorkerLoop(ookWSWorker* worker);
+	ook_task* FindTask(ookWSWorker* worker);
+	ook_task* TakeInjected(ookWSWorker* worker);
+	ook_task* StealFromOthers(ookWSWorker* worker);
+	void Park();
+	void WakeOne();
+	
+private:
+	
+	vector<ookWSWorker*> _vWorkers;
+	ookThreadOptions _options;
+	
+	//Tasks submitted from outside the pool land here until a worker takes them
+	std::deque<ook_task*> _injected;
+	boost::mutex _injectMut;
+	boost::atomic<long> _lInjected;
+	
+	//Queued but not yet started, anywhere in the pool
+	boost::atomic<long> _lPending;
+	
+	boost::atomic<int> _iSleepers;
+	boost::atomic<bool> _bShutdown;
+	boost::mutex _parkMut;
+	boost::condition_variable _parkCond;
+	
+	static boost::thread_specific_ptr<ookWSWorker*> s_pCurrentWorker;
+	
+	ookWorkStealingPool(const ookWorkStealingPool&);
+	ookWorkStealingPool& operator=(const ookWorkStealingPool&);
+};
+
+#endif
\ No newline at end of file
@@ -188,11 +188,8 @@ string ookString::LeftPad(string str, char padchar, int length)
 {
 	if(str.length() > 0)
 	{
-		if(str.length() < length)
-		{
-			for(int i=0; i <= (length - str.length()); i++)
-				str = padchar + str;
-		}
+		while(str.length() < length)
+			str = padchar + str;
 	}
 	
 	return str;
@@ -220,4 +217,27 @@ void ookString::ULongToUChars(ulong longint, uchar* outchars)
 	outchars[2] = (unsigned char)((longint >> 8) & 0XFF);
 	outchars[3] = (unsigned char)((longint & 0XFF));
 
+}
+
+/*! 
+ \brief Writes str to out as a quoted JSON string, escaping quotes,
+ backslashes and control characters.
+ */
+void ookString::WriteJSONString(ostream& out, const string& str)
+{
+	out << '"';
+	
+	for(size_t i = 0; i < str.size(); i++)
+	{
+		unsigned char c = (unsigned char) str[i];
+		
+		if((c == '"') || (c == '\\'))
+			out << '\\' << c;
+		else if(c < 0x20)
+			out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+		else
+			out << c;
+	}
+	
+	out << '"';
 }
\ No newline at end of file
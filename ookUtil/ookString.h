@@ -55,6 +55,8 @@ public:
 	static bool IsBase64(unsigned char c);
 	static ucstring UCBase64Encode(ucstring bytes_to_encode);
 	static ucstring UCBase64Decode(ucstring const& encoded_string);
+	
+	static void WriteJSONString(ostream& out, const string& str);
 
 protected:
 	